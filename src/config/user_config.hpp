@@ -653,6 +653,9 @@ namespace UserConfigParams
     /** True if arena (battle/soccer) ai profiling. */
     PARAM_PREFIX bool m_arena_ai_stats PARAM_DEFAULT(false);
 
+    /** Number of threads used to prepare the AI controller updates. */
+    PARAM_PREFIX int m_ai_threads PARAM_DEFAULT(1);
+
     /** True if slipstream debugging is activated. */
     PARAM_PREFIX bool m_slipstream_debug  PARAM_DEFAULT( false );
 
@@ -720,6 +723,10 @@ namespace UserConfigParams
     PARAM_PREFIX IntUserConfigParam m_server_max_players
         PARAM_DEFAULT(IntUserConfigParam(12, "server_max_players",
         &m_network_group, "Maximum number of players on the server."));
+    PARAM_PREFIX BoolUserConfigParam m_delta_state_compression
+        PARAM_DEFAULT(BoolUserConfigParam(false, "delta-state-compression",
+        &m_network_group, "If set, the server sends each client only the "
+        "difference to the last state that client has acknowledged."));
 
     PARAM_PREFIX StringToUIntUserConfigParam m_server_ban_list
         PARAM_DEFAULT(StringToUIntUserConfigParam("server_ban_list",
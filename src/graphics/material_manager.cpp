@@ -225,6 +225,57 @@ Material* MaterialManager::getDefaultSPMaterial(const std::string& shader_name,
     return m;
 }   // getDefaultSPMaterial
 
+//-----------------------------------------------------------------------------
+/** Returns the ID of a material which is not a default SP material. */
+static std::string getLoadedMaterialID(const Material *m)
+{
+    return "m|" + m->getShaderName() + "|" + m->getTexFname() + "|" +
+           m->getTexFullPath() + "|" + m->getUVTwoTexture();
+}   // getLoadedMaterialID
+
+//-----------------------------------------------------------------------------
+/** Returns a string which identifies a material independent of its address,
+ *  so that references to materials can be stored in cache files, and
+ *  restored with getMaterialFromID.
+ *  \param m The material, which must be managed by this material manager.
+ */
+std::string MaterialManager::getMaterialID(const Material *m) const
+{
+    for (auto &p : m_default_sp_materials)
+    {
+        if (p.second == m)
+        {
+            return "d|" + m->getShaderName() + "|" +
+                   p.first.substr(m->getShaderName().size());
+        }
+    }
+    return getLoadedMaterialID(m);
+}   // getMaterialID
+
+//-----------------------------------------------------------------------------
+/** Returns the material with the given ID (see getMaterialID). Default
+ *  materials are created if necessary, other materials must exist.
+ *  \param id The ID of the material.
+ *  \return The material, or NULL if no material with this ID exists.
+ */
+Material* MaterialManager::getMaterialFromID(const std::string &id)
+{
+    if (id.compare(0, 2, "d|") == 0)
+    {
+        const size_t sep = id.find('|', 2);
+        if (sep == std::string::npos) return NULL;
+        return getDefaultSPMaterial(id.substr(2, sep - 2),
+                                    id.substr(sep + 1));
+    }
+    // Search backward so that temporary (track) textures are found first
+    for (int i = (int)m_materials.size() - 1; i >= 0; i--)
+    {
+        if (getLoadedMaterialID(m_materials[i]) == id)
+            return m_materials[i];
+    }
+    return NULL;
+}   // getMaterialFromID
+
 //-----------------------------------------------------------------------------
 void MaterialManager::setAllUntexturedMaterialFlags(scene::IMeshBuffer *mb)
 {
@@ -84,6 +84,8 @@ public:
     void      unloadAllTextures();
 
     Material* getDefaultSPMaterial(const std::string& shader_name, const std::string& layer_one_lc = "");
+    std::string getMaterialID(const Material *m) const;
+    Material* getMaterialFromID(const std::string &id);
     Material* getLatestMaterial() { return m_materials[m_materials.size()-1]; }
 };   // MaterialManager
 
@@ -32,6 +32,7 @@
 #include "graphics/rtts.hpp"
 #include "graphics/shaders.hpp"
 #include "graphics/sp/sp_dynamic_draw_call.hpp"
+#include "graphics/sp/sp_frustum_culling.hpp"
 #include "graphics/sp/sp_instanced_data.hpp"
 #include "graphics/sp/sp_per_object_uniform.hpp"
 #include "graphics/sp/sp_mesh.hpp"
@@ -101,7 +102,18 @@ std::vector<float> g_bounding_boxes;
 // ----------------------------------------------------------------------------
 std::vector<std::shared_ptr<SPDynamicDrawCall> > g_dy_dc;
 // ----------------------------------------------------------------------------
-float g_frustums[5][24] = { { } };
+SPFrustumCulling g_culling;
+// ----------------------------------------------------------------------------
+/** A mesh buffer added in addObject, culled later in cullObjects. Its box in
+ *  g_culling has the same index. */
+struct CullingEntry
+{
+    SPMeshNode* m_node;
+    unsigned m_mesh_buffer;
+    /** Counts the calls of addObject, to find the mesh buffers of a node. */
+    unsigned m_object;
+};
+std::vector<CullingEntry> g_culling_entries;
 // ----------------------------------------------------------------------------
 unsigned sp_solid_poly_count = 0;
 // ----------------------------------------------------------------------------
@@ -622,65 +634,6 @@ SPShader* getNormalVisualizer()
     return g_normal_visualizer;
 }   // getNormalVisualizer
 
-// ----------------------------------------------------------------------------
-inline void mathPlaneNormf(float *p)
-{
-    float f = 1.0f / sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
-    p[0] *= f;
-    p[1] *= f;
-    p[2] *= f;
-    p[3] *= f;
-}   // mathPlaneNormf
-
-// ----------------------------------------------------------------------------
-inline void mathPlaneFrustumf(float* out, const core::matrix4& pvm)
-{
-    // return 6 planes, 24 floats
-    const float* m = pvm.pointer();
-
-    // near
-    out[0] = m[3] + m[2];
-    out[1] = m[7] + m[6];
-    out[2] = m[11] + m[10];
-    out[3] = m[15] + m[14];
-    mathPlaneNormf(&out[0]);
-
-    // right
-    out[4] = m[3] - m[0];
-    out[4 + 1] = m[7] - m[4];
-    out[4 + 2] = m[11] - m[8];
-    out[4 + 3] = m[15] - m[12];
-    mathPlaneNormf(&out[4]);
-
-    // left
-    out[2 * 4] = m[3] + m[0];
-    out[2 * 4 + 1] = m[7] + m[4];
-    out[2 * 4 + 2] = m[11] + m[8];
-    out[2 * 4 + 3] = m[15] + m[12];
-    mathPlaneNormf(&out[2 * 4]);
-
-    // bottom
-    out[3 * 4] = m[3] + m[1];
-    out[3 * 4 + 1] = m[7] + m[5];
-    out[3 * 4 + 2] = m[11] + m[9];
-    out[3 * 4 + 3] = m[15] + m[13];
-    mathPlaneNormf(&out[3 * 4]);
-
-    // top
-    out[4 * 4] = m[3] - m[1];
-    out[4 * 4 + 1] = m[7] - m[5];
-    out[4 * 4 + 2] = m[11] - m[9];
-    out[4 * 4 + 3] = m[15] - m[13];
-    mathPlaneNormf(&out[4 * 4]);
-
-    // far
-    out[5 * 4] = m[3] - m[2];
-    out[5 * 4 + 1] = m[7] - m[6];
-    out[5 * 4 + 2] = m[11] - m[10];
-    out[5 * 4 + 3] = m[15] - m[14];
-    mathPlaneNormf(&out[5 * 4]);
-}   // mathPlaneFrustumf
-
 // ----------------------------------------------------------------------------
 inline core::vector3df getCorner(const core::aabbox3df& bbox, unsigned n)
 {
@@ -741,20 +694,22 @@ void prepareDrawCalls()
     // 1st one is identity
     g_skinning_offset = 1;
     g_skinning_mesh.clear();
-    mathPlaneFrustumf(g_frustums[0], irr_driver->getProjViewMatrix());
+    g_culling.clear();
+    g_culling_entries.clear();
+    g_culling.setFrustum(0, irr_driver->getProjViewMatrix());
     g_handle_shadow = Track::getCurrentTrack() &&
         Track::getCurrentTrack()->hasShadows() && CVS->isDeferredEnabled() &&
         CVS->isShadowEnabled();
 
     if (g_handle_shadow)
     {
-        mathPlaneFrustumf(g_frustums[1],
+        g_culling.setFrustum(1,
             g_stk_sbr->getShadowMatrices()->getSunOrthoMatrices()[0]);
-        mathPlaneFrustumf(g_frustums[2],
+        g_culling.setFrustum(2,
             g_stk_sbr->getShadowMatrices()->getSunOrthoMatrices()[1]);
-        mathPlaneFrustumf(g_frustums[3],
+        g_culling.setFrustum(3,
             g_stk_sbr->getShadowMatrices()->getSunOrthoMatrices()[2]);
-        mathPlaneFrustumf(g_frustums[4],
+        g_culling.setFrustum(4,
             g_stk_sbr->getShadowMatrices()->getSunOrthoMatrices()[3]);
     }
 
@@ -771,6 +726,8 @@ void prepareDrawCalls()
 }
 
 // ----------------------------------------------------------------------------
+/** Adds the bounding boxes of the mesh buffers of a node for culling. The
+ *  draw calls are created in cullObjects once all nodes are added. */
 void addObject(SPMeshNode* node)
 {
     if (!sp_culling)
@@ -783,8 +740,9 @@ void addObject(SPMeshNode* node)
         return;
     }
 
+    // Identifies the mesh buffers of this node in cullObjects
+    const unsigned object = (unsigned)g_culling_entries.size() + 1;
     const core::matrix4& model_matrix = node->getAbsoluteTransformation();
-    bool added_for_skinning = false;
     for (unsigned m = 0; m < node->getSPM()->getMeshBufferCount(); m++)
     {
         SPMeshBuffer* mb = node->getSPM()->getSPMeshBuffer(m);
@@ -795,39 +753,45 @@ void addObject(SPMeshNode* node)
         }
         core::aabbox3df bb = mb->getBoundingBox();
         model_matrix.transformBoxEx(bb);
-        std::vector<bool> discard;
         const bool handle_shadow = node->isInShadowPass() &&
             g_handle_shadow && shader->hasShader(RP_SHADOW);
-        discard.resize((handle_shadow ? 5 : 1), false);
+        g_culling.addBox(bb, handle_shadow ? 5 : 1);
+        CullingEntry entry = { node, m, object };
+        g_culling_entries.push_back(entry);
+    }
+}   // addObject
 
-        for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
+// ----------------------------------------------------------------------------
+/** Culls all mesh buffers added with addObject at once, and adds the visible
+ *  ones to the draw calls in the order they were added. */
+void cullObjects()
+{
+    if (!sp_culling)
+    {
+        return;
+    }
+
+    g_culling.cull();
+    // The node whose skinning was last handled, and a node which is skipped
+    // because there is not enough space for its joints
+    unsigned skinned_object = 0;
+    unsigned skipped_object = 0;
+    for (unsigned e = 0; e < g_culling_entries.size(); e++)
+    {
+        const CullingEntry& entry = g_culling_entries[e];
+        if (entry.m_object == skipped_object)
         {
-            for (int i = 0; i < 24; i += 4)
-            {
-                bool outside = true;
-                for (int j = 0; j < 8; j++)
-                {
-                    const float dist =
-                        getCorner(bb, j).X * g_frustums[dc_type][i] +
-                        getCorner(bb, j).Y * g_frustums[dc_type][i + 1] +
-                        getCorner(bb, j).Z * g_frustums[dc_type][i + 2] +
-                        g_frustums[dc_type][i + 3];
-                    outside = outside && dist < 0.0f;
-                    if (!outside)
-                    {
-                        break;
-                    }
-                }
-                if (outside)
-                {
-                    discard[dc_type] = true;
-                    break;
-                }
-            }
+            continue;
         }
-        if (handle_shadow ?
-            (discard[0] && discard[1] && discard[2] && discard[3] &&
-            discard[4]) : discard[0])
+        SPMeshNode* node = entry.m_node;
+        const unsigned m = entry.m_mesh_buffer;
+        SPMeshBuffer* mb = node->getSPM()->getSPMeshBuffer(m);
+        SPShader* shader = node->getShader(m);
+        const core::aabbox3df bb = g_culling.getBox(e);
+        const unsigned num_frustums = g_culling.getNumFrustums(e);
+        const bool handle_shadow = num_frustums == 5;
+        const unsigned discard = g_culling.getDiscardMask(e);
+        if (discard == (1u << num_frustums) - 1)
         {
             continue;
         }
@@ -850,16 +814,17 @@ void addObject(SPMeshNode* node)
 
         mb->uploadGLMesh();
         // For first frame only need the vbo to be initialized
-        if (!added_for_skinning && node->getAnimationState())
+        if (skinned_object != entry.m_object && node->getAnimationState())
         {
-            added_for_skinning = true;
+            skinned_object = entry.m_object;
             int skinning_offset = g_skinning_offset + node->getTotalJoints();
             if (skinning_offset > int(stk_config->m_max_skinning_bones))
             {
                 Log::error("SPBase", "No enough space to render skinned"
                     " mesh %s! Max joints can hold: %d",
                     node->getName(), stk_config->m_max_skinning_bones);
-                return;
+                skipped_object = entry.m_object;
+                continue;
             }
             node->setSkinningOffset(g_skinning_offset);
             g_skinning_mesh.push_back(node);
@@ -875,7 +840,7 @@ void addObject(SPMeshNode* node)
 
         for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
         {
-            if (discard[dc_type])
+            if (discard & (1 << dc_type))
             {
                 continue;
             }
@@ -942,7 +907,7 @@ void addObject(SPMeshNode* node)
             g_instances.insert(mb);
         }
     }
-}
+}   // cullObjects
 
 // ----------------------------------------------------------------------------
 void handleDynamicDrawCall()
@@ -965,38 +930,11 @@ void handleDynamicDrawCall()
         SPShader* shader = dydc->getShader();
         core::aabbox3df bb = dydc->getBoundingBox();
         dydc->getAbsoluteTransformation().transformBoxEx(bb);
-        std::vector<bool> discard;
         const bool handle_shadow =
             g_handle_shadow && shader->hasShader(RP_SHADOW);
-        discard.resize((handle_shadow ? 5 : 1), false);
-        for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
-        {
-            for (int i = 0; i < 24; i += 4)
-            {
-                bool outside = true;
-                for (int j = 0; j < 8; j++)
-                {
-                    const float dist =
-                        getCorner(bb, j).X * g_frustums[dc_type][i] +
-                        getCorner(bb, j).Y * g_frustums[dc_type][i + 1] +
-                        getCorner(bb, j).Z * g_frustums[dc_type][i + 2] +
-                        g_frustums[dc_type][i + 3];
-                    outside = outside && dist < 0.0f;
-                    if (!outside)
-                    {
-                        break;
-                    }
-                }
-                if (outside)
-                {
-                    discard[dc_type] = true;
-                    break;
-                }
-            }
-        }
-        if (handle_shadow ?
-            (discard[0] && discard[1] && discard[2] && discard[3] &&
-            discard[4]) : discard[0])
+        const unsigned num_frustums = handle_shadow ? 5 : 1;
+        const unsigned discard = g_culling.cullBox(bb, num_frustums);
+        if (discard == (1u << num_frustums) - 1)
         {
             continue;
         }
@@ -1019,7 +957,7 @@ void handleDynamicDrawCall()
 
         for (int dc_type = 0; dc_type < (handle_shadow ? 5 : 1); dc_type++)
         {
-            if (discard[dc_type])
+            if (discard & (1 << dc_type))
             {
                 continue;
             }
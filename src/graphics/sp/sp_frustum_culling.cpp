@@ -0,0 +1,534 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/sp/sp_frustum_culling.hpp"
+#include "utils/log.hpp"
+#include "utils/random_generator.hpp"
+#include "utils/time.hpp"
+#include "utils/worker_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if __AVX__
+ #include <immintrin.h>
+ #define SIMD_AVX_SUPPORT (1)
+#elif __SSE2__ || _M_X64 || _M_IX86_FP >= 2
+ #include <emmintrin.h>
+ #define SIMD_SSE2_SUPPORT (1)
+#endif
+
+namespace SP
+{
+WorkerPool *SPFrustumCulling::m_worker_pool = NULL;
+
+// ----------------------------------------------------------------------------
+SPFrustumCulling::SPFrustumCulling()
+{
+    for (unsigned int i = 0; i < MAX_FRUSTUMS; i++)
+    {
+        for (unsigned int j = 0; j < 24; j++)
+            m_frustums[i][j] = 0.0f;
+    }
+    m_num_boxes = 0;
+}   // SPFrustumCulling
+
+// ----------------------------------------------------------------------------
+/** Sets the n-th frustum from a projection-view matrix. Frustum 0 is the
+ *  camera, 1 to 4 are the shadow cascades.
+ */
+void SPFrustumCulling::setFrustum(unsigned int n, const core::matrix4 &pvm)
+{
+    assert(n < MAX_FRUSTUMS);
+    float *out = m_frustums[n];
+    const float* m = pvm.pointer();
+    // Near, right, left, bottom, top and far plane
+    const int column[6] = { 2, 0, 0, 1, 1, 2 };
+    const float sign[6] = { 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f };
+    for (int i = 0; i < 6; i++)
+    {
+        float *p = &out[i * 4];
+        for (int j = 0; j < 4; j++)
+        {
+            p[j] = sign[i] > 0.0f ? m[j * 4 + 3] + m[j * 4 + column[i]]
+                                  : m[j * 4 + 3] - m[j * 4 + column[i]];
+        }
+        const float f = 1.0f / sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        p[0] *= f;
+        p[1] *= f;
+        p[2] *= f;
+        p[3] *= f;
+    }
+}   // setFrustum
+
+// ----------------------------------------------------------------------------
+/** Removes all boxes. The memory is kept, so that it can be reused in the
+ *  next frame. */
+void SPFrustumCulling::clear()
+{
+    m_min_x.clear(); m_min_y.clear(); m_min_z.clear();
+    m_max_x.clear(); m_max_y.clear(); m_max_z.clear();
+    m_num_frustums.clear();
+    m_discard.clear();
+    m_num_boxes = 0;
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Adds a box to be culled with the next call of cull().
+ *  \param bb The box in world coordinates.
+ *  \param num_frustums Test the box against the frustums 0 to
+ *         num_frustums-1.
+ *  \return The index of the box.
+ */
+unsigned int SPFrustumCulling::addBox(const core::aabbox3df &bb,
+                                      unsigned int num_frustums)
+{
+    assert(num_frustums <= MAX_FRUSTUMS);
+    // Remove the padding of a previous cull()
+    if (m_min_x.size() > m_num_boxes)
+    {
+        m_min_x.resize(m_num_boxes); m_min_y.resize(m_num_boxes);
+        m_min_z.resize(m_num_boxes); m_max_x.resize(m_num_boxes);
+        m_max_y.resize(m_num_boxes); m_max_z.resize(m_num_boxes);
+        m_num_frustums.resize(m_num_boxes);
+    }
+    m_min_x.push_back(bb.MinEdge.X);
+    m_min_y.push_back(bb.MinEdge.Y);
+    m_min_z.push_back(bb.MinEdge.Z);
+    m_max_x.push_back(bb.MaxEdge.X);
+    m_max_y.push_back(bb.MaxEdge.Y);
+    m_max_z.push_back(bb.MaxEdge.Z);
+    m_num_frustums.push_back((uint8_t)num_frustums);
+    return m_num_boxes++;
+}   // addBox
+
+// ----------------------------------------------------------------------------
+/** Tests all boxes against their frustums. The result can be queried with
+ *  getDiscardMask.
+ */
+void SPFrustumCulling::cull()
+{
+    // Pad the arrays so that the SIMD code can always process full groups
+    // of boxes. Padded boxes are tested against no frustum.
+    const unsigned int padded = (m_num_boxes + 7) & ~7u;
+    m_min_x.resize(padded, 0.0f); m_min_y.resize(padded, 0.0f);
+    m_min_z.resize(padded, 0.0f); m_max_x.resize(padded, 0.0f);
+    m_max_y.resize(padded, 0.0f); m_max_z.resize(padded, 0.0f);
+    m_num_frustums.resize(padded, 0);
+    m_discard.clear();
+    m_discard.resize(padded, 0);
+
+    const unsigned int chunk = 1024;
+    const unsigned int num_chunks = (padded + chunk - 1) / chunk;
+    if (m_worker_pool && num_chunks > 1)
+    {
+        m_worker_pool->run(num_chunks, [this, padded](unsigned int n)
+            {
+                cullRange(n * chunk, std::min(padded, (n + 1) * chunk));
+            });
+    }
+    else
+        cullRange(0, padded);
+}   // cull
+
+// ----------------------------------------------------------------------------
+/** Returns a mask with bit k set if box i+k (k < 8) is outside of a frustum.
+ *  \param x, y, z For each plane the coordinates of the corners of all boxes
+ *         that are furthest in the direction of the plane normal.
+ *  \param p The 6 planes of the frustum.
+ */
+inline unsigned int outsideMask(const float* const* x, const float* const* y,
+                                const float* const* z, const float* p,
+                                unsigned int i)
+{
+#if SIMD_AVX_SUPPORT
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 outside = zero;
+    for (int j = 0; j < 6; j++)
+    {
+        // Same order of operations as the scalar code
+        __m256 dist = _mm256_mul_ps(_mm256_loadu_ps(x[j] + i),
+                                    _mm256_set1_ps(p[j * 4]));
+        dist = _mm256_add_ps(dist,
+            _mm256_mul_ps(_mm256_loadu_ps(y[j] + i),
+                          _mm256_set1_ps(p[j * 4 + 1])));
+        dist = _mm256_add_ps(dist,
+            _mm256_mul_ps(_mm256_loadu_ps(z[j] + i),
+                          _mm256_set1_ps(p[j * 4 + 2])));
+        dist = _mm256_add_ps(dist, _mm256_set1_ps(p[j * 4 + 3]));
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(dist, zero, _CMP_LT_OQ));
+    }
+    return (unsigned int)_mm256_movemask_ps(outside);
+#elif SIMD_SSE2_SUPPORT
+    const __m128 zero = _mm_setzero_ps();
+    __m128 outside[2] = { zero, zero };
+    for (int j = 0; j < 6; j++)
+    {
+        const __m128 a = _mm_set1_ps(p[j * 4]);
+        const __m128 b = _mm_set1_ps(p[j * 4 + 1]);
+        const __m128 c = _mm_set1_ps(p[j * 4 + 2]);
+        const __m128 d = _mm_set1_ps(p[j * 4 + 3]);
+        for (int k = 0; k < 2; k++)
+        {
+            // Same order of operations as the scalar code
+            const unsigned int n = i + k * 4;
+            __m128 dist = _mm_mul_ps(_mm_loadu_ps(x[j] + n), a);
+            dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(y[j] + n), b));
+            dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(z[j] + n), c));
+            dist = _mm_add_ps(dist, d);
+            outside[k] = _mm_or_ps(outside[k], _mm_cmplt_ps(dist, zero));
+        }
+    }
+    return (unsigned int)(_mm_movemask_ps(outside[0]) |
+                          (_mm_movemask_ps(outside[1]) << 4));
+#else
+    unsigned int mask = 0;
+    for (unsigned int k = 0; k < 8; k++)
+    {
+        const unsigned int n = i + k;
+        for (int j = 0; j < 6; j++)
+        {
+            if (x[j][n] * p[j * 4] + y[j][n] * p[j * 4 + 1] +
+                z[j][n] * p[j * 4 + 2] + p[j * 4 + 3] < 0.0f)
+            {
+                mask |= 1 << k;
+                break;
+            }
+        }
+    }
+    return mask;
+#endif
+}   // outsideMask
+
+// ----------------------------------------------------------------------------
+/** Culls the boxes first to last-1. first and last must be multiples of 8. */
+void SPFrustumCulling::cullRange(unsigned int first, unsigned int last)
+{
+    // For each plane select the corners that are furthest in the direction
+    // of the plane normal
+    const float *x[MAX_FRUSTUMS][6], *y[MAX_FRUSTUMS][6], *z[MAX_FRUSTUMS][6];
+    for (unsigned int f = 0; f < MAX_FRUSTUMS; f++)
+    {
+        const float *p = m_frustums[f];
+        for (int j = 0; j < 6; j++)
+        {
+            x[f][j] = p[j * 4    ] > 0.0f ? m_max_x.data() : m_min_x.data();
+            y[f][j] = p[j * 4 + 1] > 0.0f ? m_max_y.data() : m_min_y.data();
+            z[f][j] = p[j * 4 + 2] > 0.0f ? m_max_z.data() : m_min_z.data();
+        }
+    }
+
+    const uint8_t *num_frustums = m_num_frustums.data();
+    uint8_t *discard = m_discard.data();
+    for (unsigned int i = first; i < last; i += 8)
+    {
+        // Only test the shadow frustums if a box in this group needs them
+        unsigned int n = 0;
+        for (unsigned int k = 0; k < 8; k++)
+            n = std::max(n, (unsigned int)num_frustums[i + k]);
+        for (unsigned int f = 0; f < n; f++)
+        {
+            const unsigned int mask = outsideMask(x[f], y[f], z[f],
+                                                  m_frustums[f], i);
+            for (unsigned int k = 0; k < 8; k++)
+                discard[i + k] |= (uint8_t)(((mask >> k) & 1) << f);
+        }
+        // Only report the frustums a box was actually tested against
+        for (unsigned int k = 0; k < 8; k++)
+            discard[i + k] &= (uint8_t)((1 << num_frustums[i + k]) - 1);
+    }
+}   // cullRange
+
+// ----------------------------------------------------------------------------
+/** Tests a single box without adding it, e.g. for dynamic draw calls.
+ *  \param bb The box in world coordinates.
+ *  \param num_frustums Test the box against the frustums 0 to
+ *         num_frustums-1.
+ *  \return Bit i is set if the box is outside of frustum i.
+ */
+unsigned int SPFrustumCulling::cullBox(const core::aabbox3df &bb,
+                                       unsigned int num_frustums) const
+{
+    unsigned int discard = 0;
+    for (unsigned int f = 0; f < num_frustums; f++)
+    {
+        const float *p = m_frustums[f];
+        for (int j = 0; j < 24; j += 4)
+        {
+            const float x = p[j    ] > 0.0f ? bb.MaxEdge.X : bb.MinEdge.X;
+            const float y = p[j + 1] > 0.0f ? bb.MaxEdge.Y : bb.MinEdge.Y;
+            const float z = p[j + 2] > 0.0f ? bb.MaxEdge.Z : bb.MinEdge.Z;
+            if (x * p[j] + y * p[j + 1] + z * p[j + 2] + p[j + 3] < 0.0f)
+            {
+                discard |= 1 << f;
+                break;
+            }
+        }
+    }
+    return discard;
+}   // cullBox
+
+// ----------------------------------------------------------------------------
+/** Sets the number of threads used by cull(). With 1 thread (the default)
+ *  the boxes are culled by the calling thread only. */
+void SPFrustumCulling::setNumThreads(unsigned int n)
+{
+    delete m_worker_pool;
+    m_worker_pool = n > 1 ? new WorkerPool(n) : NULL;
+}   // setNumThreads
+
+// ----------------------------------------------------------------------------
+/** Stops the threads used by cull(), called when STK shuts down. */
+void SPFrustumCulling::destroy()
+{
+    delete m_worker_pool;
+    m_worker_pool = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+/** The previous implementation of culling a box: tests if all 8 corners of
+ *  the box are outside of a plane. Used to check the results of cullBox and
+ *  cull.
+ *  eturn Bit i is set if the box is outside of frustum i.
+ */
+unsigned int SPFrustumCulling::cullCorners(const core::aabbox3df &bb,
+                                           unsigned int num_frustums) const
+{
+    core::vector3df corners[8];
+    bb.getEdges(corners);
+    unsigned int discard = 0;
+    for (unsigned int f = 0; f < num_frustums; f++)
+    {
+        const float *p = m_frustums[f];
+        for (int i = 0; i < 24; i += 4)
+        {
+            bool outside = true;
+            for (int j = 0; j < 8 && outside; j++)
+            {
+                outside = corners[j].X * p[i] + corners[j].Y * p[i + 1]
+                        + corners[j].Z * p[i + 2] + p[i + 3] < 0.0f;
+            }
+            if (outside)
+            {
+                discard |= 1 << f;
+                break;
+            }
+        }
+    }
+    return discard;
+}   // cullCorners
+
+// ----------------------------------------------------------------------------
+/** Sets the frustums of a camera looking over a large flat scene, and of 4
+ *  shadow cascades of increasing size. */
+void SPFrustumCulling::setTestFrustums()
+{
+    core::matrix4 projection, view;
+    projection.buildProjectionMatrixPerspectiveFovLH(1.0f, 16.0f / 9.0f,
+                                                     1.0f, 1000.0f);
+    view.buildCameraLookAtMatrixLH(core::vector3df(0, 10, 0),
+                                   core::vector3df(100, 0, 100),
+                                   core::vector3df(0, 1, 0));
+    setFrustum(0, projection * view);
+    for (unsigned int i = 1; i < MAX_FRUSTUMS; i++)
+    {
+        const float size = 20.0f * powf(4.0f, (float)(i - 1));
+        projection.buildProjectionMatrixOrthoLH(size, size, -500.0f, 500.0f);
+        view.buildCameraLookAtMatrixLH(core::vector3df(50, 50, 30),
+                                       core::vector3df(50, 0, 50),
+                                       core::vector3df(0, 1, 0));
+        setFrustum(i, projection * view);
+    }
+}   // setTestFrustums
+
+// ----------------------------------------------------------------------------
+/** Checks that cullBox and cull() give the same results as testing all
+ *  corners of each box, for boxes tested against 1 or all frustums, with
+ *  a number of boxes that needs padding, with boxes added after a previous
+ *  cull(), and with several threads.
+ */
+void SPFrustumCulling::unitTesting()
+{
+    SPFrustumCulling culling;
+    culling.setTestFrustums();
+
+    // A small fixed scene: boxes inside, outside and across the frustums
+    std::vector<core::aabbox3df> boxes;
+    std::vector<unsigned int> num_frustums;
+    for (int x = -4; x <= 12; x++)
+    {
+        for (int z = -4; z <= 12; z++)
+        {
+            const core::vector3df center(x * 15.0f, (x + z) % 3 * 4.0f - 2.0f,
+                                         z * 15.0f);
+            const float size = 0.5f + ((x * 7 + z * 3) & 7) * 1.5f;
+            const core::vector3df half(size, size * 0.5f, size);
+            boxes.push_back(core::aabbox3df(center - half, center + half));
+            num_frustums.push_back((x + z) % 2 == 0 ? MAX_FRUSTUMS : 1);
+        }
+    }
+    // 289 boxes, so cull() must pad the arrays
+    assert(boxes.size() % 8 != 0);
+
+    std::vector<unsigned int> expected(boxes.size());
+    unsigned int num_visible = 0, num_culled = 0;
+    for (unsigned int b = 0; b < boxes.size(); b++)
+    {
+        expected[b] = culling.cullCorners(boxes[b], num_frustums[b]);
+        assert(culling.cullBox(boxes[b], num_frustums[b]) == expected[b]);
+        assert(expected[b] < (1u << num_frustums[b]));
+        if (expected[b] & 1)
+            num_culled++;
+        else
+            num_visible++;
+    }
+    // Otherwise the scene would not test anything
+    assert(num_visible > 0 && num_culled > 0);
+
+    // Add the first half, cull, then add the rest: the padding of the
+    // first cull() must be removed
+    const unsigned int half = (unsigned int)boxes.size() / 2 + 3;
+    for (unsigned int b = 0; b < half; b++)
+        assert(culling.addBox(boxes[b], num_frustums[b]) == b);
+    culling.cull();
+    for (unsigned int b = 0; b < half; b++)
+        assert(culling.getDiscardMask(b) == expected[b]);
+    for (unsigned int b = half; b < boxes.size(); b++)
+        assert(culling.addBox(boxes[b], num_frustums[b]) == b);
+    culling.cull();
+    assert(culling.getNumBoxes() == boxes.size());
+    for (unsigned int b = 0; b < boxes.size(); b++)
+    {
+        assert(culling.getNumFrustums(b) == num_frustums[b]);
+        assert(culling.getDiscardMask(b) == expected[b]);
+    }
+
+    // Enough boxes for several chunks, culled by two threads
+    WorkerPool *saved_pool = m_worker_pool;
+    WorkerPool pool(2);
+    m_worker_pool = &pool;
+    culling.clear();
+    const unsigned int repeat = 10;
+    for (unsigned int r = 0; r < repeat; r++)
+    {
+        for (unsigned int b = 0; b < boxes.size(); b++)
+            culling.addBox(boxes[b], num_frustums[b]);
+    }
+    culling.cull();
+    m_worker_pool = saved_pool;
+    for (unsigned int i = 0; i < culling.getNumBoxes(); i++)
+        assert(culling.getDiscardMask(i) == expected[i % boxes.size()]);
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Culls a synthetic scene with the previous test of all 8 corners of each
+ *  box, with cullBox and with cull(), checks that the results are identical
+ *  and prints the times. It does not need a GPU.
+ */
+void SPFrustumCulling::runBenchmark()
+{
+    const unsigned int num_boxes  = 20000;
+    const unsigned int num_frames = 100;
+
+    SPFrustumCulling culling;
+    culling.setTestFrustums();
+
+    RandomGenerator random;
+    std::vector<core::aabbox3df> boxes;
+    std::vector<unsigned int> num_frustums;
+    for (unsigned int i = 0; i < num_boxes; i++)
+    {
+        const core::vector3df center(random.get(1000) - 500.0f,
+                                     random.get(100)  - 20.0f,
+                                     random.get(1000) - 500.0f);
+        const core::vector3df half(0.25f + random.get(100) * 0.1f,
+                                   0.25f + random.get(100) * 0.1f,
+                                   0.25f + random.get(100) * 0.1f);
+        boxes.push_back(core::aabbox3df(center - half, center + half));
+        num_frustums.push_back(random.get(10) < 8 ? MAX_FRUSTUMS : 1);
+    }
+
+    // 1) The previous implementation: all corners of each box
+    std::vector<unsigned int> expected(num_boxes, 0);
+    double start = StkTime::getRealTime();
+    for (unsigned int frame = 0; frame < num_frames; frame++)
+    {
+        for (unsigned int b = 0; b < num_boxes; b++)
+            expected[b] = culling.cullCorners(boxes[b], num_frustums[b]);
+    }
+    const double time_corners = StkTime::getRealTime() - start;
+
+    // 2) One box at a time with cullBox
+    unsigned int errors = 0;
+    start = StkTime::getRealTime();
+    for (unsigned int frame = 0; frame < num_frames; frame++)
+    {
+        for (unsigned int b = 0; b < num_boxes; b++)
+        {
+            if (culling.cullBox(boxes[b], num_frustums[b]) != expected[b])
+                errors++;
+        }
+    }
+    const double time_box = StkTime::getRealTime() - start;
+
+    // 3) All boxes in one batch, adding them and culling timed separately
+    double time_add = 0.0, time_batch = 0.0;
+    for (unsigned int frame = 0; frame < num_frames; frame++)
+    {
+        start = StkTime::getRealTime();
+        culling.clear();
+        for (unsigned int b = 0; b < num_boxes; b++)
+            culling.addBox(boxes[b], num_frustums[b]);
+        const double added = StkTime::getRealTime();
+        culling.cull();
+        time_add   += added - start;
+        time_batch += StkTime::getRealTime() - added;
+    }
+    unsigned int visible = 0;
+    for (unsigned int b = 0; b < num_boxes; b++)
+    {
+        if (culling.getDiscardMask(b) != expected[b])
+            errors++;
+        if ((expected[b] & 1) == 0)
+            visible++;
+    }
+
+#if SIMD_AVX_SUPPORT
+    const char *simd = "AVX";
+#elif SIMD_SSE2_SUPPORT
+    const char *simd = "SSE2";
+#else
+    const char *simd = "none";
+#endif
+    Log::info("SPFrustumCulling", "%u boxes, %u visible, SIMD: %s, "
+              "threads: %u.", num_boxes, visible, simd,
+              m_worker_pool ? m_worker_pool->getNumThreads() : 1);
+    Log::info("SPFrustumCulling", "%-8s %10s", "method", "ns/box");
+    Log::info("SPFrustumCulling", "%-8s %10.2f", "corners",
+              time_corners * 1.0e9 / (num_boxes * num_frames));
+    Log::info("SPFrustumCulling", "%-8s %10.2f", "box",
+              time_box * 1.0e9 / (num_boxes * num_frames));
+    Log::info("SPFrustumCulling", "%-8s %10.2f", "add",
+              time_add * 1.0e9 / (num_boxes * num_frames));
+    Log::info("SPFrustumCulling", "%-8s %10.2f", "batch",
+              time_batch * 1.0e9 / (num_boxes * num_frames));
+    if (errors > 0)
+        Log::error("SPFrustumCulling", "%u results differ.", errors);
+}   // runBenchmark
+
+}
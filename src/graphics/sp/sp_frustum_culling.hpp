@@ -0,0 +1,122 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SP_FRUSTUM_CULLING_HPP
+#define HEADER_SP_FRUSTUM_CULLING_HPP
+
+#include "utils/no_copy.hpp"
+
+#include "aabbox3d.h"
+#include "matrix4.h"
+
+#include <stdint.h>
+#include <vector>
+
+using namespace irr;
+
+class WorkerPool;
+
+namespace SP
+{
+
+/** \brief Tests many bounding boxes against the camera frustum and the
+ *  shadow cascade frustums in one batch.
+ *  The boxes are stored as structure of arrays, so that cull() can test
+ *  several boxes at once with SSE or AVX (or one box at a time if neither
+ *  is available). For each plane only the corner of a box that is furthest
+ *  in the direction of the plane normal is tested: since float
+ *  multiplication and addition are monotonic, the computed distance of this
+ *  corner is the largest of all corners, so the result is identical to
+ *  testing all 8 corners. This class does not use OpenGL, so it can be
+ *  tested without a GPU.
+ */
+class SPFrustumCulling : public NoCopy
+{
+public:
+    /** Maximum number of frustums: the camera and 4 shadow cascades. */
+    static const unsigned int MAX_FRUSTUMS = 5;
+
+private:
+    /** The 6 planes of each frustum (a, b, c, d of a*x+b*y+c*z+d). */
+    float m_frustums[MAX_FRUSTUMS][24];
+
+    /** The corners of the boxes. */
+    std::vector<float> m_min_x, m_min_y, m_min_z;
+    std::vector<float> m_max_x, m_max_y, m_max_z;
+
+    /** Number of frustums each box is tested against. */
+    std::vector<uint8_t> m_num_frustums;
+
+    /** The result for each box: bit i is set if the box is outside of
+     *  frustum i. */
+    std::vector<uint8_t> m_discard;
+
+    /** Number of boxes (the arrays are padded for SIMD). */
+    unsigned int m_num_boxes;
+
+    /** If not NULL the boxes are culled by several threads. */
+    static WorkerPool *m_worker_pool;
+
+    void cullRange(unsigned int first, unsigned int last);
+    unsigned int cullCorners(const core::aabbox3df &bb,
+                             unsigned int num_frustums) const;
+    void setTestFrustums();
+
+public:
+    SPFrustumCulling();
+    // ------------------------------------------------------------------------
+    void setFrustum(unsigned int n, const core::matrix4 &pvm);
+    // ------------------------------------------------------------------------
+    void clear();
+    // ------------------------------------------------------------------------
+    unsigned int addBox(const core::aabbox3df &bb, unsigned int num_frustums);
+    // ------------------------------------------------------------------------
+    void cull();
+    // ------------------------------------------------------------------------
+    unsigned int cullBox(const core::aabbox3df &bb,
+                         unsigned int num_frustums) const;
+    // ------------------------------------------------------------------------
+    /** Returns the result of cull() for the n-th box: bit i is set if the
+     *  box is outside of frustum i. */
+    unsigned int getDiscardMask(unsigned int n) const { return m_discard[n]; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of frustums the n-th box is tested against. */
+    unsigned int getNumFrustums(unsigned int n) const
+                                               { return m_num_frustums[n]; }
+    // ------------------------------------------------------------------------
+    /** Returns the n-th box. */
+    core::aabbox3df getBox(unsigned int n) const
+    {
+        return core::aabbox3df(m_min_x[n], m_min_y[n], m_min_z[n],
+                               m_max_x[n], m_max_y[n], m_max_z[n]);
+    }   // getBox
+    // ------------------------------------------------------------------------
+    /** Returns the number of boxes. */
+    unsigned int getNumBoxes() const { return m_num_boxes; }
+    // ------------------------------------------------------------------------
+    static void setNumThreads(unsigned int n);
+    // ------------------------------------------------------------------------
+    static void destroy();
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    static void runBenchmark();
+};   // SPFrustumCulling
+
+}
+
+#endif
@@ -528,6 +528,50 @@ void SPShaderManager::loadSPShaders(const std::string& directory_name)
     m_shader_directory = "";
 }   // loadSPShaders
 
+// ----------------------------------------------------------------------------
+/** Reads the use-alpha-channel setting of all shaders in a directory from
+ *  the shader files, without building the shaders. This is used by the
+ *  texture cooker, which runs without OpenGL. As in loadEachShader a shader
+ *  which already exists in result is not replaced.
+ *  \param directory_name The directory with the shader files.
+ *  \param result The settings are added to this map, indexed by shader
+ *         name.
+ */
+void SPShaderManager::readAlphaChannelInfo(const std::string& directory_name,
+                                           std::map<std::string, bool>* result)
+{
+    std::string dir = directory_name;
+    if (!dir.empty() && dir.back() != '/')
+    {
+        dir += "/";
+    }
+    std::set<std::string> shaders;
+    file_manager->listFiles(shaders, dir);
+    for (const std::string& file_name : shaders)
+    {
+        if (file_name.find("sps") == std::string::npos ||
+            file_name.find(".xml") == std::string::npos)
+        {
+            continue;
+        }
+        std::unique_ptr<XMLNode> xml(file_manager->createXMLTree
+            (dir + file_name));
+        if (!xml || xml->getName() != "spshader")
+        {
+            continue;
+        }
+        const XMLNode* shader_info = xml->getNode("shader-info");
+        std::string name;
+        if (!shader_info || !shader_info->get("name", &name) || name.empty())
+        {
+            continue;
+        }
+        bool use_alpha_channel = false;
+        shader_info->get("use-alpha-channel", &use_alpha_channel);
+        result->insert(std::make_pair(name, use_alpha_channel));
+    }
+}   // readAlphaChannelInfo
+
 // ----------------------------------------------------------------------------
 void SPShaderManager::unloadAll()
 {
@@ -20,6 +20,7 @@
 
 #include <array>
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <typeinfo>
@@ -146,6 +147,9 @@ public:
     // ------------------------------------------------------------------------
     void loadSPShaders(const std::string& directory_name);
     // ------------------------------------------------------------------------
+    static void readAlphaChannelInfo(const std::string& directory_name,
+                                     std::map<std::string, bool>* result);
+    // ------------------------------------------------------------------------
     void addSPShader(const std::string& name,
                      std::shared_ptr<SPShader> shader)
     {
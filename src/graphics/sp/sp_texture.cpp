@@ -26,8 +26,15 @@
 #include "graphics/central_settings.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material.hpp"
+#include "graphics/material_manager.hpp"
+#include "karts/kart_properties.hpp"
+#include "karts/kart_properties_manager.hpp"
+#include "tracks/track.hpp"
+#include "tracks/track_manager.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+#include "utils/worker_pool.hpp"
 
 #if !(defined(SERVER_ONLY) || defined(USE_GLES2))
 #include <squish.h>
@@ -44,10 +51,13 @@ extern "C"
 }
 #endif
 
+#include <map>
 #include <numeric>
+#include <set>
+#include <thread>
 
 #if !defined(USE_GLES2)
-static const uint8_t CACHE_VERSION = 1;
+static const uint8_t CACHE_VERSION = 3;
 #endif
 
 namespace SP
@@ -68,23 +78,47 @@ SPTexture::SPTexture(const std::string& path, Material* m, bool undo_srgb,
         return;
     }
 
-    std::string cache_subdir = "hd/";
-    if ((UserConfigParams::m_high_definition_textures & 0x01) == 0x01)
-    {
-        cache_subdir = "hd/";
-    }
-    else
-    {
-        cache_subdir = StringUtils::insertValues("resized_%i/",
-            (int)UserConfigParams::m_max_texture_size);
-    }
-    m_cache_directory = file_manager->getCachedTexturesDir() +
-        cache_subdir + container_id;
+    m_cache_directory = getCacheDirectory(container_id);
     file_manager->checkAndCreateDirectoryP(m_cache_directory);
 
 #endif
 }   // SPTexture
 
+// ----------------------------------------------------------------------------
+/** Creates a texture which is only compressed into the texture cache by
+ *  cookTextures, it does not use OpenGL.
+ *  \param alpha_channel_shader If the shader of the material uses the alpha
+ *         channel, read from the shader files by the cooker.
+ */
+SPTexture::SPTexture(const std::string& path, Material* m,
+                     const std::string& container_id,
+                     bool alpha_channel_shader)
+         : m_path(path), m_width(0), m_height(0), m_material(m),
+           m_undo_srgb(false)
+{
+    m_alpha_channel_shader = alpha_channel_shader ? 1 : 0;
+    m_cache_directory = getCacheDirectory(container_id);
+    file_manager->checkAndCreateDirectoryP(m_cache_directory);
+}   // SPTexture
+
+// ----------------------------------------------------------------------------
+/** Returns true if the shader of the material uses the alpha channel, in
+ *  which case no colorization mask is applied. */
+bool SPTexture::useAlphaChannelShader() const
+{
+#ifndef SERVER_ONLY
+    if (m_alpha_channel_shader >= 0)
+    {
+        return m_alpha_channel_shader == 1;
+    }
+    std::shared_ptr<SPShader> sps =
+        SPShaderManager::get()->getSPShader(m_material->getShaderName());
+    return sps && sps->useAlphaChannel();
+#else
+    return false;
+#endif
+}   // useAlphaChannelShader
+
 // ----------------------------------------------------------------------------
 SPTexture::SPTexture(bool white)
          : m_width(0), m_height(0), m_undo_srgb(false)
@@ -102,6 +136,24 @@ SPTexture::SPTexture(bool white)
 #endif
 }   // SPTexture
 
+// ----------------------------------------------------------------------------
+/** Returns the directory of the compressed textures of a container, which
+ *  depends on the maximum texture size. */
+std::string SPTexture::getCacheDirectory(const std::string& container_id)
+{
+    std::string cache_subdir = "hd/";
+    if ((UserConfigParams::m_high_definition_textures & 0x01) == 0x01)
+    {
+        cache_subdir = "hd/";
+    }
+    else
+    {
+        cache_subdir = StringUtils::insertValues("resized_%i/",
+            (int)UserConfigParams::m_max_texture_size);
+    }
+    return file_manager->getCachedTexturesDir() + cache_subdir + container_id;
+}   // getCacheDirectory
+
 // ----------------------------------------------------------------------------
 SPTexture::~SPTexture()
 {
@@ -188,11 +240,11 @@ std::shared_ptr<video::IImage> SPTexture::getTextureImage() const
     }
 
     uint8_t* data = (uint8_t*)image->lock();
+    // The cache directory is only set if texture compression is enabled
+    const bool use_tex_compress = !m_cache_directory.empty();
     for (unsigned int i = 0; i < image->getDimension().Width *
         image->getDimension().Height; i++)
     {
-        const bool use_tex_compress = CVS->isTextureCompressionEnabled() &&
-            !m_cache_directory.empty();
 #ifndef USE_GLES2
         if (use_tex_compress)
         {
@@ -317,7 +369,8 @@ bool SPTexture::texImage2d(std::shared_ptr<video::IImage> texture,
 bool SPTexture::saveCompressedTexture(std::shared_ptr<video::IImage> texture,
                                       const std::vector<std::pair
                                       <core::dimension2du, unsigned> >& sizes,
-                                      const std::string& cache_location)
+                                      const std::string& cache_location,
+                                      uint64_t file_key, uint64_t hash)
 {
 #if !(defined(SERVER_ONLY) || defined(USE_GLES2))
     const unsigned total_size = std::accumulate(sizes.begin(), sizes.end(), 0,
@@ -331,6 +384,8 @@ bool SPTexture::saveCompressedTexture(std::shared_ptr<video::IImage> texture,
         return true;
     }
     file->write(&CACHE_VERSION, 1);
+    file->write(&file_key, 8);
+    file->write(&hash, 8);
     const unsigned mm_sizes = (unsigned)sizes.size();
     file->write(&mm_sizes, 4);
     for (auto& p : sizes)
@@ -346,35 +401,156 @@ bool SPTexture::saveCompressedTexture(std::shared_ptr<video::IImage> texture,
 }   // saveCompressedTexture
 
 // ----------------------------------------------------------------------------
+/** Updates a hash with the size and content of a file. A missing file is
+ *  treated like an empty file.
+ *  \param file_content If false only the size and modification time of the
+ *         file are used, which does not need to read the file.
+ */
+uint64_t SPTexture::hashFile(uint64_t hash, const std::string& path,
+                             bool file_content)
+{
+    if (!file_content)
+    {
+        uint64_t stats[2] = { 0, 0 };
+        file_manager->getFileStats(path, &stats[0], &stats[1]);
+        return StringUtils::hashData(hash, stats, sizeof(stats));
+    }
+    std::vector<uint8_t> data;
+    io::IReadFile* file = irr::io::createReadFile(path.c_str());
+    if (file)
+    {
+        data.resize(file->getSize());
+        if (!data.empty())
+        {
+            const s32 read = file->read(data.data(), (u32)data.size());
+            data.resize(read > 0 ? read : 0);
+        }
+        file->drop();
+    }
+    const uint64_t size = data.size();
+    hash = StringUtils::hashData(hash, &size, sizeof(size));
+    return StringUtils::hashData(hash, data.data(), data.size());
+}   // hashFile
+
+// ----------------------------------------------------------------------------
+/** Returns a hash of everything the compressed texture depends on: the
+ *  content of the image and mask files, the material settings used by
+ *  getMask, the maximum texture size and the compression quality. It is
+ *  stored in the cache file, so that a cache is valid independent of the
+ *  modification times of the files (e.g. after a fresh install).
+ *  \param file_content If false the size and modification time of the
+ *         files are used instead of their content. This is a cheap key
+ *         which is checked first, see useTextureCache.
+ */
+uint64_t SPTexture::computeHash(bool file_content) const
+{
+    uint64_t hash = 0;
+#if !(defined(SERVER_ONLY) || defined(USE_GLES2))
+    hash = StringUtils::hashData(&CACHE_VERSION, 1);
+    const unsigned tc_quality = stk_config->m_tc_quality;
+    hash = StringUtils::hashData(hash, &tc_quality, sizeof(tc_quality));
+    const core::dimension2du& max_size = irr_driver->getVideoDriver()
+        ->getDriverAttributes().getAttributeAsDimension2d("MAX_TEXTURE_SIZE");
+    const unsigned size[2] = { max_size.Width, max_size.Height };
+    hash = StringUtils::hashData(hash, size, sizeof(size));
+    // Only the name of the image is used (it selects the mipmap filter), so
+    // that the cache stays valid if the data directory is moved
+    const std::string name = StringUtils::getBasename(m_path);
+    hash = StringUtils::hashData(hash, name.c_str(), name.size());
+    hash = hashFile(hash, m_path, file_content);
+    if (!m_material)
+    {
+        return hash;
+    }
+    // Same conditions as in getMask
+    const std::string dir = StringUtils::getPath(m_path) + "/";
+    if (!m_material->getColorizationMask().empty() ||
+        m_material->getColorizationFactor() > 0.0f ||
+        m_material->isColorizable())
+    {
+        const uint8_t flags[2] = { 1, (uint8_t)useAlphaChannelShader() };
+        hash = StringUtils::hashData(hash, flags, sizeof(flags));
+        const float factor = m_material->getColorizationFactor();
+        hash = StringUtils::hashData(hash, &factor, sizeof(factor));
+        if (!m_material->getColorizationMask().empty())
+        {
+            hash = hashFile(hash, dir + m_material->getColorizationMask(),
+                            file_content);
+        }
+    }
+    else if (!m_material->getAlphaMask().empty())
+    {
+        const uint8_t flags[1] = { 2 };
+        hash = StringUtils::hashData(hash, flags, sizeof(flags));
+        hash = hashFile(hash, dir + m_material->getAlphaMask(),
+                        file_content);
+    }
+#endif
+    return hash;
+}   // computeHash
+
+// ----------------------------------------------------------------------------
+/** Checks if the texture cache of this texture is up to date. First the
+ *  file key (see computeHash) is compared, which only needs the sizes and
+ *  modification times of the files. Only if it differs the files are read
+ *  and their content hash is compared. If only the file key was outdated
+ *  (e.g. the files were installed again), it is updated in the cache file.
+ *  \param full_path Unused.
+ *  \param cache_loc On return the location of the cache file.
+ *  \param file_key On return the file key of the current texture, if the
+ *         cache is not valid.
+ *  \param hash On return the hash of the current texture, if the cache is
+ *         not valid.
+ */
 bool SPTexture::useTextureCache(const std::string& full_path,
-                                std::string* cache_loc)
+                                std::string* cache_loc, uint64_t* file_key,
+                                uint64_t* hash)
 {
-#ifndef SERVER_ONLY
-    if (!CVS->isTextureCompressionEnabled() || m_cache_directory.empty())
+#if !(defined(SERVER_ONLY) || defined(USE_GLES2))
+    // The cache directory is only set if texture compression is enabled
+    if (m_cache_directory.empty())
     {
         return false;
     }
 
     std::string basename = StringUtils::getBasename(m_path);
     *cache_loc = m_cache_directory + "/" + basename + ".sptz";
+    *file_key = computeHash(/*file_content*/false);
+    *hash = 0;
 
-    if (file_manager->fileExists(*cache_loc) &&
-        file_manager->fileIsNewer(*cache_loc, m_path))
+    io::IReadFile* file = irr::io::createReadFile(cache_loc->c_str());
+    if (file == NULL)
+    {
+        *hash = computeHash(/*file_content*/true);
+        return false;
+    }
+    uint8_t cache_version = 0;
+    uint64_t cache_file_key = 0, cache_hash = 0;
+    const bool complete = file->read(&cache_version, 1) == 1 &&
+        cache_version == CACHE_VERSION &&
+        file->read(&cache_file_key, 8) == 8 &&
+        file->read(&cache_hash, 8) == 8;
+    file->drop();
+    if (complete && cache_file_key == *file_key)
+    {
+        return true;
+    }
+    *hash = computeHash(/*file_content*/true);
+    if (!complete || cache_hash != *hash)
+    {
+        return false;
+    }
+    // The files did not change, only their modification time
+    FILE* fp = fopen(cache_loc->c_str(), "r+b");
+    if (fp)
     {
-        if (m_material && (!m_material->getColorizationMask().empty() ||
-            m_material->getAlphaMask().empty()))
+        if (fseek(fp, 1, SEEK_SET) == 0)
         {
-            std::string mask_path = StringUtils::getPath(m_path) + "/" +
-                (!m_material->getColorizationMask().empty() ?
-                m_material->getColorizationMask() :
-                m_material->getAlphaMask());
-            if (!file_manager->fileIsNewer(*cache_loc, mask_path))
-            {
-                return false;
-            }
+            fwrite(file_key, 8, 1, fp);
         }
-        return true;
+        fclose(fp);
     }
+    return true;
 #endif
     return false;
 }   // useTextureCache
@@ -395,8 +571,12 @@ std::shared_ptr<video::IImage> SPTexture::getTextureCache(const std::string& p,
     file->read(&cache_version, 1);
     if (cache_version != CACHE_VERSION)
     {
+        file->drop();
         return cache;
     }
+    // The file key and hash were already checked in useTextureCache
+    uint64_t hash[2];
+    file->read(hash, 16);
 
     unsigned mm_sizes;
     file->read(&mm_sizes, 4);
@@ -426,7 +606,8 @@ bool SPTexture::threadedLoad()
 {
 #ifndef SERVER_ONLY
     std::string cache_loc;
-    if (useTextureCache(m_path, &cache_loc))
+    uint64_t file_key = 0, hash = 0;
+    if (useTextureCache(m_path, &cache_loc, &file_key, &hash))
     {
         std::vector<std::pair<core::dimension2du, unsigned> > sizes;
         std::shared_ptr<video::IImage> cache = getTextureCache(cache_loc,
@@ -464,9 +645,10 @@ bool SPTexture::threadedLoad()
         if (!cache_loc.empty())
         {
             SPTextureManager::get()->addThreadedFunction(
-                [this, image, r, cache_loc]()->bool
+                [this, image, r, cache_loc, file_key, hash]()->bool
                 {
-                    return saveCompressedTexture(image, r, cache_loc);
+                    return saveCompressedTexture(image, r, cache_loc,
+                                                 file_key, hash);
                 });
         }
     }
@@ -525,9 +707,7 @@ std::shared_ptr<video::IImage>
     {
         // Load colorization mask
         std::shared_ptr<video::IImage> mask;
-        std::shared_ptr<SPShader> sps =
-            SPShaderManager::get()->getSPShader(m_material->getShaderName());
-        if (sps && sps->useAlphaChannel())
+        if (useAlphaChannelShader())
         {
             Log::debug("SPTexture", "Don't use colorization mask or factor"
                 " with shader using alpha channel for %s", m_path.c_str());
@@ -753,8 +933,16 @@ void SPTexture::squishCompressImage(uint8_t* rgba, int width, int height,
 }   // squishCompressImage
 
 // ----------------------------------------------------------------------------
+/** Generates the mipmaps of an image and compresses all levels. On return
+ *  the image contains the compressed levels after each other.
+ *  \param image The image to compress.
+ *  \param pool If not NULL, the rows of 4x4 blocks of all levels are
+ *         compressed in parallel by this pool.
+ *  \return The size of each level and its compressed size in bytes.
+ */
 std::vector<std::pair<core::dimension2du, unsigned> >
-               SPTexture::compressTexture(std::shared_ptr<video::IImage> image)
+               SPTexture::compressTexture(std::shared_ptr<video::IImage> image,
+                                          WorkerPool* pool)
 {
     std::vector<std::pair<core::dimension2du, unsigned> > mipmap_sizes;
 
@@ -774,56 +962,284 @@ std::vector<std::pair<core::dimension2du, unsigned> >
     }
 
     const unsigned tc_flag = squish::kDxt5 | stk_config->m_tc_quality;
-    const unsigned compressed_size = squish::GetStorageRequirements(
-        mipmap_sizes[0].first.Width, mipmap_sizes[0].first.Height,
-        tc_flag);
-    mipmap_sizes[0].second = compressed_size;
-    uint8_t* tmp = new uint8_t[image->getDimension().getArea() * 4]();
-    uint8_t* ptr_loc = tmp + compressed_size;
-
-    generateHQMipmap(image->lock(), mipmap_sizes, ptr_loc);
-    squishCompressImage((uint8_t*)image->lock(),
-        mipmap_sizes[0].first.Width, mipmap_sizes[0].first.Height,
-        mipmap_sizes[0].first.Width * 4, tmp, tc_flag);
-    memcpy(image->lock(), tmp, image->getDimension().getArea() * 4);
-
-    // Now compress mipmap
-    ptr_loc = (uint8_t*)image->lock();
-    ptr_loc += compressed_size;
-    for (unsigned mip = 1; mip < mipmap_sizes.size(); mip++)
+    // The uncompressed levels (level 0 is the image itself) and where their
+    // compressed data starts
+    std::vector<uint8_t*> levels(mipmap_sizes.size());
+    std::vector<unsigned> offsets(mipmap_sizes.size());
+    unsigned mipmaps_size = 0, total_size = 0;
+    for (unsigned mip = 0; mip < mipmap_sizes.size(); mip++)
     {
         mipmap_sizes[mip].second = squish::GetStorageRequirements(
             mipmap_sizes[mip].first.Width, mipmap_sizes[mip].first.Height,
             tc_flag);
-        squishCompressImage(ptr_loc,
-            mipmap_sizes[mip].first.Width, mipmap_sizes[mip].first.Height,
-            mipmap_sizes[mip].first.Width * 4, tmp, tc_flag);
-        memcpy(ptr_loc, tmp, mipmap_sizes[mip].second);
-        ptr_loc += mipmap_sizes[mip].first.Width *
-            mipmap_sizes[mip].first.Height * 4;
+        offsets[mip] = total_size;
+        total_size += mipmap_sizes[mip].second;
+        if (mip > 0)
+        {
+            mipmaps_size += mipmap_sizes[mip].first.getArea() * 4;
+        }
+    }
+    std::vector<uint8_t> mipmaps(mipmaps_size);
+    generateHQMipmap(image->lock(), mipmap_sizes, mipmaps.data());
+    levels[0] = (uint8_t*)image->lock();
+    for (unsigned mip = 1; mip < mipmap_sizes.size(); mip++)
+    {
+        levels[mip] = mip == 1 ? mipmaps.data() : levels[mip - 1] +
+            mipmap_sizes[mip - 1].first.getArea() * 4;
     }
-    delete [] tmp;
 
-    if (mipmap_sizes.size() < 3)
+    // Each job compresses one row of 4x4 blocks of one level
+    std::vector<std::pair<unsigned, unsigned> > jobs;
+    for (unsigned mip = 0; mip < mipmap_sizes.size(); mip++)
     {
-        return mipmap_sizes;
+        for (unsigned y = 0; y < mipmap_sizes[mip].first.Height; y += 4)
+        {
+            jobs.emplace_back(mip, y);
+        }
+    }
+    std::vector<uint8_t> compressed(total_size);
+    std::function<void(unsigned)> job = [&](unsigned n)
+    {
+        const unsigned mip = jobs[n].first;
+        const unsigned y = jobs[n].second;
+        const unsigned w = mipmap_sizes[mip].first.Width;
+        const unsigned h = mipmap_sizes[mip].first.Height;
+        squishCompressImage(levels[mip] + y * w * 4, w,
+            std::min(h - y, 4u), w * 4,
+            compressed.data() + offsets[mip] + (y / 4) * ((w + 3) / 4) * 16,
+            tc_flag);
+    };
+    if (pool)
+    {
+        pool->run((unsigned)jobs.size(), job);
     }
-    ptr_loc = (uint8_t*)image->lock();
-    ptr_loc = ptr_loc + compressed_size + mipmap_sizes[1].second;
-    uint8_t* in_memory = (uint8_t*)image->lock() + compressed_size +
-        (mipmap_sizes[1].first.Height * mipmap_sizes[1].first.Width * 4);
+    else
+    {
+        for (unsigned n = 0; n < jobs.size(); n++)
+        {
+            job(n);
+        }
+    }
+    memcpy(image->lock(), compressed.data(), total_size);
+#endif
+    return mipmap_sizes;
+}   // compressTexture
 
-    // Adjust for saving the cache
-    for (unsigned mip = 2; mip < mipmap_sizes.size(); mip++)
+// ----------------------------------------------------------------------------
+/** Compresses this texture into the texture cache if the cache is not up to
+ *  date.
+ *  \param pool The pool used to compress the blocks of the texture.
+ *  \return True if the texture was compressed.
+ */
+bool SPTexture::cook(WorkerPool* pool)
+{
+#if !(defined(SERVER_ONLY) || defined(USE_GLES2))
+    std::string cache_loc;
+    uint64_t file_key = 0, hash = 0;
+    if (useTextureCache(m_path, &cache_loc, &file_key, &hash))
+    {
+        return false;
+    }
+    std::shared_ptr<video::IImage> image = getTextureImage();
+    if (!image || image->getDimension().Width < 4 ||
+        image->getDimension().Height < 4)
     {
-        memcpy(ptr_loc, in_memory, mipmap_sizes[mip].second);
-        ptr_loc += mipmap_sizes[mip].second;
-        in_memory += mipmap_sizes[mip].first.Height *
-            mipmap_sizes[mip].first.Width * 4;
+        return false;
     }
+    std::shared_ptr<video::IImage> mask = getMask(image->getDimension());
+    if (mask)
+    {
+        applyMask(image.get(), mask.get());
+    }
+    auto r = compressTexture(image, pool);
+    saveCompressedTexture(image, r, cache_loc, file_key, hash);
+    return true;
+#else
+    return false;
+#endif
+}   // cook
 
+// ----------------------------------------------------------------------------
+#if !(defined(SERVER_ONLY) || defined(USE_GLES2))
+/** Adds all files below root + sub to result, with their path relative to
+ *  root. Hidden entries and the directories in skip (which are cooked with
+ *  their own container id) are not searched.
+ */
+static void listFilesRecursive(const std::string& root, const std::string& sub,
+                               const std::set<std::string>& skip,
+                               std::vector<std::string>* result)
+{
+    std::set<std::string> files;
+    file_manager->listFiles(files, root + sub);
+    for (const std::string& file : files)
+    {
+        if (file.empty() || file[0] == '.')
+        {
+            continue;
+        }
+        const std::string path = sub + file;
+        if (file_manager->isDirectory(root + path))
+        {
+            if (skip.find(root + path + "/") == skip.end())
+            {
+                listFilesRecursive(root, path + "/", skip, result);
+            }
+        }
+        else
+        {
+            result->push_back(path);
+        }
+    }
+}   // listFilesRecursive
+
+// ----------------------------------------------------------------------------
+/** Adds the library objects in the directory lib_dir (which must end with
+ *  '/') to dirs, with the same container ids as used when loading them.
+ */
+static void addLibraryDirs(const std::string& lib_dir,
+                           std::vector<std::pair<std::string,
+                                                 std::string> >* dirs)
+{
+    if (!file_manager->isDirectory(lib_dir))
+    {
+        return;
+    }
+    std::set<std::string> libs;
+    file_manager->listFiles(libs, lib_dir);
+    for (const std::string& name : libs)
+    {
+        if (name.empty() || name[0] == '.')
+        {
+            continue;
+        }
+        const std::string path = lib_dir + name + "/";
+        if (file_manager->fileExists(path + "node.xml"))
+        {
+            dirs->emplace_back(path, "library/" + name);
+        }
+    }
+}   // addLibraryDirs
 #endif
-    return mipmap_sizes;
-}
+
+// ----------------------------------------------------------------------------
+/** Compresses the textures of all karts, tracks and library objects and of
+ *  the shared texture directories into the texture cache, so that the first
+ *  race after a fresh install does not need to compress them. Each
+ *  directory is searched recursively. The blocks of all mipmap levels of a
+ *  texture are compressed by all cores. Textures whose cache is up to date
+ *  are skipped. This does not use OpenGL, so it works with --no-graphics,
+ *  too: the shaders are not built, instead their use-alpha-channel setting
+ *  (which decides about the colorization mask) is read from the shader
+ *  files.
+ */
+void SPTexture::cookTextures()
+{
+#if !(defined(SERVER_ONLY) || defined(USE_GLES2))
+    // The texture directories and their container ids, which must be the
+    // same as in pushTextureSearchPath
+    std::vector<std::pair<std::string, std::string> > dirs;
+    const std::string texture_dir =
+        file_manager->getAssetDirectory(FileManager::TEXTURE);
+    dirs.emplace_back(texture_dir, "textures");
+    if (file_manager->isDirectory(texture_dir + "deprecated"))
+    {
+        dirs.emplace_back(texture_dir + "deprecated/", "deprecatedtex");
+    }
+    for (unsigned i = 0; i < kart_properties_manager->getNumberOfKarts(); i++)
+    {
+        const KartProperties* kp = kart_properties_manager->getKartById(i);
+        dirs.emplace_back(kp->getKartDir(), "karts/" + kp->getIdent());
+    }
+    addLibraryDirs(file_manager->getAssetDirectory(FileManager::LIBRARY),
+                   &dirs);
+    for (unsigned i = 0; i < track_manager->getNumberOfTracks(); i++)
+    {
+        const Track* track = track_manager->getTrack(i);
+        const std::string track_dir =
+            StringUtils::getPath(track->getFilename()) + "/";
+        dirs.emplace_back(track_dir, "tracks/" + track->getIdent());
+        addLibraryDirs(track_dir + "library/", &dirs);
+    }
+    std::set<std::string> skip;
+    for (auto& dir : dirs)
+    {
+        skip.insert(dir.first);
+    }
+
+    // Karts, tracks and library objects can have their own shaders, the
+    // global ones take precedence as in SPShaderManager::loadEachShader
+    std::map<std::string, bool> global_shaders;
+    SPShaderManager::readAlphaChannelInfo(file_manager->getShadersDir(),
+                                          &global_shaders);
+
+    unsigned num_threads = std::thread::hardware_concurrency();
+    WorkerPool pool(num_threads > 0 ? num_threads : 1);
+    Log::info("SPTexture", "Cooking the textures of %d directories with %d "
+              "threads.", (int)dirs.size(), pool.getNumThreads());
+    const double start = StkTime::getRealTime();
+    unsigned num_textures = 0, num_cooked = 0;
+    for (auto& dir : dirs)
+    {
+        const std::string materials_file = dir.first + "materials.xml";
+        const bool has_materials = dir.second != "textures" &&
+            dir.second != "deprecatedtex" &&
+            file_manager->fileExists(materials_file);
+        if (has_materials)
+        {
+            material_manager->pushTempMaterial(materials_file);
+        }
+        std::map<std::string, bool> shaders = global_shaders;
+        SPShaderManager::readAlphaChannelInfo(dir.first, &shaders);
+
+        std::vector<std::string> files;
+        listFilesRecursive(dir.first, "", skip, &files);
+        unsigned cooked = 0;
+        for (const std::string& file : files)
+        {
+            const std::string ext =
+                StringUtils::toLowerCase(StringUtils::getExtension(file));
+            if (ext != "png" && ext != "jpg" && ext != "jpeg")
+            {
+                continue;
+            }
+            // Only the first texture layer uses the material (for its mask)
+            const std::string name = StringUtils::getBasename(file);
+            Material* m =
+                material_manager->hasMaterial(StringUtils::toLowerCase(name)) ?
+                material_manager->getMaterial(name, false/*full_path*/,
+                false/*make_permanent*/, false/*complain_if_not_found*/,
+                true/*strip_path*/, false/*install*/) : NULL;
+            bool alpha_channel_shader = false;
+            if (m)
+            {
+                auto it = shaders.find(m->getShaderName());
+                alpha_channel_shader = it != shaders.end() && it->second;
+            }
+            SPTexture texture(dir.first + file, m, dir.second,
+                              alpha_channel_shader);
+            num_textures++;
+            if (texture.cook(&pool))
+            {
+                cooked++;
+            }
+        }
+        if (has_materials)
+        {
+            material_manager->popTempMaterial();
+        }
+        if (cooked > 0)
+        {
+            Log::info("SPTexture", "%s: %d textures compressed.",
+                      dir.second.c_str(), cooked);
+        }
+        num_cooked += cooked;
+    }
+    Log::info("SPTexture", "%d of %d textures compressed in %.1f s.",
+              num_cooked, num_textures, StkTime::getRealTime() - start);
+#else
+    Log::error("SPTexture", "Texture compression is not supported in this "
+               "build.");
+#endif
+}   // cookTextures
 
 }
@@ -35,6 +35,7 @@ namespace irr
 }
 
 class Material;
+class WorkerPool;
 
 using namespace irr;
 
@@ -58,6 +59,25 @@ private:
 
     const bool m_undo_srgb;
 
+    /** Set by the texture cooker to 1 if the shader of the material uses the
+     *  alpha channel, since no shaders are built then. -1 if the shader
+     *  manager is asked. */
+    int m_alpha_channel_shader = -1;
+
+    // ------------------------------------------------------------------------
+    SPTexture(const std::string& path, Material* m,
+              const std::string& container_id, bool alpha_channel_shader);
+    // ------------------------------------------------------------------------
+    bool useAlphaChannelShader() const;
+    // ------------------------------------------------------------------------
+    static std::string getCacheDirectory(const std::string& container_id);
+    // ------------------------------------------------------------------------
+    static uint64_t hashFile(uint64_t hash, const std::string& path,
+                             bool file_content);
+    // ------------------------------------------------------------------------
+    uint64_t computeHash(bool file_content) const;
+    // ------------------------------------------------------------------------
+    bool cook(WorkerPool* pool);
     // ------------------------------------------------------------------------
     void squishCompressImage(uint8_t* rgba, int width, int height, int pitch,
                              void* blocks, unsigned flags);
@@ -147,12 +167,15 @@ private:
     bool saveCompressedTexture(std::shared_ptr<video::IImage> texture,
                               const std::vector<std::pair<core::dimension2du,
                               unsigned> >& sizes,
-                              const std::string& cache_location);
+                              const std::string& cache_location,
+                              uint64_t file_key, uint64_t hash);
     // ------------------------------------------------------------------------
     std::vector<std::pair<core::dimension2du, unsigned> >
-                       compressTexture(std::shared_ptr<video::IImage> texture);
+                       compressTexture(std::shared_ptr<video::IImage> texture,
+                                       WorkerPool* pool = NULL);
     // ------------------------------------------------------------------------
-    bool useTextureCache(const std::string& full_path, std::string* cache_loc);
+    bool useTextureCache(const std::string& full_path, std::string* cache_loc,
+                         uint64_t* file_key, uint64_t* hash);
     // ------------------------------------------------------------------------
     std::shared_ptr<video::IImage> getTextureCache(const std::string& path,
         std::vector<std::pair<core::dimension2du, unsigned> >* sizes);
@@ -190,7 +213,8 @@ public:
     unsigned getHeight() const                      { return m_height.load(); }
     // ------------------------------------------------------------------------
     bool threadedLoad();
-
+    // ------------------------------------------------------------------------
+    static void cookTextures();
 
 };
 
@@ -22,17 +22,44 @@
 #include "graphics/central_settings.hpp"
 #include "graphics/material_manager.hpp"
 #include "graphics/stk_tex_manager.hpp"
+#include "io/file_manager.hpp"
+#include "io/mapped_file.hpp"
+#include "karts/kart_properties.hpp"
+#include "karts/kart_properties_manager.hpp"
+#include "tracks/track.hpp"
+#include "tracks/track_manager.hpp"
 #include "utils/constants.hpp"
 #include "utils/mini_glm.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+#include "utils/worker_pool.hpp"
 
 #include "../../lib/irrlicht/source/Irrlicht/CSkinnedMesh.h"
 const uint8_t VERSION_NOW = 1;
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <set>
+#include <thread>
 #include <IVideoDriver.h>
 #include <IFileSystem.h>
 
+WorkerPool* SPMeshLoader::m_worker_pool = NULL;
+
+// ----------------------------------------------------------------------------
+/** Copies size bytes from *cur to out and advances *cur, or returns false if
+ *  there are not enough bytes left before end. */
+static bool readData(const uint8_t** cur, const uint8_t* end, void* out,
+                     size_t size)
+{
+    if ((size_t)(end - *cur) < size)
+        return false;
+    memcpy(out, *cur, size);
+    *cur += size;
+    return true;
+}   // readData
+
 // ----------------------------------------------------------------------------
 bool SPMeshLoader::isALoadableFileExtension(const io::path& filename) const
 {
@@ -40,6 +67,11 @@ bool SPMeshLoader::isALoadableFileExtension(const io::path& filename) const
 }   // isALoadableFileExtension
 
 // ----------------------------------------------------------------------------
+/** Loads a spm file. The file is mapped into memory (or read with one call
+ *  if it is not a file on disk), and the vertices and indices are decoded
+ *  from there in one pass into vectors which are then moved (not copied)
+ *  into the mesh buffers.
+ */
 scene::IAnimatedMesh* SPMeshLoader::createMesh(io::IReadFile* f)
 {
 #ifndef SERVER_ONLY
@@ -56,6 +88,18 @@ scene::IAnimatedMesh* SPMeshLoader::createMesh(io::IReadFile* f)
     {
         return NULL;
     }
+    MappedFile file(f);
+    const uint8_t* cur = file.getData();
+    const uint8_t* end = cur + file.getSize();
+    SPMHeader header;
+    std::vector<SPMBuffer> buffers;
+    if (cur == NULL || !readHeader(&cur, end, &header) ||
+        !scanMeshBuffers(&cur, end, header, &buffers))
+    {
+        Log::error("SPMeshLoader", "Cannot load '%s'.",
+            f->getFileName().c_str());
+        return NULL;
+    }
     m_bind_frame = 0;
     m_joint_count = 0;
     m_frame_count = 0;
@@ -63,66 +107,12 @@ scene::IAnimatedMesh* SPMeshLoader::createMesh(io::IReadFile* f)
     m_mesh = real_spm ? new SP::SPMesh() : m_scene_manager->createSkinnedMesh();
     io::IFileSystem* fs = m_scene_manager->getFileSystem();
     std::string base_path = fs->getFileDir(f->getFileName()).c_str();
-    std::string header;
-    header.resize(2);
-    f->read(&header.front(), 2);
-    if (header != "SP")
-    {
-        Log::error("SPMeshLoader", "Not a spm file.");
-        m_mesh->drop();
-        return NULL;
-    }
-    uint8_t byte = 0;
-    f->read(&byte, 1);
-    uint8_t version = byte >> 3;
-    if (version != VERSION_NOW)
-    {
-        Log::error("SPMeshLoader", "Version mismatch, file %d SP %d", version,
-            VERSION_NOW);
-        m_mesh->drop();
-        return NULL;
-    }
-    byte &= ~0x08;
-    header = byte == 0 ? "SPMS" : byte == 1 ? "SPMA" : "SPMN";
-    if (header == "SPMS")
-    {
-        Log::error("SPMeshLoader", "Space partitioned mesh not supported.");
-        m_mesh->drop();
-        return NULL;
-    }
-    f->read(&byte, 1);
-    bool read_normal = byte & 0x01;
-    bool read_vcolor = byte >> 1 & 0x01;
-    bool read_tangent = byte >> 2 & 0x01;
-    const bool is_skinned = header == "SPMA";
-    const SPVertexType vt = is_skinned ? SPVT_SKINNED : SPVT_NORMAL;
-    float bbox[6];
-    f->read(bbox, 24);
-    uint16_t size_num = 0;
-    f->read(&size_num, 2);
-    unsigned id = 0;
-    std::unordered_map<unsigned, std::tuple<video::SMaterial, bool,
-        bool> > mat_map;
-    std::unordered_map<unsigned, std::tuple<Material*, bool,
-        bool> > sp_mat_map;
-    while (size_num != 0)
+    if (real_spm)
     {
-        uint8_t tex_size;
-        std::string tex_name_1, tex_name_2;
-        f->read(&tex_size, 1);
-        if (tex_size > 0)
-        {
-            tex_name_1.resize(tex_size);
-            f->read(&tex_name_1.front(), tex_size);
-        }
-        f->read(&tex_size, 1);
-        if (tex_size > 0)
-        {
-            tex_name_2.resize(tex_size);
-            f->read(&tex_name_2.front(), tex_size);
-        }
-        if (real_spm)
+        std::vector<Material*> materials;
+        for (unsigned i = 0; i < header.m_textures.size(); i++)
         {
+            std::string tex_name_1 = header.m_textures[i].first;
             if (!tex_name_1.empty())
             {
                 std::string full_path = base_path + "/" + tex_name_1;
@@ -131,13 +121,45 @@ scene::IAnimatedMesh* SPMeshLoader::createMesh(io::IReadFile* f)
                     tex_name_1 = full_path;
                 }
             }
-            sp_mat_map[id] =
-                std::make_tuple(
-                material_manager->getMaterialSPM(tex_name_1, tex_name_2),
-                !tex_name_1.empty(), !tex_name_2.empty());
+            materials.push_back(material_manager->getMaterialSPM(tex_name_1,
+                header.m_textures[i].second));
+        }
+        SP::SPMesh* spm = static_cast<SP::SPMesh*>(m_mesh);
+        for (unsigned i = 0; i < buffers.size(); i++)
+        {
+            spm->m_buffer.push_back(new SP::SPMeshBuffer());
+        }
+        // A job only writes the vertices and indices of its own mesh
+        // buffer, so the buffers can be decoded in parallel
+        auto decode = [&buffers, &header, spm](unsigned i)
+        {
+            std::vector<video::S3DVertexSkinnedMesh> vertices;
+            std::vector<uint16_t> indices;
+            decodeSPM(buffers[i], header, &vertices, &indices);
+            spm->m_buffer[i]->setSPMVertices(vertices);
+            spm->m_buffer[i]->setIndices(indices);
+        };
+        if (m_worker_pool)
+        {
+            m_worker_pool->run((unsigned)buffers.size(), decode);
         }
         else
         {
+            for (unsigned i = 0; i < buffers.size(); i++)
+                decode(i);
+        }
+        for (unsigned i = 0; i < buffers.size(); i++)
+        {
+            spm->m_buffer[i]->setSTKMaterial(materials[buffers[i].m_mat_id]);
+        }
+    }
+    else
+    {
+        std::vector<video::SMaterial> materials;
+        for (unsigned i = 0; i < header.m_textures.size(); i++)
+        {
+            std::string tex_name_1 = header.m_textures[i].first;
+            std::string tex_name_2 = header.m_textures[i].second;
             video::ITexture* textures[2] = { NULL, NULL };
             if (!tex_name_1.empty())
             {
@@ -174,68 +196,22 @@ scene::IAnimatedMesh* SPMeshLoader::createMesh(io::IReadFile* f)
             {
                 m.setTexture(1, textures[1]);
             }
-            mat_map[id] =
-                std::make_tuple(m, !tex_name_1.empty(), !tex_name_2.empty());
-        }
-        size_num--;
-        id++;
-    }
-    f->read(&size_num, 2);
-    while (size_num != 0)
-    {
-        uint16_t mat_size;
-        f->read(&mat_size, 2);
-        while (mat_size != 0)
-        {
-            uint32_t vertices_count, indices_count;
-            uint16_t mat_id;
-            f->read(&vertices_count, 4);
-            if (vertices_count > 65535)
-            {
-                Log::error("SPMeshLoader", "32bit index not supported.");
-                m_mesh->drop();
-                return NULL;
-            }
-            f->read(&indices_count, 4);
-            f->read(&mat_id, 2);
-            if (real_spm)
-            {
-                assert(mat_id < sp_mat_map.size());
-                decompressSPM(f, vertices_count, indices_count, read_normal,
-                    read_vcolor, read_tangent, std::get<1>(sp_mat_map[mat_id]),
-                    std::get<2>(sp_mat_map[mat_id]), vt,
-                    std::get<0>(sp_mat_map[mat_id]));
-            }
-            else
-            {
-                assert(mat_id < mat_map.size());
-                decompress(f, vertices_count, indices_count, read_normal,
-                    read_vcolor, read_tangent, std::get<1>(mat_map[mat_id]),
-                    std::get<2>(mat_map[mat_id]), vt,
-                    std::get<0>(mat_map[mat_id]));
-            }
-            mat_size--;
+            materials.push_back(m);
         }
-        if (header == "SPMS")
+        for (unsigned i = 0; i < buffers.size(); i++)
         {
-            // Reserved, never used
-            assert(false);
-            f->read(bbox, 24);
+            decompress(buffers[i], header, materials[buffers[i].m_mat_id]);
         }
-        size_num--;
     }
-    if (header == "SPMA")
+    if (header.m_vertex_type == SPVT_SKINNED)
     {
-        createAnimationData(f);
+        // The armatures follow the mesh buffers
+        io::IReadFile* armatures = fs->createMemoryReadFile((void*)cur,
+            (s32)(end - cur), f->getFileName(), false/*deleteMemory*/);
+        createAnimationData(armatures);
+        armatures->drop();
         convertIrrlicht();
     }
-    else if (header == "SPMS")
-    {
-        // Reserved, never used
-        assert(false);
-        uint16_t pre_computed_size = 0;
-        f->read(&pre_computed_size, 2);
-    }
     const bool has_armature = !m_all_armatures.empty();
     if (real_spm)
     {
@@ -269,159 +245,351 @@ scene::IAnimatedMesh* SPMeshLoader::createMesh(io::IReadFile* f)
 }   // createMesh
 
 // ----------------------------------------------------------------------------
-void SPMeshLoader::decompressSPM(irr::io::IReadFile* spm,
-                                 unsigned vertices_count,
-                                 unsigned indices_count, bool read_normal,
-                                 bool read_vcolor, bool read_tangent,
-                                 bool uv_one, bool uv_two, SPVertexType vt,
-                                 Material* m)
+/** Reads the header of a spm file and the names of its textures.
+ *  \param cur Start of the data, it is moved to the end of the header.
+ *  \param end End of the data.
+ *  \param header Returns the header.
+ *  \return False if the file is not a valid spm file.
+ */
+bool SPMeshLoader::readHeader(const uint8_t** cur, const uint8_t* end,
+                              SPMHeader* header)
 {
-    assert(vertices_count != 0);
-    assert(indices_count != 0);
+    char magic[2];
+    if (!readData(cur, end, magic, 2) || magic[0] != 'S' || magic[1] != 'P')
+    {
+        Log::error("SPMeshLoader", "Not a spm file.");
+        return false;
+    }
+    uint8_t byte = 0;
+    if (!readData(cur, end, &byte, 1))
+    {
+        Log::error("SPMeshLoader", "Truncated spm file.");
+        return false;
+    }
+    uint8_t version = byte >> 3;
+    if (version != VERSION_NOW)
+    {
+        Log::error("SPMeshLoader", "Version mismatch, file %d SP %d", version,
+            VERSION_NOW);
+        return false;
+    }
+    byte &= ~0x08;
+    if (byte == 0)
+    {
+        Log::error("SPMeshLoader", "Space partitioned mesh not supported.");
+        return false;
+    }
+    header->m_vertex_type = byte == 1 ? SPVT_SKINNED : SPVT_NORMAL;
+    float bbox[6];
+    uint16_t size_num = 0;
+    if (!readData(cur, end, &byte, 1) || !readData(cur, end, bbox, 24) ||
+        !readData(cur, end, &size_num, 2))
+    {
+        Log::error("SPMeshLoader", "Truncated spm file.");
+        return false;
+    }
+    header->m_read_normal = byte & 0x01;
+    header->m_read_vcolor = byte >> 1 & 0x01;
+    header->m_read_tangent = byte >> 2 & 0x01;
+    header->m_textures.resize(size_num);
+    for (unsigned i = 0; i < size_num; i++)
+    {
+        std::string* tex_name[2] = { &header->m_textures[i].first,
+                                     &header->m_textures[i].second };
+        for (unsigned j = 0; j < 2; j++)
+        {
+            uint8_t tex_size = 0;
+            if (!readData(cur, end, &tex_size, 1) ||
+                (size_t)(end - *cur) < tex_size)
+            {
+                Log::error("SPMeshLoader", "Truncated spm file.");
+                return false;
+            }
+            tex_name[j]->assign((const char*)*cur, tex_size);
+            *cur += tex_size;
+        }
+    }
+    return true;
+}   // readHeader
 
-    using namespace SP;
-    SPMeshBuffer* mb = new SPMeshBuffer();
-    static_cast<SPMesh*>(m_mesh)->m_buffer.push_back(mb);
-    const unsigned idx_size = vertices_count > 255 ? 2 : 1;
-    for (unsigned i = 0; i < vertices_count; i++)
+// ----------------------------------------------------------------------------
+/** Finds the vertices and indices of all mesh buffers of a spm file, so
+ *  that they can be decoded independently of each other.
+ *  \param cur Start of the mesh buffers, it is moved to the end of them.
+ *  \param end End of the data.
+ *  \param header The header of the file.
+ *  \param buffers Returns the mesh buffers.
+ *  \return False if the mesh buffers are invalid or truncated.
+ */
+bool SPMeshLoader::scanMeshBuffers(const uint8_t** cur, const uint8_t* end,
+                                   const SPMHeader& header,
+                                   std::vector<SPMBuffer>* buffers)
+{
+    uint16_t size_num = 0;
+    if (!readData(cur, end, &size_num, 2))
+    {
+        Log::error("SPMeshLoader", "Truncated spm file.");
+        return false;
+    }
+    for (unsigned section = 0; section < size_num; section++)
+    {
+        uint16_t mat_size = 0;
+        if (!readData(cur, end, &mat_size, 2))
+        {
+            Log::error("SPMeshLoader", "Truncated spm file.");
+            return false;
+        }
+        for (unsigned i = 0; i < mat_size; i++)
+        {
+            SPMBuffer b;
+            uint32_t vertices_count = 0, indices_count = 0;
+            if (!readData(cur, end, &vertices_count, 4) ||
+                !readData(cur, end, &indices_count, 4) ||
+                !readData(cur, end, &b.m_mat_id, 2))
+            {
+                Log::error("SPMeshLoader", "Truncated spm file.");
+                return false;
+            }
+            if (vertices_count > 65535)
+            {
+                Log::error("SPMeshLoader", "32bit index not supported.");
+                return false;
+            }
+            if (vertices_count == 0 || indices_count == 0 ||
+                b.m_mat_id >= header.m_textures.size())
+            {
+                Log::error("SPMeshLoader", "Invalid mesh buffer.");
+                return false;
+            }
+            b.m_vertices_count = vertices_count;
+            b.m_indices_count = indices_count;
+
+            // Size of a vertex without its color
+            const bool uv_one = !header.m_textures[b.m_mat_id].first.empty();
+            const bool uv_two = !header.m_textures[b.m_mat_id].second.empty();
+            size_t vertex_size = 12;
+            if (header.m_read_normal)
+                vertex_size += 4;
+            if (uv_one)
+            {
+                vertex_size += 4;
+                if (uv_two)
+                    vertex_size += 4;
+                if (header.m_read_tangent)
+                    vertex_size += 4;
+            }
+            if (header.m_vertex_type == SPVT_SKINNED)
+                vertex_size += 16;
+
+            b.m_vertices = *cur;
+            if (header.m_read_vcolor)
+            {
+                // The color is either one byte (white) or 4 bytes
+                const size_t color_offset = header.m_read_normal ? 16 : 12;
+                for (unsigned j = 0; j < vertices_count; j++)
+                {
+                    if ((size_t)(end - *cur) <= color_offset)
+                    {
+                        Log::error("SPMeshLoader", "Truncated spm file.");
+                        return false;
+                    }
+                    const size_t size = (*cur)[color_offset] == 128 ?
+                        vertex_size + 1 : vertex_size + 4;
+                    if ((size_t)(end - *cur) < size)
+                    {
+                        Log::error("SPMeshLoader", "Truncated spm file.");
+                        return false;
+                    }
+                    *cur += size;
+                }
+            }
+            else
+            {
+                if ((size_t)(end - *cur) / vertex_size < vertices_count)
+                {
+                    Log::error("SPMeshLoader", "Truncated spm file.");
+                    return false;
+                }
+                *cur += vertex_size * vertices_count;
+            }
+
+            b.m_indices = *cur;
+            const size_t indices_size = (size_t)indices_count *
+                (vertices_count > 255 ? 2 : 1);
+            if ((size_t)(end - *cur) < indices_size)
+            {
+                Log::error("SPMeshLoader", "Truncated spm file.");
+                return false;
+            }
+            *cur += indices_size;
+            buffers->push_back(b);
+        }
+    }
+    return true;
+}   // scanMeshBuffers
+
+// ----------------------------------------------------------------------------
+/** Decodes the vertices and indices of a mesh buffer found by
+ *  scanMeshBuffers in one pass. It does not use OpenGL and only writes to
+ *  the given vectors, so several mesh buffers can be decoded in parallel.
+ *  \param buffer The mesh buffer to decode.
+ *  \param header The header of the file.
+ *  \param vertices Returns the vertices.
+ *  \param indices Returns the indices.
+ */
+void SPMeshLoader::decodeSPM(const SPMBuffer& buffer, const SPMHeader& header,
+                             std::vector<video::S3DVertexSkinnedMesh>*
+                             vertices, std::vector<uint16_t>* indices)
+{
+    const bool read_normal = header.m_read_normal;
+    const bool read_vcolor = header.m_read_vcolor;
+    const bool read_tangent = header.m_read_tangent;
+    const bool uv_one = !header.m_textures[buffer.m_mat_id].first.empty();
+    const bool uv_two = !header.m_textures[buffer.m_mat_id].second.empty();
+    const bool skinned = header.m_vertex_type == SPVT_SKINNED;
+
+    const uint8_t* spm = buffer.m_vertices;
+    vertices->resize(buffer.m_vertices_count);
+    video::S3DVertexSkinnedMesh* vertex = vertices->data();
+    for (unsigned i = 0; i < buffer.m_vertices_count; i++, vertex++)
     {
-        video::S3DVertexSkinnedMesh vertex = {};
         // 3 * float position
-        spm->read(&vertex.m_position, 12);
+        float position[3];
+        memcpy(position, spm, 12);
+        vertex->m_position.set(position[0], position[1], position[2]);
+        spm += 12;
         if (read_normal)
         {
-            spm->read(&vertex.m_normal, 4);
+            memcpy(&vertex->m_normal, spm, 4);
+            spm += 4;
         }
         else
         {
             // 0, 1, 0
-            vertex.m_normal = 0x1FF << 10;
+            vertex->m_normal = 0x1FF << 10;
         }
+        // The default color is white
         if (read_vcolor)
         {
-            // Color identifier
-            uint8_t ci;
-            spm->read(&ci, 1);
-            if (ci == 128)
+            // Color identifier, 128 is all white
+            if (spm[0] == 128)
             {
-                // All white
-                vertex.m_color = video::SColor(255, 255, 255, 255);
+                spm += 1;
             }
             else
             {
-                uint8_t r, g, b;
-                spm->read(&r, 1);
-                spm->read(&g, 1);
-                spm->read(&b, 1);
-                vertex.m_color = video::SColor(255, r, g, b);
+                vertex->m_color = video::SColor(255, spm[1], spm[2], spm[3]);
+                spm += 4;
             }
         }
-        else
-        {
-            vertex.m_color = video::SColor(255, 255, 255, 255);
-        }
         if (uv_one)
         {
-            spm->read(&vertex.m_all_uvs[0], 4);
+            memcpy(&vertex->m_all_uvs[0], spm, 4);
+            spm += 4;
             if (uv_two)
             {
-                spm->read(&vertex.m_all_uvs[2], 4);
+                memcpy(&vertex->m_all_uvs[2], spm, 4);
+                spm += 4;
             }
             if (read_tangent)
             {
-                spm->read(&vertex.m_tangent, 4);
+                memcpy(&vertex->m_tangent, spm, 4);
+                spm += 4;
             }
             else
             {
-                vertex.m_tangent = MiniGLM::quickTangent(vertex.m_normal);
+                vertex->m_tangent = MiniGLM::quickTangent(vertex->m_normal);
             }
         }
-        if (vt == SPVT_SKINNED)
+        if (skinned)
         {
-            spm->read(&vertex.m_joint_idx[0], 16);
-            if (vertex.m_joint_idx[0] == -1 ||
-                vertex.m_weight[0] == 0 ||
+            memcpy(&vertex->m_joint_idx[0], spm, 16);
+            spm += 16;
+            if (vertex->m_joint_idx[0] == -1 ||
+                vertex->m_weight[0] == 0 ||
                 // -0.0 in half float (16bit)
-                vertex.m_weight[0] == -32768)
+                vertex->m_weight[0] == -32768)
             {
                 // For the skinned mesh shader
-                vertex.m_joint_idx[0] = -32767;
+                vertex->m_joint_idx[0] = -32767;
                 // 1.0 in half float (16bit)
-                vertex.m_weight[0] = 15360;
+                vertex->m_weight[0] = 15360;
             }
         }
-        mb->addSPMVertex(vertex);
     }
 
-    std::vector<uint16_t> indices;
-    indices.resize(indices_count);
-    if (idx_size == 2)
+    indices->resize(buffer.m_indices_count);
+    if (buffer.m_vertices_count > 255)
     {
-        spm->read(indices.data(), indices_count * 2);
+        memcpy(indices->data(), buffer.m_indices, buffer.m_indices_count * 2);
     }
     else
     {
-        std::vector<uint8_t> tmp_idx;
-        tmp_idx.resize(indices_count);
-        spm->read(tmp_idx.data(), indices_count);
-        for (unsigned i = 0; i < indices_count; i++)
+        for (unsigned i = 0; i < buffer.m_indices_count; i++)
         {
-            indices[i] = tmp_idx[i];
+            (*indices)[i] = buffer.m_indices[i];
         }
     }
-    mb->setIndices(indices);
-    mb->setSTKMaterial(m);
-
-}   // decompressSPM
+}   // decodeSPM
 
 // ----------------------------------------------------------------------------
-void SPMeshLoader::decompress(irr::io::IReadFile* spm, unsigned vertices_count,
-                              unsigned indices_count, bool read_normal,
-                              bool read_vcolor, bool read_tangent, bool uv_one,
-                              bool uv_two, SPVertexType vt,
+/** Converts a mesh buffer found by scanMeshBuffers to an irrlicht mesh
+ *  buffer, for the legacy device. */
+void SPMeshLoader::decompress(const SPMBuffer& buffer, const SPMHeader& header,
                               const video::SMaterial& m)
 {
-    assert(vertices_count != 0);
-    assert(indices_count != 0);
+    const bool read_normal = header.m_read_normal;
+    const bool read_vcolor = header.m_read_vcolor;
+    const bool read_tangent = header.m_read_tangent;
+    const bool uv_one = !header.m_textures[buffer.m_mat_id].first.empty();
+    const bool uv_two = !header.m_textures[buffer.m_mat_id].second.empty();
+    const SPVertexType vt = header.m_vertex_type;
+    const unsigned vertices_count = buffer.m_vertices_count;
+    const unsigned indices_count = buffer.m_indices_count;
+
     scene::SSkinMeshBuffer* mb = m_mesh->addMeshBuffer();
     if (uv_two)
     {
         mb->convertTo2TCoords();
+        mb->Vertices_2TCoords.reallocate(vertices_count);
+    }
+    else
+    {
+        mb->Vertices_Standard.reallocate(vertices_count);
     }
     using namespace MiniGLM;
-    const unsigned idx_size = vertices_count > 255 ? 2 : 1;
-    char tmp[8] = {};
+    const uint8_t* spm = buffer.m_vertices;
     std::vector<std::pair<std::array<short, 4>, std::array<float, 4> > >
         cur_joints;
     for (unsigned i = 0; i < vertices_count; i++)
     {
         video::S3DVertex2TCoords vertex;
         // 3 * float position
-        spm->read(&vertex.Pos, 12);
+        float position[3];
+        memcpy(position, spm, 12);
+        vertex.Pos.set(position[0], position[1], position[2]);
+        spm += 12;
         if (read_normal)
         {
             // 3 10 + 2 bits normal
             uint32_t packed;
-            spm->read(&packed, 4);
+            memcpy(&packed, spm, 4);
+            spm += 4;
             vertex.Normal = decompressVector3(packed);
         }
         if (read_vcolor)
         {
             // Color identifier
-            uint8_t ci;
-            spm->read(&ci, 1);
-            if (ci == 128)
+            if (spm[0] == 128)
             {
                 // All white
                 vertex.Color = video::SColor(255, 255, 255, 255);
+                spm += 1;
             }
             else
             {
-                uint8_t r, g, b;
-                spm->read(&r, 1);
-                spm->read(&g, 1);
-                spm->read(&b, 1);
-                vertex.Color = video::SColor(255, r, g, b);
+                vertex.Color = video::SColor(255, spm[1], spm[2], spm[3]);
+                spm += 4;
             }
         }
         else
@@ -431,14 +599,16 @@ void SPMeshLoader::decompress(irr::io::IReadFile* spm, unsigned vertices_count,
         if (uv_one)
         {
             short hf[2];
-            spm->read(hf, 4);
+            memcpy(hf, spm, 4);
+            spm += 4;
             vertex.TCoords.X = toFloat32(hf[0]);
             vertex.TCoords.Y = toFloat32(hf[1]);
             assert(!std::isnan(vertex.TCoords.X));
             assert(!std::isnan(vertex.TCoords.Y));
             if (uv_two)
             {
-                spm->read(hf, 4);
+                memcpy(hf, spm, 4);
+                spm += 4;
                 vertex.TCoords2.X = toFloat32(hf[0]);
                 vertex.TCoords2.Y = toFloat32(hf[1]);
                 assert(!std::isnan(vertex.TCoords2.X));
@@ -446,24 +616,25 @@ void SPMeshLoader::decompress(irr::io::IReadFile* spm, unsigned vertices_count,
             }
             if (read_tangent)
             {
-                uint32_t packed;
-                spm->read(&packed, 4);
+                // Not used by the legacy device
+                spm += 4;
             }
         }
         if (vt == SPVT_SKINNED)
         {
             std::array<short, 4> joint_idx;
-            spm->read(joint_idx.data(), 8);
-            spm->read(tmp, 8);
+            memcpy(joint_idx.data(), spm, 8);
+            spm += 8;
             std::array<float, 4> joint_weight = {};
             for (int j = 0; j < 8; j += 2)
             {
                 short hf;
-                memcpy(&hf, tmp + j, 2);
+                memcpy(&hf, spm + j, 2);
                 const unsigned idx = j >> 1;
                 joint_weight[idx] = toFloat32(hf);
                 assert(!std::isnan(joint_weight[idx]));
             }
+            spm += 8;
             cur_joints.emplace_back(joint_idx, joint_weight);
         }
         if (uv_two)
@@ -484,18 +655,15 @@ void SPMeshLoader::decompress(irr::io::IReadFile* spm, unsigned vertices_count,
         mb->Material = m;
     }
     mb->Indices.set_used(indices_count);
-    if (idx_size == 2)
+    if (vertices_count > 255)
     {
-        spm->read(mb->Indices.pointer(), indices_count * 2);
+        memcpy(mb->Indices.pointer(), buffer.m_indices, indices_count * 2);
     }
     else
     {
-        std::vector<uint8_t> tmp_idx;
-        tmp_idx.resize(indices_count);
-        spm->read(tmp_idx.data(), indices_count);
         for (unsigned i = 0; i < indices_count; i++)
         {
-            mb->Indices[i] = tmp_idx[i];
+            mb->Indices[i] = buffer.m_indices[i];
         }
     }
 
@@ -676,3 +844,104 @@ void SPMeshLoader::convertIrrlicht()
     }
 
 }   // convertIrrlicht
+
+// ----------------------------------------------------------------------------
+/** Sets the number of threads used to decode the mesh buffers of a spm file.
+ *  With 1 thread (the default) the loading thread decodes them. Otherwise
+ *  meshes must only be loaded by one thread at a time.
+ */
+void SPMeshLoader::setNumThreads(unsigned n)
+{
+    delete m_worker_pool;
+    m_worker_pool = n > 1 ? new WorkerPool(n) : NULL;
+}   // setNumThreads
+
+// ----------------------------------------------------------------------------
+/** Decodes the vertices and indices of all spm files of all karts and tracks
+ *  with one thread and with one thread per core, checks that the results are
+ *  identical and prints the times. It does not need a GPU. The first run
+ *  includes reading the files from disk if the operating system has not
+ *  cached them yet.
+ */
+void SPMeshLoader::runBenchmark()
+{
+    std::vector<std::string> dirs;
+    for (unsigned i = 0; i < kart_properties_manager->getNumberOfKarts(); i++)
+        dirs.push_back(kart_properties_manager->getKartById(i)->getKartDir());
+    for (unsigned i = 0; i < track_manager->getNumberOfTracks(); i++)
+    {
+        const Track* track = track_manager->getTrack(i);
+        dirs.push_back(StringUtils::getPath(track->getFilename()));
+    }
+    std::vector<std::string> files;
+    for (const std::string& dir : dirs)
+    {
+        std::set<std::string> result;
+        file_manager->listFiles(result, dir, /*make_full_path*/true);
+        for (const std::string& name : result)
+        {
+            if (StringUtils::getExtension(name) == "spm")
+                files.push_back(name);
+        }
+    }
+
+    unsigned num_threads = std::thread::hardware_concurrency();
+    if (num_threads < 1)
+        num_threads = 1;
+    const unsigned all_threads[] = { 1, 1, num_threads };
+    Log::info("SPMeshLoader", "Loading %d spm files of %d directories.",
+              (int)files.size(), (int)dirs.size());
+    uint64_t first_hash = 0;
+    for (unsigned run = 0; run < 3; run++)
+    {
+        WorkerPool pool(all_threads[run]);
+        size_t num_bytes = 0, num_vertices = 0, num_indices = 0;
+        double scan_time = 0, decode_time = 0;
+        uint64_t hash = StringUtils::hashData(NULL, 0);
+        for (const std::string& name : files)
+        {
+            const double start = StkTime::getRealTime();
+            MappedFile file(name);
+            const uint8_t* cur = file.getData();
+            const uint8_t* end = cur + file.getSize();
+            SPMHeader header;
+            std::vector<SPMBuffer> buffers;
+            const bool valid = cur != NULL &&
+                readHeader(&cur, end, &header) &&
+                scanMeshBuffers(&cur, end, header, &buffers);
+            const double scanned = StkTime::getRealTime();
+            scan_time += scanned - start;
+            if (!valid)
+                continue;
+
+            std::vector<std::vector<video::S3DVertexSkinnedMesh> >
+                vertices(buffers.size());
+            std::vector<std::vector<uint16_t> > indices(buffers.size());
+            pool.run((unsigned)buffers.size(), [&](unsigned i)
+                {
+                    decodeSPM(buffers[i], header, &vertices[i], &indices[i]);
+                });
+            decode_time += StkTime::getRealTime() - scanned;
+
+            num_bytes += file.getSize();
+            for (unsigned i = 0; i < buffers.size(); i++)
+            {
+                hash = StringUtils::hashData(hash, vertices[i].data(),
+                    vertices[i].size() * sizeof(vertices[i][0]));
+                hash = StringUtils::hashData(hash, indices[i].data(),
+                    indices[i].size() * sizeof(indices[i][0]));
+                num_vertices += vertices[i].size();
+                num_indices += indices[i].size();
+            }
+        }
+        Log::info("SPMeshLoader", "%d thread(s): mapped and scanned %.1f MB "
+                  "in %.1f ms, decoded %d vertices and %d indices in %.1f ms.",
+                  pool.getNumThreads(), num_bytes / (1024.0f * 1024.0f),
+                  scan_time * 1000.0, (int)num_vertices, (int)num_indices,
+                  decode_time * 1000.0);
+        if (run == 0)
+            first_hash = hash;
+        else if (hash != first_hash)
+            Log::error("SPMeshLoader", "The decoded meshes differ.");
+    }
+}   // runBenchmark
@@ -25,11 +25,14 @@
 #include <ISkinnedMesh.h>
 #include <IReadFile.h>
 #include <array>
+#include <stdint.h>
+#include <string>
 #include <vector>
 
 using namespace irr;
 
 class Material;
+class WorkerPool;
 
 class SPMeshLoader : public scene::IMeshLoader
 {
@@ -48,16 +51,39 @@ private:
         SPVT_SKINNED
     };
     // ------------------------------------------------------------------------
-    void decompress(irr::io::IReadFile* spm, unsigned vertices_count,
-                    unsigned indices_count, bool read_normal, bool read_vcolor,
-                    bool read_tangent, bool uv_one, bool uv_two,
-                    SPVertexType vt, const video::SMaterial& m);
+    /** The header of a spm file and the names of its textures. */
+    struct SPMHeader
+    {
+        bool m_read_normal, m_read_vcolor, m_read_tangent;
+        SPVertexType m_vertex_type;
+        /** The two texture names of each material. */
+        std::vector<std::pair<std::string, std::string> > m_textures;
+    };
+    // ------------------------------------------------------------------------
+    /** The location of a mesh buffer in a spm file. */
+    struct SPMBuffer
+    {
+        const uint8_t* m_vertices;
+        const uint8_t* m_indices;
+        unsigned m_vertices_count, m_indices_count;
+        uint16_t m_mat_id;
+    };
+    // ------------------------------------------------------------------------
+    static WorkerPool* m_worker_pool;
     // ------------------------------------------------------------------------
-    void decompressSPM(irr::io::IReadFile* spm, unsigned vertices_count,
-                       unsigned indices_count, bool read_normal,
-                       bool read_vcolor, bool read_tangent, bool uv_one,
-                       bool uv_two, SPVertexType vt,
-                       Material* m);
+    static bool readHeader(const uint8_t** cur, const uint8_t* end,
+                           SPMHeader* header);
+    // ------------------------------------------------------------------------
+    static bool scanMeshBuffers(const uint8_t** cur, const uint8_t* end,
+                                const SPMHeader& header,
+                                std::vector<SPMBuffer>* buffers);
+    // ------------------------------------------------------------------------
+    static void decodeSPM(const SPMBuffer& buffer, const SPMHeader& header,
+                          std::vector<video::S3DVertexSkinnedMesh>* vertices,
+                          std::vector<uint16_t>* indices);
+    // ------------------------------------------------------------------------
+    void decompress(const SPMBuffer& buffer, const SPMHeader& header,
+                    const video::SMaterial& m);
     // ------------------------------------------------------------------------
     void createAnimationData(irr::io::IReadFile* spm);
     // ------------------------------------------------------------------------
@@ -77,6 +103,10 @@ public:
     virtual bool isALoadableFileExtension(const io::path& filename) const;
     // ------------------------------------------------------------------------
     virtual scene::IAnimatedMesh* createMesh(io::IReadFile* file);
+    // ------------------------------------------------------------------------
+    static void setNumThreads(unsigned n);
+    // ------------------------------------------------------------------------
+    static void runBenchmark();
 
 };
 
@@ -244,6 +244,7 @@ FileManager::FileManager()
     checkAndCreateScreenshotDir();
     checkAndCreateReplayDir();
     checkAndCreateCachedTexturesDir();
+    checkAndCreateCacheDir();
     checkAndCreateGPDir();
 
     redirectOutput();
@@ -710,6 +711,15 @@ std::string FileManager::getCachedTexturesDir() const
     return m_cached_textures_dir;
 }   // getCachedTexturesDir
 
+//-----------------------------------------------------------------------------
+/** Returns the directory in which other data (e.g. the physics data of a
+ *  track) is cached. All files in this directory can be recreated.
+ */
+std::string FileManager::getCacheDir() const
+{
+    return m_cache_dir;
+}   // getCacheDir
+
 //-----------------------------------------------------------------------------
 /** Returns the directory in which user-defined grand prix should be stored.
  */
@@ -1044,6 +1054,30 @@ void FileManager::checkAndCreateCachedTexturesDir()
 
 }   // checkAndCreateCachedTexturesDir
 
+// ----------------------------------------------------------------------------
+/** Creates the directory for cached data. This will set m_cache_dir with
+ *  the appropriate path.
+ */
+void FileManager::checkAndCreateCacheDir()
+{
+#if defined(WIN32) || defined(__CYGWIN__)
+    m_cache_dir = m_user_config_dir + "cache/";
+#elif defined(__APPLE__)
+    m_cache_dir = getenv("HOME");
+    m_cache_dir += "/Library/Application Support/SuperTuxKart/Cache/";
+#else
+    m_cache_dir = checkAndCreateLinuxDir("XDG_CACHE_HOME", "supertuxkart", ".cache/", ".");
+    m_cache_dir += "data/";
+#endif
+
+    if (!checkAndCreateDirectory(m_cache_dir))
+    {
+        Log::error("FileManager", "Can not create cache directory '%s', "
+            "falling back to '.'.", m_cache_dir.c_str());
+        m_cache_dir = "./";
+    }
+}   // checkAndCreateCacheDir
+
 // ----------------------------------------------------------------------------
 /** Creates the directories for user-defined grand prix. This will set m_gp_dir
  *  with the appropriate path.
@@ -1461,3 +1495,20 @@ bool FileManager::fileIsNewer(const std::string& f1, const std::string& f2) cons
     return stat1.st_mtime > stat2.st_mtime;
 }   // fileIsNewer
 
+// ----------------------------------------------------------------------------
+/** Returns the modification time and size of a file.
+ *  \param path Full path of the file.
+ *  \param mtime On return the modification time.
+ *  \param size On return the size of the file in bytes.
+ *  \return False if the file does not exist.
+ */
+bool FileManager::getFileStats(const std::string &path, uint64_t *mtime,
+                               uint64_t *size) const
+{
+    struct stat mystat;
+    if (stat(path.c_str(), &mystat) < 0) return false;
+    *mtime = (uint64_t)mystat.st_mtime;
+    *size  = (uint64_t)mystat.st_size;
+    return true;
+}   // getFileStats
+
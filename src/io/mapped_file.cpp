@@ -0,0 +1,186 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "io/mapped_file.hpp"
+
+#include <IReadFile.h>
+#include "../../lib/irrlicht/source/Irrlicht/CReadFile.h"
+
+#include <stdio.h>
+
+#if defined(WIN32) && !defined(__CYGWIN__)
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+// ----------------------------------------------------------------------------
+/** Maps or reads the file with the given name.
+ *  \param path Full path of the file.
+ */
+MappedFile::MappedFile(const std::string &path)
+{
+    m_data         = NULL;
+    m_size         = 0;
+    m_mapping      = NULL;
+    m_mapping_size = 0;
+    if (map(path))
+    {
+        m_data = (const uint8_t*)m_mapping;
+        m_size = m_mapping_size;
+        return;
+    }
+
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return;
+    if (fseek(file, 0, SEEK_END) == 0)
+    {
+        long size = ftell(file);
+        if (size > 0 && fseek(file, 0, SEEK_SET) == 0)
+        {
+            m_buffer.resize(size);
+            if (fread(m_buffer.data(), 1, size, file) == (size_t)size)
+            {
+                m_data = m_buffer.data();
+                m_size = m_buffer.size();
+            }
+        }
+    }
+    fclose(file);
+}   // MappedFile(path)
+
+// ----------------------------------------------------------------------------
+/** Gives access to the rest of an irrlicht file, starting at its current
+ *  position. The file is mapped if it is a plain file on disk, otherwise
+ *  the rest of it is read with one call.
+ *  \param file The file to read.
+ */
+MappedFile::MappedFile(irr::io::IReadFile *file)
+{
+    m_data         = NULL;
+    m_size         = 0;
+    m_mapping      = NULL;
+    m_mapping_size = 0;
+    const long pos  = file->getPos();
+    const long size = file->getSize();
+    if (pos < 0 || size <= pos)
+        return;
+
+    // Only a plain file on disk is mapped: a file in an archive (or in
+    // memory) can have the same name as a different file on disk.
+    if (dynamic_cast<irr::io::CReadFile*>(file) &&
+        map(file->getFileName().c_str()) && m_mapping_size == (size_t)size)
+    {
+        m_data = (const uint8_t*)m_mapping + pos;
+        m_size = size - pos;
+        return;
+    }
+    unmap();
+
+    m_buffer.resize(size - pos);
+    if (file->read(m_buffer.data(), (unsigned)m_buffer.size()) ==
+        (int)m_buffer.size())
+    {
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+}   // MappedFile(IReadFile)
+
+// ----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    unmap();
+}   // ~MappedFile
+
+// ----------------------------------------------------------------------------
+/** Maps the whole file into memory.
+ *  \param path Full path of the file.
+ *  \return True if the file is mapped.
+ */
+bool MappedFile::map(const std::string &path)
+{
+#if defined(WIN32) && !defined(__CYGWIN__)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0,
+                                        NULL);
+    void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+                         : NULL;
+    if (!data)
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_file_handle    = file;
+    m_mapping_handle = mapping;
+    m_mapping        = data;
+    m_mapping_size   = (size_t)size.QuadPart;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the file is closed
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    m_mapping      = data;
+    m_mapping_size = st.st_size;
+#endif
+    return true;
+}   // map
+
+// ----------------------------------------------------------------------------
+/** Removes the mapping (if any). */
+void MappedFile::unmap()
+{
+    if (!m_mapping)
+        return;
+#if defined(WIN32) && !defined(__CYGWIN__)
+    UnmapViewOfFile(m_mapping);
+    CloseHandle(m_mapping_handle);
+    CloseHandle(m_file_handle);
+#else
+    munmap(m_mapping, m_mapping_size);
+#endif
+    m_mapping      = NULL;
+    m_mapping_size = 0;
+}   // unmap
@@ -0,0 +1,84 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_MAPPED_FILE_HPP
+#define HEADER_MAPPED_FILE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace irr
+{
+    namespace io { class IReadFile; }
+}
+
+/** \class MappedFile
+ *  \brief Gives read-only access to the whole content of a file.
+ *  If possible the file is mapped into memory, so the operating system
+ *  loads the pages on demand and no copy of the data is made. Otherwise
+ *  (e.g. for a file in an archive) the content is read with one call into
+ *  a buffer. In both cases the data is valid until the object is deleted.
+ *  \ingroup io
+ */
+class MappedFile : public NoCopy
+{
+private:
+    /** The content of the file, NULL if the file could not be read. */
+    const uint8_t *m_data;
+
+    /** Size of the content in bytes. */
+    size_t m_size;
+
+    /** Start and size of the mapping, which can start before m_data if
+     *  the file was already partly read. */
+    void  *m_mapping;
+    size_t m_mapping_size;
+
+#if defined(WIN32) && !defined(__CYGWIN__)
+    /** Handles of the file and of the mapping object. */
+    void *m_file_handle;
+    void *m_mapping_handle;
+#endif
+
+    /** The content if the file could not be mapped. */
+    std::vector<uint8_t> m_buffer;
+
+    bool map(const std::string &path);
+    void unmap();
+
+public:
+         MappedFile(const std::string &path);
+         MappedFile(irr::io::IReadFile *file);
+        ~MappedFile();
+    // ------------------------------------------------------------------------
+    /** Returns the content of the file, or NULL if it could not be read. */
+    const uint8_t *getData() const { return m_data; }
+    // ------------------------------------------------------------------------
+    /** Returns the size of the content in bytes. */
+    size_t getSize() const { return m_size; }
+    // ------------------------------------------------------------------------
+    /** Returns true if the file is mapped, false if it was copied. */
+    bool isMapped() const { return m_mapping != NULL; }
+};   // MappedFile
+
+#endif
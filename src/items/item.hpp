@@ -202,6 +202,11 @@ public:
         lc.setY(lc.getY() / 2.0f);
         return lc.length2() < m_distance_2;
     }   // hitKart
+    // ------------------------------------------------------------------------
+    /** Returns a distance so that hitKart is always false for a kart that is
+     *  further away from this item. Since hitKart halves the vertical
+     *  distance, this is twice the hit radius. */
+    float getMaxHitDistance() const { return 2.0f * sqrtf(m_distance_2); }
 
 protected:
     // ------------------------------------------------------------------------
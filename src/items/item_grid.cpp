@@ -0,0 +1,180 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "items/item_grid.hpp"
+
+#include "items/item.hpp"
+
+#include <algorithm>
+#include <random>
+
+const float ItemGrid::CELL_SIZE = 4.0f;
+
+/** Compares items by their item id. */
+static bool compareItemId(const Item *a, const Item *b)
+{
+    return a->getItemId() < b->getItemId();
+}   // compareItemId
+
+// ----------------------------------------------------------------------------
+ItemGrid::ItemGrid()
+{
+    m_buckets.resize(NUM_BUCKETS);
+}   // ItemGrid
+
+// ----------------------------------------------------------------------------
+/** Returns the range of cells that contain all points in the XZ plane that
+ *  are closer than radius to the given position.
+ */
+void ItemGrid::getCellRange(const Vec3 &xyz, float radius, int *min_x,
+                            int *min_z, int *max_x, int *max_z) const
+{
+    *min_x = getCell(xyz.getX() - radius);
+    *min_z = getCell(xyz.getZ() - radius);
+    *max_x = getCell(xyz.getX() + radius);
+    *max_z = getCell(xyz.getZ() + radius);
+}   // getCellRange
+
+// ----------------------------------------------------------------------------
+/** Adds an item to all cells within its maximum hit distance. The item id
+ *  must be set and must not change while the item is in the grid.
+ *  \param item The item to add.
+ */
+void ItemGrid::insert(Item *item)
+{
+    int min_x, min_z, max_x, max_z;
+    getCellRange(item->getXYZ(), item->getMaxHitDistance(),
+                 &min_x, &min_z, &max_x, &max_z);
+    for (int z = min_z; z <= max_z; z++)
+    {
+        for (int x = min_x; x <= max_x; x++)
+        {
+            std::vector<Item*> &bucket = m_buckets[getBucket(x, z)];
+            std::vector<Item*>::iterator it =
+                std::lower_bound(bucket.begin(), bucket.end(), item,
+                                 compareItemId);
+            // Several cells of a large item can share a bucket
+            if (it == bucket.end() || *it != item)
+                bucket.insert(it, item);
+        }
+    }
+}   // insert
+
+// ----------------------------------------------------------------------------
+/** Removes an item from all cells it was added to.
+ *  \param item The item to remove.
+ */
+void ItemGrid::remove(Item *item)
+{
+    int min_x, min_z, max_x, max_z;
+    getCellRange(item->getXYZ(), item->getMaxHitDistance(),
+                 &min_x, &min_z, &max_x, &max_z);
+    for (int z = min_z; z <= max_z; z++)
+    {
+        for (int x = min_x; x <= max_x; x++)
+        {
+            std::vector<Item*> &bucket = m_buckets[getBucket(x, z)];
+            std::vector<Item*>::iterator it =
+                std::lower_bound(bucket.begin(), bucket.end(), item,
+                                 compareItemId);
+            if (it != bucket.end() && *it == item)
+                bucket.erase(it);
+        }
+    }
+}   // remove
+
+// ----------------------------------------------------------------------------
+/** Inserts and removes items in the same way as the ItemManager (deleted
+ *  items, e.g. used up bubble gums, free their id, which is then reused),
+ *  and checks that the grid finds exactly the items, in the same order,
+ *  that testing all items finds. Trigger items are used, since they don't
+ *  need a scene node.
+ */
+void ItemGrid::unitTesting()
+{
+    std::mt19937 random(4321);
+    std::uniform_real_distribution<float> random_xz(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> random_y(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> random_distance(0.3f, 6.0f);
+    std::uniform_int_distribution<int> random_action(0, 9);
+
+    ItemGrid grid;
+    std::vector<Item*> all_items;
+    unsigned int num_items = 0;
+    for (unsigned int step = 0; step < 3000; step++)
+    {
+        if (random_action(random) < 6 || num_items == 0)
+        {
+            Item *item = new Item(Vec3(random_xz(random), random_y(random),
+                                       random_xz(random)),
+                                  random_distance(random), NULL);
+            // Reuse the last free id, like ItemManager::insertItem
+            int index = (int)all_items.size() - 1;
+            while (index >= 0 && all_items[index])
+                index--;
+            if (index == -1)
+            {
+                index = (int)all_items.size();
+                all_items.push_back(item);
+            }
+            else
+                all_items[index] = item;
+            item->setItemId(index);
+            grid.insert(item);
+            num_items++;
+        }
+        else
+        {
+            std::uniform_int_distribution<int> random_index(
+                0, (int)all_items.size() - 1);
+            Item *item = all_items[random_index(random)];
+            if (!item) continue;
+            grid.remove(item);
+            all_items[item->getItemId()] = NULL;
+            delete item;
+            num_items--;
+        }
+
+        if (step % 10 != 0) continue;
+        for (unsigned int k = 0; k < 20; k++)
+        {
+            const Vec3 xyz(random_xz(random), random_y(random),
+                           random_xz(random));
+            std::vector<Item*> linear, from_grid;
+            for (unsigned int i = 0; i < all_items.size(); i++)
+            {
+                if (all_items[i] && all_items[i]->hitKart(xyz))
+                    linear.push_back(all_items[i]);
+            }
+            const std::vector<Item*> &candidates = grid.getHitCandidates(xyz);
+            for (unsigned int i = 0; i < candidates.size(); i++)
+            {
+                assert(i == 0 || candidates[i - 1]->getItemId() <
+                                 candidates[i]->getItemId());
+                assert(all_items[candidates[i]->getItemId()] ==
+                       candidates[i]);
+                if (candidates[i]->hitKart(xyz))
+                    from_grid.push_back(candidates[i]);
+            }
+            assert(linear == from_grid);
+        }   // for k < 20
+    }   // for step < 3000
+
+    for (unsigned int i = 0; i < all_items.size(); i++)
+        delete all_items[i];
+}   // unitTesting
@@ -0,0 +1,80 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_ITEM_GRID_HPP
+#define HEADER_ITEM_GRID_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
+
+#include <vector>
+
+class Item;
+
+/** \brief A uniform grid in the XZ plane to find the items a kart can hit.
+ *  The grid is unbounded: cells are hashed into a fixed number of buckets,
+ *  so it works for items on and off the track, and for tracks without a
+ *  drive graph. An item is stored in all cells that are closer to the item
+ *  than Item::getMaxHitDistance, so the bucket of a kart's cell contains
+ *  all items the kart can hit. Different cells can share a bucket, which
+ *  only adds candidates. The items in a bucket are sorted by item id, so
+ *  they are processed in the same order as in the list of all items.
+ *  \ingroup items
+ */
+class ItemGrid : public NoCopy
+{
+private:
+    /** Side length of a cell. */
+    static const float CELL_SIZE;
+
+    /** Number of buckets, must be a power of 2. */
+    static const unsigned int NUM_BUCKETS = 4096;
+
+    /** The items of all cells that are hashed into a bucket, sorted by
+     *  item id. */
+    std::vector< std::vector<Item*> > m_buckets;
+
+    void getCellRange(const Vec3 &xyz, float radius, int *min_x, int *min_z,
+                      int *max_x, int *max_z) const;
+    // ------------------------------------------------------------------------
+    /** Returns the cell index for a coordinate. */
+    int getCell(float f) const { return (int)floorf(f / CELL_SIZE); }
+    // ------------------------------------------------------------------------
+    /** Returns the bucket a cell is hashed into. */
+    unsigned int getBucket(int x, int z) const
+    {
+        return ((unsigned int)x * 73856093u ^ (unsigned int)z * 19349663u)
+               & (NUM_BUCKETS - 1);
+    }   // getBucket
+
+public:
+    static void unitTesting();
+
+         ItemGrid();
+    void insert(Item *item);
+    void remove(Item *item);
+    // ------------------------------------------------------------------------
+    /** Returns a list of items, sorted by item id, which contains all items
+     *  that a kart at the given position can hit (and usually some more). */
+    const std::vector<Item*>& getHitCandidates(const Vec3 &xyz) const
+    {
+        return m_buckets[getBucket(getCell(xyz.getX()), getCell(xyz.getZ()))];
+    }   // getHitCandidates
+};   // ItemGrid
+
+#endif
@@ -228,6 +228,7 @@ void ItemManager::insertItem(Item *item)
     else
         m_all_items.push_back(item);
     item->setItemId(index);
+    m_item_grid.insert(item);
 
     // Now insert into the appropriate quad list, if there is a quad list
     // (i.e. race mode has a quad graph).
@@ -315,19 +316,15 @@ void ItemManager::collectedItem(Item *item, AbstractKart *kart, int add_info)
  */
 void  ItemManager::checkItemHit(AbstractKart* kart)
 {
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
-
-    for(AllItemTypes::iterator i =m_all_items.begin();
-        i!=m_all_items.end();  i++)
+    // The grid returns all items that can be hit at the kart's position
+    // (plus a few more), sorted by item id, so the items are collected in
+    // the same order as when testing all items.
+    const AllItemTypes &candidates =
+        m_item_grid.getHitCandidates(kart->getXYZ());
+    for(AllItemTypes::const_iterator i =candidates.begin();
+        i!=candidates.end();  i++)
     {
-        if((!*i) || (*i)->wasCollected()) continue;
+        if((*i)->wasCollected()) continue;
         // To allow inlining and avoid including kart.hpp in item.hpp,
         // we pass the kart and the position separately.
         if((*i)->hitKart(kart->getXYZ(), kart))
@@ -344,7 +341,7 @@ void  ItemManager::checkItemHit(AbstractKart* kart)
                 RaceEventManager::getInstance()->collectedItem(*i, kart);
             }
         }   // if hit
-    }   // for m_all_items
+    }   // for candidates
 }   // checkItemHit
 
 //-----------------------------------------------------------------------------
@@ -445,6 +442,7 @@ void ItemManager::deleteItem(Item *item)
         assert(it!=items.end());
         items.erase(it);
     }   // if m_items_in_quads
+    m_item_grid.remove(item);
 
     int index = item->getItemId();
     m_all_items[index] = NULL;
@@ -22,6 +22,7 @@
 #include "LinearMath/btTransform.h"
 
 #include "items/item.hpp"
+#include "items/item_grid.hpp"
 #include "utils/aligned_array.hpp"
 #include "utils/no_copy.hpp"
 
@@ -85,6 +86,9 @@ private:
      *  field is undefined if no Graph exist, e.g. arena without navmesh. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** All items sorted into a grid, used to find the items a kart hits. */
+    ItemGrid m_item_grid;
+
     /** What item this item is switched to. */
     std::vector<Item::ItemType> m_switch_to;
 
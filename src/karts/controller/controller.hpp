@@ -62,6 +62,13 @@ public:
     virtual      ~Controller         () {};
     virtual void  reset              () = 0;
     virtual void  update             (int ticks) = 0;
+    // ------------------------------------------------------------------------
+    /** Called for all karts at the start of a time step, before any kart is
+     *  updated. It can be used to do expensive computations for the next
+     *  update() in advance. It is called from several threads at the same
+     *  time, so it must only read shared state (which does not change while
+     *  it runs), and only write to this controller. */
+    virtual void  prepareUpdate      (int ticks) {}
     virtual void  handleZipper       (bool play_sound) = 0;
     virtual void  collectedItem      (const Item &item, int add_info=-1,
                                       float previous_energy=0) = 0;
@@ -161,6 +161,7 @@ void SkiddingAI::reset()
 {
     m_time_since_last_shot       = 0.0f;
     m_start_kart_crash_direction = 0;
+    m_crashes_prepared           = false;
     m_start_delay                = -1;
     m_time_since_stuck           = 0.0f;
     m_kart_ahead                 = NULL;
@@ -311,8 +312,16 @@ void SkiddingAI::update(int ticks)
     m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI,
                         m_ai_properties->getSpeedCap(m_distance_to_player),
                         /*fade_in_time*/0);
-    //Detect if we are going to crash with the track and/or kart
-    checkCrashes(m_kart->getXYZ());
+    // Crashes with the track and/or karts are normally detected in
+    // prepareUpdate already. It skips karts which it expects to return
+    // early above, so check here if the state of the kart changed since.
+    if (!m_crashes_prepared)
+    {
+        const KartStateSnapshot &snapshot = m_world->getKartSnapshot();
+        const unsigned int id = m_kart->getWorldKartId();
+        checkCrashes(snapshot.getXYZ(id), snapshot.getForwardSpeed(id));
+    }
+    m_crashes_prepared = false;
     determineTrackDirection();
 
     int item_skill = computeSkill(ITEM_SKILL);
@@ -375,6 +384,26 @@ void SkiddingAI::update(int ticks)
     AIBaseLapController::update(ticks);
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Detects crashes before the kart is updated, which can be done in parallel
+ *  for all AI karts. The position and speed of the kart are taken from the
+ *  world's kart snapshot, which contains the values the kart will have
+ *  during its update. The world calls this before each update, with or
+ *  without threads, so the AI always uses the same input. Nothing is done
+ *  if update() will return before it uses the crash information.
+ */
+void SkiddingAI::prepareUpdate(int ticks)
+{
+    m_crashes_prepared = false;
+    if (m_kart->getKartAnimation() || isStuck() || m_world->isStartPhase())
+        return;
+
+    const KartStateSnapshot &snapshot = m_world->getKartSnapshot();
+    const unsigned int id = m_kart->getWorldKartId();
+    checkCrashes(snapshot.getXYZ(id), snapshot.getForwardSpeed(id));
+    m_crashes_prepared = true;
+}   // prepareUpdate
+
 //-----------------------------------------------------------------------------
 /** This function decides if the AI should brake.
  *  The decision can be based on race mode (e.g. in follow the leader the AI
@@ -2334,9 +2363,9 @@ int SkiddingAI::computeSkill(SkillType type)
 } //computeSkill
 
 //-----------------------------------------------------------------------------
-void SkiddingAI::checkCrashes(const Vec3& pos )
+void SkiddingAI::checkCrashes(const Vec3& pos, float forward_speed)
 {
-    int steps = int( m_kart->getVelocityLC().getZ() / m_kart_length );
+    int steps = int( forward_speed / m_kart_length );
     if( steps < 2 ) steps = 2;
 
     // The AI drives significantly better with more steps, so for now
@@ -2366,8 +2395,6 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
         m_crashes.m_kart = slip->getSlipstreamTarget()->getWorldKartId();
     }
 
-    const size_t NUM_KARTS = m_world->getNumKarts();
-
     float speed = m_kart->getVelocity().length();
     // If the velocity is zero, no sense in checking for crashes in time
     if(speed==0) return;
@@ -2382,35 +2409,29 @@ void SkiddingAI::checkCrashes(const Vec3& pos )
     {
         Log::warn(getControllerName().c_str(),
                   "Incorrect STEPS=%d. kart_length %f velocity %f",
-                  steps, m_kart_length, m_kart->getVelocityLC().getZ());
+                  steps, m_kart_length, forward_speed);
         steps=1000;
     }
+    /* Find if we crash with any kart, as long as we haven't found one
+     * yet. The crash only counts if it happens before we crash with the
+     * track, which is tested below.
+     */
+    int crash_kart      = -1;
+    int kart_crash_step = steps;
+    if( m_crashes.m_kart == -1 )
+    {
+        crash_kart = m_world->getKartSnapshot().findKartCrash(
+                         m_kart->getWorldKartId(), pos, vel_normal,
+                         forward_speed, m_kart_length, dt,
+                         steps, &kart_crash_step);
+    }
+
     for(int i = 1; steps > i; ++i)
     {
         Vec3 step_coord = pos + vel_normal* m_kart_length * float(i);
 
-        /* Find if we crash with any kart, as long as we haven't found one
-         * yet
-         */
-        if( m_crashes.m_kart == -1 )
-        {
-            for( unsigned int j = 0; j < NUM_KARTS; ++j )
-            {
-                const AbstractKart* kart = m_world->getKart(j);
-                // Ignore eliminated karts
-                if(kart==m_kart||kart->isEliminated()||kart->isGhostKart()) continue;
-                const AbstractKart *other_kart = m_world->getKart(j);
-                // Ignore karts ahead that are faster than this kart.
-                if(m_kart->getVelocityLC().getZ() < other_kart->getVelocityLC().getZ())
-                    continue;
-                Vec3 other_kart_xyz = other_kart->getXYZ()
-                                    + other_kart->getVelocity()*(i*dt);
-                float kart_distance = (step_coord - other_kart_xyz).length();
-
-                if( kart_distance < m_kart_length)
-                    m_crashes.m_kart = j;
-            }
-        }
+        if(i == kart_crash_step)
+            m_crashes.m_kart = crash_kart;
 
         /*Find if we crash with the drivelines*/
         if(current_node!=Graph::UNKNOWN_SECTOR &&
@@ -125,6 +125,9 @@ private:
         void clear() {m_road = false; m_kart = -1;}
     } m_crashes;
 
+    /** True if m_crashes was computed by prepareUpdate in this time step. */
+    bool m_crashes_prepared;
+
     RaceManager::AISuperPower m_superpower;
 
     /*General purpose variables*/
@@ -271,7 +274,7 @@ private:
                         std::vector<const Item *> *items_to_avoid,
                         std::vector<const Item *> *items_to_collect);
 
-    void  checkCrashes(const Vec3& pos);
+    void  checkCrashes(const Vec3& pos, float forward_speed);
     void  findNonCrashingPointFixed(Vec3 *result, int *last_node);
     void  findNonCrashingPointNew(Vec3 *result, int *last_node);
     void  findNonCrashingPoint(Vec3 *result, int *last_node);
@@ -288,6 +291,7 @@ public:
                  SkiddingAI(AbstractKart *kart);
                 ~SkiddingAI();
     virtual void update      (int ticks);
+    virtual void prepareUpdate(int ticks);
     virtual void reset       ();
     virtual const irr::core::stringw& getNamePostfix() const;
 };
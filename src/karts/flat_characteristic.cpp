@@ -0,0 +1,547 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "karts/flat_characteristic.hpp"
+
+#include "karts/cached_characteristic.hpp"
+#include "karts/kart_properties.hpp"
+#include "karts/kart_properties_manager.hpp"
+#include "utils/interpolation_array.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+
+#include <cmath>
+
+// ----------------------------------------------------------------------------
+/** Copies the values of a vector. Values that do not fit into the array are
+ *  dropped with a warning.
+ *  \param values The values to copy.
+ */
+void FlatCharacteristic::FloatArray::set(const std::vector<float> &values)
+{
+    m_size = (unsigned int)values.size();
+    if (m_size > MAX_ARRAY_SIZE)
+    {
+        Log::warn("FlatCharacteristic", "Only %d of %d array values are used.",
+                  MAX_ARRAY_SIZE, m_size);
+        m_size = MAX_ARRAY_SIZE;
+    }
+    for (unsigned int i = 0; i < m_size; i++)
+        m_values[i] = values[i];
+}   // FloatArray::set
+
+// ============================================================================
+/** Copies the points of an InterpolationArray. Points that do not fit into
+ *  the array are dropped with a warning.
+ *  \param values The interpolation array to copy.
+ */
+void FlatCharacteristic::Interpolation::set(const InterpolationArray &values)
+{
+    m_size = values.size();
+    if (m_size > MAX_ARRAY_SIZE)
+    {
+        Log::warn("FlatCharacteristic",
+                  "Only %d of %d interpolation points are used.",
+                  MAX_ARRAY_SIZE, m_size);
+        m_size = MAX_ARRAY_SIZE;
+    }
+    for (unsigned int i = 0; i < m_size; i++)
+    {
+        m_x[i] = values.getX(i);
+        m_y[i] = values.getY(i);
+        if (i == 0) continue;
+        // Same as InterpolationArray::push_back, which avoids a division
+        // by zero for two equal x values
+        if (m_x[i] == m_x[i - 1])
+            m_delta[i - 1] = (m_y[i] - m_y[i - 1]) / 0.001f;
+        else
+            m_delta[i - 1] = (m_y[i] - m_y[i - 1]) / (m_x[i] - m_x[i - 1]);
+    }
+}   // Interpolation::set
+
+// ----------------------------------------------------------------------------
+/** Sets the Y value for a specified point. */
+void FlatCharacteristic::Interpolation::setY(unsigned int i, float y)
+{
+    m_y[i] = y;
+    if (i > 0)
+        m_delta[i - 1] = (m_y[i] - m_y[i - 1]) / (m_x[i] - m_x[i - 1]);
+    if (i + 1 < m_size)
+        m_delta[i] = (m_y[i + 1] - m_y[i]) / (m_x[i + 1] - m_x[i]);
+}   // Interpolation::setY
+
+// ----------------------------------------------------------------------------
+/** Returns the interpolated Y value for a given x. An empty interpolation
+ *  (one that is not set by any source) returns 0, like an unset float. */
+float FlatCharacteristic::Interpolation::get(float x) const
+{
+    if (m_size == 0)
+        return 0;
+    if (m_size == 1 || x < m_x[0])
+        return m_y[0];
+
+    if (x > m_x[m_size - 1])
+        return m_y[m_size - 1];
+
+    for (unsigned int i = 1; i < m_size; i++)
+    {
+        if (x > m_x[i]) continue;
+        return m_y[i - 1] + m_delta[i - 1] * (x - m_x[i - 1]);
+    }
+    assert(false); return 0;  // keep compiler happy
+}   // Interpolation::get
+
+// ----------------------------------------------------------------------------
+/** Returns the X value necessary for a specified Y value. If it's not
+ *  possible to find a corresponding X (y is too small or too large),
+ *  x_min or x_max is returned. */
+float FlatCharacteristic::Interpolation::getReverse(float y) const
+{
+    if (m_size == 0) return 0;
+    if (m_size == 1) return m_x[0];
+
+    const bool decreasing = m_y[1] < m_y[0];
+    if (decreasing ? y > m_y[0] : y < m_y[0])
+        return m_x[0];
+
+    for (unsigned int i = 1; i < m_size; i++)
+    {
+        if (decreasing ? y < m_y[i] : y > m_y[i]) continue;
+        return m_x[i - 1] + (y - m_y[i - 1]) / m_delta[i - 1];
+    }
+    return m_x[m_size - 1];
+}   // Interpolation::getReverse
+
+// ============================================================================
+/** Reads all values of a characteristic.
+ *  \param c The characteristic, usually the combination of all sources that
+ *         apply to a kart.
+ */
+void FlatCharacteristic::update(const AbstractCharacteristic *c)
+{
+    // Script-generated content generated by tools/create_kart_properties.py flatload
+    // Please don't change the following tag. It will be automatically detected
+    // by the script and replace the contained content.
+    // To update the code, use tools/update_characteristics.py
+    /* <characteristics-start flatload> */
+    load(c, AbstractCharacteristic::SUSPENSION_STIFFNESS,
+         &m_suspension_stiffness);
+    load(c, AbstractCharacteristic::SUSPENSION_REST,
+         &m_suspension_rest);
+    load(c, AbstractCharacteristic::SUSPENSION_TRAVEL,
+         &m_suspension_travel);
+    load(c, AbstractCharacteristic::SUSPENSION_EXP_SPRING_RESPONSE,
+         &m_suspension_exp_spring_response);
+    load(c, AbstractCharacteristic::SUSPENSION_MAX_FORCE,
+         &m_suspension_max_force);
+    load(c, AbstractCharacteristic::STABILITY_ROLL_INFLUENCE,
+         &m_stability_roll_influence);
+    load(c, AbstractCharacteristic::STABILITY_CHASSIS_LINEAR_DAMPING,
+         &m_stability_chassis_linear_damping);
+    load(c, AbstractCharacteristic::STABILITY_CHASSIS_ANGULAR_DAMPING,
+         &m_stability_chassis_angular_damping);
+    load(c, AbstractCharacteristic::STABILITY_DOWNWARD_IMPULSE_FACTOR,
+         &m_stability_downward_impulse_factor);
+    load(c, AbstractCharacteristic::STABILITY_TRACK_CONNECTION_ACCEL,
+         &m_stability_track_connection_accel);
+    load(c, AbstractCharacteristic::STABILITY_ANGULAR_FACTOR,
+         &m_stability_angular_factor);
+    load(c, AbstractCharacteristic::STABILITY_SMOOTH_FLYING_IMPULSE,
+         &m_stability_smooth_flying_impulse);
+    load(c, AbstractCharacteristic::TURN_RADIUS,
+         &m_turn_radius);
+    load(c, AbstractCharacteristic::TURN_TIME_RESET_STEER,
+         &m_turn_time_reset_steer);
+    load(c, AbstractCharacteristic::TURN_TIME_FULL_STEER,
+         &m_turn_time_full_steer);
+    load(c, AbstractCharacteristic::ENGINE_POWER,
+         &m_engine_power);
+    load(c, AbstractCharacteristic::ENGINE_MAX_SPEED,
+         &m_engine_max_speed);
+    load(c, AbstractCharacteristic::ENGINE_BRAKE_FACTOR,
+         &m_engine_brake_factor);
+    load(c, AbstractCharacteristic::ENGINE_BRAKE_TIME_INCREASE,
+         &m_engine_brake_time_increase);
+    load(c, AbstractCharacteristic::ENGINE_MAX_SPEED_REVERSE_RATIO,
+         &m_engine_max_speed_reverse_ratio);
+    load(c, AbstractCharacteristic::GEAR_SWITCH_RATIO,
+         &m_gear_switch_ratio);
+    load(c, AbstractCharacteristic::GEAR_POWER_INCREASE,
+         &m_gear_power_increase);
+    load(c, AbstractCharacteristic::MASS,
+         &m_mass);
+    load(c, AbstractCharacteristic::WHEELS_DAMPING_RELAXATION,
+         &m_wheels_damping_relaxation);
+    load(c, AbstractCharacteristic::WHEELS_DAMPING_COMPRESSION,
+         &m_wheels_damping_compression);
+    load(c, AbstractCharacteristic::CAMERA_DISTANCE,
+         &m_camera_distance);
+    load(c, AbstractCharacteristic::CAMERA_FORWARD_UP_ANGLE,
+         &m_camera_forward_up_angle);
+    load(c, AbstractCharacteristic::CAMERA_BACKWARD_UP_ANGLE,
+         &m_camera_backward_up_angle);
+    load(c, AbstractCharacteristic::JUMP_ANIMATION_TIME,
+         &m_jump_animation_time);
+    load(c, AbstractCharacteristic::LEAN_MAX,
+         &m_lean_max);
+    load(c, AbstractCharacteristic::LEAN_SPEED,
+         &m_lean_speed);
+    load(c, AbstractCharacteristic::ANVIL_DURATION,
+         &m_anvil_duration);
+    load(c, AbstractCharacteristic::ANVIL_WEIGHT,
+         &m_anvil_weight);
+    load(c, AbstractCharacteristic::ANVIL_SPEED_FACTOR,
+         &m_anvil_speed_factor);
+    load(c, AbstractCharacteristic::PARACHUTE_FRICTION,
+         &m_parachute_friction);
+    load(c, AbstractCharacteristic::PARACHUTE_DURATION,
+         &m_parachute_duration);
+    load(c, AbstractCharacteristic::PARACHUTE_DURATION_OTHER,
+         &m_parachute_duration_other);
+    load(c, AbstractCharacteristic::PARACHUTE_DURATION_RANK_MULT,
+         &m_parachute_duration_rank_mult);
+    load(c, AbstractCharacteristic::PARACHUTE_DURATION_SPEED_MULT,
+         &m_parachute_duration_speed_mult);
+    load(c, AbstractCharacteristic::PARACHUTE_LBOUND_FRACTION,
+         &m_parachute_lbound_fraction);
+    load(c, AbstractCharacteristic::PARACHUTE_UBOUND_FRACTION,
+         &m_parachute_ubound_fraction);
+    load(c, AbstractCharacteristic::PARACHUTE_MAX_SPEED,
+         &m_parachute_max_speed);
+    load(c, AbstractCharacteristic::FRICTION_KART_FRICTION,
+         &m_friction_kart_friction);
+    load(c, AbstractCharacteristic::BUBBLEGUM_DURATION,
+         &m_bubblegum_duration);
+    load(c, AbstractCharacteristic::BUBBLEGUM_SPEED_FRACTION,
+         &m_bubblegum_speed_fraction);
+    load(c, AbstractCharacteristic::BUBBLEGUM_TORQUE,
+         &m_bubblegum_torque);
+    load(c, AbstractCharacteristic::BUBBLEGUM_FADE_IN_TIME,
+         &m_bubblegum_fade_in_time);
+    load(c, AbstractCharacteristic::BUBBLEGUM_SHIELD_DURATION,
+         &m_bubblegum_shield_duration);
+    load(c, AbstractCharacteristic::ZIPPER_DURATION,
+         &m_zipper_duration);
+    load(c, AbstractCharacteristic::ZIPPER_FORCE,
+         &m_zipper_force);
+    load(c, AbstractCharacteristic::ZIPPER_SPEED_GAIN,
+         &m_zipper_speed_gain);
+    load(c, AbstractCharacteristic::ZIPPER_MAX_SPEED_INCREASE,
+         &m_zipper_max_speed_increase);
+    load(c, AbstractCharacteristic::ZIPPER_FADE_OUT_TIME,
+         &m_zipper_fade_out_time);
+    load(c, AbstractCharacteristic::SWATTER_DURATION,
+         &m_swatter_duration);
+    load(c, AbstractCharacteristic::SWATTER_DISTANCE,
+         &m_swatter_distance);
+    load(c, AbstractCharacteristic::SWATTER_SQUASH_DURATION,
+         &m_swatter_squash_duration);
+    load(c, AbstractCharacteristic::SWATTER_SQUASH_SLOWDOWN,
+         &m_swatter_squash_slowdown);
+    load(c, AbstractCharacteristic::PLUNGER_BAND_MAX_LENGTH,
+         &m_plunger_band_max_length);
+    load(c, AbstractCharacteristic::PLUNGER_BAND_FORCE,
+         &m_plunger_band_force);
+    load(c, AbstractCharacteristic::PLUNGER_BAND_DURATION,
+         &m_plunger_band_duration);
+    load(c, AbstractCharacteristic::PLUNGER_BAND_SPEED_INCREASE,
+         &m_plunger_band_speed_increase);
+    load(c, AbstractCharacteristic::PLUNGER_BAND_FADE_OUT_TIME,
+         &m_plunger_band_fade_out_time);
+    load(c, AbstractCharacteristic::PLUNGER_IN_FACE_TIME,
+         &m_plunger_in_face_time);
+    load(c, AbstractCharacteristic::STARTUP_TIME,
+         &m_startup_time);
+    load(c, AbstractCharacteristic::STARTUP_BOOST,
+         &m_startup_boost);
+    load(c, AbstractCharacteristic::RESCUE_DURATION,
+         &m_rescue_duration);
+    load(c, AbstractCharacteristic::RESCUE_VERT_OFFSET,
+         &m_rescue_vert_offset);
+    load(c, AbstractCharacteristic::RESCUE_HEIGHT,
+         &m_rescue_height);
+    load(c, AbstractCharacteristic::EXPLOSION_DURATION,
+         &m_explosion_duration);
+    load(c, AbstractCharacteristic::EXPLOSION_RADIUS,
+         &m_explosion_radius);
+    load(c, AbstractCharacteristic::EXPLOSION_INVULNERABILITY_TIME,
+         &m_explosion_invulnerability_time);
+    load(c, AbstractCharacteristic::NITRO_DURATION,
+         &m_nitro_duration);
+    load(c, AbstractCharacteristic::NITRO_ENGINE_FORCE,
+         &m_nitro_engine_force);
+    load(c, AbstractCharacteristic::NITRO_CONSUMPTION,
+         &m_nitro_consumption);
+    load(c, AbstractCharacteristic::NITRO_SMALL_CONTAINER,
+         &m_nitro_small_container);
+    load(c, AbstractCharacteristic::NITRO_BIG_CONTAINER,
+         &m_nitro_big_container);
+    load(c, AbstractCharacteristic::NITRO_MAX_SPEED_INCREASE,
+         &m_nitro_max_speed_increase);
+    load(c, AbstractCharacteristic::NITRO_FADE_OUT_TIME,
+         &m_nitro_fade_out_time);
+    load(c, AbstractCharacteristic::NITRO_MAX,
+         &m_nitro_max);
+    load(c, AbstractCharacteristic::SLIPSTREAM_DURATION_FACTOR,
+         &m_slipstream_duration_factor);
+    load(c, AbstractCharacteristic::SLIPSTREAM_BASE_SPEED,
+         &m_slipstream_base_speed);
+    load(c, AbstractCharacteristic::SLIPSTREAM_LENGTH,
+         &m_slipstream_length);
+    load(c, AbstractCharacteristic::SLIPSTREAM_WIDTH,
+         &m_slipstream_width);
+    load(c, AbstractCharacteristic::SLIPSTREAM_INNER_FACTOR,
+         &m_slipstream_inner_factor);
+    load(c, AbstractCharacteristic::SLIPSTREAM_MIN_COLLECT_TIME,
+         &m_slipstream_min_collect_time);
+    load(c, AbstractCharacteristic::SLIPSTREAM_MAX_COLLECT_TIME,
+         &m_slipstream_max_collect_time);
+    load(c, AbstractCharacteristic::SLIPSTREAM_ADD_POWER,
+         &m_slipstream_add_power);
+    load(c, AbstractCharacteristic::SLIPSTREAM_MIN_SPEED,
+         &m_slipstream_min_speed);
+    load(c, AbstractCharacteristic::SLIPSTREAM_MAX_SPEED_INCREASE,
+         &m_slipstream_max_speed_increase);
+    load(c, AbstractCharacteristic::SLIPSTREAM_FADE_OUT_TIME,
+         &m_slipstream_fade_out_time);
+    load(c, AbstractCharacteristic::SKID_INCREASE,
+         &m_skid_increase);
+    load(c, AbstractCharacteristic::SKID_DECREASE,
+         &m_skid_decrease);
+    load(c, AbstractCharacteristic::SKID_MAX,
+         &m_skid_max);
+    load(c, AbstractCharacteristic::SKID_TIME_TILL_MAX,
+         &m_skid_time_till_max);
+    load(c, AbstractCharacteristic::SKID_VISUAL,
+         &m_skid_visual);
+    load(c, AbstractCharacteristic::SKID_VISUAL_TIME,
+         &m_skid_visual_time);
+    load(c, AbstractCharacteristic::SKID_REVERT_VISUAL_TIME,
+         &m_skid_revert_visual_time);
+    load(c, AbstractCharacteristic::SKID_MIN_SPEED,
+         &m_skid_min_speed);
+    load(c, AbstractCharacteristic::SKID_TIME_TILL_BONUS,
+         &m_skid_time_till_bonus);
+    load(c, AbstractCharacteristic::SKID_BONUS_SPEED,
+         &m_skid_bonus_speed);
+    load(c, AbstractCharacteristic::SKID_BONUS_TIME,
+         &m_skid_bonus_time);
+    load(c, AbstractCharacteristic::SKID_BONUS_FORCE,
+         &m_skid_bonus_force);
+    load(c, AbstractCharacteristic::SKID_PHYSICAL_JUMP_TIME,
+         &m_skid_physical_jump_time);
+    load(c, AbstractCharacteristic::SKID_GRAPHICAL_JUMP_TIME,
+         &m_skid_graphical_jump_time);
+    load(c, AbstractCharacteristic::SKID_POST_SKID_ROTATE_FACTOR,
+         &m_skid_post_skid_rotate_factor);
+    load(c, AbstractCharacteristic::SKID_REDUCE_TURN_MIN,
+         &m_skid_reduce_turn_min);
+    load(c, AbstractCharacteristic::SKID_REDUCE_TURN_MAX,
+         &m_skid_reduce_turn_max);
+    load(c, AbstractCharacteristic::SKID_ENABLED,
+         &m_skid_enabled);
+
+    /* <characteristics-end flatload> */
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Reads one float value. A value that is not set by any source is 0. */
+void FlatCharacteristic::load(const AbstractCharacteristic *c,
+                              AbstractCharacteristic::CharacteristicType type,
+                              float *value)
+{
+    bool is_set = false;
+    c->process(type, value, &is_set);
+    if (!is_set)
+    {
+        Log::warn("FlatCharacteristic", "Characteristic %s is not set.",
+                  AbstractCharacteristic::getName(type).c_str());
+        *value = 0;
+    }
+}   // load(float)
+
+// ----------------------------------------------------------------------------
+/** Reads one bool value. A value that is not set by any source is false. */
+void FlatCharacteristic::load(const AbstractCharacteristic *c,
+                              AbstractCharacteristic::CharacteristicType type,
+                              bool *value)
+{
+    bool is_set = false;
+    c->process(type, value, &is_set);
+    if (!is_set)
+    {
+        Log::warn("FlatCharacteristic", "Characteristic %s is not set.",
+                  AbstractCharacteristic::getName(type).c_str());
+        *value = false;
+    }
+}   // load(bool)
+
+// ----------------------------------------------------------------------------
+/** Reads one float array. An array that is not set by any source is empty.
+ */
+void FlatCharacteristic::load(const AbstractCharacteristic *c,
+                              AbstractCharacteristic::CharacteristicType type,
+                              FloatArray *value)
+{
+    std::vector<float> values;
+    bool is_set = false;
+    c->process(type, &values, &is_set);
+    if (!is_set)
+        Log::warn("FlatCharacteristic", "Characteristic %s is not set.",
+                  AbstractCharacteristic::getName(type).c_str());
+    value->set(values);
+}   // load(FloatArray)
+
+// ----------------------------------------------------------------------------
+/** Reads one interpolation array. An array that is not set by any source is
+ *  empty. */
+void FlatCharacteristic::load(const AbstractCharacteristic *c,
+                              AbstractCharacteristic::CharacteristicType type,
+                              Interpolation *value)
+{
+    InterpolationArray values;
+    bool is_set = false;
+    c->process(type, &values, &is_set);
+    if (!is_set)
+        Log::warn("FlatCharacteristic", "Characteristic %s is not set.",
+                  AbstractCharacteristic::getName(type).c_str());
+    value->set(values);
+}   // load(Interpolation)
+
+// ============================================================================
+/** Reads the characteristics that a kart uses in one time step, in the same
+ *  way as Kart::update and the functions it calls (getActualWheelForce,
+ *  getMaxSteerAngle, getTimeFullSteer, Skidding::getSkidBonus, ...). It is
+ *  used with a KartProperties (flat values) and with a CachedCharacteristic
+ *  (the previous implementation of the KartProperties getters).
+ */
+template<typename T>
+static float readTickCharacteristics(const T &c, float wheel_base,
+                                     float speed, float skid_time,
+                                     float steer)
+{
+    float result = 0;
+
+    // Kart::getActualWheelForce
+    const auto &gear_ratio = c.getGearSwitchRatio();
+    for (unsigned int i = 0; i < gear_ratio.size(); i++)
+    {
+        if (speed <= c.getEngineMaxSpeed() * gear_ratio[i])
+        {
+            result += c.getEnginePower() * c.getGearPowerIncrease()[i];
+            break;
+        }
+    }
+
+    // Kart::getMaxSteerAngle
+    auto turn_angle_at_speed = c.getTurnRadius();
+    for (int i = 0; i < (int)turn_angle_at_speed.size(); i++)
+        turn_angle_at_speed.setY(i, sin(wheel_base /
+                                        turn_angle_at_speed.getY(i)));
+    result += turn_angle_at_speed.get(speed);
+
+    // Kart::getTimeFullSteer
+    result += c.getTurnTimeFullSteer().get(steer);
+
+    // Skidding::getSkidBonus
+    for (unsigned int i = 0; i < c.getSkidBonusSpeed().size(); i++)
+    {
+        if (skid_time <= c.getSkidTimeTillBonus()[i]) break;
+        result += c.getSkidBonusSpeed()[i] + c.getSkidBonusTime()[i]
+                + c.getSkidBonusForce()[i];
+    }
+
+    // Single values read in Kart::update, updateEnginePowerAndBrakes,
+    // updateNitro, updateSliding and Skidding::update
+    result += c.getEngineMaxSpeed() * c.getEngineMaxSpeedReverseRatio()
+            + c.getEngineBrakeFactor() + c.getEngineBrakeTimeIncrease()
+            + c.getNitroConsumption() + c.getNitroEngineForce()
+            + c.getNitroMax() + c.getSkidVisual() + c.getSkidVisualTime()
+            + c.getSkidMinSpeed() + c.getSkidIncrease() + c.getSkidDecrease()
+            + c.getSkidMax() + c.getSkidTimeTillMax()
+            + c.getSkidReduceTurnMin() + c.getLeanMax() + c.getLeanSpeed()
+            + c.getStabilityDownwardImpulseFactor()
+            + c.getStabilityTrackConnectionAccel()
+            + c.getStabilityChassisAngularDamping() + c.getMass();
+    if (c.getSkidEnabled())
+        result += 1.0f;
+    return result;
+}   // readTickCharacteristics
+
+// ----------------------------------------------------------------------------
+/** Compares the time needed to read the characteristics of one time step of
+ *  a kart through the previous CachedCharacteristic with the time needed by
+ *  the flat values in KartProperties, for all loaded karts.
+ */
+void FlatCharacteristic::runBenchmark()
+{
+    const unsigned int num_ticks = 200000;
+    Log::info("FlatCharacteristic", "%-20s %12s %12s %8s", "kart",
+              "cached ns", "flat ns", "result");
+
+    double total_cached = 0, total_flat = 0;
+    const unsigned int num_karts = kart_properties_manager->getNumberOfKarts();
+    for (unsigned int k = 0; k < num_karts; k++)
+    {
+        const KartProperties *kp = kart_properties_manager->getKartById(k);
+        CachedCharacteristic *cached =
+            new CachedCharacteristic(kp->getCombinedCharacteristic());
+        const float wheel_base = kp->getWheelBase();
+
+        // The objects are read through volatile pointers, so that the
+        // compiler can not move any reads out of the loop, just like in
+        // Kart::update, which reads them through m_kart_properties
+        const CachedCharacteristic * volatile cached_ptr = cached;
+        const KartProperties * volatile kp_ptr = kp;
+
+        float sum_cached = 0;
+        double start = StkTime::getRealTime();
+        for (unsigned int i = 0; i < num_ticks; i++)
+        {
+            sum_cached += readTickCharacteristics(*cached_ptr, wheel_base,
+                                                  (i % 40) * 1.0f,
+                                                  (i % 50) * 0.1f,
+                                                  (i % 10) * 0.1f);
+        }
+        const double time_cached = StkTime::getRealTime() - start;
+
+        float sum_flat = 0;
+        start = StkTime::getRealTime();
+        for (unsigned int i = 0; i < num_ticks; i++)
+        {
+            sum_flat += readTickCharacteristics(*kp_ptr, wheel_base,
+                                                (i % 40) * 1.0f,
+                                                (i % 50) * 0.1f,
+                                                (i % 10) * 0.1f);
+        }
+        const double time_flat = StkTime::getRealTime() - start;
+
+        Log::info("FlatCharacteristic", "%-20s %12.2f %12.2f %8s",
+                  kp->getIdent().c_str(), time_cached * 1.0e9 / num_ticks,
+                  time_flat * 1.0e9 / num_ticks,
+                  sum_cached == sum_flat ? "same" : "DIFFERENT");
+        total_cached += time_cached;
+        total_flat   += time_flat;
+        delete cached;
+    }   // for k < num_karts
+
+    if (num_karts == 0) return;
+    Log::info("FlatCharacteristic", "%-20s %12.2f %12.2f", "average",
+              total_cached * 1.0e9 / (num_ticks * num_karts),
+              total_flat * 1.0e9 / (num_ticks * num_karts));
+}   // runBenchmark
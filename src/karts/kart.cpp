@@ -48,7 +48,6 @@
 #include "items/projectile_manager.hpp"
 #include "karts/abstract_characteristic.hpp"
 #include "karts/abstract_kart_animation.hpp"
-#include "karts/cached_characteristic.hpp"
 #include "karts/controller/end_controller.hpp"
 #include "karts/controller/spare_tire_ai.hpp"
 #include "karts/explosion_animation.hpp"
@@ -62,6 +61,7 @@
 #include "karts/skidding.hpp"
 #include "main_loop.hpp"
 #include "modes/overworld.hpp"
+#include "modes/profile_world.hpp"
 #include "modes/soccer_world.hpp"
 #include "modes/world.hpp"
 #include "modes/linear_world.hpp"
@@ -722,7 +722,8 @@ void Kart::createPhysics()
     trans.setIdentity();
     createBody(mass, trans, &m_kart_chassis,
                m_kart_properties->getRestitution());
-    std::vector<float> ang_fact = m_kart_properties->getStabilityAngularFactor();
+    const FlatCharacteristic::FloatArray &ang_fact =
+        m_kart_properties->getStabilityAngularFactor();
     // The angular factor (with X and Z values <1) helps to keep the kart
     // upright, especially in case of a collision.
     m_body->setAngularFactor(Vec3(ang_fact[0], ang_fact[1], ang_fact[2]));
@@ -869,7 +870,8 @@ void Kart::updateWeight()
  *  \param radius The radius for which the speed needs to be computed. */
 float Kart::getSpeedForTurnRadius(float radius) const
 {
-    InterpolationArray turn_angle_at_speed = m_kart_properties->getTurnRadius();
+    FlatCharacteristic::Interpolation turn_angle_at_speed =
+        m_kart_properties->getTurnRadius();
     // Convert the turn radius into turn angle
     for(int i = 0; i < (int)turn_angle_at_speed.size(); i++)
         turn_angle_at_speed.setY(i, sin(m_kart_properties->getWheelBase() /
@@ -883,7 +885,8 @@ float Kart::getSpeedForTurnRadius(float radius) const
 /** Returns the maximum steering angle (depending on speed). */
 float Kart::getMaxSteerAngle(float speed) const
 {
-    InterpolationArray turn_angle_at_speed = m_kart_properties->getTurnRadius();
+    FlatCharacteristic::Interpolation turn_angle_at_speed =
+        m_kart_properties->getTurnRadius();
     // Convert the turn radius into turn angle
     for(int i = 0; i < (int)turn_angle_at_speed.size(); i++)
         turn_angle_at_speed.setY(i, sin(m_kart_properties->getWheelBase() /
@@ -1104,7 +1107,8 @@ void Kart::collectedItem(Item *item, int add_info)
 float Kart::getStartupBoost() const
 {
     float t = stk_config->ticks2Time(World::getWorld()->getTicksSinceStart());
-    std::vector<float> startup_times = m_kart_properties->getStartupTime();
+    const FlatCharacteristic::FloatArray &startup_times =
+        m_kart_properties->getStartupTime();
     for (unsigned int i = 0; i < startup_times.size(); i++)
     {
         if (t <= startup_times[i])
@@ -1121,7 +1125,8 @@ float Kart::getActualWheelForce()
 {
     float add_force = m_max_speed->getCurrentAdditionalEngineForce();
     assert(!std::isnan(add_force));
-    const std::vector<float>& gear_ratio=m_kart_properties->getGearSwitchRatio();
+    const FlatCharacteristic::FloatArray &gear_ratio =
+        m_kart_properties->getGearSwitchRatio();
     for(unsigned int i=0; i<gear_ratio.size(); i++)
     {
         if(m_speed <= m_kart_properties->getEngineMaxSpeed() * gear_ratio[i])
@@ -1336,7 +1341,10 @@ void Kart::update(int ticks)
     // is used furthermore for engine power, camera distance etc
     updateSpeed();
 
-    m_controller->update(ticks);
+    {
+        ProfileWorld::SimTimer timer(ProfileWorld::SIM_AI);
+        m_controller->update(ticks);
+    }
 
 #ifndef SERVER_ONLY
 #undef DEBUG_CAMERA_SHAKE
@@ -0,0 +1,113 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "karts/kart_state_snapshot.hpp"
+
+#include "karts/abstract_kart.hpp"
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btMotionState.h"
+
+#include <limits>
+
+// ----------------------------------------------------------------------------
+/** Copies the position and velocity of all karts. The position is taken
+ *  from the physics body, i.e. it is the position each kart will have after
+ *  its own update in this time step.
+ *  \param karts All karts of the world.
+ */
+void KartStateSnapshot::update(const std::vector<AbstractKart*> &karts)
+{
+    const unsigned int n = (unsigned int)karts.size();
+    m_x.resize(n);  m_y.resize(n);  m_z.resize(n);
+    m_vx.resize(n); m_vy.resize(n); m_vz.resize(n);
+    m_forward_speed.resize(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const AbstractKart *kart = karts[i];
+        btTransform trans = kart->getTrans();
+        if (kart->getBody() && kart->getBody()->getInvMass() != 0)
+            kart->getBody()->getMotionState()->getWorldTransform(trans);
+        const Vec3 xyz = trans.getOrigin();
+        const Vec3 vel = kart->getVelocity();
+        m_x[i]  = xyz.getX(); m_y[i]  = xyz.getY(); m_z[i]  = xyz.getZ();
+        m_vx[i] = vel.getX(); m_vy[i] = vel.getY(); m_vz[i] = vel.getZ();
+        if (kart->isEliminated() || kart->isGhostKart())
+            m_forward_speed[i] = std::numeric_limits<float>::max();
+        else
+            m_forward_speed[i] = (vel * trans.getBasis()).getZ();
+    }
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Predicts if a kart will drive into another kart. The kart is moved along
+ *  the given direction in steps of step_length, and at step i the other
+ *  karts are moved with their velocity for i*dt. A crash happens if the
+ *  distance is less than step_length. Karts that are faster (in their
+ *  forward direction) than forward_speed are ignored, since they will drive
+ *  away.
+ *  \param kart_id World kart id of the kart doing the test, which is ignored.
+ *  \param xyz Position of the kart.
+ *  \param direction Normalised direction in which the kart is driving.
+ *  \param forward_speed Speed of the kart in its forward direction.
+ *  \param step_length Distance between two tested points (and minimum
+ *         distance to other karts).
+ *  \param dt Time it takes the kart to drive step_length.
+ *  \param steps Points 1 to steps-1 are tested.
+ *  \param crash_step On return the step at which the crash happens.
+ *  \return The id of the kart crashed into at the first step that has any
+ *          crash (the one with the highest id if several karts are hit), or
+ *          -1 if no crash happens.
+ */
+int KartStateSnapshot::findKartCrash(unsigned int kart_id, const Vec3 &xyz,
+                                     const Vec3 &direction,
+                                     float forward_speed, float step_length,
+                                     float dt, int steps,
+                                     int *crash_step) const
+{
+    const int n  = (int)m_x.size();
+    const int id = (int)kart_id;
+    const float min_dist_2 = step_length * step_length;
+    const float *x  = m_x.data(),  *y  = m_y.data(),  *z  = m_z.data();
+    const float *vx = m_vx.data(), *vy = m_vy.data(), *vz = m_vz.data();
+    const float *forward = m_forward_speed.data();
+    for (int i = 1; i < steps; i++)
+    {
+        const float sx = xyz.getX() + direction.getX() * step_length * i;
+        const float sy = xyz.getY() + direction.getY() * step_length * i;
+        const float sz = xyz.getZ() + direction.getZ() * step_length * i;
+        const float t  = i * dt;
+        // Branch free loop over all karts, so it can be vectorised
+        int hit = -1;
+        for (int j = 0; j < n; j++)
+        {
+            const float dx = sx - (x[j] + vx[j] * t);
+            const float dy = sy - (y[j] + vy[j] * t);
+            const float dz = sz - (z[j] + vz[j] * t);
+            const bool crash = (dx * dx + dy * dy + dz * dz < min_dist_2) &
+                               (forward[j] <= forward_speed) & (j != id);
+            hit = crash ? j : hit;
+        }
+        if (hit != -1)
+        {
+            *crash_step = i;
+            return hit;
+        }
+    }   // for i < steps
+    return -1;
+}   // findKartCrash
@@ -0,0 +1,73 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_KART_STATE_SNAPSHOT_HPP
+#define HEADER_KART_STATE_SNAPSHOT_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
+
+#include <vector>
+
+class AbstractKart;
+
+/** \brief A structure-of-arrays copy of the position and velocity of all
+ *  karts, taken once per time step by the world before the karts are
+ *  updated.
+ *  The AI uses it to predict collisions with other karts: the tests for
+ *  all karts are done in one pass over a few contiguous float arrays (which
+ *  the compiler can vectorise), instead of going through the kart objects.
+ *  Since it is taken before any kart is updated, all AI karts also see the
+ *  same state of the other karts, independent of the update order.
+ * \ingroup karts
+ */
+class KartStateSnapshot : public NoCopy
+{
+private:
+    /** Position of each kart. */
+    std::vector<float> m_x, m_y, m_z;
+
+    /** Velocity of each kart. */
+    std::vector<float> m_vx, m_vy, m_vz;
+
+    /** The velocity of each kart in its forward direction. This is set to
+     *  a very large value for karts that can not be crashed into (i.e.
+     *  eliminated and ghost karts), so that they are skipped by the test
+     *  that ignores faster karts. */
+    std::vector<float> m_forward_speed;
+
+public:
+    // ------------------------------------------------------------------------
+    void update(const std::vector<AbstractKart*> &karts);
+    // ------------------------------------------------------------------------
+    int  findKartCrash(unsigned int kart_id, const Vec3 &xyz,
+                       const Vec3 &direction, float forward_speed,
+                       float step_length, float dt, int steps,
+                       int *crash_step) const;
+    // ------------------------------------------------------------------------
+    /** Returns the number of karts in this snapshot. */
+    unsigned int getNumKarts() const { return (unsigned int)m_x.size(); }
+    // ------------------------------------------------------------------------
+    /** Returns the position of a kart. */
+    Vec3 getXYZ(unsigned int i) const { return Vec3(m_x[i], m_y[i], m_z[i]); }
+    // ------------------------------------------------------------------------
+    /** Returns the velocity of a kart in its forward direction. */
+    float getForwardSpeed(unsigned int i) const { return m_forward_speed[i]; }
+};   // KartStateSnapshot
+
+#endif
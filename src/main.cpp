@@ -191,7 +191,10 @@
 #include "graphics/particle_kind_manager.hpp"
 #include "graphics/referee.hpp"
 #include "graphics/sp/sp_base.hpp"
+#include "graphics/sp/sp_frustum_culling.hpp"
 #include "graphics/sp/sp_shader.hpp"
+#include "graphics/sp/sp_texture.hpp"
+#include "graphics/sp_mesh_loader.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/event_handler.hpp"
 #include "guiengine/dialog_queue.hpp"
@@ -201,18 +204,22 @@
 #include "input/wiimote_manager.hpp"
 #include "io/file_manager.hpp"
 #include "items/attachment_manager.hpp"
+#include "items/item_grid.hpp"
 #include "items/item_manager.hpp"
 #include "items/projectile_manager.hpp"
 #include "karts/combined_characteristic.hpp"
 #include "karts/controller/ai_base_lap_controller.hpp"
+#include "karts/flat_characteristic.hpp"
 #include "karts/kart_model.hpp"
 #include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "modes/cutscene_world.hpp"
 #include "modes/demo_world.hpp"
 #include "modes/profile_world.hpp"
+#include "network/bit_stream.hpp"
 #include "network/protocols/connect_to_server.hpp"
 #include "network/protocols/client_lobby.hpp"
+#include "network/protocols/game_protocol.hpp"
 #include "network/game_setup.hpp"
 #include "network/network_config.hpp"
 #include "network/network_string.hpp"
@@ -223,9 +230,12 @@
 #include "network/stk_host.hpp"
 #include "online/profile_manager.hpp"
 #include "online/request_manager.hpp"
+#include "physics/physics.hpp"
+#include "physics/triangle_mesh.hpp"
 #include "race/grand_prix_manager.hpp"
 #include "race/highscore_manager.hpp"
 #include "race/history.hpp"
+#include "race/history_stream.hpp"
 #include "race/race_manager.hpp"
 #include "replay/replay_play.hpp"
 #include "replay/replay_recorder.hpp"
@@ -245,6 +255,7 @@
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
 #include "utils/mini_glm.hpp"
+#include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 
 static void cleanSuperTuxKart();
@@ -572,6 +583,39 @@ void cmdLineHelp()
                               "seconds.\n"
     "       --unlock-all       Permanently unlock all karts and tracks for testing.\n"
     "       --no-unlock-all    Disable unlock-all (i.e. base unlocking on player achievement).\n"
+    "       --sim-benchmark=n  Simulate n physics time steps of a race with AI "
+                              "karts\n"
+    "                          and no graphics as fast as possible, and "
+                              "print timings.\n"
+    "       --seed=n           Use n as seed for random numbers.\n"
+    "       --ai-threads=n     Use n threads to prepare the AI updates.\n"
+    "       --culling-threads=n Use n threads for frustum culling.\n"
+    "       --spm-threads=n    Use n threads to decode the mesh buffers of "
+                              "spm files.\n"
+    "       --convert-replay=FILE Convert a text replay file to the binary "
+                              "format.\n"
+    "       --arena-compact-paths Store the shortest paths of arenas in a "
+                              "compact format.\n"
+    "       --arena-benchmark  Compare memory and speed of the arena path "
+                              "formats.\n"
+    "       --physics-compact-mesh Store track triangle meshes in a compact "
+                              "format.\n"
+    "       --physics-mesh-benchmark Compare memory and raycast speed of the "
+                              "triangle mesh formats.\n"
+    "       --physics-batch-raycasts Cast the wheel rays of all karts in "
+                              "one batch.\n"
+    "       --physics-stats    Print the time of each physics phase at the "
+                              "end of a race.\n"
+    "       --characteristics-benchmark Compare the time to read the kart "
+                              "characteristics\n"
+    "                          of one time step with and without the flat "
+                              "values.\n"
+    "       --culling-benchmark Compare the time to cull a synthetic scene "
+                              "box by box and in one batch.\n"
+    "       --spm-benchmark    Print the time to load the meshes of all "
+                              "karts and tracks.\n"
+    "       --cook-textures    Compress the textures of all karts, tracks and "
+                              "library objects into the texture cache.\n"
     "       --no-graphics      Do not display the actual race.\n"
     "       --sp-shader-debug  Enables debug in sp shader, it will print all unavailable uniforms.\n"
     "       --demo-mode=t      Enables demo mode after t seconds of idle time in "
@@ -581,6 +625,12 @@ void cmdLineHelp()
     "       --demo-laps=n      Number of laps to use in a demo.\n"
     "       --demo-karts=n     Number of karts to use in a demo.\n"
     // "       --history          Replay history file 'history.dat'.\n"
+    "       --profiler-trace=FILE Record all profiler events to FILE in "
+                              "Chrome's trace\n"
+    "                          event format (also works with no graphics).\n"
+    "       --history-stream   Stream the history of a race in compressed "
+                              "chunks to\n"
+    "                          'history.dat' (for long sessions).\n"
     // "       --test-ai=n        Use the test-ai for every n-th AI kart.\n"
     // "                          (so n=1 means all Ais will be the test ai)\n"
     // "
@@ -734,6 +784,18 @@ int handleCmdLinePreliminary()
     if(CommandLine::has("--kartdir", &s))
         KartPropertiesManager::addKartSearchDir(s);
 
+    int sim_ticks;
+    if(CommandLine::has("--sim-benchmark", &sim_ticks))
+    {
+        if (sim_ticks <= 0)
+        {
+            Log::error("main", "Invalid number of benchmark ticks: %d.",
+                       sim_ticks);
+        }
+        else   // This also disables graphics
+            ProfileWorld::setProfileModeTicks(sim_ticks);
+    }   // --sim-benchmark
+
 #ifndef SERVER_ONLY
     if(CommandLine::has("--no-graphics") || CommandLine::has("-l"))
 #endif
@@ -926,6 +988,12 @@ int handleCmdLine()
         AIBaseController::enableDebug();
     if(CommandLine::has("--test-ai", &n))
         AIBaseController::setTestAI(n);
+    if(CommandLine::has("--ai-threads", &n))
+        UserConfigParams::m_ai_threads = std::max(n, 1);
+    if(CommandLine::has("--culling-threads", &n))
+        SP::SPFrustumCulling::setNumThreads(std::max(n, 1));
+    if(CommandLine::has("--spm-threads", &n))
+        SPMeshLoader::setNumThreads(std::max(n, 1));
     if (CommandLine::has("--fps-debug"))
         UserConfigParams::m_fps_debug = true;
     if (CommandLine::has("--rewind") )
@@ -1400,9 +1468,91 @@ int handleCmdLine()
         Log::verbose("main", "Profiling: %d seconds.", n);
         UserConfigParams::m_no_start_screen = true;
         ProfileWorld::setProfileModeTime((float)n);
-        race_manager->setNumLaps(999999); // profile end depends on time
+        // profile end depends on time
+        race_manager->setNumLaps(ProfileWorld::UNLIMITED_LAPS);
     }   // --profile-time
 
+    if(ProfileWorld::isSimBenchmark())
+    {
+        Log::verbose("main", "Simulation benchmark.");
+        UserConfigParams::m_no_start_screen = true;
+        // end depends on number of ticks
+        race_manager->setNumLaps(ProfileWorld::UNLIMITED_LAPS);
+    }   // --sim-benchmark
+
+    if(CommandLine::has("--convert-replay", &s))
+    {
+        // Converts a text replay to the binary format and exits
+        ReplayPlay::convertTextReplay(s);
+        return 0;
+    }   // --convert-replay
+
+    if(CommandLine::has("--arena-compact-paths"))
+        ArenaGraph::setDefaultBackend(ArenaGraph::PATH_COMPACT);
+
+    if(CommandLine::has("--arena-benchmark"))
+    {
+        // Prints load time, memory and query time of all arena graphs
+        ArenaGraph::runBenchmark();
+        return 0;
+    }   // --arena-benchmark
+
+    if(CommandLine::has("--physics-compact-mesh"))
+        TriangleMesh::setCompactLayout(true);
+
+    if(CommandLine::has("--physics-batch-raycasts"))
+        Physics::setBatchRaycasts(true);
+
+    if(CommandLine::has("--physics-stats"))
+        Physics::setLogStats(true);
+
+    if(CommandLine::has("--physics-mesh-benchmark"))
+    {
+        // Prints build time, memory and raycast time of the mesh formats
+        TriangleMesh::runBenchmark();
+        return 0;
+    }   // --physics-mesh-benchmark
+
+    if(CommandLine::has("--characteristics-benchmark"))
+    {
+        // Prints the time all karts need to read their characteristics
+        FlatCharacteristic::runBenchmark();
+        return 0;
+    }   // --characteristics-benchmark
+
+    if(CommandLine::has("--culling-benchmark"))
+    {
+        // Prints the time to cull the boxes of a synthetic scene
+        SP::SPFrustumCulling::runBenchmark();
+        return 0;
+    }   // --culling-benchmark
+
+    if(CommandLine::has("--spm-benchmark"))
+    {
+        // Prints the time to decode the spm files of all karts and tracks
+        SPMeshLoader::runBenchmark();
+        return 0;
+    }   // --spm-benchmark
+
+    if(CommandLine::has("--cook-textures"))
+    {
+        // Fills the texture cache, can be combined with --no-graphics
+        SP::SPTexture::cookTextures();
+        return 0;
+    }   // --cook-textures
+
+    if(CommandLine::has("--profiler-trace", &s))
+    {
+        // Record the whole session, e.g. to analyse frame time spikes
+        profiler.startTrace(s);
+    }   // --profiler-trace
+
+    if(CommandLine::has("--history-stream"))
+    {
+        // Write the history in compressed chunks while racing
+        history->setStreamHistory(true);
+    }   // --history-stream
+
     if(CommandLine::has("--history"))
     {
         history->setReplayHistory(true);
@@ -1660,7 +1810,12 @@ int main(int argc, char *argv[] )
                 main_loop->abort();
         });
 #endif
-    srand(( unsigned ) time( 0 ));
+    // A fixed seed makes races reproducible, e.g. for benchmarks
+    int seed;
+    if(CommandLine::has("--seed", &seed))
+        srand(( unsigned ) seed);
+    else
+        srand(( unsigned ) time( 0 ));
 
     try
     {
@@ -1954,7 +2109,10 @@ int main(int argc, char *argv[] )
             race_manager->setupPlayerKartInfo();
             race_manager->startNew(false);
         }
-        main_loop->run();
+        if(ProfileWorld::isSimBenchmark())
+            ProfileWorld::runSimBenchmark();
+        else
+            main_loop->run();
 
     }  // try
     catch (std::exception &e)
@@ -2024,6 +2182,7 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
  */
 static void cleanSuperTuxKart()
 {
+    profiler.stopTrace();
 
     delete main_loop;
 
@@ -2050,6 +2209,7 @@ static void cleanSuperTuxKart()
     if(history)                 delete history;
     ReplayPlay::destroy();
     ReplayRecorder::destroy();
+    SP::SPFrustumCulling::destroy();
     delete ParticleKindManager::get();
     PlayerManager::destroy();
     if(unlock_manager)          delete unlock_manager;
@@ -2129,8 +2289,12 @@ void runUnitTests()
     GraphicsRestrictions::unitTesting();
     Log::info("UnitTest", "NetworkString");
     NetworkString::unitTesting();
+    Log::info("UnitTest", "BitWriter");
+    BitWriter::unitTesting();
     Log::info("UnitTest", "TransportAddress");
     TransportAddress::unitTesting();
+    Log::info("UnitTest", "GameProtocol");
+    GameProtocol::unitTesting();
 
     Log::info("UnitTest", "Easter detection");
     // Test easter mode: in 2015 Easter is 5th of April - check with 0 days
@@ -2176,6 +2340,18 @@ void runUnitTests()
     Log::info("UnitTest", "RewindQueue");
     RewindQueue::unitTesting();
 
+    Log::info("UnitTest", "Replay");
+    ReplayBase::unitTesting();
+
+    Log::info("UnitTest", "HistoryStream");
+    HistoryStreamWriter::unitTesting();
+
+    Log::info("UnitTest", "ItemGrid");
+    ItemGrid::unitTesting();
+
+    Log::info("UnitTest", "SPFrustumCulling");
+    SP::SPFrustumCulling::unitTesting();
+
     Log::info("UnitTest", "=====================");
     Log::info("UnitTest", "Testing successful   ");
     Log::info("UnitTest", "=====================");
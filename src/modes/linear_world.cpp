@@ -122,6 +122,7 @@ void LinearWorld::reset()
     // First all kart infos must be updated before the kart position can be
     // recomputed, since otherwise 'new' (initialised) valued will be compared
     // with old values.
+    m_race_order.clear();
     updateRacePosition();
 
 #ifdef DEBUG
@@ -690,99 +691,99 @@ void LinearWorld::updateRacePosition()
     bool rank_changed = false;
 #endif
 
-    // NOTE: if you do any changes to this loop, the next loop (see
-    // DEBUG_KART_RANK below) needs to have the same changes applied
-    // so that debug output is still correct!!!!!!!!!!!
+    // Karts that are either eliminated or have finished the race already
+    // have their (final) position assigned. If these karts would get their
+    // rank updated, it could happen that a kart that finished first will be
+    // overtaken after crossing the finishing line and become second!
+    // All other karts are ranked behind the finished karts.
+    unsigned int num_finished = 0;
+    unsigned int num_racing   = 0;
     for (unsigned int i=0; i<kart_amount; i++)
     {
         AbstractKart* kart = m_karts[i];
-        // Karts that are either eliminated or have finished the
-        // race already have their (final) position assigned. If
-        // these karts would get their rank updated, it could happen
-        // that a kart that finished first will be overtaken after
-        // crossing the finishing line and become second!
         if(kart->isEliminated() || kart->hasFinishedRace())
         {
+            if(!kart->isEliminated())
+                num_finished++;
             // This is only necessary to support debugging inconsistencies
-            // in kart position parameters.
-            setKartPosition(i, kart->getPosition());
+            // in kart position parameters (and to store the position of
+            // a just eliminated kart).
+            updateKartPosition(i, kart->getPosition());
             continue;
         }
-        KartInfo& kart_info = m_kart_info[i];
-
-        int p = 1 ;
-
-        const unsigned int my_id = kart->getWorldKartId();
-        const float my_distance  = m_kart_info[my_id].m_overall_distance;
-
-        // Count karts ahead of the current kart, i.e. kart that are
-        // already finished or have covered a larger overall distance.
-        for (unsigned int j = 0 ; j < kart_amount ; j++)
-        {
-            // don't compare a kart with itself and ignore eliminated karts
-            if(j == my_id || m_karts[j]->isEliminated())
-                continue;
-
-            // If the other kart has:
-            // - finished the race (but this kart hasn't)
-            // - or is ahead
-            // - or has the same distance (very unlikely) but started earlier
-            // it is ahead --> increase position
-            if((!kart->hasFinishedRace() && m_karts[j]->hasFinishedRace()) ||
-                m_kart_info[j].m_overall_distance > my_distance            ||
-               (m_kart_info[j].m_overall_distance == my_distance &&
-                m_karts[j]->getInitialPosition()<kart->getInitialPosition() ) )
-            {
-                p++;
-            }
-
-        } //next kart
+        num_racing++;
+    }   // for i<kart_amount
 
-#ifndef DEBUG
-        setKartPosition(i, p);
-#else
-        rank_changed |= kart->getPosition()!=p;
-        if (!setKartPosition(i,p))
+    // Remove karts that have finished or were eliminated from the order,
+    // and start again from kart id order if karts were added (e.g. on
+    // reset or after a rewind).
+    unsigned int n = 0;
+    for (unsigned int k=0; k<m_race_order.size(); k++)
+    {
+        const AbstractKart* kart = m_karts[m_race_order[k]];
+        if(!kart->isEliminated() && !kart->hasFinishedRace())
+            m_race_order[n++] = m_race_order[k];
+    }
+    m_race_order.resize(n);
+    if(n != num_racing)
+    {
+        m_race_order.clear();
+        for (unsigned int i=0; i<kart_amount; i++)
         {
-            Log::error("[LinearWorld]", "Same rank used twice!!");
-
-            Log::debug("[LinearWorld]", "Info used to decide ranking :");
-            for (unsigned int d=0; d<kart_amount; d++)
-            {
-                Log::debug("[LinearWorld]", "Kart %s has finished (%d), is at lap (%u),"
-                            "is at distance (%u), is eliminated(%d)",
-                            m_karts[d]->getIdent().c_str(),
-                            m_karts[d]->hasFinishedRace(),
-                            getLapForKart(d),
-                            m_kart_info[d].m_overall_distance,
-                            m_karts[d]->isEliminated());
-            }
-
-            Log::debug("[LinearWorld]", "Who has each ranking so far :");
-            for (unsigned int d=0; d<i; d++)
-            {
-                Log::debug("[LinearWorld]", "%s has rank %d", m_karts[d]->getIdent().c_str(),
-                            m_karts[d]->getPosition());
-            }
-
-            Log::debug("[LinearWorld]", "    --> And %s is being set at rank %d",
-                        kart->getIdent().c_str(), p);
-            history->Save();
-            assert(false);
+            if(!m_karts[i]->isEliminated() && !m_karts[i]->hasFinishedRace())
+                m_race_order.push_back(i);
         }
-#endif
+    }
 
-        // Switch on faster music if not already done so, if the
-        // first kart is doing its last lap.
-        if(!m_faster_music_active                                  &&
-            p == 1                                                 &&
-            kart_info.m_finished_laps == race_manager->getNumLaps() - 1 &&
-            useFastMusicNearEnd()                                       )
+    // A kart is ahead of another if it has covered a larger overall
+    // distance, or has the same distance (very unlikely) but started
+    // earlier. Karts only overtake each other now and then, so the order
+    // of the previous time step is nearly sorted: insertion sort only
+    // compares each kart with the one ahead of it, and each swap is an
+    // actual change of the race position.
+    // NOTE: if you do any changes to this order, the debug loop (see
+    // DEBUG_KART_RANK below) needs to have the same changes applied
+    // so that debug output is still correct!!!!!!!!!!!
+    for (unsigned int k=1; k<m_race_order.size(); k++)
+    {
+        const unsigned int id = m_race_order[k];
+        const float distance  = m_kart_info[id].m_overall_distance;
+        const int   initial   = m_karts[id]->getInitialPosition();
+        unsigned int j = k;
+        while(j > 0)
         {
-            music_manager->switchToFastMusic();
-            m_faster_music_active=true;
+            const unsigned int ahead = m_race_order[j-1];
+            const float ahead_distance = m_kart_info[ahead].m_overall_distance;
+            if(ahead_distance > distance ||
+               (ahead_distance == distance &&
+                m_karts[ahead]->getInitialPosition() < initial))
+                break;
+            m_race_order[j] = ahead;
+            j--;
         }
-    }   // for i<kart_amount
+        m_race_order[j] = id;
+    }   // for k<m_race_order.size()
+
+    for (unsigned int k=0; k<m_race_order.size(); k++)
+    {
+        const unsigned int i = m_race_order[k];
+        const int p = num_finished + k + 1;
+#ifdef DEBUG
+        rank_changed |= m_karts[i]->getPosition()!=p;
+#endif
+        updateKartPosition(i, p);
+    }   // for k<m_race_order.size()
+
+    // Switch on faster music if not already done so, if the
+    // first kart is doing its last lap.
+    if(!m_faster_music_active && num_finished == 0 && !m_race_order.empty() &&
+        m_kart_info[m_race_order[0]].m_finished_laps
+                                           == race_manager->getNumLaps() - 1 &&
+        useFastMusicNearEnd()                                              )
+    {
+        music_manager->switchToFastMusic();
+        m_faster_music_active=true;
+    }
 
     // Define this to get a detailled analyses each time a race position
     // changes.
@@ -856,6 +857,44 @@ void LinearWorld::updateRacePosition()
     endSetKartPositions();
 }   // updateRacePosition
 
+//-----------------------------------------------------------------------------
+/** Sets the position of a kart, unless the kart has this position already.
+ *  In debug mode the position is always set, to detect two karts being
+ *  given the same position.
+ *  \param i Kart id.
+ *  \param p The new position of the kart.
+ */
+void LinearWorld::updateKartPosition(unsigned int i, int p)
+{
+#ifndef DEBUG
+    if(m_karts[i]->getPosition() == p && m_position_index[p-1] == (int)i)
+        return;
+    setKartPosition(i, p);
+#else
+    if (!setKartPosition(i,p))
+    {
+        Log::error("[LinearWorld]", "Same rank used twice!!");
+
+        Log::debug("[LinearWorld]", "Info used to decide ranking :");
+        for (unsigned int d=0; d<m_karts.size(); d++)
+        {
+            Log::debug("[LinearWorld]", "Kart %s has finished (%d), is at lap (%u),"
+                        "is at distance (%u), is eliminated(%d)",
+                        m_karts[d]->getIdent().c_str(),
+                        m_karts[d]->hasFinishedRace(),
+                        getLapForKart(d),
+                        m_kart_info[d].m_overall_distance,
+                        m_karts[d]->isEliminated());
+        }
+
+        Log::debug("[LinearWorld]", "    --> And %s is being set at rank %d",
+                    m_karts[i]->getIdent().c_str(), p);
+        history->Save();
+        assert(false);
+    }
+#endif
+}   // updateKartPosition
+
 //-----------------------------------------------------------------------------
 /** Checks if a kart is going in the wrong direction. This is done only for
  *  player karts to display a message to the player.
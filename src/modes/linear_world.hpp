@@ -55,6 +55,10 @@ private:
      *  get valid finish times estimates. */
     float       m_distance_increase;
 
+    /** The ids of all karts that are still racing (i.e. not eliminated
+     *  and not finished), sorted by their race position. */
+    std::vector<unsigned int> m_race_order;
+
     // ------------------------------------------------------------------------
     /** Some additional info that needs to be kept for each kart
      * in this kind of race.
@@ -108,6 +112,7 @@ protected:
 
     virtual void  checkForWrongDirection(unsigned int i, float dt);
     void          updateRacePosition();
+    void          updateKartPosition(unsigned int i, int p);
     virtual float estimateFinishTimeForKart(AbstractKart* kart) OVERRIDE;
 
 public:
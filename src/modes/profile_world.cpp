@@ -23,7 +23,10 @@
 #include "graphics/irr_driver.hpp"
 #include "karts/kart_with_stats.hpp"
 #include "karts/controller/controller.hpp"
+#include "physics/physics.hpp"
 #include "tracks/track.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
 
 #include <ISceneManager.h>
 
@@ -34,6 +37,8 @@ ProfileWorld::ProfileType ProfileWorld::m_profile_mode=PROFILE_NONE;
 int   ProfileWorld::m_num_laps    = 0;
 float ProfileWorld::m_time        = 0.0f;
 bool  ProfileWorld::m_no_graphics = false;
+int   ProfileWorld::m_num_ticks   = 0;
+uint64_t ProfileWorld::m_sim_time[ProfileWorld::SIM_COUNT];
 
 //-----------------------------------------------------------------------------
 /** The constructor sets the number of (local) players to 0, since only AI
@@ -45,7 +50,7 @@ ProfileWorld::ProfileWorld()
     // Set number of laps so that the end of the race can be detected by
     // quering the number of finished karts from the race manager (in laps
     // based profiling) - in case of time based profiling, the number of
-    // laps is set to 99999.
+    // laps is set to UNLIMITED_LAPS.
     race_manager->setNumLaps(m_num_laps);
     setPhase(RACE_PHASE);
     m_frame_count      = 0;
@@ -56,6 +61,8 @@ ProfileWorld::ProfileWorld()
     m_num_transparent  = 0;
     m_num_trans_effect = 0;
     m_num_calls        = 0;
+    for (unsigned int i = 0; i < SIM_COUNT; i++)
+        m_sim_time[i] = 0;
 }   // ProfileWorld
 
 //-----------------------------------------------------------------------------
@@ -77,7 +84,7 @@ ProfileWorld::~ProfileWorld()
 void ProfileWorld::setProfileModeTime(float time)
 {
     m_profile_mode = PROFILE_TIME;
-    m_num_laps     = 99999;
+    m_num_laps     = UNLIMITED_LAPS;
     m_time         = time;
 }   // setProfileModeTime
 
@@ -92,6 +99,43 @@ void ProfileWorld::setProfileModeLaps(int laps)
     m_num_laps     = laps;
 }   // setProfileModeLaps
 
+//-----------------------------------------------------------------------------
+/** Enables the headless simulation benchmark: the race is run without
+ *  graphics for a fixed number of physics time steps, which are executed as
+ *  fast as possible (see runSimBenchmark()). The number of laps is set to a
+ *  high number so that the race does not finish early.
+ *  \param ticks Number of physics time steps to simulate.
+ */
+void ProfileWorld::setProfileModeTicks(int ticks)
+{
+    m_profile_mode = PROFILE_TICKS;
+    m_num_laps     = UNLIMITED_LAPS;
+    m_num_ticks    = ticks;
+    m_no_graphics  = true;
+}   // setProfileModeTicks
+
+//-----------------------------------------------------------------------------
+/** Runs the simulation benchmark. Instead of using the main loop (which
+ *  throttles the frame rate, handles input, GUI, sound, ...) the world is
+ *  updated one physics time step at a time until the requested number of
+ *  ticks is done. The world deletes itself in enterRaceOverState(), which
+ *  also prints the results.
+ */
+void ProfileWorld::runSimBenchmark()
+{
+    assert(isSimBenchmark());
+    while (World::getWorld())
+    {
+        World *world = World::getWorld();
+        world->updateWorld(1);
+        // updateWorld can delete the world when the race is over
+        if (World::getWorld())
+            world->updateTime(1);
+        // Each tick is one frame in a profiler trace
+        PROFILER_SYNC_FRAME();
+    }
+}   // runSimBenchmark
+
 //-----------------------------------------------------------------------------
 /** Creates a kart, having a certain position, starting location, and local
  *  and global player id (if applicable).
@@ -142,6 +186,9 @@ bool ProfileWorld::isRaceOver()
         // Now it must be laps based profiling:
         return race_manager->getFinishedKarts()==getNumKarts();
     }
+
+    if(m_profile_mode == PROFILE_TICKS)
+        return m_frame_count >= m_num_ticks;
     // Unknown profile mode
     assert(false);
     return false;  // keep compiler happy
@@ -153,9 +200,13 @@ bool ProfileWorld::isRaceOver()
  */
 void ProfileWorld::update(int ticks)
 {
+    if (m_frame_count == 0)
+        m_sim_start = std::chrono::high_resolution_clock::now();
     StandardRace::update(ticks);
 
     m_frame_count++;
+    if (m_no_graphics) return;
+
     video::IVideoDriver *driver = irr_driver->getVideoDriver();
     io::IAttributes   *attr = irr_driver->getSceneManager()->getParameters();
     m_num_triangles    += (int)(driver->getPrimitiveCountDrawn( 0 )
@@ -168,6 +219,32 @@ void ProfileWorld::update(int ticks)
 
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Prints the results of the simulation benchmark: the number of simulated
+ *  physics time steps per second, and the time spent in each subsystem.
+ *  Note that the time for karts includes the time for their AI controllers.
+ *  The time of physics is then split into the physics phases.
+ */
+void ProfileWorld::printSimBenchmarkResults()
+{
+    const char *names[SIM_COUNT] = { "physics", "karts", "  AI",
+                                     "items", "checks", "rewinder" };
+    double total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - m_sim_start).count()
+        * 1.0e-9;
+    if (total <= 0.0) total = 1.0e-9;
+    Log::info("simbench", "%d ticks %d karts in %.3f s: %.1f ticks/s",
+              m_frame_count, getNumKarts(), total, m_frame_count / total);
+    for (unsigned int i = 0; i < SIM_COUNT; i++)
+    {
+        double t = m_sim_time[i] * 1.0e-9;
+        Log::info("simbench", "%-10s %8.3f s %6.2f%% %8.2f us/tick",
+                  names[i], t, 100.0 * t / total,
+                  m_frame_count > 0 ? t * 1.0e6 / m_frame_count : 0.0);
+    }
+    Physics::getInstance()->getTotalStats().print("simbench");
+}   // printSimBenchmarkResults
+
 //-----------------------------------------------------------------------------
 /** This function is called when the race is finished, but end-of-race
  *  animations have still to be played. In the case of profiling,
@@ -179,7 +256,7 @@ void ProfileWorld::enterRaceOverState()
     // aborting too early). So in this case determine the maximum number
     // of laps and set this +1 as the number of laps to get more meaningful
     // time estimations.
-    if(m_profile_mode==PROFILE_TIME)
+    if(m_profile_mode==PROFILE_TIME || m_profile_mode==PROFILE_TICKS)
     {
         int max_laps = -2;
         for(unsigned int i=0; i<race_manager->getNumberOfKarts(); i++)
@@ -205,6 +282,9 @@ void ProfileWorld::enterRaceOverState()
     Log::verbose("profile", "Number of frames: %d time %f, Average FPS: %f",
                  m_frame_count, runtime, (float)m_frame_count/runtime);
 
+    if (m_profile_mode == PROFILE_TICKS)
+        printSimBenchmarkResults();
+
     // Print geometry statistics if we're not in no-graphics mode
     if(!m_no_graphics)
     {
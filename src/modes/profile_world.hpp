@@ -20,6 +20,9 @@
 #define HEADER_PROFILE_WORLD_HPP
 
 #include "modes/standard_race.hpp"
+#include "utils/types.hpp"
+
+#include <chrono>
 
 class Kart;
 
@@ -29,9 +32,44 @@ class Kart;
  */
 class ProfileWorld : public StandardRace
 {
+public:
+    /** The subsystems for which the time is measured in the simulation
+     *  benchmark. */
+    enum SimSubsystem { SIM_PHYSICS, SIM_KARTS, SIM_AI, SIM_ITEMS,
+                        SIM_CHECKS, SIM_REWIND, SIM_COUNT };
+
+    // ------------------------------------------------------------------------
+    /** Adds the time between construction and destruction of this object to
+     *  the time of a subsystem. It does nothing if the simulation benchmark
+     *  is not running, so it can be left in the code. */
+    class SimTimer
+    {
+    private:
+        SimSubsystem m_subsystem;
+        bool m_active;
+        std::chrono::high_resolution_clock::time_point m_start;
+    public:
+        SimTimer(SimSubsystem subsystem)
+        {
+            m_subsystem = subsystem;
+            m_active    = m_profile_mode == PROFILE_TICKS;
+            if (m_active)
+                m_start = std::chrono::high_resolution_clock::now();
+        }   // SimTimer
+        // --------------------------------------------------------------------
+        ~SimTimer()
+        {
+            if (!m_active) return;
+            m_sim_time[m_subsystem] += (uint64_t)
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::high_resolution_clock::now() - m_start).count();
+        }   // ~SimTimer
+    };   // SimTimer
+
 private:
     /** Profiling modes. */
-    enum        ProfileType {PROFILE_NONE, PROFILE_TIME, PROFILE_LAPS};
+    enum        ProfileType {PROFILE_NONE, PROFILE_TIME, PROFILE_LAPS,
+                             PROFILE_TICKS};
 
     /** If profiling is done, and if so, which mode. */
     static ProfileType m_profile_mode;
@@ -43,6 +81,19 @@ private:
     /** In time based profiling only: time to run. */
     static float m_time;
 
+    /** In tick based profiling (simulation benchmark) only: number of
+     *  physics time steps to run. */
+    static int   m_num_ticks;
+
+    /** Accumulated time in nanoseconds spent in each subsystem. */
+    static uint64_t m_sim_time[SIM_COUNT];
+
+    /** Start time of the simulation benchmark, i.e. of the first simulated
+     *  time step (so loading the track and karts is not included). */
+    std::chrono::high_resolution_clock::time_point m_sim_start;
+
+    void printSimBenchmarkResults();
+
     /** Return value of real time at start of race. */
     unsigned int m_start_time;
 
@@ -78,6 +129,10 @@ protected:
                                      PerPlayerDifficulty difficulty);
 
 public:
+    /** Number of laps used when the end of the profile run does not depend
+     *  on laps, high enough that no kart finishes the race. */
+    static const int UNLIMITED_LAPS = 99999;
+
                           ProfileWorld();
     virtual              ~ProfileWorld();
     /** Returns identifier for this world. */
@@ -88,10 +143,15 @@ public:
 
     static   void setProfileModeTime(float time);
     static   void setProfileModeLaps(int laps);
+    static   void setProfileModeTicks(int ticks);
+    static   void runSimBenchmark();
     // ------------------------------------------------------------------------
     /** Returns true if profile mode was selected. */
     static   bool isProfileMode() {return m_profile_mode!=PROFILE_NONE; }
     // ------------------------------------------------------------------------
+    /** Returns true if the headless simulation benchmark was selected. */
+    static   bool isSimBenchmark() {return m_profile_mode==PROFILE_TICKS; }
+    // ------------------------------------------------------------------------
     /** Switches off graphics. */
     static   void disableGraphics() { m_no_graphics = true; }
     // ------------------------------------------------------------------------
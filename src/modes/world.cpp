@@ -72,6 +72,7 @@
 #include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <algorithm>
 #include <assert.h>
@@ -125,6 +126,7 @@ World::World() : WorldStatus()
 
     m_race_gui           = NULL;
     m_saved_race_gui     = NULL;
+    m_ai_pool            = NULL;
     m_use_highscores     = true;
     m_schedule_pause     = false;
     m_schedule_unpause   = false;
@@ -165,6 +167,9 @@ void World::init()
 
     RewindManager::create();
 
+    if (UserConfigParams::m_ai_threads > 1)
+        m_ai_pool = new WorkerPool(UserConfigParams::m_ai_threads);
+
     // Grab the track file
     Track *track = track_manager->getTrack(race_manager->getTrackName());
     Scripting::ScriptEngine::getInstance<Scripting::ScriptEngine>();
@@ -483,6 +488,8 @@ World::~World()
     
     Weather::kill();
 
+    delete m_ai_pool;
+
     for ( unsigned int i = 0 ; i < m_karts.size() ; i++ )
     {
         // Let ReplayPlay destroy the ghost karts
@@ -1016,7 +1023,10 @@ void World::update(int ticks)
     WorldStatus::update(ticks);
     PROFILER_POP_CPU_MARKER();
     PROFILER_PUSH_CPU_MARKER("World::update (RewindManager)", 0x20, 0x7F, 0x40);
-    RewindManager::get()->update(ticks);
+    {
+        ProfileWorld::SimTimer timer(ProfileWorld::SIM_REWIND);
+        RewindManager::get()->update(ticks);
+    }
     PROFILER_POP_CPU_MARKER();
 
     PROFILER_PUSH_CPU_MARKER("World::update (Kart::upate)", 0x40, 0x7F, 0x00);
@@ -1024,14 +1034,33 @@ void World::update(int ticks)
     // Update all the karts. This in turn will also update the controller,
     // which causes all AI steering commands set. So in the following 
     // physics update the new steering is taken into account.
-    const int kart_amount = (int)m_karts.size();
-    for (int i = 0 ; i < kart_amount; ++i)
     {
-        SpareTireAI* sta =
-            dynamic_cast<SpareTireAI*>(m_karts[i]->getController());
-        // Update all karts that are not eliminated
-        if(!m_karts[i]->isEliminated() || (sta && sta->isMoving()))
-            m_karts[i]->update(ticks);
+        ProfileWorld::SimTimer timer(ProfileWorld::SIM_KARTS);
+        m_kart_snapshot.update(m_karts);
+        const int kart_amount = (int)m_karts.size();
+        // Controllers only write their own data in prepareUpdate, and all
+        // read the same snapshot, so the result does not depend on the
+        // number of threads or the order in which karts are prepared.
+        auto prepare = [this, ticks](unsigned int i)
+        {
+            if (!m_karts[i]->isEliminated())
+                m_karts[i]->getController()->prepareUpdate(ticks);
+        };
+        if (m_ai_pool)
+            m_ai_pool->run(kart_amount, prepare);
+        else
+        {
+            for (int i = 0; i < kart_amount; i++)
+                prepare(i);
+        }
+        for (int i = 0 ; i < kart_amount; ++i)
+        {
+            SpareTireAI* sta =
+                dynamic_cast<SpareTireAI*>(m_karts[i]->getController());
+            // Update all karts that are not eliminated
+            if(!m_karts[i]->isEliminated() || (sta && sta->isMoving()))
+                m_karts[i]->update(ticks);
+        }
     }
     PROFILER_POP_CPU_MARKER();
 
@@ -1051,10 +1080,16 @@ void World::update(int ticks)
     Scripting::ScriptEngine *script_engine = Scripting::ScriptEngine::getInstance();
     if (script_engine) script_engine->update(ticks);
 
-    Physics::getInstance()->update(ticks);
+    {
+        ProfileWorld::SimTimer timer(ProfileWorld::SIM_PHYSICS);
+        Physics::getInstance()->update(ticks);
+    }
 
     PROFILER_PUSH_CPU_MARKER("World::update (projectiles)", 0xa0, 0x7F, 0x00);
-    projectile_manager->update(ticks);
+    {
+        ProfileWorld::SimTimer timer(ProfileWorld::SIM_ITEMS);
+        projectile_manager->update(ticks);
+    }
     PROFILER_POP_CPU_MARKER();
 
     PROFILER_POP_CPU_MARKER();
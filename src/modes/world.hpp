@@ -29,6 +29,7 @@
 #include <stdexcept>
 
 #include "graphics/weather.hpp"
+#include "karts/kart_state_snapshot.hpp"
 #include "modes/world_status.hpp"
 #include "race/highscores.hpp"
 #include "states_screens/race_gui_base.hpp"
@@ -41,6 +42,7 @@ class AbstractKart;
 class btRigidBody;
 class Controller;
 class PhysicalObject;
+class WorkerPool;
 
 namespace Scripting
 {
@@ -94,6 +96,14 @@ protected:
     KartList                  m_karts;
     RandomGenerator           m_random;
 
+    /** Position and velocity of all karts at the start of the current
+     *  time step, used by the AI. */
+    KartStateSnapshot         m_kart_snapshot;
+
+    /** Threads used to prepare the controller updates of all karts, NULL
+     *  if this is done on the main thread only. */
+    WorkerPool               *m_ai_pool;
+
     AbstractKart* m_fastest_kart;
     /** Number of eliminated karts. */
     int         m_eliminated_karts;
@@ -294,6 +304,10 @@ public:
     /** Returns all karts. */
     const KartList & getKarts() const { return m_karts; }
     // ------------------------------------------------------------------------
+    /** Returns the position and velocity of all karts at the start of the
+     *  current time step. */
+    const KartStateSnapshot& getKartSnapshot() const { return m_kart_snapshot; }
+    // ------------------------------------------------------------------------
     /** Returns the number of currently active (i.e.non-elikminated) karts. */
     unsigned int    getCurrentNumKarts() const { return (int)m_karts.size() -
                                                          m_eliminated_karts; }
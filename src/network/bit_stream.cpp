@@ -0,0 +1,189 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/bit_stream.hpp"
+
+#include "utils/mini_glm.hpp"
+
+#include <cmath>
+
+// ============================================================================
+/** Unit tests for BitWriter and BitReader. It tests that all data types can
+ *  be read back, that the expected number of bytes is used, and that byte
+ *  aligned data can be mixed with bit-packed data.
+ */
+void BitWriter::unitTesting()
+{
+    BareNetworkString s;
+    {
+        BitWriter w(&s);
+        w.addBool(true).addBool(false).addBits(5, 3).addBits(0xffffffff, 32);
+        w.addVarUInt(0).addVarUInt(15).addVarUInt(16).addVarUInt(0xffffffff);
+        w.addVarInt(-1).addVarInt(7).addVarInt(-2147483647 - 1);
+        w.addRangedFloat(0.5f, -1.0f, 1.0f, 10);
+        w.addRangedFloat(-5.0f, -1.0f, 1.0f, 10);  // clamped to min
+        w.addHalfFloat(1.5f);
+    }   // destructor flushes
+    // Old byte-aligned data after the bit-packed section
+    s.addUInt16(12345);
+
+    BitReader r(&s);
+    assert(r.getBool());
+    assert(!r.getBool());
+    assert(r.getBits(3) == 5);
+    assert(r.getBits(32) == 0xffffffff);
+    assert(r.getVarUInt() == 0);
+    assert(r.getVarUInt() == 15);
+    assert(r.getVarUInt() == 16);
+    assert(r.getVarUInt() == 0xffffffff);
+    assert(r.getVarInt() == -1);
+    assert(r.getVarInt() == 7);
+    assert(r.getVarInt() == -2147483647 - 1);
+    float f = r.getRangedFloat(-1.0f, 1.0f, 10);
+    assert(fabsf(f - 0.5f) <= 2.0f / 1023.0f);
+    assert(r.getRangedFloat(-1.0f, 1.0f, 10) == -1.0f);
+    assert(r.getHalfFloat() == 1.5f);
+    assert(s.getUInt16() == 12345);
+    assert(s.size() == 0);
+
+    // Small values must only use a few bits: 8 booleans and a 4-bit
+    // value with its continuation bit need 2 bytes.
+    BareNetworkString small;
+    BitWriter ws(&small);
+    for (unsigned int i = 0; i < 8; i++)
+        ws.addBool(i % 2 == 0);
+    ws.addVarUInt(9);
+    ws.flush();
+    assert(small.size() == 2);
+
+    // Reading past the end or a malformed value must set the error flag
+    // instead of reading beyond the string.
+    BareNetworkString truncated;
+    truncated.addUInt8(0xff);
+    BitReader rt(&truncated);
+    assert(rt.getRemainingBits() == 8);
+    rt.getBits(4);
+    assert(!rt.hasError());
+    assert(rt.getBits(5) == 0);
+    assert(rt.hasError());
+    BareNetworkString endless;
+    for (unsigned int i = 0; i < 16; i++)
+        endless.addUInt8(0xff);
+    BitReader re(&endless);
+    re.getVarUInt();
+    assert(re.hasError());
+    assert(re.getRemainingBits() > 0);
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Adds an unsigned integer using a variable number of bits: the value is
+ *  split into groups of 4 bits, each followed by one bit indicating if more
+ *  groups follow. So values below 16 use 5 bits, values below 256 10 bits.
+ */
+BitWriter& BitWriter::addVarUInt(uint32_t value)
+{
+    while (value >= 16)
+    {
+        addBits((value & 15) | 16, 5);
+        value >>= 4;
+    }
+    return addBits(value, 5);
+}   // addVarUInt
+
+// ----------------------------------------------------------------------------
+/** Adds a signed integer with a variable number of bits. Zig-zag encoding is
+ *  used, so that values with a small absolute value use only a few bits.
+ */
+BitWriter& BitWriter::addVarInt(int32_t value)
+{
+    uint32_t u = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    return addVarUInt(u);
+}   // addVarInt
+
+// ----------------------------------------------------------------------------
+/** Adds a float from a bounded range, quantised to n bits. Values outside of
+ *  the range are clamped.
+ *  \param f The value to store.
+ *  \param min, max The range of the value.
+ *  \param n Number of bits to use (1 <= n <= 32).
+ */
+BitWriter& BitWriter::addRangedFloat(float f, float min, float max,
+                                     unsigned int n)
+{
+    assert(n > 0 && n <= 32 && max > min);
+    const double steps = (double)((((uint64_t)1) << n) - 1);
+    if (f < min) f = min;
+    if (f > max) f = max;
+    double q = floor((f - min) / (double)(max - min) * steps + 0.5);
+    return addBits((uint32_t)q, n);
+}   // addRangedFloat
+
+// ----------------------------------------------------------------------------
+/** Adds a float compressed to 16 bits (IEEE half float). */
+BitWriter& BitWriter::addHalfFloat(float f)
+{
+    return addBits((uint16_t)MiniGLM::toFloat16(f), 16);
+}   // addHalfFloat
+
+// ============================================================================
+/** Reads an unsigned integer written with BitWriter::addVarUInt. */
+uint32_t BitReader::getVarUInt()
+{
+    uint32_t result = 0;
+    unsigned int shift = 0;
+    while (true)
+    {
+        uint32_t group = getBits(5);
+        result |= (group & 15) << shift;
+        if ((group & 16) == 0 || m_error) break;
+        shift += 4;
+        // A 32 bit value never needs more than 8 groups
+        if (shift >= 32)
+        {
+            m_error = true;
+            break;
+        }
+    }
+    return result;
+}   // getVarUInt
+
+// ----------------------------------------------------------------------------
+/** Reads a signed integer written with BitWriter::addVarInt. */
+int32_t BitReader::getVarInt()
+{
+    uint32_t u = getVarUInt();
+    return (int32_t)((u >> 1) ^ (0u - (u & 1)));
+}   // getVarInt
+
+// ----------------------------------------------------------------------------
+/** Reads a quantised float written with BitWriter::addRangedFloat. The same
+ *  range and number of bits must be used as when writing. */
+float BitReader::getRangedFloat(float min, float max, unsigned int n)
+{
+    assert(n > 0 && n <= 32 && max > min);
+    const double steps = (double)((((uint64_t)1) << n) - 1);
+    uint32_t q = getBits(n);
+    return (float)(min + q * (double)(max - min) / steps);
+}   // getRangedFloat
+
+// ----------------------------------------------------------------------------
+/** Reads a half float written with BitWriter::addHalfFloat. */
+float BitReader::getHalfFloat()
+{
+    return MiniGLM::toFloat32((short)getBits(16));
+}   // getHalfFloat
@@ -0,0 +1,177 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file bit_stream.hpp
+ *  \brief Bit-level writing and reading of data in a BareNetworkString.
+ */
+
+#ifndef HEADER_BIT_STREAM_HPP
+#define HEADER_BIT_STREAM_HPP
+
+#include "network/network_string.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <assert.h>
+
+/** \class BitWriter
+ *  \brief Writes values with an arbitrary number of bits to a network string.
+ *  The bits are collected and appended to the string as complete bytes, the
+ *  last byte is padded with 0 bits when flush() is called (which is also done
+ *  by the destructor). After flushing, the normal byte-aligned functions of
+ *  the string can be used again, so a protocol can use bit-packing for only
+ *  a part of a message, and old messages remain unchanged.
+ *  \ingroup network
+ */
+class BitWriter : public NoCopy
+{
+private:
+    /** The string to which complete bytes are appended. */
+    BareNetworkString *m_string;
+
+    /** Bits not yet written to the string, the oldest bit is bit 0. */
+    uint64_t m_bits;
+
+    /** Number of valid bits in m_bits. */
+    unsigned int m_num_bits;
+
+public:
+    static void unitTesting();
+
+    // ------------------------------------------------------------------------
+    BitWriter(BareNetworkString *string)
+    {
+        m_string   = string;
+        m_bits     = 0;
+        m_num_bits = 0;
+    }   // BitWriter
+    // ------------------------------------------------------------------------
+    ~BitWriter() { flush(); }
+    // ------------------------------------------------------------------------
+    /** Adds the lowest n bits of value (n <= 32). */
+    BitWriter& addBits(uint32_t value, unsigned int n)
+    {
+        assert(n <= 32);
+        if (n < 32)
+            value &= (1u << n) - 1;
+        m_bits |= ((uint64_t)value) << m_num_bits;
+        m_num_bits += n;
+        while (m_num_bits >= 8)
+        {
+            m_string->addUInt8((uint8_t)(m_bits & 0xff));
+            m_bits >>= 8;
+            m_num_bits -= 8;
+        }
+        return *this;
+    }   // addBits
+    // ------------------------------------------------------------------------
+    /** Adds a boolean value using a single bit. */
+    BitWriter& addBool(bool b) { return addBits(b ? 1 : 0, 1); }
+    // ------------------------------------------------------------------------
+    BitWriter& addVarUInt(uint32_t value);
+    BitWriter& addVarInt(int32_t value);
+    BitWriter& addRangedFloat(float f, float min, float max, unsigned int n);
+    BitWriter& addHalfFloat(float f);
+    // ------------------------------------------------------------------------
+    /** Writes all pending bits to the string, padding the last byte with 0
+     *  bits. */
+    void flush()
+    {
+        if (m_num_bits > 0)
+        {
+            m_string->addUInt8((uint8_t)(m_bits & 0xff));
+            m_bits     = 0;
+            m_num_bits = 0;
+        }
+    }   // flush
+};   // class BitWriter
+
+// ============================================================================
+/** \class BitReader
+ *  \brief Reads values written by a BitWriter from a network string. Bytes
+ *  are only read from the string when necessary, so after the last value of
+ *  a bit-packed section is read, the string points to the first byte after
+ *  this section (the padding bits of the last byte are ignored).
+ *  \ingroup network
+ */
+class BitReader : public NoCopy
+{
+private:
+    /** The string from which bytes are read. */
+    const BareNetworkString *m_string;
+
+    /** Bits read from the string but not yet returned. */
+    uint64_t m_bits;
+
+    /** Number of valid bits in m_bits. */
+    unsigned int m_num_bits;
+
+    /** Set if more bits were requested than the string contains, or if a
+     *  value was not encoded correctly. */
+    bool m_error;
+
+public:
+    // ------------------------------------------------------------------------
+    BitReader(const BareNetworkString *string)
+    {
+        m_string   = string;
+        m_bits     = 0;
+        m_num_bits = 0;
+        m_error    = false;
+    }   // BitReader
+    // ------------------------------------------------------------------------
+    /** Returns the next n bits (n <= 32). If the string does not contain
+     *  enough bits, nothing is read, 0 is returned and hasError() becomes
+     *  true. */
+    uint32_t getBits(unsigned int n)
+    {
+        assert(n <= 32);
+        while (m_num_bits < n)
+        {
+            if (m_string->size() == 0)
+            {
+                m_error = true;
+                return 0;
+            }
+            m_bits |= ((uint64_t)m_string->getUInt8()) << m_num_bits;
+            m_num_bits += 8;
+        }
+        uint32_t result = (uint32_t)(m_bits & ((((uint64_t)1) << n) - 1));
+        m_bits >>= n;
+        m_num_bits -= n;
+        return result;
+    }   // getBits
+    // ------------------------------------------------------------------------
+    /** Returns a boolean value stored in a single bit. */
+    bool getBool() { return getBits(1) == 1; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of bits that can still be read. */
+    unsigned int getRemainingBits() const
+                               { return m_num_bits + 8 * m_string->size(); }
+    // ------------------------------------------------------------------------
+    /** Returns true if data was missing or malformed while reading, in
+     *  which case all values read should be discarded. */
+    bool hasError() const { return m_error; }
+    // ------------------------------------------------------------------------
+    uint32_t getVarUInt();
+    int32_t  getVarInt();
+    float    getRangedFloat(float min, float max, unsigned int n);
+    float    getHalfFloat();
+};   // class BitReader
+
+#endif
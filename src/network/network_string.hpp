@@ -141,6 +141,22 @@ public:
     /** Allows to read a buffer from the beginning again. */
     void reset() { m_current_offset = 0; }
     // ------------------------------------------------------------------------
+    /** Replaces the content of this string with a copy of the given data.
+     *  Already allocated memory is reused if it is large enough. */
+    void setData(const char *data, int len)
+    {
+        m_buffer.assign((const uint8_t*)data, (const uint8_t*)data + len);
+        m_current_offset = 0;
+    }   // setData
+    // ------------------------------------------------------------------------
+    /** Removes all data from this string, but keeps the allocated memory,
+     *  so the string can be reused without new allocations. */
+    void clearBuffer()
+    {
+        m_buffer.clear();
+        m_current_offset = 0;
+    }   // clearBuffer
+    // ------------------------------------------------------------------------
     BareNetworkString& encodeString16(const irr::core::stringw& value)
     {
         uint8_t str_len = (uint8_t)value.size();
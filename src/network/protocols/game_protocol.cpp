@@ -17,9 +17,12 @@
 
 #include "network/protocols/game_protocol.hpp"
 
+#include "config/stk_config.hpp"
+#include "config/user_config.hpp"
 #include "modes/world.hpp"
 #include "karts/abstract_kart.hpp"
 #include "karts/controller/player_controller.hpp"
+#include "network/bit_stream.hpp"
 #include "network/event.hpp"
 #include "network/network_config.hpp"
 #include "network/game_setup.hpp"
@@ -29,9 +32,13 @@
 #include "network/rewind_manager.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
+#include "race/race_manager.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
 
+#include <algorithm>
+#include <string.h>
+
 // ============================================================================
 std::weak_ptr<GameProtocol> GameProtocol::m_game_protocol;
 // ============================================================================
@@ -52,41 +59,175 @@ std::shared_ptr<GameProtocol> GameProtocol::createInstance()
 GameProtocol::GameProtocol()
             : Protocol( PROTOCOL_CONTROLLER_EVENTS)
 {
-    m_data_to_send = getNetworkString();
+    m_data_to_send  = getNetworkString();
+    m_delta_to_send = getNetworkString();
+    m_state_history_ticks.resize(DELTA_HISTORY_SIZE, -1);
+    for (unsigned int i = 0; i < DELTA_HISTORY_SIZE; i++)
+        m_state_history.push_back(new BareNetworkString());
+    m_next_state_history = 0;
+    m_first_action_sequence   = 0;
+    m_num_sent_actions        = 0;
+    m_last_action_frame_ticks = 0;
+    m_acked_action_sequence   = 0;
 }   // GameProtocol
 
 //-----------------------------------------------------------------------------
 GameProtocol::~GameProtocol()
 {
     delete m_data_to_send;
+    delete m_delta_to_send;
+    for (unsigned int i = 0; i < m_state_history.size(); i++)
+        delete m_state_history[i];
+
+    for (auto &p : m_peer_action_stats)
+    {
+        Log::info("GameProtocol", "Host %d: %d actions received, %d "
+                  "recovered from redundant frames, %d duplicated, %d lost.",
+                  p.first, p.second.m_received, p.second.m_recovered,
+                  p.second.m_duplicated, p.second.m_lost);
+    }
 }   // ~GameProtocol
 
 //-----------------------------------------------------------------------------
-/** Synchronous update - will send all commands collected during the last
- *  frame (and could optional only send messages every N frames).
+/** Unit tests for the delta compression of states. It tests that the
+ *  decoded state is identical to the original state with matching,
+ *  partially matching, resized and missing baseline blocks, and that only
+ *  changed words are sent.
+ */
+void GameProtocol::unitTesting()
+{
+    // Creates a state with one block for each specified size, filled
+    // with a pattern based on 'seed'.
+    class TestState
+    {
+    public:
+        static void create(BareNetworkString *s, const unsigned int *sizes,
+                           unsigned int n, int seed)
+        {
+            for (unsigned int i = 0; i < n; i++)
+            {
+                s->addUInt16(sizes[i]);
+                for (unsigned int j = 0; j < sizes[i]; j++)
+                    s->addUInt8((uint8_t)(j * 7 + i + seed));
+            }
+        }
+    };   // TestState
+
+    const unsigned int sizes[] = { 61, 7, 0, 33 };
+    BareNetworkString baseline, state, delta, restored;
+    TestState::create(&baseline, sizes, 4, 0);
+    TestState::create(&state, sizes, 4, 0);
+
+    // 1) Identical states: only sizes and masks are sent
+    encodeStateDelta(state, baseline, &delta);
+    assert(delta.size() == 4 * 2 + 2 + 1 + 0 + 2);
+    assert(decodeStateDelta(delta, baseline, &restored));
+    assert(restored.size() == state.size());
+    assert(memcmp(restored.getData(), state.getData(), state.size()) == 0);
+
+    // 2) Change a few bytes, including the last partial word of a block
+    state.getData()[2 + 5]      ^= 0x10;
+    state.getData()[2 + 60]     ^= 0x01;
+    state.getData()[2 + 61 + 3] ^= 0x80;
+    delta.clearBuffer();
+    restored.clearBuffer();
+    encodeStateDelta(state, baseline, &delta);
+    assert(delta.size() == 4 * 2 + 2 + 1 + 0 + 2 + 4 + 1 + 4);
+    assert(decodeStateDelta(delta, baseline, &restored));
+    assert(restored.size() == state.size());
+    assert(memcmp(restored.getData(), state.getData(), state.size()) == 0);
+
+    // 3) A block with a different size in the baseline must be sent fully
+    const unsigned int other_sizes[] = { 61, 8, 0, 33 };
+    BareNetworkString other_baseline;
+    TestState::create(&other_baseline, other_sizes, 4, 0);
+    delta.clearBuffer();
+    restored.clearBuffer();
+    encodeStateDelta(state, other_baseline, &delta);
+    assert(decodeStateDelta(delta, other_baseline, &restored));
+    assert(memcmp(restored.getData(), state.getData(), state.size()) == 0);
+
+    // 4) An empty baseline (i.e. a full state)
+    BareNetworkString empty;
+    delta.clearBuffer();
+    restored.clearBuffer();
+    encodeStateDelta(state, empty, &delta);
+    assert(decodeStateDelta(delta, empty, &restored));
+    assert(memcmp(restored.getData(), state.getData(), state.size()) == 0);
+
+    // 5) Decoding with a wrong baseline that misses required data fails
+    delta.clearBuffer();
+    restored.clearBuffer();
+    encodeStateDelta(state, baseline, &delta);
+    assert(!decodeStateDelta(delta, empty, &restored));
+}   // unitTesting
+
+//-----------------------------------------------------------------------------
+/** Synchronous update - will send all actions collected since the last
+ *  frame in one action frame to the server. Each frame also contains all
+ *  actions that have not been acknowledged by the server yet, so a lost
+ *  packet does not lose an action (and trigger a rewind on the server).
+ *  The frame is bit-packed, and the ticks of each action are stored as
+ *  difference to the previous action.
  */
 void GameProtocol::update(int ticks)
 {
+    // Remove all actions the server has acknowledged
+    uint32_t acked = m_acked_action_sequence;
+    while (!m_all_actions.empty() &&
+           (int32_t)(acked - m_first_action_sequence) > 0)
+    {
+        m_all_actions.pop_front();
+        m_first_action_sequence++;
+        if (m_num_sent_actions > 0) m_num_sent_actions--;
+    }
+
     if (m_all_actions.size() == 0) return;   // nothing to do
 
+    // If there are no new actions, only resend from time to time
+    int now = World::getWorld()->getTimeTicks();
+    if (m_num_sent_actions == m_all_actions.size() &&
+        now - m_last_action_frame_ticks < ACTION_RESEND_TICKS)
+        return;
+
+    while (m_all_actions.size() > MAX_UNACKED_ACTIONS)
+    {
+        Log::warn("GameProtocol", "Too many unacknowledged actions, "
+                  "dropping action %d.", m_first_action_sequence);
+        m_all_actions.pop_front();
+        m_first_action_sequence++;
+        if (m_num_sent_actions > 0) m_num_sent_actions--;
+    }
+
     // Clear left-over data from previous frame. This way the network
     // string will increase till it reaches maximum size necessary
     m_data_to_send->clear();
-    m_data_to_send->addUInt8(GP_CONTROLLER_ACTION)
-                   .addUInt8(uint8_t(m_all_actions.size()));
-
-    // Add all actions
-    for (auto a : m_all_actions)
+    m_data_to_send->addUInt8(GP_ACTION_FRAME)
+                   .addUInt32(m_first_action_sequence)
+                   .addUInt32(m_all_actions.front().m_ticks);
     {
-        m_data_to_send->addUInt32(a.m_ticks);
-        m_data_to_send->addUInt8(a.m_kart_id);
-        m_data_to_send->addUInt8((uint8_t)(a.m_action)).addUInt32(a.m_value)
-                       .addUInt32(a.m_value_l).addUInt32(a.m_value_r);
-    }   // for a in m_all_actions
-
-    // FIXME: for now send reliable
-    sendToServer(m_data_to_send, /*reliable*/ true);
-    m_all_actions.clear();
+        BitWriter writer(m_data_to_send);
+        writer.addVarUInt((uint32_t)m_all_actions.size())
+              .addVarUInt(m_num_sent_actions);
+
+        // Add all actions
+        int previous_ticks = m_all_actions.front().m_ticks;
+        for (auto a : m_all_actions)
+        {
+            writer.addVarInt(a.m_ticks - previous_ticks)
+                  .addVarUInt(a.m_kart_id)
+                  .addVarUInt((uint32_t)a.m_action)
+                  .addVarInt(a.m_value)
+                  .addVarInt(a.m_value_l)
+                  .addVarInt(a.m_value_r);
+            previous_ticks = a.m_ticks;
+        }   // for a in m_all_actions
+    }   // flush the bit writer
+
+    // Lost frames are handled by resending unacknowledged actions
+    sendToServer(m_data_to_send, /*reliable*/ false);
+    m_num_sent_actions        = (unsigned int)m_all_actions.size();
+    m_last_action_frame_ticks = now;
 }   // update
 
 //-----------------------------------------------------------------------------
@@ -103,6 +244,10 @@ bool GameProtocol::notifyEventAsynchronous(Event* event)
     case GP_CONTROLLER_ACTION: handleControllerAction(event); break;
     case GP_STATE:             handleState(event);            break;
     case GP_ADJUST_TIME:       handleAdjustTime(event);       break;
+    case GP_STATE_DELTA:       handleStateDelta(event);       break;
+    case GP_STATE_ACK:         handleStateAck(event);         break;
+    case GP_ACTION_FRAME:      handleActionFrame(event);      break;
+    case GP_ACTION_ACK:        handleActionAck(event);        break;
     default: Log::error("GameProtocol",
                         "Received unknown message type %d - ignored.",
                         message_type);                        break;
@@ -135,8 +280,8 @@ void GameProtocol::controllerAction(int kart_id, PlayerAction action,
     m_all_actions.push_back(a);
 
     // Store the event in the rewind manager, which is responsible
-    // for freeing the allocated memory
-    BareNetworkString *s = new BareNetworkString(4);
+    // for freeing (or recycling) the buffer
+    BareNetworkString *s = RewindManager::get()->getBuffer();
     s->addUInt8(kart_id).addUInt8(action).addUInt32(value)
                         .addUInt32(val_l).addUInt32(val_r);
 
@@ -163,31 +308,13 @@ void GameProtocol::handleControllerAction(Event *event)
     for (unsigned int i = 0; i < count; i++)
     {
         int ticks = data.getUInt32();
-
-        // Since this is running in a thread, it might be called during
-        // a rewind, i.e. with an incorrect world time. So the event
-        // time needs to be compared with the World time independent
-        // of any rewinding.
-        if (ticks < RewindManager::get()->getNotRewoundWorldTicks() &&
-            !will_trigger_rewind                                     )
-        {
-            will_trigger_rewind = true;
-            rewind_delta = ticks 
-                         - RewindManager::get()->getNotRewoundWorldTicks();
-        }
         uint8_t kart_id = data.getUInt8();
-        assert(kart_id < World::getWorld()->getNumKarts());
-
         PlayerAction action = (PlayerAction)(data.getUInt8());
         int value   = data.getUInt32();
         int value_l = data.getUInt32();
         int value_r = data.getUInt32();
-        Log::info("GameProtocol", "Action at %d: %d %d %d %d %d",
-                  ticks, kart_id, action, value, value_l, value_r);
-        BareNetworkString *s = new BareNetworkString(3);
-        s->addUInt8(kart_id).addUInt8(action).addUInt32(value)
-                            .addUInt32(value_l).addUInt32(value_r);
-        RewindManager::get()->addNetworkEvent(this, s, ticks);
+        addNetworkAction(ticks, kart_id, action, value, value_l, value_r,
+                         &will_trigger_rewind, &rewind_delta);
     }
 
     if (data.size() > 0)
@@ -215,6 +342,214 @@ void GameProtocol::handleControllerAction(Event *event)
 
 }   // handleControllerAction
 
+// ----------------------------------------------------------------------------
+/** Adds one action received from the network to the RewindManager's network
+ *  event queue.
+ *  \param will_trigger_rewind Set to true if this action is in the past of
+ *         the (not rewound) world time, i.e. will trigger a rewind.
+ *  \param rewind_delta If a rewind is triggered by the first action, the
+ *         (negative) difference between action ticks and world time.
+ */
+void GameProtocol::addNetworkAction(int ticks, uint8_t kart_id,
+                                    PlayerAction action, int value,
+                                    int value_l, int value_r,
+                                    bool *will_trigger_rewind,
+                                    int *rewind_delta)
+{
+    // Since this is running in a thread, it might be called during
+    // a rewind, i.e. with an incorrect world time. So the event
+    // time needs to be compared with the World time independent
+    // of any rewinding.
+    if (ticks < RewindManager::get()->getNotRewoundWorldTicks() &&
+        !*will_trigger_rewind                                    )
+    {
+        *will_trigger_rewind = true;
+        *rewind_delta = ticks
+                      - RewindManager::get()->getNotRewoundWorldTicks();
+    }
+    assert(kart_id < World::getWorld()->getNumKarts());
+
+    Log::info("GameProtocol", "Action at %d: %d %d %d %d %d",
+              ticks, kart_id, action, value, value_l, value_r);
+    BareNetworkString *s = RewindManager::get()->getBuffer();
+    s->addUInt8(kart_id).addUInt8(action).addUInt32(value)
+                        .addUInt32(value_l).addUInt32(value_r);
+    RewindManager::get()->addNetworkEvent(this, s, ticks);
+}   // addNetworkAction
+
+// ----------------------------------------------------------------------------
+/** Called on the server when an action frame from a client is received.
+ *  Actions that were already received in an earlier frame are ignored, all
+ *  new actions are added to the RewindManager and forwarded to all other
+ *  clients. The highest received action is acknowledged to the client.
+ */
+void GameProtocol::handleActionFrame(Event *event)
+{
+    // Ignore events arriving when the race has already finished
+    if (!World::getWorld())
+        return;
+
+    // The message comes from the network, so don't trust the sender
+    if (!NetworkConfig::get()->isServer())
+    {
+        Log::warn("GameProtocol", "Host %d sent an action frame to a client.",
+                  event->getPeer()->getHostId());
+        return;
+    }
+    if (!checkDataSize(event, 8)) return;
+    NetworkString &data = event->data();
+    uint32_t first_sequence = data.getUInt32();
+    int ticks               = data.getUInt32();
+
+    // The frame is sent by a client, so nothing in it can be trusted: it is
+    // completely decoded and checked before any action is used.
+    STKPeer *peer = event->getPeer();
+    BitReader reader(&data);
+    unsigned int count      = reader.getVarUInt();
+    unsigned int num_resent = reader.getVarUInt();
+    if (reader.hasError() || count > MAX_UNACKED_ACTIONS ||
+        num_resent > count)
+    {
+        Log::warn("GameProtocol", "Host %d sent an invalid action frame.",
+                  peer->getHostId());
+        return;
+    }
+    std::vector<Action> all_actions(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (reader.getRemainingBits() < MIN_ACTION_BITS)
+        {
+            Log::warn("GameProtocol", "Host %d sent a truncated action "
+                      "frame.", peer->getHostId());
+            return;
+        }
+        Action &a = all_actions[i];
+        ticks      += reader.getVarInt();
+        a.m_ticks   = ticks;
+        a.m_kart_id = reader.getVarUInt();
+        a.m_action  = (PlayerAction)reader.getVarUInt();
+        a.m_value   = reader.getVarInt();
+        a.m_value_l = reader.getVarInt();
+        a.m_value_r = reader.getVarInt();
+        // A client can only control its own karts
+        const unsigned int kart_id = (unsigned int)a.m_kart_id;
+        if (reader.hasError() || kart_id >= race_manager->getNumPlayers() ||
+            kart_id >= World::getWorld()->getNumKarts() ||
+            race_manager->getKartInfo(kart_id).getHostId() !=
+                (int)peer->getHostId() ||
+            a.m_action < PA_FIRST_GAME_ACTION ||
+            a.m_action > PA_LAST_GAME_ACTION)
+        {
+            Log::warn("GameProtocol", "Host %d sent an invalid action.",
+                      peer->getHostId());
+            return;
+        }
+    }
+
+    std::vector<Action> new_actions;
+    std::unique_lock<std::mutex> lock(m_peer_action_stats_mutex);
+    PeerActionStats &stats = m_peer_action_stats[peer->getHostId()];
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const Action &a = all_actions[i];
+        uint32_t sequence = first_sequence + i;
+        if ((int32_t)(sequence - stats.m_next_sequence) < 0)
+        {
+            stats.m_duplicated++;
+            continue;
+        }
+        if (sequence != stats.m_next_sequence)
+        {
+            Log::warn("GameProtocol", "Host %d lost %d actions.",
+                      peer->getHostId(),
+                      sequence - stats.m_next_sequence);
+            stats.m_lost += sequence - stats.m_next_sequence;
+        }
+        stats.m_next_sequence = sequence + 1;
+        stats.m_received++;
+        if (i < num_resent)
+            stats.m_recovered++;
+        new_actions.push_back(a);
+    }
+    uint32_t next_sequence = stats.m_next_sequence;
+    lock.unlock();
+
+    // Acknowledge the received actions, so the client can stop resending
+    // them. If the ack is lost, the next one will acknowledge them.
+    NetworkString *ack = getNetworkString(5);
+    ack->addUInt8(GP_ACTION_ACK).addUInt32(next_sequence);
+    event->getPeer()->sendPacket(ack, /*reliable*/false);
+    delete ack;
+
+    if (new_actions.empty()) return;
+
+    bool will_trigger_rewind = false;
+    int rewind_delta = 0;
+    // The number of actions is at most MAX_UNACKED_ACTIONS, and kart ids and
+    // actions were checked above, so all of them fit into one byte.
+    static_assert(MAX_UNACKED_ACTIONS <= 255, "Action count needs a byte");
+    NetworkString *forward = getNetworkString(2 + 19 * new_actions.size());
+    forward->addUInt8(GP_CONTROLLER_ACTION)
+            .addUInt8(uint8_t(new_actions.size()));
+    for (auto a : new_actions)
+    {
+        addNetworkAction(a.m_ticks, a.m_kart_id, a.m_action, a.m_value,
+                         a.m_value_l, a.m_value_r, &will_trigger_rewind,
+                         &rewind_delta);
+        forward->addUInt32(a.m_ticks).addUInt8(a.m_kart_id)
+                .addUInt8((uint8_t)(a.m_action)).addUInt32(a.m_value)
+                .addUInt32(a.m_value_l).addUInt32(a.m_value_r);
+    }
+
+    // Send the new actions to all clients except the original sender.
+    STKHost::get()->sendPacketExcept(event->getPeer(), forward, false);
+    delete forward;
+
+    if (will_trigger_rewind)
+    {
+        Log::info("GameProtocol",
+            "At %d %f %d requesting time adjust of %d for host %d",
+            World::getWorld()->getTimeTicks(), StkTime::getRealTime(),
+            RewindManager::get()->getNotRewoundWorldTicks(),
+            rewind_delta, event->getPeer()->getHostId());
+        adjustTimeForClient(event->getPeer(), rewind_delta);
+    }
+}   // handleActionFrame
+
+// ----------------------------------------------------------------------------
+/** Called on a client when the server acknowledges received actions.
+ */
+void GameProtocol::handleActionAck(Event *event)
+{
+    uint32_t sequence = event->data().getUInt32();
+    // Acks can arrive out of order, only use newer ones.
+    if ((int32_t)(sequence - m_acked_action_sequence) > 0)
+        m_acked_action_sequence = sequence;
+}   // handleActionAck
+
+// ----------------------------------------------------------------------------
+/** Server only: returns statistics about the actions received from a peer.
+ *  \param host_id The host id of the peer.
+ *  \param received Number of different actions received.
+ *  \param recovered Number of actions only received because they were
+ *         resent in a later frame.
+ *  \param lost Number of actions never received.
+ *  \return False if no actions were received from this peer.
+ */
+bool GameProtocol::getActionStats(uint32_t host_id, unsigned int *received,
+                                  unsigned int *recovered,
+                                  unsigned int *lost) const
+{
+    std::lock_guard<std::mutex> lock(m_peer_action_stats_mutex);
+    std::map<uint32_t, PeerActionStats>::const_iterator it =
+        m_peer_action_stats.find(host_id);
+    if (it == m_peer_action_stats.end()) return false;
+    *received  = it->second.m_received;
+    *recovered = it->second.m_recovered;
+    *lost      = it->second.m_lost;
+    return true;
+}   // getActionStats
+
 // ----------------------------------------------------------------------------
 /** The server might request that a client adjusts its world clock (in order to
  *  reduce rewinds). This function sends a a (unreliable) message to the 
@@ -283,9 +618,313 @@ void GameProtocol::sendState()
     Log::info("GameProtocol", "Sending new state at %d.",
         World::getWorld()->getTimeTicks());
     assert(NetworkConfig::get()->isServer());
-    sendMessageToPeersChangingToken(m_data_to_send, /*reliable*/true);
+    if (!UserConfigParams::m_delta_state_compression)
+    {
+        sendMessageToPeersChangingToken(m_data_to_send, /*reliable*/true);
+        return;
+    }
+
+    // Delta compression: store the full state (without message type and
+    // ticks) so it can be used as a baseline later, then send each peer
+    // the difference to the latest state it has acknowledged.
+    int ticks = World::getWorld()->getTimeTicks();
+    const int header_size = 1 + 4;   // GP_STATE and ticks
+    addStateToHistory(ticks, m_data_to_send->getCurrentData() + header_size,
+                      m_data_to_send->size() - header_size);
+
+    std::vector<std::shared_ptr<STKPeer> > peers = STKHost::get()->getPeers();
+    for (unsigned int i = 0; i < peers.size(); i++)
+    {
+        if (peers[i]->isClientServerTokenSet())
+            sendStateToPeer(peers[i].get(), ticks);
+    }
 }   // sendState
 
+// ----------------------------------------------------------------------------
+/** Server only: sends the state at the given ticks (which must be the latest
+ *  state in the history) to one peer. If the peer has acknowledged a state
+ *  which is still in the history, only the difference to this state is
+ *  sent, otherwise (e.g. at the start of a race, or after packet loss) the
+ *  full state is sent.
+ *  \param peer The peer to send the state to.
+ *  \param ticks The time of the state to send.
+ */
+void GameProtocol::sendStateToPeer(STKPeer *peer, int ticks)
+{
+    int acked_ticks = -1;
+    m_acked_state_mutex.lock();
+    std::map<uint32_t, int>::const_iterator it =
+        m_acked_state_ticks.find(peer->getHostId());
+    if (it != m_acked_state_ticks.end())
+        acked_ticks = it->second;
+    m_acked_state_mutex.unlock();
+
+    const BareNetworkString *state    = getStateFromHistory(ticks);
+    const BareNetworkString *baseline = acked_ticks >= 0
+                                      ? getStateFromHistory(acked_ticks)
+                                      : NULL;
+    assert(state);
+
+    m_delta_to_send->clear();
+    m_delta_to_send->addUInt8(GP_STATE_DELTA).addUInt32(ticks);
+    if (baseline)
+    {
+        m_delta_to_send->addUInt32(acked_ticks);
+        encodeStateDelta(*state, *baseline, m_delta_to_send);
+    }
+    else
+    {
+        // No usable baseline, send the full state
+        m_delta_to_send->addUInt32(0xffffffff);
+        (*m_delta_to_send) += *state;
+    }
+    Log::verbose("GameProtocol", "State at %d for host %d: %d bytes "
+                 "(full state %d bytes, baseline %d).", ticks,
+                 peer->getHostId(), m_delta_to_send->size(), state->size(),
+                 acked_ticks);
+    peer->sendPacket(m_delta_to_send, /*reliable*/true);
+}   // sendStateToPeer
+
+// ----------------------------------------------------------------------------
+/** Stores a copy of a full state in the ring buffer of recent states, which
+ *  are used as baselines for delta compression.
+ *  \param ticks Time of the state.
+ *  \param data Pointer to the state data (without message type and ticks).
+ *  \param len Number of bytes of the state.
+ */
+void GameProtocol::addStateToHistory(int ticks, const char *data, int len)
+{
+    m_state_history_ticks[m_next_state_history] = ticks;
+    m_state_history[m_next_state_history]->setData(data, len);
+    m_next_state_history = (m_next_state_history + 1) % DELTA_HISTORY_SIZE;
+}   // addStateToHistory
+
+// ----------------------------------------------------------------------------
+/** Returns the full state at the given time from the history, or NULL if
+ *  there is no such state (anymore).
+ *  \param ticks Time of the state.
+ */
+const BareNetworkString* GameProtocol::getStateFromHistory(int ticks) const
+{
+    for (unsigned int i = 0; i < DELTA_HISTORY_SIZE; i++)
+    {
+        if (m_state_history_ticks[i] == ticks)
+            return m_state_history[i];
+    }
+    return NULL;
+}   // getStateFromHistory
+
+// ----------------------------------------------------------------------------
+/** Delta compresses a full state against a baseline state. Both states
+ *  consist of one block per rewinder, each prefixed with a 16-bit size.
+ *  Each block is split into 4-byte words, and only the words that differ
+ *  from the same block in the baseline are written, prefixed with a bit
+ *  mask of changed words. If a block in the baseline has a different size,
+ *  all words of that block are written. The encoding is lossless, so the
+ *  decoded state is bit-identical to the original state.
+ *  \param state The full state to compress.
+ *  \param baseline The state the receiver already has.
+ *  \param delta The compressed data is appended to this string.
+ */
+void GameProtocol::encodeStateDelta(const BareNetworkString &state,
+                                    const BareNetworkString &baseline,
+                                    BareNetworkString *delta)
+{
+    const uint8_t *s = (const uint8_t*)state.getCurrentData();
+    const uint8_t *b = (const uint8_t*)baseline.getCurrentData();
+    const unsigned int s_len = state.size();
+    const unsigned int b_len = baseline.size();
+    unsigned int s_pos = 0, b_pos = 0;
+
+    while (s_pos + 2 <= s_len)
+    {
+        unsigned int size = (s[s_pos] << 8) | s[s_pos + 1];
+        s_pos += 2;
+        assert(s_pos + size <= s_len);
+
+        // Find the corresponding block in the baseline
+        const uint8_t *base = NULL;
+        if (b_pos + 2 <= b_len)
+        {
+            unsigned int b_size = (b[b_pos] << 8) | b[b_pos + 1];
+            b_pos += 2;
+            if (b_size == size && b_pos + b_size <= b_len)
+                base = b + b_pos;
+            b_pos += b_size;
+        }
+
+        delta->addUInt16(size);
+        const unsigned int words = (size + 3) / 4;
+        const unsigned int mask_start = delta->getTotalSize();
+        for (unsigned int i = 0; i < (words + 7) / 8; i++)
+            delta->addUInt8(0);
+
+        for (unsigned int w = 0; w < words; w++)
+        {
+            unsigned int n = std::min(4u, size - 4 * w);
+            const uint8_t *word = s + s_pos + 4 * w;
+            if (base && memcmp(word, base + 4 * w, n) == 0) continue;
+            delta->getData()[mask_start + w / 8] |= (char)(1 << (w % 8));
+            for (unsigned int i = 0; i < n; i++)
+                delta->addUInt8(word[i]);
+        }
+        s_pos += size;
+    }   // while s_pos < s_len
+}   // encodeStateDelta
+
+// ----------------------------------------------------------------------------
+/** Restores a full state from a delta compressed state (see
+ *  encodeStateDelta) and the baseline the delta was computed against.
+ *  \param delta The compressed data, read from the current position.
+ *  \param baseline The baseline state.
+ *  \param state The restored state is appended to this string.
+ *  \return False if the data is invalid or does not match the baseline.
+ */
+bool GameProtocol::decodeStateDelta(const BareNetworkString &delta,
+                                    const BareNetworkString &baseline,
+                                    BareNetworkString *state)
+{
+    const uint8_t *d = (const uint8_t*)delta.getCurrentData();
+    const uint8_t *b = (const uint8_t*)baseline.getCurrentData();
+    const unsigned int d_len = delta.size();
+    const unsigned int b_len = baseline.size();
+    unsigned int d_pos = 0, b_pos = 0;
+
+    while (d_pos < d_len)
+    {
+        if (d_pos + 2 > d_len) return false;
+        unsigned int size = (d[d_pos] << 8) | d[d_pos + 1];
+        d_pos += 2;
+
+        const uint8_t *base = NULL;
+        if (b_pos + 2 <= b_len)
+        {
+            unsigned int b_size = (b[b_pos] << 8) | b[b_pos + 1];
+            b_pos += 2;
+            if (b_size == size && b_pos + b_size <= b_len)
+                base = b + b_pos;
+            b_pos += b_size;
+        }
+
+        const unsigned int words = (size + 3) / 4;
+        const uint8_t *mask = d + d_pos;
+        d_pos += (words + 7) / 8;
+        if (d_pos > d_len) return false;
+
+        state->addUInt16(size);
+        for (unsigned int w = 0; w < words; w++)
+        {
+            unsigned int n = std::min(4u, size - 4 * w);
+            const uint8_t *word;
+            if (mask[w / 8] & (1 << (w % 8)))
+            {
+                if (d_pos + n > d_len) return false;
+                word = d + d_pos;
+                d_pos += n;
+            }
+            else
+            {
+                if (!base) return false;
+                word = base + 4 * w;
+            }
+            for (unsigned int i = 0; i < n; i++)
+                state->addUInt8(word[i]);
+        }
+    }   // while d_pos < d_len
+    return true;
+}   // decodeStateDelta
+
+// ----------------------------------------------------------------------------
+/** Called on a client when a state is received from a server that uses
+ *  delta compression. The full state is restored using the baseline from
+ *  the history of received states, and the server is informed about the
+ *  received state so it can be used as baseline for the next states.
+ */
+void GameProtocol::handleStateDelta(Event *event)
+{
+    // Ignore events arriving when client has already exited
+    if (!World::getWorld())
+        return;
+
+    if (!NetworkConfig::get()->isClient())
+    {
+        Log::warn("GameProtocol", "Host %d sent a state delta to the server.",
+                  event->getPeer()->getHostId());
+        return;
+    }
+    if (!checkDataSize(event, 8)) return;
+    const NetworkString &data = event->data();
+    int ticks               = data.getUInt32();
+    uint32_t baseline_ticks = data.getUInt32();
+
+    BareNetworkString *bns = RewindManager::get()->getBuffer();
+    if (baseline_ticks == 0xffffffff)
+    {
+        bns->setData(data.getCurrentData(), data.size());
+    }
+    else
+    {
+        const BareNetworkString *baseline =
+            getStateFromHistory((int)baseline_ticks);
+        if (!baseline || !decodeStateDelta(data, *baseline, bns))
+        {
+            Log::warn("GameProtocol",
+                      "Can not decode state at %d with baseline %d.",
+                      ticks, baseline_ticks);
+            RewindManager::get()->freeBuffer(bns);
+            // Request a full state from the server.
+            NetworkString *ns = getNetworkString(5);
+            ns->addUInt8(GP_STATE_ACK).addUInt32(0xffffffff);
+            sendToServer(ns, /*reliable*/false);
+            delete ns;
+            return;
+        }
+    }
+    addStateToHistory(ticks, bns->getData(), bns->getTotalSize());
+
+    // The memory for bns will be handled by the RewindQueue
+    RewindManager::get()->addNetworkState(bns, ticks);
+
+    NetworkString *ns = getNetworkString(5);
+    ns->addUInt8(GP_STATE_ACK).addUInt32(ticks);
+    // Acks can be sent unreliable: if one is lost the server just uses
+    // an older baseline (or sends a full state).
+    sendToServer(ns, /*reliable*/false);
+    delete ns;
+
+    Log::info("GameProtocol", "Received at %d delta state from %d (%d).",
+              World::getWorld()->getTimeTicks(), ticks, baseline_ticks);
+}   // handleStateDelta
+
+// ----------------------------------------------------------------------------
+/** Called on the server when a client acknowledges a received state. A value
+ *  of 0xffffffff indicates that the client could not decode a state, in which
+ *  case the next state sent to this client will be a full state.
+ */
+void GameProtocol::handleStateAck(Event *event)
+{
+    // The message comes from the network, so don't trust the sender
+    if (!NetworkConfig::get()->isServer())
+    {
+        Log::warn("GameProtocol", "Host %d sent a state ack to a client.",
+                  event->getPeer()->getHostId());
+        return;
+    }
+    if (!checkDataSize(event, 4)) return;
+    int ticks = (int)event->data().getUInt32();
+    uint32_t host_id = event->getPeer()->getHostId();
+
+    std::lock_guard<std::mutex> lock(m_acked_state_mutex);
+    if (ticks < 0)
+    {
+        m_acked_state_ticks.erase(host_id);
+        return;
+    }
+    std::map<uint32_t, int>::iterator it = m_acked_state_ticks.find(host_id);
+    if (it == m_acked_state_ticks.end() || it->second < ticks)
+        m_acked_state_ticks[host_id] = ticks;
+}   // handleStateAck
+
 // ----------------------------------------------------------------------------
 /** Called when a new full state is received form the server.
  */
@@ -298,13 +937,13 @@ void GameProtocol::handleState(Event *event)
     assert(NetworkConfig::get()->isClient());
     const NetworkString &data = event->data();
     int ticks          = data.getUInt32();
-    // Now copy the state data (without ticks etc) to a new
+    // Now copy the state data (without ticks etc) to a (pooled)
     // string, so it can be reset to the beginning easily
     // when restoring the state:
-    BareNetworkString *bns = new BareNetworkString(data.getCurrentData(),
-                                                   data.size());
+    BareNetworkString *bns = RewindManager::get()->getBuffer();
+    bns->setData(data.getCurrentData(), data.size());
 
-    // The memory for bns will be handled in the RewindInfoState object
+    // The memory for bns will be handled by the RewindQueue
     RewindManager::get()->addNetworkState(bns, ticks);
 
     Log::info("GameProtocol", "Received at %d state from %d",
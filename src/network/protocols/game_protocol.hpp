@@ -26,6 +26,10 @@
 #include "utils/cpp2011.hpp"
 #include "utils/singleton.hpp"
 
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <vector>
 
 class BareNetworkString;
@@ -40,13 +44,57 @@ private:
     /** The type of game events to be forwarded to the server. */
     enum { GP_CONTROLLER_ACTION,
            GP_STATE,
-           GP_ADJUST_TIME
+           GP_ADJUST_TIME,
+           GP_STATE_DELTA,
+           GP_STATE_ACK,
+           GP_ACTION_FRAME,
+           GP_ACTION_ACK
     };
 
+    /** Maximum number of unacknowledged actions a client keeps and resends
+     *  in each action frame. */
+    static const unsigned int MAX_UNACKED_ACTIONS = 64;
+
+    /** Minimum number of bits of an action in an action frame: each of its
+     *  6 values uses at least 5 bits. */
+    static const unsigned int MIN_ACTION_BITS = 30;
+
+    /** If a client has unacknowledged actions but no new actions, it resends
+     *  the unacknowledged actions after this many ticks. */
+    static const int ACTION_RESEND_TICKS = 6;
+
     /** A network string that collects all information from the server to be sent
      *  next. */
     NetworkString *m_data_to_send;
 
+    /** Server only: a network string used to assemble the delta compressed
+     *  state for one peer. */
+    NetworkString *m_delta_to_send;
+
+    /** Number of full states kept (on the server the states sent, on a
+     *  client the states received) to be used as baseline for delta
+     *  compressed states. */
+    static const unsigned int DELTA_HISTORY_SIZE = 16;
+
+    /** The ticks of each state in m_state_history, -1 if unused. */
+    std::vector<int> m_state_history_ticks;
+
+    /** A ring buffer with the most recent full states (without message
+     *  type and ticks). On the server this is accessed by the main thread,
+     *  on a client only by the network thread. */
+    std::vector<BareNetworkString*> m_state_history;
+
+    /** Index in m_state_history at which the next state is stored. */
+    unsigned int m_next_state_history;
+
+    /** Server only: the ticks of the latest state each peer (identified by
+     *  its host id) has acknowledged. */
+    std::map<uint32_t, int> m_acked_state_ticks;
+
+    /** Protects m_acked_state_ticks, which is written by the network thread
+     *  and read by the main thread. */
+    std::mutex m_acked_state_mutex;
+
     /** The server might request that the world clock of a client is adjusted
      *  to reduce number of rollbacks. */
     std::vector<int8_t> m_adjust_time;
@@ -62,15 +110,73 @@ private:
         int          m_value_r;
     };   // struct Action
 
-    // List of all kart actions to send to the server
-    std::vector<Action> m_all_actions;
+    /** Client only: all kart actions that have not been acknowledged by the
+     *  server yet, sorted by sequence number. */
+    std::deque<Action> m_all_actions;
+
+    /** Client only: sequence number of the first action in m_all_actions.
+     *  Each action gets a consecutive sequence number, which the server
+     *  uses to detect duplicated and lost actions. */
+    uint32_t m_first_action_sequence;
+
+    /** Client only: how many of the actions in m_all_actions have already
+     *  been sent at least once. */
+    unsigned int m_num_sent_actions;
+
+    /** Client only: world ticks at which the last action frame was sent. */
+    int m_last_action_frame_ticks;
+
+    /** Client only: all actions with a sequence number smaller than this
+     *  have been received by the server. Written by the network thread. */
+    std::atomic<uint32_t> m_acked_action_sequence;
+
+    /** Server only: statistics about the actions received from one peer. */
+    struct PeerActionStats
+    {
+        /** The sequence number of the next expected action. */
+        uint32_t     m_next_sequence;
+        /** Number of new actions received. */
+        unsigned int m_received;
+        /** Number of new actions that were received in a resent part of a
+         *  frame, i.e. whose original frame was lost or delayed. */
+        unsigned int m_recovered;
+        /** Number of actions received more than once. */
+        unsigned int m_duplicated;
+        /** Number of actions that were never received. */
+        unsigned int m_lost;
+        PeerActionStats() : m_next_sequence(0), m_received(0),
+                            m_recovered(0), m_duplicated(0), m_lost(0) {}
+    };   // PeerActionStats
+
+    /** Server only: action statistics for each peer (by host id). */
+    std::map<uint32_t, PeerActionStats> m_peer_action_stats;
+
+    /** Protects m_peer_action_stats. */
+    mutable std::mutex m_peer_action_stats_mutex;
 
     void handleControllerAction(Event *event);
+    void handleActionFrame(Event *event);
+    void handleActionAck(Event *event);
+    void addNetworkAction(int ticks, uint8_t kart_id, PlayerAction action,
+                          int value, int value_l, int value_r,
+                          bool *will_trigger_rewind, int *rewind_delta);
     void handleState(Event *event);
     void handleAdjustTime(Event *event);
+    void handleStateDelta(Event *event);
+    void handleStateAck(Event *event);
+    void addStateToHistory(int ticks, const char *data, int len);
+    const BareNetworkString* getStateFromHistory(int ticks) const;
+    void sendStateToPeer(STKPeer *peer, int ticks);
     static std::weak_ptr<GameProtocol> m_game_protocol;
 public:
              GameProtocol();
+    static void unitTesting();
+    static void encodeStateDelta(const BareNetworkString &state,
+                                 const BareNetworkString &baseline,
+                                 BareNetworkString *delta);
+    static bool decodeStateDelta(const BareNetworkString &delta,
+                                 const BareNetworkString &baseline,
+                                 BareNetworkString *state);
     virtual ~GameProtocol();
 
     virtual bool notifyEventAsynchronous(Event* event) OVERRIDE;
@@ -82,6 +188,8 @@ public:
     void addState(BareNetworkString *buffer);
     void sendState();
     void adjustTimeForClient(STKPeer *peer, int ticks);
+    bool getActionStats(uint32_t host_id, unsigned int *received,
+                        unsigned int *recovered, unsigned int *lost) const;
 
     virtual void undo(BareNetworkString *buffer) OVERRIDE;
     virtual void rewind(BareNetworkString *buffer) OVERRIDE;
@@ -133,6 +133,7 @@ void ServerLobby::setup()
     resetPeersReady();
     m_peers_votes.clear();
     m_server_delay = 0.0;
+    m_race_start_cpu_time = StkTime::getThreadCPUTime();
     Log::info("ServerLobby", "Reset server to initial state.");
 }   // setup
 
@@ -752,6 +753,16 @@ void ServerLobby::checkRaceFinished()
         total->addUInt32(fastest_lap);
     }
 
+    // Report the CPU time the main thread used for this race, so that the
+    // cost of a race (and of hosting several servers on one machine) can be
+    // measured. Both times are taken in the main thread, which updates the
+    // world, so the network threads are not included.
+    int ticks = World::getWorld()->getTimeTicks();
+    double cpu_time = StkTime::getThreadCPUTime() - m_race_start_cpu_time;
+    Log::info("ServerLobby", "Race used %.2f s CPU time for %d ticks "
+              "(%.3f ms per tick).", cpu_time, ticks,
+              ticks > 0 ? 1000.0 * cpu_time / ticks : 0.0);
+
     stopCurrentRace();
     // Set the delay before the server forces all clients to exit the race
     // result screen and go back to the lobby
@@ -1266,6 +1277,7 @@ std::tuple<std::string, uint8_t, bool> ServerLobby::handleVote()
  */
 void ServerLobby::finishedLoadingWorld()
 {
+    m_race_start_cpu_time = StkTime::getThreadCPUTime();
     m_server_has_loaded_world.store(true);
 }   // finishedLoadingWorld;
 
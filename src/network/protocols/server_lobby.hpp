@@ -61,6 +61,10 @@ private:
      *  seconds), which is the real time at which the server should start. */
     double m_server_delay;
 
+    /** CPU time of the main thread (which updates the world) when the world
+     *  was loaded. Used to report the CPU cost of each race. */
+    double m_race_start_cpu_time;
+
     bool m_has_created_server_id_file;
 
     /** It indicates if this server is registered with the stk server. */
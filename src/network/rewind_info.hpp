@@ -56,6 +56,10 @@ private:
 public:
     RewindInfo(int ticks, bool is_confirmed);
 
+    /** Returns the buffer with the state or event data of this RewindInfo.
+     *  Used by the RewindQueue to recycle buffers. */
+    virtual BareNetworkString *getBuffer() const = 0;
+
     /** Called when going back in time to undo any rewind information. */
     virtual void undo() = 0;
 
@@ -64,6 +68,14 @@ public:
     virtual void rewind() = 0;
     void setTicks(int ticks);
     // ------------------------------------------------------------------------
+    /** Re-initialises the time and confirmed flag when a pooled RewindInfo
+     *  is reused by the RewindQueue. */
+    void init(int ticks, bool is_confirmed)
+    {
+        m_ticks        = ticks;
+        m_is_confirmed = is_confirmed;
+    }   // init
+    // ------------------------------------------------------------------------
     virtual ~RewindInfo() { }
     // ------------------------------------------------------------------------
     /** Returns the time at which this RewindInfo was saved. */
@@ -97,9 +109,20 @@ public:
     virtual ~RewindInfoState() { delete m_buffer; };
     virtual void rewind();
 
+    // ------------------------------------------------------------------------
+    /** Re-initialises a pooled state object. */
+    void init(int ticks, BareNetworkString *buffer, bool is_confirmed)
+    {
+        RewindInfo::init(ticks, is_confirmed);
+        m_buffer = buffer;
+    }   // init
     // ------------------------------------------------------------------------
     /** Returns a pointer to the state buffer. */
-    BareNetworkString *getBuffer() const { return m_buffer; }
+    virtual BareNetworkString *getBuffer() const OVERRIDE { return m_buffer; }
+    // ------------------------------------------------------------------------
+    /** Removes the buffer from this object without freeing it, so the
+     *  buffer can be recycled. */
+    void releaseBuffer() { m_buffer = NULL; }
     // ------------------------------------------------------------------------
     virtual bool isState() const { return true; }
     // ------------------------------------------------------------------------
@@ -128,6 +151,19 @@ public:
         delete m_buffer;
     }   // ~RewindInfoEvent
 
+    // ------------------------------------------------------------------------
+    /** Re-initialises a pooled event object. */
+    void init(int ticks, EventRewinder *event_rewinder,
+              BareNetworkString *buffer, bool is_confirmed)
+    {
+        RewindInfo::init(ticks, is_confirmed);
+        m_event_rewinder = event_rewinder;
+        m_buffer         = buffer;
+    }   // init
+    // ------------------------------------------------------------------------
+    /** Removes the buffer from this object without freeing it, so the
+     *  buffer can be recycled. */
+    void releaseBuffer() { m_buffer = NULL; }
     // ------------------------------------------------------------------------
     virtual bool isEvent() const { return true; }
     // ------------------------------------------------------------------------
@@ -150,7 +186,7 @@ public:
     }   // rewind
     // ------------------------------------------------------------------------
     /** Returns the buffer with the event information in it. */
-    BareNetworkString *getBuffer() { return m_buffer; }
+    virtual BareNetworkString *getBuffer() const OVERRIDE { return m_buffer; }
 };   // class RewindIndoEvent
 
 #endif
@@ -126,7 +126,7 @@ void RewindManager::addEvent(EventRewinder *event_rewinder,
 {
     if (m_is_rewinding)
     {
-        delete buffer;
+        m_rewind_queue.freeBuffer(buffer);
         Log::error("RewindManager", "Adding event when rewinding");
         return;
     }
@@ -204,11 +204,10 @@ void RewindManager::saveLocalState()
     saveState(/*local_state*/true);
     NetworkString *state = GameProtocol::lock()->getState();
 
-    // Copy the data to a new string, making the buffer in
+    // Copy the data to a (pooled) string, making the buffer in
     // GameProtocol availble for again.
-    BareNetworkString *bns =
-        new BareNetworkString(state->getCurrentData(),
-                              state->size()           );
+    BareNetworkString *bns = m_rewind_queue.getBuffer();
+    bns->setData(state->getCurrentData(), state->size());
     m_rewind_queue.addLocalState(bns, /*confirmed*/true, ticks);
 }   // saveLocalState
 
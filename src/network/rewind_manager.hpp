@@ -150,6 +150,15 @@ public:
     void saveLocalState();
     void restoreState(BareNetworkString *buffer);
     // ------------------------------------------------------------------------
+    /** Returns an empty buffer to store a state or event in. The buffer is
+     *  taken from a pool if possible to avoid memory allocations. This is
+     *  thread-safe, so it can be called from the network thread. */
+    BareNetworkString* getBuffer() { return m_rewind_queue.getBuffer(); }
+    // ------------------------------------------------------------------------
+    /** Returns a buffer that was not added to the rewind queue to the pool.
+     *  This is thread-safe. */
+    void freeBuffer(BareNetworkString *b) { m_rewind_queue.freeBuffer(b); }
+    // ------------------------------------------------------------------------
     /** Adds a Rewinder to the list of all rewinders.
      *  \return true If rewinding is enabled, false otherwise. 
      */
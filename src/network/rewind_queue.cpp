@@ -42,6 +42,11 @@
  */
 RewindQueue::RewindQueue()
 {
+    // Initial size of the ring buffer, must be a power of 2. It will be
+    // increased if necessary.
+    m_all_rewind_info.resize(256, NULL);
+    m_first = 0;
+    m_count = 0;
     reset();
 }   // RewindQueue
 
@@ -51,12 +56,27 @@ RewindQueue::RewindQueue()
  */
 RewindQueue::~RewindQueue()
 {
-    // This frees all current data
+    // This moves all current data into the pools
     reset();
+
+    for (unsigned int i = 0; i < m_free_states.size(); i++)
+        delete m_free_states[i];
+    m_free_states.clear();
+    for (unsigned int i = 0; i < m_free_events.size(); i++)
+        delete m_free_events[i];
+    m_free_events.clear();
+
+    m_free_buffers.lock();
+    std::vector<BareNetworkString*> &buffers = m_free_buffers.getData();
+    for (unsigned int i = 0; i < buffers.size(); i++)
+        delete buffers[i];
+    buffers.clear();
+    m_free_buffers.unlock();
 }   // ~RewindQueue
 
 // ----------------------------------------------------------------------------
-/** Frees all saved state information and all destroyable rewinder.
+/** Frees all saved state information and all destroyable rewinder. The
+ *  RewindInfo objects and their buffers are kept in the pools to be reused.
  */
 void RewindQueue::reset()
 {
@@ -66,48 +86,147 @@ void RewindQueue::reset()
     for (AllNetworkRewindInfo::const_iterator i  = info.begin(); 
                                               i != info.end(); ++i)
     {
-        delete *i;
+        freeBuffer(i->m_buffer);
     }
     m_network_events.getData().clear();
     m_network_events.unlock();
 
-    AllRewindInfo::const_iterator i;
-    for (i = m_all_rewind_info.begin(); i != m_all_rewind_info.end(); ++i)
-        delete *i;
+    for (unsigned int i = 0; i < m_count; i++)
+        releaseRewindInfo(at(i));
 
-    m_all_rewind_info.clear();
-    m_current = m_all_rewind_info.end();
+    m_first   = 0;
+    m_count   = 0;
+    m_current = 0;
     m_latest_confirmed_state_time = -1;
 }   // reset
 
+// ----------------------------------------------------------------------------
+/** Returns an empty buffer that can be used to store a state or event. If
+ *  possible a previously freed buffer is reused. The buffer is owned by the
+ *  caller till it is passed to one of the add functions. This function is
+ *  thread-safe, so it can be used by the network thread.
+ */
+BareNetworkString* RewindQueue::getBuffer()
+{
+    m_free_buffers.lock();
+    std::vector<BareNetworkString*> &buffers = m_free_buffers.getData();
+    if (buffers.empty())
+    {
+        m_free_buffers.unlock();
+        return new BareNetworkString();
+    }
+    BareNetworkString *buffer = buffers.back();
+    buffers.pop_back();
+    m_free_buffers.unlock();
+    return buffer;
+}   // getBuffer
+
+// ----------------------------------------------------------------------------
+/** Returns a buffer to the pool of free buffers. This function is
+ *  thread-safe.
+ *  \param buffer The buffer to recycle, can be NULL.
+ */
+void RewindQueue::freeBuffer(BareNetworkString *buffer)
+{
+    if (!buffer) return;
+    buffer->clearBuffer();
+    m_free_buffers.lock();
+    m_free_buffers.getData().push_back(buffer);
+    m_free_buffers.unlock();
+}   // freeBuffer
+
+// ----------------------------------------------------------------------------
+/** Returns a state RewindInfo, reusing a pooled object if possible.
+ */
+RewindInfo* RewindQueue::createState(int ticks, BareNetworkString *buffer,
+                                     bool confirmed)
+{
+    if (m_free_states.empty())
+        return new RewindInfoState(ticks, buffer, confirmed);
+    RewindInfoState *ris = m_free_states.back();
+    m_free_states.pop_back();
+    ris->init(ticks, buffer, confirmed);
+    return ris;
+}   // createState
+
+// ----------------------------------------------------------------------------
+/** Returns an event RewindInfo, reusing a pooled object if possible.
+ */
+RewindInfo* RewindQueue::createEvent(int ticks, EventRewinder *event_rewinder,
+                                     BareNetworkString *buffer, bool confirmed)
+{
+    if (m_free_events.empty())
+        return new RewindInfoEvent(ticks, event_rewinder, buffer, confirmed);
+    RewindInfoEvent *rie = m_free_events.back();
+    m_free_events.pop_back();
+    rie->init(ticks, event_rewinder, buffer, confirmed);
+    return rie;
+}   // createEvent
+
+// ----------------------------------------------------------------------------
+/** Moves a RewindInfo that is not needed anymore (and its buffer) into the
+ *  pools so it can be reused later.
+ */
+void RewindQueue::releaseRewindInfo(RewindInfo *ri)
+{
+    freeBuffer(ri->getBuffer());
+    if (ri->isEvent())
+    {
+        RewindInfoEvent *rie = static_cast<RewindInfoEvent*>(ri);
+        rie->releaseBuffer();
+        m_free_events.push_back(rie);
+    }
+    else
+    {
+        RewindInfoState *ris = static_cast<RewindInfoState*>(ri);
+        ris->releaseBuffer();
+        m_free_states.push_back(ris);
+    }
+}   // releaseRewindInfo
+
 // ----------------------------------------------------------------------------
 /** Inserts a RewindInfo object in the list of all events at the correct time.
  *  If there are several RewindInfo at the exact same time, state RewindInfo
  *  will be insert at the front, and event info at the end of the RewindInfo
- *  with the same time.
+ *  with the same time. If the current pointer is at the end of the list, it
+ *  will be updated to point to the new event.
  *  \param ri The RewindInfo object to insert.
- *  \param update_current If set, the current pointer will be updated if
- *         necessary to point to the new event
  */
 void RewindQueue::insertRewindInfo(RewindInfo *ri)
 {
-    AllRewindInfo::iterator i = m_all_rewind_info.end();
+    // Increase the size of the ring buffer if it is full, and copy all
+    // elements so that the oldest element is at index 0 again.
+    if (m_count == m_all_rewind_info.size())
+    {
+        std::vector<RewindInfo*> bigger(m_all_rewind_info.size() * 2, NULL);
+        for (unsigned int i = 0; i < m_count; i++)
+            bigger[i] = at(i);
+        m_all_rewind_info.swap(bigger);
+        m_first = 0;
+    }
 
-    while (i != m_all_rewind_info.begin())
+    unsigned int pos = m_count;
+    while (pos > 0)
     {
-        AllRewindInfo::iterator i_prev = i;
-        i_prev--;
         // Now test if 'ri' needs to be inserted after the
         // previous element, i.e. before the current element:
-        if ((*i_prev)->getTicks() < ri->getTicks()) break;
-        if ((*i_prev)->getTicks() == ri->getTicks() &&
-            ri->isEvent()                              ) break;
-        i = i_prev;
+        RewindInfo *prev = at(pos - 1);
+        if (prev->getTicks() < ri->getTicks()) break;
+        if (prev->getTicks() == ri->getTicks() && ri->isEvent()) break;
+        pos--;
     }
-    if(m_current == m_all_rewind_info.end())
-        m_current = m_all_rewind_info.insert(i, ri);
-    else
-        m_all_rewind_info.insert(i, ri);  
+
+    // Move all later elements one slot to the back. In most cases new
+    // infos are added at the end, so this loop is rarely executed.
+    for (unsigned int i = m_count; i > pos; i--)
+        slot(i) = slot(i - 1);
+    slot(pos) = ri;
+
+    if (m_current == m_count)
+        m_current = pos;
+    else if (pos <= m_current)
+        m_current++;
+    m_count++;
 }   // insertRewindInfo
 
 // ----------------------------------------------------------------------------
@@ -120,8 +239,7 @@ void RewindQueue::addLocalEvent(EventRewinder *event_rewinder,
                                 BareNetworkString *buffer, bool confirmed,
                                 int ticks                                  )
 {
-    RewindInfo *ri = new RewindInfoEvent(ticks, event_rewinder,
-                                         buffer, confirmed);
+    RewindInfo *ri = createEvent(ticks, event_rewinder, buffer, confirmed);
     insertRewindInfo(ri);
 }   // addLocalEvent
 
@@ -139,7 +257,7 @@ void RewindQueue::addLocalEvent(EventRewinder *event_rewinder,
 void RewindQueue::addLocalState(BareNetworkString *buffer,
                                 bool confirmed, int ticks)
 {
-    RewindInfo *ri = new RewindInfoState(ticks, buffer, confirmed);
+    RewindInfo *ri = createState(ticks, buffer, confirmed);
     assert(ri);
     insertRewindInfo(ri);
     if (confirmed && m_latest_confirmed_state_time < ticks)
@@ -159,11 +277,14 @@ void RewindQueue::addLocalState(BareNetworkString *buffer,
 void RewindQueue::addNetworkEvent(EventRewinder *event_rewinder,
                                   BareNetworkString *buffer, int ticks)
 {
-    RewindInfo *ri = new RewindInfoEvent(ticks, event_rewinder,
-                                         buffer, /*confirmed*/true);
+    NetworkRewindInfo nri;
+    nri.m_ticks          = ticks;
+    nri.m_event_rewinder = event_rewinder;
+    nri.m_buffer         = buffer;
+    nri.m_is_event       = true;
 
     m_network_events.lock();
-    m_network_events.getData().push_back(ri);
+    m_network_events.getData().push_back(nri);
     m_network_events.unlock();
 }   // addNetworkEvent
 
@@ -177,10 +298,14 @@ void RewindQueue::addNetworkEvent(EventRewinder *event_rewinder,
  */
 void RewindQueue::addNetworkState(BareNetworkString *buffer, int ticks)
 {
-    RewindInfo *ri = new RewindInfoState(ticks, buffer, /*confirmed*/true);
+    NetworkRewindInfo nri;
+    nri.m_ticks          = ticks;
+    nri.m_event_rewinder = NULL;
+    nri.m_buffer         = buffer;
+    nri.m_is_event       = false;
 
     m_network_events.lock();
-    m_network_events.getData().push_back(ri);
+    m_network_events.getData().push_back(nri);
     m_network_events.unlock();
 }   // addNetworkState
 
@@ -210,7 +335,6 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
     // Only a client ever rewinds. So the rewind time should be the latest
     // received state before current world time (if any)
     *rewind_ticks = -9999;
-    bool adjust_next = false;
 
     // FIXME: making m_network_events sorted would prevent the need to 
     // go through the whole list of events
@@ -220,21 +344,21 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
     {
         // Ignore any events that will happen in the future. The current
         // time step is world_ticks.
-        if ((*i)->getTicks() > world_ticks)
+        if (i->m_ticks > world_ticks)
         {
             i++;
             continue;
         }
         // Any state of event that is received before the latest confirmed
         // state can be deleted.
-        if ((*i)->getTicks() < m_latest_confirmed_state_time)
+        if (i->m_ticks < m_latest_confirmed_state_time)
         {
             Log::info("RewindQueue",
                       "Deleting %s at %d because it's before confirmed state %d",
-                      (*i)->isEvent() ? "event" : "state",
-                      (*i)->getTicks(),
+                      i->m_is_event ? "event" : "state",
+                      i->m_ticks,
                       m_latest_confirmed_state_time);
-            delete *i;
+            freeBuffer(i->m_buffer);
             i = m_network_events.getData().erase(i);
             continue;
         }
@@ -243,25 +367,30 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
         // duplicated states, which in the best case would then have
         // a negative effect for every player, when in fact only one
         // player might have a network hickup).
-        if (NetworkConfig::get()->isServer() && (*i)->getTicks() < world_ticks)
+        if (NetworkConfig::get()->isServer() && i->m_ticks < world_ticks)
         {
             Log::warn("RewindQueue", "At %d received message from %d",
-                world_ticks, (*i)->getTicks());
+                world_ticks, i->m_ticks);
             // Server received an event in the past. Adjust this event
             // to be executed 'now' - at least we get a bit closer to the
             // client state.
-            (*i)->setTicks(world_ticks);
+            i->m_ticks = world_ticks;
         }
 
-        insertRewindInfo(*i);
+        RewindInfo *ri = i->m_is_event
+                       ? createEvent(i->m_ticks, i->m_event_rewinder,
+                                     i->m_buffer, /*confirmed*/true)
+                       : createState(i->m_ticks, i->m_buffer,
+                                     /*confirmed*/true);
+        insertRewindInfo(ri);
 
         Log::info("Rewind", "Inserting %s from time %d",
-                  (*i)->isEvent() ? "event" : "state",
-                  (*i)->getTicks()                       );
+                  ri->isEvent() ? "event" : "state",
+                  ri->getTicks()                       );
 
         // Check if a rewind is necessary, i.e. a message is received in the
         // past of client (server never rewinds).
-        if (NetworkConfig::get()->isClient() && (*i)->getTicks() < world_ticks)
+        if (NetworkConfig::get()->isClient() && ri->getTicks() < world_ticks)
         {
             // We need rewind if we receive an event in the past. This will
             // then trigger a rewind later. Note that we only rewind to the
@@ -272,14 +401,14 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
             // the earlier event, and the event will be replayed anyway. This
             // makes it easy to handle lost event messages.
             *needs_rewind = true;
-            if ((*i)->getTicks() > *rewind_ticks)
-                *rewind_ticks = (*i)->getTicks();
+            if (ri->getTicks() > *rewind_ticks)
+                *rewind_ticks = ri->getTicks();
         }   // if client and ticks < world_ticks
 
-        if ((*i)->isState() && (*i)->getTicks() > latest_confirmed_state &&
-            (*i)->isConfirmed())
+        if (ri->isState() && ri->getTicks() > latest_confirmed_state &&
+            ri->isConfirmed())
         {
-            latest_confirmed_state = (*i)->getTicks();
+            latest_confirmed_state = ri->getTicks();
         }
 
         i = m_network_events.getData().erase(i);
@@ -296,18 +425,20 @@ void RewindQueue::mergeNetworkData(int world_ticks, bool *needs_rewind,
 }   // mergeNetworkData
 
 // ----------------------------------------------------------------------------
-/** Deletes all states and event before the given time.
+/** Deletes all states and event before the given time. The RewindInfo
+ *  objects are moved into the pools to be reused.
  *  \param ticks Time (in ticks).
  */
 void RewindQueue::cleanupOldRewindInfo(int ticks)
 {
-    auto i = m_all_rewind_info.begin();
-
-    while ( (*i)->getTicks() < ticks)
+    while (m_count > 0 && at(0)->getTicks() < ticks)
     {
-        if (m_current == i) next();
-        delete *i;
-        i = m_all_rewind_info.erase(i);
+        releaseRewindInfo(at(0));
+        m_first = (m_first + 1) & (m_all_rewind_info.size() - 1);
+        m_count--;
+        // If current was the removed element, it now points to the next
+        // element, which has the same index as the removed element.
+        if (m_current > 0) m_current--;
     }
 
 }   // cleanupOldRewindInfo
@@ -315,7 +446,7 @@ void RewindQueue::cleanupOldRewindInfo(int ticks)
 // ----------------------------------------------------------------------------
 bool RewindQueue::isEmpty() const
 {
-    return m_current == m_all_rewind_info.end();
+    return m_current == m_count;
 }   // isEmpty
 
 // ----------------------------------------------------------------------------
@@ -323,7 +454,7 @@ bool RewindQueue::isEmpty() const
  */
 bool RewindQueue::hasMoreRewindInfo() const
 {
-    return m_current != m_all_rewind_info.end();
+    return m_current < m_count;
 }   // hasMoreRewindInfo
 
 // ----------------------------------------------------------------------------
@@ -337,17 +468,18 @@ int RewindQueue::undoUntil(int undo_ticks)
 {
     // A rewind is done after a state in the past is inserted. This function
     // makes sure that m_current is not end()
-    assert(m_current != m_all_rewind_info.end());
+    assert(m_current < m_count);
     
-    while((*m_current)->getTicks() > undo_ticks ||
-        (*m_current)->isEvent() || !(*m_current)->isConfirmed())
+    while(at(m_current)->getTicks() > undo_ticks ||
+          at(m_current)->isEvent() || !at(m_current)->isConfirmed())
     {
         // Undo all events and states from the current time
-        (*m_current)->undo();
+        at(m_current)->undo();
+        assert(m_current > 0);
         m_current--;
     }
 
-    return (*m_current)->getTicks();
+    return at(m_current)->getTicks();
 }   // undoUntil
 
 // ----------------------------------------------------------------------------
@@ -357,10 +489,10 @@ int RewindQueue::undoUntil(int undo_ticks)
 void RewindQueue::replayAllEvents(int ticks)
 {
     // Replay all events that happened at the current time step
-    while ( hasMoreRewindInfo() && (*m_current)->getTicks() == ticks )
+    while ( hasMoreRewindInfo() && at(m_current)->getTicks() == ticks )
     {
-        if ((*m_current)->isEvent())
-            (*m_current)->rewind();
+        if (at(m_current)->isEvent())
+            at(m_current)->rewind();
         m_current++;
     }   // while current->getTIcks == ticks
 
@@ -404,37 +536,37 @@ void RewindQueue::unitTesting()
     assert(!q0.hasMoreRewindInfo());
 
     q0.addLocalState(NULL, /*confirmed*/true, 0);
-    assert(q0.m_all_rewind_info.front()->isState());
-    assert(!q0.m_all_rewind_info.front()->isEvent());
+    assert(q0.at(0)->isState());
+    assert(!q0.at(0)->isEvent());
     assert(q0.hasMoreRewindInfo());
     assert(q0.undoUntil(0) == 0);
 
     q0.addNetworkEvent(dummy_rewinder, NULL, 0);
     // Network events are not immediately merged
-    assert(q0.m_all_rewind_info.size() == 1);
+    assert(q0.m_count == 1);
 
     bool needs_rewind;
     int rewind_ticks;
     int world_ticks = 0;
     q0.mergeNetworkData(world_ticks, &needs_rewind, &rewind_ticks);
     assert(q0.hasMoreRewindInfo());
-    assert(q0.m_all_rewind_info.size() == 2);
-    AllRewindInfo::iterator rii = q0.m_all_rewind_info.begin();
-    assert((*rii)->isState());
+    assert(q0.m_count == 2);
+    unsigned int rii = 0;
+    assert(q0.at(rii)->isState());
     rii++;
-    assert((*rii)->isEvent());
+    assert(q0.at(rii)->isEvent());
 
     // Another state must be sorted before the event:
     q0.addNetworkState(NULL, 0);
     assert(q0.hasMoreRewindInfo());
     q0.mergeNetworkData(world_ticks, &needs_rewind, &rewind_ticks);
-    assert(q0.m_all_rewind_info.size() == 3);
-    rii = q0.m_all_rewind_info.begin();
-    assert((*rii)->isState());
+    assert(q0.m_count == 3);
+    rii = 0;
+    assert(q0.at(rii)->isState());
     rii++;
-    assert((*rii)->isState());
+    assert(q0.at(rii)->isState());
     rii++;
-    assert((*rii)->isEvent());
+    assert(q0.at(rii)->isEvent());
 
     // Test time base comparisons: adding an event to the end
     q0.addLocalEvent(dummy_rewinder, NULL, true, 4);
@@ -443,18 +575,18 @@ void RewindQueue::unitTesting()
     // rii points to the 3rd element, the ones added just now
     // should be elements4 and 5:
     rii++;
-    assert((*rii)->getTicks()==1);
+    assert(q0.at(rii)->getTicks()==1);
     rii++;
-    assert((*rii)->getTicks()==4);
+    assert(q0.at(rii)->getTicks()==4);
 
     // Now test inserting an event first, then the state
     RewindQueue q1;
     q1.addLocalEvent(NULL, NULL, true, 5);
     q1.addLocalState(NULL, true, 5);
-    rii = q1.m_all_rewind_info.begin();
-    assert((*rii)->isState());
+    rii = 0;
+    assert(q1.at(rii)->isState());
     rii++;
-    assert((*rii)->isEvent());
+    assert(q1.at(rii)->isEvent());
 
     // Bugs seen before
     // ----------------
@@ -472,7 +604,7 @@ void RewindQueue::unitTesting()
     //    event, that m_current pooints to the first event, otherwise
     //    events with same time stamp will not be handled correctly.
     //    At this stage current points to the event at time 2 from above
-    AllRewindInfo::iterator current_old = b1.m_current;
+    unsigned int current_old = b1.m_current;
     b1.addLocalEvent(NULL, NULL, true, 2);
     // Make sure that current was not modified, i.e. the new event at time
     // 2 was added at the end of the list:
@@ -484,7 +616,7 @@ void RewindQueue::unitTesting()
     assert(ri->getTicks() == 2);
     assert(ri->isEvent());
     b1.next();
-    assert(b1.m_current == b1.m_all_rewind_info.end());
+    assert(b1.m_current == b1.m_count);
 
     // 3) Test that if cleanupOldRewindInfo is called, it will if necessary
     //    adjust m_current to point to the latest confirmed state.
@@ -493,7 +625,41 @@ void RewindQueue::unitTesting()
     b2.addNetworkState(NULL, 2);
     b2.addNetworkState(NULL, 3);
     b2.mergeNetworkData(4, &needs_rewind, &rewind_ticks);
-    assert((*b2.m_current)->getTicks() == 3);
-
+    assert(b2.getCurrent()->getTicks() == 3);
+
+    // Ring buffer and pool tests
+    // --------------------------
+    // 1) Adding more infos than the initial ring buffer size must grow
+    //    the buffer and keep the sorting order.
+    RewindQueue r1;
+    unsigned int initial_size = (unsigned int)r1.m_all_rewind_info.size();
+    for (unsigned int i = 0; i < initial_size + 10; i++)
+        r1.addLocalEvent(NULL, NULL, true, i);
+    assert(r1.m_count == initial_size + 10);
+    assert(r1.m_all_rewind_info.size() == 2 * initial_size);
+    for (unsigned int i = 0; i < r1.m_count; i++)
+        assert(r1.at(i)->getTicks() == (int)i);
+
+    // 2) Removing old infos wraps the ring buffer around, and the
+    //    removed RewindInfo objects and buffers are reused.
+    RewindQueue r2;
+    initial_size = (unsigned int)r2.m_all_rewind_info.size();
+    for (unsigned int i = 0; i < 3 * initial_size; i++)
+    {
+        BareNetworkString *buffer = r2.getBuffer();
+        buffer->addUInt8(i & 0xff);
+        r2.addLocalState(buffer, /*confirmed*/true, i);
+        assert(r2.m_count == 1);
+        assert(r2.getCurrent()->getTicks() == (int)i);
+        assert(r2.getCurrent()->getBuffer()->getUInt8() == (i & 0xff));
+    }
+    // The ring buffer must not have been increased, and only one
+    // state object and buffer is in the pools at any time.
+    assert(r2.m_all_rewind_info.size() == initial_size);
+    assert(r2.m_free_states.size() == 1);
+    assert(r2.m_free_buffers.getData().size() == 1);
+    r2.reset();
+    assert(r2.m_free_states.size() == 2);
+    assert(r2.m_free_buffers.getData().size() == 2);
 
 }   // unitTesting
@@ -24,12 +24,13 @@
 #include "utils/synchronised.hpp"
 
 #include <assert.h>
-#include <list>
 #include <vector>
 
+class BareNetworkString;
 class EventRewinder;
 class RewindInfo;
-class TimeStepInfo;
+class RewindInfoEvent;
+class RewindInfoState;
 
 /** \ingroup network
  */
@@ -38,27 +39,81 @@ class RewindQueue
 {
 private:
 
-    typedef std::list<RewindInfo*> AllRewindInfo;
+    /** All RewindInfo objects sorted by time. They are stored in a ring
+     *  buffer (the size of this vector is always a power of 2), which
+     *  allows cheap removal of old infos at the front and cheap insertion
+     *  of new infos at the end. The vector is only grown if it is full,
+     *  so in a steady state no memory allocations are done. */
+    std::vector<RewindInfo*> m_all_rewind_info;
 
-    AllRewindInfo m_all_rewind_info;
+    /** Index in m_all_rewind_info of the oldest RewindInfo. */
+    unsigned int m_first;
+
+    /** Number of RewindInfo objects stored in the ring buffer. */
+    unsigned int m_count;
+
+    /** A RewindInfo received from the network. The RewindInfo object itself
+     *  is only created (or taken from the pool) once the data is merged in
+     *  the main thread, so that the network thread does not need to access
+     *  the (not thread-safe) pools. */
+    struct NetworkRewindInfo
+    {
+        int                m_ticks;
+        EventRewinder     *m_event_rewinder;
+        BareNetworkString *m_buffer;
+        bool               m_is_event;
+    };   // NetworkRewindInfo
 
     /** The list of all events received from the network. They are stored
      *  in a separate thread (so this data structure is thread-save), and
      *  merged into m_rewind_info from the main thread. This design (as
      *  opposed to locking m_rewind_info) reduces the synchronisation
      *  between main thread and network thread. */
-    typedef std::vector<RewindInfo*> AllNetworkRewindInfo;
+    typedef std::vector<NetworkRewindInfo> AllNetworkRewindInfo;
     Synchronised<AllNetworkRewindInfo> m_network_events;
 
-    /** Iterator to the curren time step info to be handled. */
-    AllRewindInfo::iterator m_current;
+    /** Pool of unused state objects, which are reused instead of being
+     *  deleted and allocated again. */
+    std::vector<RewindInfoState*> m_free_states;
+
+    /** Pool of unused event objects. */
+    std::vector<RewindInfoEvent*> m_free_events;
+
+    /** Pool of buffers that can be reused for states and events. This can
+     *  be accessed from the network thread, so it must be synchronised. */
+    Synchronised<std::vector<BareNetworkString*> > m_free_buffers;
+
+    /** Index (relative to m_first) of the current time step info to be
+     *  handled. If it is m_count, there is no more info to handle. */
+    unsigned int m_current;
 
     /** Time at which the latest confirmed state is at. */
     int m_latest_confirmed_state_time;
 
+    // ------------------------------------------------------------------------
+    /** Returns the RewindInfo at the given index (relative to the oldest
+     *  RewindInfo in the ring buffer). */
+    RewindInfo* at(unsigned int i) const
+    {
+        assert(i < m_count);
+        return m_all_rewind_info[(m_first + i) &
+                                 (m_all_rewind_info.size() - 1)];
+    }   // at
+    // ------------------------------------------------------------------------
+    /** Returns a reference to the ring buffer slot for the given index. */
+    RewindInfo*& slot(unsigned int i)
+    {
+        return m_all_rewind_info[(m_first + i) &
+                                 (m_all_rewind_info.size() - 1)];
+    }   // slot
 
     void insertRewindInfo(RewindInfo *ri);
     void cleanupOldRewindInfo(int ticks);
+    RewindInfo* createState(int ticks, BareNetworkString *buffer,
+                            bool confirmed);
+    RewindInfo* createEvent(int ticks, EventRewinder *event_rewinder,
+                            BareNetworkString *buffer, bool confirmed);
+    void releaseRewindInfo(RewindInfo *ri);
 
 public:
         static void unitTesting();
@@ -78,13 +133,15 @@ public:
     bool isEmpty() const;
     bool hasMoreRewindInfo() const;
     int  undoUntil(int undo_ticks);
+    BareNetworkString* getBuffer();
+    void freeBuffer(BareNetworkString *buffer);
 
     // ------------------------------------------------------------------------
     /** Sets the current element to be the next one and returns the next
      *  RewindInfo element. */
     void next()
     {
-        assert(m_current != m_all_rewind_info.end());
+        assert(m_current < m_count);
         m_current++;
         return;
     }   // operator++
@@ -94,11 +151,10 @@ public:
      *  least one more RewindInfo (see hasMoreRewindInfo()). */
     RewindInfo* getCurrent()
     {
-        return (m_current != m_all_rewind_info.end() ) ? *m_current : NULL;
+        return (m_current < m_count) ? at(m_current) : NULL;
     }   // getNext
 
 };   // RewindQueue
 
 
 #endif
-
@@ -51,6 +51,7 @@ btKart::btKart(btRigidBody* chassis, btVehicleRaycaster* raycaster,
     m_indexUpAxis               = 1;
     m_indexForwardAxis          = 2;
     m_kart                      = kart;
+    m_has_track_hits            = false;
     reset();
 }   // btKart
 
@@ -212,6 +213,41 @@ void btKart::updateWheelTransformsWS(btWheelInfo& wheel,
                                                 wheel.m_wheelAxleCS;
 }   // updateWheelTransformsWS
 
+// ----------------------------------------------------------------------------
+/** Computes the ray used for the suspension of a wheel. It is slightly
+ *  longer than the suspension, to see if the kart might soon hit the ground
+ *  and some 'cushioning' is needed to avoid that the chassis hits the
+ *  ground.
+ *  \param index Index of the wheel.
+ *  \param from, to On return start and end point of the ray.
+ *  \param fraction Fraction of the connection point of the wheel, smaller
+ *         values move the ray towards the centre of the chassis.
+ */
+void btKart::getWheelRay(unsigned int index, btVector3 *from, btVector3 *to,
+                         float fraction)
+{
+    btWheelInfo &wheel = m_wheelInfo[index];
+    updateWheelTransformsWS( wheel,false, fraction);
+
+    btScalar raylen = wheel.getSuspensionRestLength()
+                    + wheel.m_maxSuspensionTravel + 0.5f;
+    *from = wheel.m_raycastInfo.m_hardPointWS;
+    *to   = *from + wheel.m_raycastInfo.m_wheelDirectionWS * raylen;
+}   // getWheelRay
+
+// ----------------------------------------------------------------------------
+/** Sets the results of the wheel rays against the track, which are then
+ *  used instead of testing the track again in the next updateVehicle call.
+ *  \param hits The track hits, one for each wheel.
+ */
+void btKart::setTrackHits(const btKartRaycaster::TrackHit *hits)
+{
+    m_track_hits.resize(getNumWheels());
+    for (int i = 0; i < getNumWheels(); i++)
+        m_track_hits[i] = hits[i];
+    m_has_track_hits = true;
+}   // setTrackHits
+
 // ----------------------------------------------------------------------------
 /**
  */
@@ -231,26 +267,29 @@ btScalar btKart::rayCast(unsigned int index, float fraction)
         m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = 0;
     }
 
-    updateWheelTransformsWS( wheel,false, fraction);
+    btVector3 source, target;
+    getWheelRay(index, &source, &target, fraction);
+    wheel.m_raycastInfo.m_contactPointWS = target;
 
     btScalar max_susp_len = wheel.getSuspensionRestLength()
                           + wheel.m_maxSuspensionTravel;
-
-    // Do a slightly longer raycast to see if the kart might soon hit the 
-    // ground and some 'cushioning' is needed to avoid that the chassis
-    // hits the ground.
     btScalar raylen = max_susp_len + 0.5f;
-
-    btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
-    const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
-    wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
-    const btVector3& target = wheel.m_raycastInfo.m_contactPointWS;
+    btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * raylen;
 
     btVehicleRaycaster::btVehicleRaycasterResult rayResults;
 
     btAssert(m_vehicleRaycaster);
 
-    void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+    void* object;
+    if (m_has_track_hits && fraction == 1.0f)
+    {
+        // The track was already tested by btKartRaycastBatch, which is only
+        // used with a btKartRaycaster.
+        object = static_cast<btKartRaycaster*>(m_vehicleRaycaster)
+               ->castRay(source, target, rayResults, m_track_hits[index]);
+    }
+    else
+        object = m_vehicleRaycaster->castRay(source,target,rayResults);
 
     wheel.m_raycastInfo.m_groundObject = 0;
 
@@ -404,6 +443,7 @@ void btKart::updateVehicle( btScalar step )
                 m_num_wheels_on_ground++;
         }
     }
+    m_has_track_hits = false;
 
     // Test if the kart is falling so fast 
     // that the chassis might hit the track
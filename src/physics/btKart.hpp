@@ -127,6 +127,13 @@ private:
 
     btAlignedObjectArray<btWheelInfo> m_wheelInfo;
 
+    /** The results of the wheel rays against the track, if they were cast
+     *  by btKartRaycastBatch for the next updateVehicle call. */
+    btAlignedObjectArray<btKartRaycaster::TrackHit> m_track_hits;
+
+    /** True if m_track_hits can be used in the next updateVehicle call. */
+    bool m_has_track_hits;
+
     void     defaultInit();
     btScalar rayCast(btWheelInfo& wheel, const btVector3& ray);
 
@@ -146,6 +153,9 @@ public:
     void               debugDraw(btIDebugDraw* debugDrawer);
     const btTransform& getChassisWorldTransform() const;
     btScalar           rayCast(unsigned int index, float fraction=1.0f);
+    void               getWheelRay(unsigned int index, btVector3 *from,
+                                   btVector3 *to, float fraction=1.0f);
+    void               setTrackHits(const btKartRaycaster::TrackHit *hits);
     virtual void       updateVehicle(btScalar step);
     void               resetSuspension();
     btScalar           getSteeringValue(int wheel) const;
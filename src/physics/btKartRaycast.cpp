@@ -16,54 +16,117 @@
 #include "BulletDynamics/Dynamics/btDynamicsWorld.h"
 
 #include "modes/world.hpp"
+#include "physics/btKart.hpp"
+#include "physics/stk_dynamics_world.hpp"
 #include "physics/triangle_mesh.hpp"
 #include "tracks/track.hpp"
 
-void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
-                               btVehicleRaycasterResult& result)
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
+
+uint64_t btKartRaycaster::m_num_raycasts = 0;
+
+// ============================================================================
+/** A closest hit callback which also stores the index of the triangle hit,
+ *  and which can ignore one object.
+ */
+class ClosestWithNormal : public btCollisionWorld::ClosestRayResultCallback
 {
-    // ========================================================================
-    class ClosestWithNormal : public btCollisionWorld::ClosestRayResultCallback
-    {
-    private:
-        int m_triangle_index;
-    public:
-        /** Constructor, initialises the triangle index. */
-        ClosestWithNormal(const btVector3 &from,
-                          const btVector3 &to)
-                          : btCollisionWorld::ClosestRayResultCallback(from,to)
-        {
-            m_triangle_index = -1;
-        }   // CloestWithNormal
-        // --------------------------------------------------------------------
-        /** Stores the index of the triangle hit. */
-        virtual    btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
-                                         bool normalInWorldSpace)
-        {
-            // We don't always get a triangle index, sometimes (e.g. ray hits
-            // other kart) we get shapePart=-1, or no localShapeInfo at all
-            if(rayResult.m_localShapeInfo &&
-                rayResult.m_localShapeInfo->m_shapePart>-1)
-                m_triangle_index = rayResult.m_localShapeInfo->m_triangleIndex;
-            return
-                btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult,
-                normalInWorldSpace);
-        }
-        // --------------------------------------------------------------------
-        /** Returns the index of the triangle which was hit, or -1 if
-         *  no triangle was hit. */
-        int getTriangleIndex() const { return m_triangle_index; }
+private:
+    int m_triangle_index;
 
-    };   // CloestWithNormal
-    // ========================================================================
+    /** An object which is not tested, or NULL. */
+    const btCollisionObject *m_ignore;
+public:
+    /** Constructor, initialises the triangle index. */
+    ClosestWithNormal(const btVector3 &from, const btVector3 &to,
+                      const btCollisionObject *ignore = NULL)
+                    : btCollisionWorld::ClosestRayResultCallback(from,to)
+    {
+        m_triangle_index = -1;
+        m_ignore         = ignore;
+    }   // CloestWithNormal
+    // ------------------------------------------------------------------------
+    virtual bool needsCollision(btBroadphaseProxy* proxy0) const
+    {
+        if (proxy0->m_clientObject == m_ignore)
+            return false;
+        return btCollisionWorld::ClosestRayResultCallback
+                               ::needsCollision(proxy0);
+    }   // needsCollision
+    // ------------------------------------------------------------------------
+    /** Stores the index of the triangle hit. */
+    virtual    btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
+                                     bool normalInWorldSpace)
+    {
+        // We don't always get a triangle index, sometimes (e.g. ray hits
+        // other kart) we get shapePart=-1, or no localShapeInfo at all
+        if(rayResult.m_localShapeInfo &&
+            rayResult.m_localShapeInfo->m_shapePart>-1)
+            m_triangle_index = rayResult.m_localShapeInfo->m_triangleIndex;
+        return
+            btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult,
+            normalInWorldSpace);
+    }
+    // ------------------------------------------------------------------------
+    /** Returns the index of the triangle which was hit, or -1 if
+     *  no triangle was hit. */
+    int getTriangleIndex() const { return m_triangle_index; }
+    // ------------------------------------------------------------------------
+    /** Replaces the current result with a hit of the given object, if it is
+     *  at least as close as the current hit. */
+    void mergeHit(const btCollisionObject *object,
+                  const btKartRaycaster::TrackHit &hit)
+    {
+        if (hit.m_triangle_index < 0 || hit.m_fraction > m_closestHitFraction)
+            return;
+        m_closestHitFraction = hit.m_fraction;
+        m_collisionObject    = const_cast<btCollisionObject*>(object);
+        m_hitNormalWorld     = hit.m_normal;
+        m_hitPointWorld.setInterpolate3(m_rayFromWorld, m_rayToWorld,
+                                        hit.m_fraction);
+        m_triangle_index     = hit.m_triangle_index;
+    }   // mergeHit
 
-    ClosestWithNormal rayCallback(from,to);
+};   // CloestWithNormal
 
-    m_dynamicsWorld->rayTest(from, to, rayCallback);
+// ============================================================================
+/** Collects the result of a raycast against the triangles of the track. */
+class TrackRayCallback : public btTriangleRaycastCallback
+{
+private:
+    btKartRaycaster::TrackHit *m_hit;
+public:
+    TrackRayCallback(const btVector3 &from, const btVector3 &to,
+                     btKartRaycaster::TrackHit *hit)
+                   : btTriangleRaycastCallback(from, to), m_hit(hit)
+    {
+        m_hit->m_fraction       = 1.0f;
+        m_hit->m_triangle_index = -1;
+    }   // TrackRayCallback
+    // ------------------------------------------------------------------------
+    virtual btScalar reportHit(const btVector3 &normal, btScalar fraction,
+                               int part, int triangle_index)
+    {
+        m_hit->m_fraction       = fraction;
+        m_hit->m_normal         = normal;
+        m_hit->m_triangle_index = triangle_index;
+        return fraction;
+    }   // reportHit
+};   // TrackRayCallback
 
+// ============================================================================
+/** Fills in the result of a raycast from the closest hit found.
+ *  \return The body that was hit, or NULL if no body with contact
+ *          response was hit.
+ */
+static void* fillResult(const ClosestWithNormal &rayCallback,
+                        bool smooth_normals,
+                        btVehicleRaycaster::btVehicleRaycasterResult& result)
+{
     if (rayCallback.hasHit())
     {
-        btRigidBody* body = btRigidBody::upcast(rayCallback.m_collisionObject);
+        const btRigidBody* body =
+            btRigidBody::upcast(rayCallback.m_collisionObject);
         if (body && body->hasContactResponse())
         {
             result.m_hitPointInWorld = rayCallback.m_hitPointWorld;
@@ -71,8 +134,6 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
             result.m_hitNormalInWorld.normalize();
             result.m_distFraction = rayCallback.m_closestHitFraction;
             result.m_triangle_index = -1;
-            const TriangleMesh &tm =
-                Track::getCurrentTrack()->getTriangleMesh();
             // FIXME: this code assumes atm that the object the kart is
             // driving on is the main track (and not e.g. a physical object).
             // If this should not be the case (i.e. the object hit by the
@@ -81,9 +142,9 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
             // different triangle mesh). TODO: Add a mapping from bullet
             // objects back to triangle meshes, so that it's easy to pick up
             // the right triangle mesh for smoothing
-            TriangleMesh::RigidBodyTriangleMesh *rbtm =
-                dynamic_cast<TriangleMesh::RigidBodyTriangleMesh*>(body);
-            if(m_smooth_normals &&
+            const TriangleMesh::RigidBodyTriangleMesh *rbtm =
+                dynamic_cast<const TriangleMesh::RigidBodyTriangleMesh*>(body);
+            if(smooth_normals &&
                 rayCallback.getTriangleIndex()>-1 &&
                 rbtm != NULL                         )
             {
@@ -103,9 +164,188 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
                     result.m_hitNormalInWorld.getZ());
 #endif
             }
-            return body;
+            return const_cast<btRigidBody*>(body);
         }
     }
     return 0;
-}
+}   // fillResult
+
+// ----------------------------------------------------------------------------
+void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
+                               btVehicleRaycasterResult& result)
+{
+    m_num_raycasts++;
+    ClosestWithNormal rayCallback(from,to);
+
+    m_dynamicsWorld->rayTest(from, to, rayCallback);
+
+    return fillResult(rayCallback, m_smooth_normals, result);
+}   // castRay
+
+// ----------------------------------------------------------------------------
+/** Casts a ray for which the track mesh was already tested (see
+ *  castTrackRays). Only the other objects of the world are tested, and the
+ *  closer of both hits is used.
+ *  \param track_hit The result of the same ray against the track mesh.
+ */
+void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
+                               btVehicleRaycasterResult& result,
+                               const TrackHit &track_hit)
+{
+    m_num_raycasts++;
+    const btRigidBody *track_body =
+        Track::getCurrentTrack()->getTriangleMesh().getBody();
+    ClosestWithNormal rayCallback(from, to, track_body);
 
+    m_dynamicsWorld->rayTest(from, to, rayCallback);
+    rayCallback.mergeHit(track_body, track_hit);
+
+    return fillResult(rayCallback, m_smooth_normals, result);
+}   // castRay
+
+// ----------------------------------------------------------------------------
+/** Casts many rays against the track mesh only. If the track uses a
+ *  quantised bvh (see TriangleMesh::setCompactLayout) the rays are tested
+ *  in packets of 32: the tree is walked once per packet, and each node is
+ *  tested against the bounding boxes of all rays of the packet that are
+ *  still active in this subtree. Otherwise each ray is cast on its own.
+ *  Packets only pay off if their rays are close to each other, e.g. the
+ *  wheel rays of one kart.
+ *  The triangles are tested in the same order as in a bullet raycast, so
+ *  the result is the same as the track hit of btCollisionWorld::rayTest.
+ *  \param tm The track mesh, which must have a physical body.
+ *  \param n Number of rays.
+ *  \param from, to Start and end points of the rays in world space.
+ *  \param hits On return the hits of the rays.
+ */
+void btKartRaycaster::castTrackRays(const TriangleMesh &tm, int n,
+                                    const btVector3 *from,
+                                    const btVector3 *to, TrackHit *hits)
+{
+    const btTransform &trans      = tm.getBody()->getWorldTransform();
+    const btTransform world_to_tm = trans.inverse();
+    // The shape is not changed, but bullet only offers non-const access
+    // to the bvh.
+    btBvhTriangleMeshShape *shape = static_cast<btBvhTriangleMeshShape*>(
+        const_cast<btCollisionShape*>(&tm.getCollisionShape()));
+    btOptimizedBvh *bvh = shape->getOptimizedBvh();
+
+    btAlignedObjectArray<TrackRayCallback> rays;
+    rays.reserve(n);
+    for (int i = 0; i < n; i++)
+    {
+        rays.push_back(TrackRayCallback(world_to_tm * from[i],
+                                        world_to_tm * to[i], &hits[i]));
+    }
+
+    if (!bvh->isQuantized())
+    {
+        for (int i = 0; i < n; i++)
+        {
+            shape->performRaycast(&rays[i], rays[i].m_from, rays[i].m_to);
+        }
+    }
+    else
+    {
+        const btQuantizedBvhNode *nodes = &bvh->getQuantizedNodeArray()[0];
+        // The escape index of the root is the number of nodes
+        const int num_nodes = nodes[0].isLeafNode()
+                            ? 1 : nodes[0].getEscapeIndex();
+        unsigned short q_min[32][3], q_max[32][3];
+        btVector3 triangle[3];
+        for (int start = 0; start < n; start += 32)
+        {
+            const int count = btMin(n - start, 32);
+            for (int i = 0; i < count; i++)
+            {
+                const TrackRayCallback &ray = rays[start + i];
+                btVector3 aabb_min = ray.m_from, aabb_max = ray.m_from;
+                aabb_min.setMin(ray.m_to);
+                aabb_max.setMax(ray.m_to);
+                bvh->quantizeWithClamp(q_min[i], aabb_min, 0);
+                bvh->quantizeWithClamp(q_max[i], aabb_max, 1);
+            }
+            int index = 0;
+            while (index < num_nodes)
+            {
+                const btQuantizedBvhNode &node = nodes[index];
+                uint32_t mask = 0;
+                for (int i = 0; i < count; i++)
+                {
+                    mask |= testQuantizedAabbAgainstQuantizedAabb(
+                                q_min[i], q_max[i], node.m_quantizedAabbMin,
+                                node.m_quantizedAabbMax) << i;
+                }
+                if (!node.isLeafNode())
+                {
+                    // Skip the whole subtree if no ray overlaps it
+                    index += mask ? 1 : node.getEscapeIndex();
+                    continue;
+                }
+                if (mask)
+                {
+                    const int triangle_index = node.getTriangleIndex();
+                    tm.getTriangle(triangle_index, &triangle[0],
+                                   &triangle[1], &triangle[2]);
+                    for (int i = 0; i < count; i++)
+                    {
+                        if (mask & (1u << i))
+                        {
+                            rays[start + i].processTriangle(triangle,
+                                                            node.getPartId(),
+                                                            triangle_index);
+                        }
+                    }
+                }
+                index++;
+            }   // while index < num_nodes
+        }   // for start < n
+    }
+
+    for (int i = 0; i < n; i++)
+        hits[i].m_normal = trans.getBasis() * hits[i].m_normal;
+}   // castTrackRays
+
+// ============================================================================
+/** Casts the wheel rays of all karts against the track mesh, and gives each
+ *  kart the results for its next btKart::updateVehicle call.
+ */
+void btKartRaycastBatch::updateAction(btCollisionWorld* collisionWorld,
+                                      btScalar step)
+{
+    Track *track = Track::getCurrentTrack();
+    if (!track || !track->getPtrTriangleMesh() ||
+        !track->getPtrTriangleMesh()->getBody())
+        return;
+
+    m_karts.clear();
+    m_from.clear();
+    m_to.clear();
+    for (int i = 0; i < m_world->getNumActions(); i++)
+    {
+        btKart *kart = dynamic_cast<btKart*>(m_world->getAction(i));
+        if (!kart) continue;
+        m_karts.push_back(kart);
+        for (int j = 0; j < kart->getNumWheels(); j++)
+        {
+            btVector3 from, to;
+            kart->getWheelRay(j, &from, &to);
+            m_from.push_back(from);
+            m_to.push_back(to);
+        }
+    }
+
+    m_hits.resize(m_from.size());
+    // The rays of one kart are close to each other, so they make a good
+    // packet. Rays of different karts would visit mostly different nodes.
+    int n = 0;
+    for (int i = 0; i < m_karts.size(); i++)
+    {
+        const int num_wheels = m_karts[i]->getNumWheels();
+        btKartRaycaster::castTrackRays(*track->getPtrTriangleMesh(),
+                                       num_wheels, &m_from[n], &m_to[n],
+                                       &m_hits[n]);
+        m_karts[i]->setTrackHits(&m_hits[n]);
+        n += num_wheels;
+    }
+}   // updateAction
@@ -19,14 +19,35 @@ class btDynamicsWorld;
 #include "BulletDynamics/Vehicle/btWheelInfo.h"
 #include "BulletDynamics/Dynamics/btActionInterface.h"
 
+#include "utils/types.hpp"
+
+
+class btKart;
+class STKDynamicsWorld;
+class TriangleMesh;
 
 class btKartRaycaster : public btVehicleRaycaster
 {
+public:
+    /** The result of a raycast against the track mesh only. */
+    struct TrackHit
+    {
+        /** Fraction of the ray at the hit, 1 if the track was not hit. */
+        btScalar  m_fraction;
+        /** The world space normal of the triangle hit. */
+        btVector3 m_normal;
+        /** Index of the triangle hit, -1 if the track was not hit. */
+        int       m_triangle_index;
+    };   // TrackHit
+
 private:
     btDynamicsWorld*    m_dynamicsWorld;
     /** True if the normals should be smoothed. Not all tracks support this,
     *  so this flag is set depending on track when constructing this object. */
     bool                m_smooth_normals;
+
+    /** Number of rays cast by all karts, for the physics stats. */
+    static uint64_t     m_num_raycasts;
 public:
     btKartRaycaster(btDynamicsWorld* world, bool smooth_normals=false)
         :m_dynamicsWorld(world), m_smooth_normals(smooth_normals)
@@ -35,9 +56,42 @@ public:
 
     virtual void* castRay(const btVector3& from,const btVector3& to,
                           btVehicleRaycasterResult& result);
+    void* castRay(const btVector3& from, const btVector3& to,
+                  btVehicleRaycasterResult& result,
+                  const TrackHit &track_hit);
+    /** Returns the number of rays cast by all karts so far. */
+    static uint64_t getNumRaycasts() { return m_num_raycasts; }
+    static void castTrackRays(const TriangleMesh &tm, int n,
+                              const btVector3 *from, const btVector3 *to,
+                              TrackHit *hits);
 
 };
 
+// ============================================================================
+/** An action which casts the wheel rays of all karts against the track
+ *  mesh before the karts are updated. The rays are tested in packets, so
+ *  that each node of the track bvh is loaded once for a whole packet of
+ *  rays instead of once per ray. It must be the first action of the world,
+ *  so that it runs after the karts are moved in a substep, but before any
+ *  kart casts its rays in btKart::updateVehicle.
+ */
+class btKartRaycastBatch : public btActionInterface
+{
+private:
+    STKDynamicsWorld                         *m_world;
+    btAlignedObjectArray<btKart*>             m_karts;
+    btAlignedObjectArray<btVector3>           m_from;
+    btAlignedObjectArray<btVector3>           m_to;
+    btAlignedObjectArray<btKartRaycaster::TrackHit> m_hits;
+
+public:
+    btKartRaycastBatch(STKDynamicsWorld *world) : m_world(world) {}
+    virtual void updateAction(btCollisionWorld* collisionWorld,
+                              btScalar step);
+    virtual void debugDraw(btIDebugDraw* debugDrawer) {}
+    virtual void resetMaxSpeed() {}
+};   // btKartRaycastBatch
+
 
 #endif //RAYCASTVEHICLE_H
 
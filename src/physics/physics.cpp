@@ -42,8 +42,12 @@
 #include "scriptengine/script_engine.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_object.hpp"
+#include "utils/log.hpp"
 #include "utils/profiler.hpp"
 
+bool Physics::m_batch_raycasts = false;
+bool Physics::m_log_stats      = false;
+
 // ----------------------------------------------------------------------------
 /** Initialise physics.
  *  Create the bullet dynamics world.
@@ -52,6 +56,7 @@ Physics::Physics() : btSequentialImpulseConstraintSolver()
 {
     m_collision_conf      = new btDefaultCollisionConfiguration();
     m_dispatcher          = new btCollisionDispatcher(m_collision_conf);
+    m_raycast_batch       = NULL;
 }   // Physics
 
 //-----------------------------------------------------------------------------
@@ -68,19 +73,35 @@ void Physics::init(const Vec3 &world_min, const Vec3 &world_max)
                                                  this,
                                                  m_collision_conf);
     m_karts_to_delete.clear();
+    m_track_ident         = Track::getCurrentTrack()->getIdent();
+    m_last_stats.reset();
+    m_total_stats.reset();
     m_dynamics_world->setGravity(
         btVector3(0.0f,
                   -Track::getCurrentTrack()->getGravity(),
                   0.0f));
     m_debug_drawer = new IrrDebugDrawer();
     m_dynamics_world->setDebugDrawer(m_debug_drawer);
+    if (m_batch_raycasts)
+    {
+        // Must be the first action, so it runs before all karts
+        m_raycast_batch = new btKartRaycastBatch(m_dynamics_world);
+        m_dynamics_world->addAction(m_raycast_batch);
+    }
 }   // init
 
 //-----------------------------------------------------------------------------
 Physics::~Physics()
 {
+    if (m_log_stats && m_total_stats.m_num_updates > 0)
+    {
+        Log::info("Physics", "Statistics for track '%s':",
+                  m_track_ident.c_str());
+        m_total_stats.print("Physics");
+    }
     delete m_debug_drawer;
     delete m_dynamics_world;
+    delete m_raycast_batch;
     delete m_axis_sweep;
     delete m_dispatcher;
     delete m_collision_conf;
@@ -150,6 +171,9 @@ void Physics::update(int ticks)
     // are stored in a vector, but only one entry per collision pair
     // of objects.
     m_all_collisions.clear();
+    PhysicsStats &stats = m_dynamics_world->getStats();
+    stats.reset();
+    stats.m_num_updates = 1;
 
     // Since the world update (which calls physics update) is called at the
     // fixed frequency necessary for the physics update, we need to do exactly
@@ -157,6 +181,33 @@ void Physics::update(int ticks)
     m_dynamics_world->stepSimulation(stk_config->ticks2Time(1), 1,
                                      stk_config->ticks2Time(1)      );
 
+    {
+        PhysicsStats::PhaseTimer timer(&stats,
+                                       PhysicsStats::PHASE_COLLISIONS);
+        stats.m_num_collisions = m_all_collisions.size();
+        handleCollisions();
+    }
+
+    m_physics_loop_active = false;
+    // Now remove the karts that were removed while the above loop
+    // was active. Now we can safely call removeKart, since the loop
+    // is finished and m_physics_world_active is not set anymore.
+    for(unsigned int i=0; i<m_karts_to_delete.size(); i++)
+        removeKart(m_karts_to_delete[i]);
+    m_karts_to_delete.clear();
+
+    m_last_stats = stats;
+    m_total_stats.add(stats);
+
+    PROFILER_POP_CPU_MARKER();
+}   // update
+
+//-----------------------------------------------------------------------------
+/** Handles all collisions found in the last physics step, i.e. calls the
+ *  functions of the karts, flyables and objects involved.
+ */
+void Physics::handleCollisions()
+{
     // Now handle the actual collision. Note: flyables can not be removed
     // inside of this loop, since the same flyables might hit more than one
     // other object. So only a flag is set in the flyables, the actual
@@ -342,17 +393,7 @@ void Physics::update(int ticks)
             p->getUserPointer(1)->getPointerFlyable()->hit(NULL);
         }
     }  // for all p in m_all_collisions
-
-    m_physics_loop_active = false;
-    // Now remove the karts that were removed while the above loop
-    // was active. Now we can safely call removeKart, since the loop
-    // is finished and m_physics_world_active is not set anymore.
-    for(unsigned int i=0; i<m_karts_to_delete.size(); i++)
-        removeKart(m_karts_to_delete[i]);
-    m_karts_to_delete.clear();
-
-    PROFILER_POP_CPU_MARKER();
-}   // update
+}   // handleCollisions
 
 //-----------------------------------------------------------------------------
 /** Handles the special case of two karts colliding with each other, which
@@ -516,6 +557,8 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
                                                         debugDrawer,
                                                         stackAlloc,
                                                         dispatcher);
+    PhysicsStats::PhaseTimer timer(&m_dynamics_world->getStats(),
+                                   PhysicsStats::PHASE_COLLISIONS);
     int currentNumManifolds = m_dispatcher->getNumManifolds();
     // We can't explode a rocket in a loop, since a rocket might collide with
     // more than one object, and/or more than once with each object (if there
@@ -25,16 +25,19 @@
   */
 
 #include <set>
+#include <string>
 #include <vector>
 
 #include "btBulletDynamicsCommon.h"
 
 #include "physics/irr_debug_drawer.hpp"
+#include "physics/physics_stats.hpp"
 #include "physics/stk_dynamics_world.hpp"
 #include "physics/user_pointer.hpp"
 #include "utils/singleton.hpp"
 
 class AbstractKart;
+class btKartRaycastBatch;
 class STKDynamicsWorld;
 class Vec3;
 
@@ -149,6 +152,27 @@ private:
     btDefaultCollisionConfiguration *m_collision_conf;
     CollisionList                    m_all_collisions;
 
+    /** Casts the wheel rays of all karts against the track in one batch,
+     *  NULL if the rays are cast individually. */
+    btKartRaycastBatch              *m_raycast_batch;
+
+    /** If the wheel rays of new worlds are cast in one batch. */
+    static bool                      m_batch_raycasts;
+
+    /** If the physics stats are printed when the physics is deleted. */
+    static bool                      m_log_stats;
+
+    /** Counters and timers of the last update. */
+    PhysicsStats                     m_last_stats;
+
+    /** Counters and timers of all updates since init was called. */
+    PhysicsStats                     m_total_stats;
+
+    /** Ident of the track, used when printing the stats. */
+    std::string                      m_track_ident;
+
+    void  handleCollisions();
+
     /** Singleton. */
     static Physics                  *m_physics;
 
@@ -177,6 +201,21 @@ public:
     /** Returns true if the debug drawer is enabled. */
     bool  isDebug() const     {return m_debug_drawer->debugEnabled(); }
     IrrDebugDrawer* getDebugDrawer() { return m_debug_drawer; }
+    // ------------------------------------------------------------------------
+    /** Selects if the wheel rays of all karts are cast against the track
+     *  in one batch in worlds created from now on. */
+    static void setBatchRaycasts(bool batch) { m_batch_raycasts = batch; }
+    // ------------------------------------------------------------------------
+    /** Selects if the physics stats of each world are printed when the
+     *  world is deleted. */
+    static void setLogStats(bool log) { m_log_stats = log; }
+    // ------------------------------------------------------------------------
+    /** Returns the counters and timers of the last update. */
+    const PhysicsStats& getLastStats() const { return m_last_stats; }
+    // ------------------------------------------------------------------------
+    /** Returns the counters and timers of all updates of this world. */
+    const PhysicsStats& getTotalStats() const { return m_total_stats; }
+    // ------------------------------------------------------------------------
     virtual btScalar solveGroup(btCollisionObject** bodies, int numBodies,
                                 btPersistentManifold** manifold,int numManifolds,
                                 btTypedConstraint** constraints,int numConstraints,
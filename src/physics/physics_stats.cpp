@@ -0,0 +1,125 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "physics/physics_stats.hpp"
+
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+
+#include <string.h>
+
+// ----------------------------------------------------------------------------
+/** Starts measuring a phase.
+ *  \param stats The stats to which the time is added.
+ *  \param phase The phase to measure.
+ */
+PhysicsStats::PhaseTimer::PhaseTimer(PhysicsStats *stats, Phase phase)
+{
+    m_stats              = stats;
+    m_phase              = phase;
+    m_parent             = stats->m_active_timer;
+    m_nested_time        = 0;
+    stats->m_active_timer = this;
+    PROFILER_PUSH_CPU_MARKER(getPhaseName(phase), 255, 128, 0);
+    m_start = std::chrono::high_resolution_clock::now();
+}   // PhaseTimer
+
+// ----------------------------------------------------------------------------
+/** Adds the time since construction (without the time of nested timers) to
+ *  the phase. */
+PhysicsStats::PhaseTimer::~PhaseTimer()
+{
+    uint64_t t = (uint64_t)
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now() - m_start).count();
+    PROFILER_POP_CPU_MARKER();
+    m_stats->m_time[m_phase] += t - m_nested_time;
+    if (m_parent)
+        m_parent->m_nested_time += t;
+    m_stats->m_active_timer = m_parent;
+}   // ~PhaseTimer
+
+// ----------------------------------------------------------------------------
+/** Sets all counters and times to 0. */
+void PhysicsStats::reset()
+{
+    memset(m_time, 0, sizeof(m_time));
+    m_num_updates    = 0;
+    m_num_substeps   = 0;
+    m_num_pairs      = 0;
+    m_num_manifolds  = 0;
+    m_num_contacts   = 0;
+    m_num_raycasts   = 0;
+    m_num_collisions = 0;
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Adds the counters and times of other stats to this object. */
+void PhysicsStats::add(const PhysicsStats &other)
+{
+    for (unsigned int i = 0; i < PHASE_COUNT; i++)
+        m_time[i] += other.m_time[i];
+    m_num_updates    += other.m_num_updates;
+    m_num_substeps   += other.m_num_substeps;
+    m_num_pairs      += other.m_num_pairs;
+    m_num_manifolds  += other.m_num_manifolds;
+    m_num_contacts   += other.m_num_contacts;
+    m_num_raycasts   += other.m_num_raycasts;
+    m_num_collisions += other.m_num_collisions;
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Returns the name of a phase, which is also used as profiler marker. */
+const char* PhysicsStats::getPhaseName(Phase phase)
+{
+    switch (phase)
+    {
+    case PHASE_BROADPHASE:  return "Physics broadphase";
+    case PHASE_NARROWPHASE: return "Physics narrowphase";
+    case PHASE_SOLVER:      return "Physics solver";
+    case PHASE_INTEGRATE:   return "Physics integrate";
+    case PHASE_KARTS:       return "Physics karts";
+    case PHASE_COLLISIONS:  return "Physics collisions";
+    default:                return "Physics";
+    }
+}   // getPhaseName
+
+// ----------------------------------------------------------------------------
+/** Prints the average counters per substep and the time of each phase.
+ *  \param component The component name used in the log.
+ */
+void PhysicsStats::print(const char *component) const
+{
+    const double substeps = m_num_substeps > 0 ? (double)m_num_substeps : 1.0;
+    Log::info(component, "physics: %llu updates %llu substeps, per substep: "
+              "%.1f pairs %.1f manifolds %.1f contacts %.1f raycasts, "
+              "%llu collisions",
+              (unsigned long long)m_num_updates,
+              (unsigned long long)m_num_substeps,
+              m_num_pairs / substeps, m_num_manifolds / substeps,
+              m_num_contacts / substeps, m_num_raycasts / substeps,
+              (unsigned long long)m_num_collisions);
+    const double total = getTotalTime() > 0 ? (double)getTotalTime() : 1.0;
+    for (unsigned int i = 0; i < PHASE_COUNT; i++)
+    {
+        Log::info(component, "%-20s %8.3f s %6.2f%% %8.2f us/substep",
+                  getPhaseName((Phase)i), m_time[i] * 1.0e-9,
+                  100.0 * m_time[i] / total, m_time[i] * 1.0e-3 / substeps);
+    }
+}   // print
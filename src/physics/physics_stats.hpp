@@ -0,0 +1,107 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_PHYSICS_STATS_HPP
+#define HEADER_PHYSICS_STATS_HPP
+
+#include "utils/types.hpp"
+
+#include <chrono>
+
+/** \brief Counters and timers of the physics simulation.
+ *  The time is split into the phases of a bullet substep, and the time
+ *  STK needs to handle the collisions found. The times are exclusive, i.e.
+ *  the time of a phase that is measured while another phase is measured
+ *  (e.g. the collision handling done by the solver) is only added to the
+ *  inner phase.
+ *  \ingroup physics
+ */
+struct PhysicsStats
+{
+    /** The measured phases. */
+    enum Phase { PHASE_BROADPHASE,  PHASE_NARROWPHASE, PHASE_SOLVER,
+                 PHASE_INTEGRATE,   PHASE_KARTS,       PHASE_COLLISIONS,
+                 PHASE_COUNT };
+
+    /** Time spent in each phase in nanoseconds. */
+    uint64_t m_time[PHASE_COUNT];
+
+    /** Number of calls to Physics::update. */
+    uint64_t m_num_updates;
+
+    /** Number of bullet substeps. */
+    uint64_t m_num_substeps;
+
+    /** Sum over all substeps of the number of overlapping broadphase
+     *  pairs. */
+    uint64_t m_num_pairs;
+
+    /** Sum over all substeps of the number of contact manifolds. */
+    uint64_t m_num_manifolds;
+
+    /** Sum over all substeps of the number of contact points. */
+    uint64_t m_num_contacts;
+
+    /** Number of raycasts done by the karts. */
+    uint64_t m_num_raycasts;
+
+    /** Number of collisions handled by STK (i.e. pairs of objects which
+     *  need an STK reaction, like a kart hitting a kart). */
+    uint64_t m_num_collisions;
+
+    // ========================================================================
+    /** Adds the time between construction and destruction of this object to
+     *  a phase, and shows the phase as a profiler marker. */
+    class PhaseTimer
+    {
+    private:
+        PhysicsStats *m_stats;
+        Phase         m_phase;
+        /** The timer active when this timer was started. */
+        PhaseTimer   *m_parent;
+        /** Time spent in nested timers, in nanoseconds. */
+        uint64_t      m_nested_time;
+        std::chrono::high_resolution_clock::time_point m_start;
+    public:
+        PhaseTimer(PhysicsStats *stats, Phase phase);
+        ~PhaseTimer();
+    };   // PhaseTimer
+
+    // ------------------------------------------------------------------------
+    PhysicsStats() : m_active_timer(NULL) { reset(); }
+    void reset();
+    void add(const PhysicsStats &other);
+    void print(const char *component) const;
+    static const char* getPhaseName(Phase phase);
+    // ------------------------------------------------------------------------
+    /** Returns the total time of all phases in nanoseconds. */
+    uint64_t getTotalTime() const
+    {
+        uint64_t total = 0;
+        for (unsigned int i = 0; i < PHASE_COUNT; i++)
+            total += m_time[i];
+        return total;
+    }   // getTotalTime
+
+private:
+    /** The innermost timer which is currently running. */
+    PhaseTimer *m_active_timer;
+};   // PhysicsStats
+
+#endif
@@ -0,0 +1,101 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "physics/stk_dynamics_world.hpp"
+
+#include "physics/btKartRaycast.hpp"
+
+// ----------------------------------------------------------------------------
+/** Does one substep. This is bullet's btDiscreteDynamicsWorld::
+ *  internalSingleStepSimulation, with the collision detection split into
+ *  broad- and narrowphase, and a timer around each phase.
+ *  \param time_step Duration of the substep.
+ */
+void STKDynamicsWorld::internalSingleStepSimulation(btScalar time_step)
+{
+    m_stats.m_num_substeps++;
+    if (m_internalPreTickCallback)
+        (*m_internalPreTickCallback)(this, time_step);
+
+    {
+        PhysicsStats::PhaseTimer timer(&m_stats,
+                                       PhysicsStats::PHASE_INTEGRATE);
+        predictUnconstraintMotion(time_step);
+    }
+
+    btDispatcherInfo &dispatch_info = getDispatchInfo();
+    dispatch_info.m_timeStep  = time_step;
+    dispatch_info.m_stepCount = 0;
+    dispatch_info.m_debugDraw = getDebugDrawer();
+
+    {
+        PhysicsStats::PhaseTimer timer(&m_stats,
+                                       PhysicsStats::PHASE_BROADPHASE);
+        updateAabbs();
+        m_broadphasePairCache->calculateOverlappingPairs(m_dispatcher1);
+    }
+    btOverlappingPairCache *pairs =
+        m_broadphasePairCache->getOverlappingPairCache();
+    m_stats.m_num_pairs += pairs->getNumOverlappingPairs();
+
+    {
+        PhysicsStats::PhaseTimer timer(&m_stats,
+                                       PhysicsStats::PHASE_NARROWPHASE);
+        if (m_dispatcher1)
+        {
+            m_dispatcher1->dispatchAllCollisionPairs(pairs, dispatch_info,
+                                                     m_dispatcher1);
+        }
+    }
+    if (m_dispatcher1)
+    {
+        const int num_manifolds = m_dispatcher1->getNumManifolds();
+        m_stats.m_num_manifolds += num_manifolds;
+        for (int i = 0; i < num_manifolds; i++)
+        {
+            m_stats.m_num_contacts += m_dispatcher1
+                ->getManifoldByIndexInternal(i)->getNumContacts();
+        }
+    }
+
+    {
+        PhysicsStats::PhaseTimer timer(&m_stats, PhysicsStats::PHASE_SOLVER);
+        calculateSimulationIslands();
+        getSolverInfo().m_timeStep = time_step;
+        solveConstraints(getSolverInfo());
+    }
+
+    {
+        PhysicsStats::PhaseTimer timer(&m_stats,
+                                       PhysicsStats::PHASE_INTEGRATE);
+        integrateTransforms(time_step);
+    }
+
+    {
+        PhysicsStats::PhaseTimer timer(&m_stats, PhysicsStats::PHASE_KARTS);
+        const uint64_t raycasts = btKartRaycaster::getNumRaycasts();
+        updateActions(time_step);
+        m_stats.m_num_raycasts += btKartRaycaster::getNumRaycasts() - raycasts;
+    }
+
+    updateActivationState(time_step);
+
+    if (m_internalTickCallback)
+        (*m_internalTickCallback)(this, time_step);
+}   // internalSingleStepSimulation
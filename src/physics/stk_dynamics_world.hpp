@@ -21,12 +21,22 @@
 
 #include "btBulletDynamicsCommon.h"
 
+#include "physics/physics_stats.hpp"
+
 /** A thin wrapper around bullet's btDiscreteDynamicsWorld. Used to
  *  be able to query and set the 'left over' time from a previous
- *  time step, which is needed for more precise rewind/replays.
+ *  time step, which is needed for more precise rewind/replays, and to
+ *  measure the time of each phase of a substep.
  */
 class STKDynamicsWorld : public btDiscreteDynamicsWorld
 {
+private:
+    /** Counters and timers of the current physics update. */
+    PhysicsStats m_stats;
+
+protected:
+    virtual void internalSingleStepSimulation(btScalar time_step);
+
 public:
     /** The standard constructor which just created a btDiscreteDynamicsWorld. */
     STKDynamicsWorld(btDispatcher*             dispatcher,
@@ -49,6 +59,16 @@ public:
     // ------------------------------------------------------------------------
     /** Gets the local time. */
     float getLocalTime() const { return m_localTime; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of actions (e.g. karts) in this world. */
+    int getNumActions() const { return m_actions.size(); }
+    // ------------------------------------------------------------------------
+    /** Returns the action with the given index. Actions are updated in the
+     *  order of their index. */
+    btActionInterface* getAction(int n) { return m_actions[n]; }
+    // ------------------------------------------------------------------------
+    /** Returns the counters and timers of the current physics update. */
+    PhysicsStats& getStats() { return m_stats; }
 };   // STKDynamicsWorld
 #endif
 /* EOF */
@@ -19,14 +19,18 @@
 #include "physics/triangle_mesh.hpp"
 
 #include "config/stk_config.hpp"
+#include "graphics/material_manager.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
 #include "utils/time.hpp"
 
 #include "btBulletDynamicsCommon.h"
 
+#include <algorithm>
 #include <fstream>
 
+bool TriangleMesh::m_default_compact = false;
+
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
  */
@@ -43,6 +47,10 @@ TriangleMesh::TriangleMesh(bool can_be_transformed) : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_serialized_bvh      = NULL;
+    m_serialized_bvh_size = 0;
+    m_compact             = m_default_compact;
+    m_compact_mesh        = NULL;
     m_user_pointer.set(this);
 }   // TriangleMesh
 
@@ -67,33 +75,91 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
                                const btVector3 &n3,
                                const Material* m)
 {
-    m_triangleIndex2Material.push_back(m);
-
     btVector3 normal = (t2-t1).cross(t3-t1);
     normal.normalize();
-    m_normals.push_back( normal.angle(n1)>stk_config->m_smooth_angle_limit
-                         ? normal : n1                                     );
-    m_normals.push_back( normal.angle(n2)>stk_config->m_smooth_angle_limit
-                         ? normal : n2                                     );
-    m_normals.push_back( normal.angle(n3)>stk_config->m_smooth_angle_limit
-                         ? normal : n3                                     );
-    m_mesh.addTriangle(t1, t2, t3);
+    addTriangleData(t1, t2, t3,
+                    normal.angle(n1)>stk_config->m_smooth_angle_limit
+                    ? normal : n1,
+                    normal.angle(n2)>stk_config->m_smooth_angle_limit
+                    ? normal : n2,
+                    normal.angle(n3)>stk_config->m_smooth_angle_limit
+                    ? normal : n3,
+                    m);
+}   // addTriangle
 
+// -----------------------------------------------------------------------------
+/** Stores a triangle with its (already smoothed) normals and material in
+ *  the layout used by this mesh.
+ *  \param t1,t2,t3 Points of the triangle.
+ *  \param n1,n2,n3 Normals at the corresponding points.
+ *  \param m Material used for this triangle
+ */
+void TriangleMesh::addTriangleData(const btVector3 &t1, const btVector3 &t2,
+                                   const btVector3 &t3,
+                                   const btVector3 &n1, const btVector3 &n2,
+                                   const btVector3 &n3,
+                                   const Material* m)
+{
     // Area of triangle ABC
     btVector3 edge1 = t2 - t1;
     btVector3 edge2 = t3 - t1;
-    m_p1p2p3.push_back(edge1.cross(edge2).length2());
-}   // addTriangle
+    const float p1p2p3 = edge1.cross(edge2).length2();
+
+    if (!m_compact)
+    {
+        m_triangleIndex2Material.push_back(m);
+        m_normals.push_back(n1);
+        m_normals.push_back(n2);
+        m_normals.push_back(n3);
+        m_mesh.addTriangle(t1, t2, t3);
+        m_p1p2p3.push_back(p1p2p3);
+        return;
+    }
+
+    CompactTriangle triangle;
+    const btVector3 *t[3] = { &t1, &t2, &t3 };
+    const btVector3 *n[3] = { &n1, &n2, &n3 };
+    for (unsigned int k = 0; k < 3; k++)
+    {
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            triangle.m_vertices[3 * k + c] = (*t[k])[c];
+            triangle.m_normals [3 * k + c] = (*n[k])[c];
+        }
+    }
+    triangle.m_p1p2p3   = p1p2p3;
+    triangle.m_material = NO_MATERIAL;
+    triangle.m_padding[0] = triangle.m_padding[1] = triangle.m_padding[2] = 0;
+    if (m)
+    {
+        // Consecutive triangles usually have the same material, and there
+        // are only a few materials per mesh
+        size_t index = m_compact_triangles.empty()
+                     ? NO_MATERIAL : m_compact_triangles.back().m_material;
+        if (index == NO_MATERIAL || m_compact_materials[index] != m)
+        {
+            index = std::find(m_compact_materials.begin(),
+                              m_compact_materials.end(), m)
+                  - m_compact_materials.begin();
+            if (index == m_compact_materials.size())
+                m_compact_materials.push_back(m);
+        }
+        assert(index < NO_MATERIAL);
+        triangle.m_material = (uint16_t)index;
+    }
+    m_compact_triangles.push_back(triangle);
+}   // addTriangleData
 
 // -----------------------------------------------------------------------------
 /** Creates a collision body only, which can be used for raycasting, but
- *  has no physical properties.
+ *  has no physical properties. If a serialized bvh was restored by
+ *  loadCache, it is used instead of building the bvh.
  *  @param serialized_bhv if non-null, load the serialized bhv from file instead
  *                        of builing it on the fly
  */
 void TriangleMesh::createCollisionShape(bool create_collision_object, const char* serialized_bhv)
 {
-    if(m_triangleIndex2Material.size()==0)
+    if(getNumTriangles()==0)
     {
         m_collision_shape  = NULL;
         m_motion_state     = NULL;
@@ -112,45 +178,72 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
         assert(pos != -1L);
         fseek(f, 0, SEEK_SET);
 
-        void* bytes = btAlignedAlloc(pos, 16);
-        fread(bytes, pos, 1, f);
+        if (m_serialized_bvh)
+            btAlignedFree(m_serialized_bvh);
+        m_serialized_bvh      = btAlignedAlloc(pos, 16);
+        m_serialized_bvh_size = (unsigned int)pos;
+        fread(m_serialized_bvh, pos, 1, f);
         fclose(f);
+    }
 
-        btOptimizedBvh* bhv = btOptimizedBvh::deSerializeInPlace(bytes, pos, !IS_LITTLE_ENDIAN);
-        if (bhv == NULL)
-        {
-            Log::warn("TriangleMesh", "Failed to load serialized BHV");
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-        }
-        else
+    btStridingMeshInterface *mesh = &m_mesh;
+    if (m_compact)
+    {
+        // Let bullet read the vertices directly from the triangle records:
+        // with a vertex stride of one vertex, the k-th vertex of triangle i
+        // is vertex i*vertices_per_triangle+k.
+        static_assert(sizeof(CompactTriangle) % (3 * sizeof(float)) == 0,
+                      "Wrong compiler padding");
+        const int vertices_per_triangle =
+            sizeof(CompactTriangle) / (3 * sizeof(float));
+        const int n = (int)m_compact_triangles.size();
+        m_compact_indices.resize(3 * n);
+        for (int i = 0; i < n; i++)
         {
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
-                                                           false /* buildBvh */);
-            bhv_triangle_mesh->setOptimizedBvh( bhv );
+            for (int k = 0; k < 3; k++)
+                m_compact_indices[3 * i + k] = i * vertices_per_triangle + k;
         }
-        // Do *NOT* free the bytes, 'deSerializeInPlace' makes the btOptimizedBvh object
-        // directly at this memory location
-        //free(bytes);
+        btIndexedMesh indexed_mesh;
+        indexed_mesh.m_numTriangles        = n;
+        indexed_mesh.m_triangleIndexBase   =
+            (const unsigned char*)m_compact_indices.data();
+        indexed_mesh.m_triangleIndexStride = 3 * sizeof(int);
+        indexed_mesh.m_numVertices         = n * vertices_per_triangle;
+        indexed_mesh.m_vertexBase          =
+            (const unsigned char*)m_compact_triangles.data();
+        indexed_mesh.m_vertexStride        = 3 * sizeof(float);
+        indexed_mesh.m_indexType           = PHY_INTEGER;
+        indexed_mesh.m_vertexType          = PHY_FLOAT;
+        delete m_compact_mesh;
+        m_compact_mesh = new btTriangleIndexVertexArray();
+        m_compact_mesh->addIndexedMesh(indexed_mesh, PHY_INTEGER);
+        mesh = m_compact_mesh;
+    }
+    // A quantised bvh can only store 2^21 triangle indices
+    const bool quantized = m_compact && getNumTriangles() < (1 << 21);
 
+    btOptimizedBvh* bhv = NULL;
+    if (m_serialized_bvh != NULL)
+    {
+        // Do *NOT* free the bytes, 'deSerializeInPlace' makes the
+        // btOptimizedBvh object directly at this memory location. It is
+        // freed in removeAll.
+        bhv = btOptimizedBvh::deSerializeInPlace(m_serialized_bvh,
+                                                 m_serialized_bvh_size,
+                                                 !IS_LITTLE_ENDIAN);
+        if (bhv == NULL)
+            Log::warn("TriangleMesh", "Failed to load serialized BHV");
+    }
+
+    if (bhv != NULL)
+    {
+        bhv_triangle_mesh = new btBvhTriangleMeshShape(mesh, quantized,
+                                                       false /* buildBvh */);
+        bhv_triangle_mesh->setOptimizedBvh( bhv );
     }
     else
     {
-        bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-
-        /*
-         // code to serialize triangle mesh
-        btOptimizedBvh* bvh = bhv_triangle_mesh->getOptimizedBvh();
-        unsigned int ssize = bvh->calculateSerializeBufferSize();
-        char* buffer = (char*)btAlignedAlloc(ssize, 16);
-        bool success = bvh->serialize(buffer, ssize, !IS_LITTLE_ENDIAN);
-        printf("serialization success = %i\n", success);
-
-        std::ofstream fileout("/tmp/btOptimizedBvh");
-        fileout.write(buffer, ssize);
-        fileout.close();
-
-        btAlignedFree(buffer);
-         */
+        bhv_triangle_mesh = new btBvhTriangleMeshShape(mesh, quantized);
     }
 
     m_collision_shape = bhv_triangle_mesh;
@@ -229,8 +322,221 @@ void TriangleMesh::removeAll()
     }
     delete m_collision_shape;
     m_collision_shape = NULL;
+    delete m_compact_mesh;
+    m_compact_mesh = NULL;
+    if (m_serialized_bvh)
+    {
+        btAlignedFree(m_serialized_bvh);
+        m_serialized_bvh      = NULL;
+        m_serialized_bvh_size = 0;
+    }
 }   // removeAll
 
+// ----------------------------------------------------------------------------
+/** Writes a string with its length to a cache file. */
+static bool writeString(FILE *fd, const std::string &s)
+{
+    const uint32_t len = (uint32_t)s.size();
+    return fwrite(&len, sizeof(len), 1, fd) == 1 &&
+           (len == 0 || fwrite(s.data(), 1, len, fd) == len);
+}   // writeString
+
+// ----------------------------------------------------------------------------
+/** Reads a string written by writeString from a cache file. */
+static bool readString(FILE *fd, std::string *s)
+{
+    uint32_t len = 0;
+    if (fread(&len, sizeof(len), 1, fd) != 1 || len > 4096)
+        return false;
+    s->resize(len);
+    return len == 0 || fread(&(*s)[0], 1, len, fd) == len;
+}   // readString
+
+// ----------------------------------------------------------------------------
+/** Returns the number of bytes between the current position and the end of
+ *  a file, or 0 if this can not be determined. */
+static uint64_t getRemainingSize(FILE *fd)
+{
+    const long pos = ftell(fd);
+    if (pos < 0 || fseek(fd, 0, SEEK_END) != 0)
+        return 0;
+    const long end = ftell(fd);
+    if (fseek(fd, pos, SEEK_SET) != 0)
+        return 0;
+    return end > pos ? (uint64_t)(end - pos) : 0;
+}   // getRemainingSize
+
+// ----------------------------------------------------------------------------
+/** Writes all triangles, their normals and materials, and the bvh of the
+ *  collision shape (if it was created) to a cache file, so that the mesh can
+ *  be restored with loadCache without converting the scene nodes again. The
+ *  data is stored in the native byte order, since the cache is only used
+ *  on the machine which created it.
+ *  \param fd The file to write to.
+ *  \return True if all data was written.
+ */
+bool TriangleMesh::saveCache(FILE *fd) const
+{
+    const uint32_t n = getNumTriangles();
+
+    // Materials are stored as an index into a table of material IDs
+    std::vector<const Material*> materials;
+    std::vector<int32_t> material_index(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const Material *m = getMaterial(i);
+        if (!m)
+        {
+            material_index[i] = -1;
+            continue;
+        }
+        std::vector<const Material*>::iterator it =
+            std::find(materials.begin(), materials.end(), m);
+        material_index[i] = (int32_t)(it - materials.begin());
+        if (it == materials.end())
+            materials.push_back(m);
+    }
+
+    std::vector<float> vertices(9 * n), normals(9 * n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        btVector3 p[3], q[3];
+        getTriangle(i, &p[0], &p[1], &p[2]);
+        getNormals(i, &q[0], &q[1], &q[2]);
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                vertices[9 * i + 3 * k + c] = p[k][c];
+                normals [9 * i + 3 * k + c] = q[k][c];
+            }
+        }
+    }
+
+    const uint32_t num_materials = (uint32_t)materials.size();
+    bool ok = fwrite(&n,             sizeof(n),             1, fd) == 1 &&
+              fwrite(&num_materials, sizeof(num_materials), 1, fd) == 1;
+    for (unsigned int i = 0; ok && i < num_materials; i++)
+        ok = writeString(fd, material_manager->getMaterialID(materials[i]));
+    ok = ok &&
+         fwrite(vertices.data(), sizeof(float), 9 * n, fd) == 9 * n &&
+         fwrite(normals.data(), sizeof(float), 9 * n, fd) == 9 * n &&
+         fwrite(material_index.data(), sizeof(int32_t), n, fd) == n;
+
+    // Store the bvh, so that it does not need to be built again
+    uint32_t bvh_size = 0;
+    void *bvh_buffer  = NULL;
+    if (m_collision_shape)
+    {
+        btBvhTriangleMeshShape *shape =
+            static_cast<btBvhTriangleMeshShape*>(m_collision_shape);
+        const btOptimizedBvh *bvh = shape->getOptimizedBvh();
+        bvh_size   = bvh->calculateSerializeBufferSize();
+        bvh_buffer = btAlignedAlloc(bvh_size, 16);
+        if (!bvh->serializeInPlace(bvh_buffer, bvh_size, !IS_LITTLE_ENDIAN))
+            bvh_size = 0;
+    }
+    ok = ok && fwrite(&bvh_size, sizeof(bvh_size), 1, fd) == 1 &&
+         (bvh_size == 0 || fwrite(bvh_buffer, 1, bvh_size, fd) == bvh_size);
+    if (bvh_buffer)
+        btAlignedFree(bvh_buffer);
+    return ok;
+}   // saveCache
+
+// ----------------------------------------------------------------------------
+/** Restores the triangles, normals and materials, and the serialized bvh
+ *  written by saveCache. The bvh is used when the collision shape is
+ *  created. The mesh must not contain any triangles yet.
+ *  \param fd The file to read from.
+ *  \return True if the data was read, false if the file is invalid or a
+ *          material could not be found (in which case the mesh is not
+ *          modified).
+ */
+bool TriangleMesh::loadCache(FILE *fd)
+{
+    assert(getNumTriangles() == 0 && !m_collision_shape);
+
+    uint32_t n = 0, num_materials = 0;
+    if (fread(&n,             sizeof(n),             1, fd) != 1 ||
+        fread(&num_materials, sizeof(num_materials), 1, fd) != 1 ||
+        num_materials > n)
+        return false;
+
+    // Check that the file can contain the claimed data before allocating
+    // memory for it: each triangle has 9 floats for the vertices and the
+    // normals and a material index, each material at least its length.
+    const uint64_t min_size = (uint64_t)n * (2 * 9 * sizeof(float) +
+                                             sizeof(int32_t))
+                            + (uint64_t)num_materials * sizeof(uint32_t)
+                            + sizeof(uint32_t);
+    const uint64_t remaining = getRemainingSize(fd);
+    if (min_size > remaining)
+        return false;
+
+    std::vector<const Material*> materials(num_materials);
+    for (unsigned int i = 0; i < num_materials; i++)
+    {
+        std::string id;
+        if (!readString(fd, &id))
+            return false;
+        materials[i] = material_manager->getMaterialFromID(id);
+        if (!materials[i])
+            return false;
+    }
+
+    std::vector<float> vertices(9 * (size_t)n), normals(9 * (size_t)n);
+    std::vector<int32_t> material_index(n);
+    uint32_t bvh_size = 0;
+    if (fread(vertices.data(), sizeof(float), 9 * n, fd) != 9 * n ||
+        fread(normals.data(), sizeof(float), 9 * n, fd) != 9 * n ||
+        fread(material_index.data(), sizeof(int32_t), n, fd) != n ||
+        fread(&bvh_size, sizeof(bvh_size), 1, fd) != 1)
+        return false;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        if (material_index[i] >= (int32_t)num_materials)
+            return false;
+    }
+
+    void *bvh_buffer = NULL;
+    if (bvh_size > getRemainingSize(fd))
+        return false;
+    if (bvh_size > 0)
+    {
+        bvh_buffer = btAlignedAlloc(bvh_size, 16);
+        if (fread(bvh_buffer, 1, bvh_size, fd) != bvh_size)
+        {
+            btAlignedFree(bvh_buffer);
+            return false;
+        }
+    }
+
+    if (m_compact)
+        m_compact_triangles.reserve(n);
+    else
+        m_triangleIndex2Material.reserve(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const float *v = &vertices[9 * i];
+        const float *m = &normals[9 * i];
+        // The normals were already smoothed when the cache was written
+        addTriangleData(btVector3(v[0], v[1], v[2]),
+                        btVector3(v[3], v[4], v[5]),
+                        btVector3(v[6], v[7], v[8]),
+                        btVector3(m[0], m[1], m[2]),
+                        btVector3(m[3], m[4], m[5]),
+                        btVector3(m[6], m[7], m[8]),
+                        material_index[i] < 0 ? NULL
+                                              : materials[material_index[i]]);
+    }
+
+    if (m_serialized_bvh)
+        btAlignedFree(m_serialized_bvh);
+    m_serialized_bvh      = bvh_buffer;
+    m_serialized_bvh_size = bvh_size;
+    return true;
+}   // loadCache
+
 // -----------------------------------------------------------------------------
 /** Interpolates the normal at the given position for the triangle with
  *  a given index. The position must be inside of the given triangle.
@@ -379,7 +685,7 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
     if(ray_callback.hasHit())
     {
         *xyz      = ray_callback.m_hitPointWorld;
-        *material = m_triangleIndex2Material[index];
+        *material = getMaterial(index);
 
         if(normal)
         {
@@ -403,3 +709,107 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
     return ray_callback.hasHit();
 
 }   // castRay
+
+// ----------------------------------------------------------------------------
+/** Returns the number of bytes used for the triangle data and the bvh. */
+size_t TriangleMesh::getMemoryUsage() const
+{
+    size_t size;
+    if (m_compact)
+    {
+        size = m_compact_triangles.size() * sizeof(CompactTriangle)
+             + m_compact_indices.size() * sizeof(int)
+             + m_compact_materials.size() * sizeof(Material*);
+    }
+    else
+    {
+        const btIndexedMesh &m = m_mesh.getIndexedMeshArray()[0];
+        size = (size_t)m.m_numVertices * m.m_vertexStride
+             + (size_t)m.m_numTriangles * m.m_triangleIndexStride
+             + m_normals.size() * sizeof(btVector3)
+             + m_p1p2p3.size() * sizeof(float)
+             + m_triangleIndex2Material.size() * sizeof(Material*);
+    }
+    if (m_collision_shape)
+    {
+        btBvhTriangleMeshShape *shape =
+            static_cast<btBvhTriangleMeshShape*>(m_collision_shape);
+        size += shape->getOptimizedBvh()->calculateSerializeBufferSize();
+    }
+    return size;
+}   // getMemoryUsage
+
+// ----------------------------------------------------------------------------
+/** Compares the default and the compact layout: for a synthetic terrain it
+ *  prints the time to build the mesh and its bvh, the memory used, and the
+ *  average time of a wheel raycast (a short ray down to the terrain, with
+ *  material lookup and normal interpolation).
+ */
+void TriangleMesh::runBenchmark()
+{
+    const bool old_compact = m_default_compact;
+    const int grid = 400;
+    const unsigned int num_rays = 1000000;
+    const char *names[] = { "default", "compact" };
+
+    Log::info("TriangleMesh", "%-8s %10s %10s %10s %10s %8s", "layout",
+              "triangles", "build ms", "KB", "ray ns", "hits");
+    for (int compact = 0; compact < 2; compact++)
+    {
+        m_default_compact = compact == 1;
+        TriangleMesh *tm = new TriangleMesh(/*can_be_transformed*/false);
+
+        // A hilly terrain of grid x grid quads of size 1
+        struct Terrain
+        {
+            static float height(float x, float z)
+            {
+                return 4.0f * sinf(x * 0.05f) * cosf(z * 0.07f);
+            }
+        };
+        const btVector3 up(0, 1, 0);
+        double start = StkTime::getRealTime();
+        for (int z = 0; z < grid; z++)
+        {
+            for (int x = 0; x < grid; x++)
+            {
+                const btVector3 p00(x,     Terrain::height(x,     z    ), z    );
+                const btVector3 p10(x + 1, Terrain::height(x + 1, z    ), z    );
+                const btVector3 p01(x,     Terrain::height(x,     z + 1), z + 1);
+                const btVector3 p11(x + 1, Terrain::height(x + 1, z + 1), z + 1);
+                tm->addTriangle(p00, p01, p10, up, up, up, NULL);
+                tm->addTriangle(p10, p01, p11, up, up, up, NULL);
+            }
+        }
+        tm->createCollisionShape();
+        double build = StkTime::getRealTime() - start;
+
+        // Use the same pseudo-random rays for each layout
+        uint32_t seed = 12345;
+        unsigned int hits = 0;
+        start = StkTime::getRealTime();
+        for (unsigned int i = 0; i < num_rays; i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            const float x = (seed >> 8) * (grid / 16777216.0f);
+            seed = seed * 1664525 + 1013904223;
+            const float z = (seed >> 8) * (grid / 16777216.0f);
+            const float h = Terrain::height(x, z);
+            btVector3 xyz, normal;
+            const Material *material;
+            if (tm->castRay(btVector3(x, h + 0.5f, z), btVector3(x, h - 1.0f, z),
+                            &xyz, &material, &normal,
+                            /*interpolate_normal*/true))
+                hits++;
+        }
+        double rays = StkTime::getRealTime() - start;
+
+        Log::info("TriangleMesh", "%-8s %10u %10.2f %10.1f %10.2f %8u",
+                  names[compact], tm->getNumTriangles(), build * 1000.0,
+                  tm->getMemoryUsage() / 1024.0, rays * 1.0e9 / num_rays,
+                  hits);
+        delete tm;
+    }   // for compact < 2
+
+    m_default_compact = old_compact;
+}   // runBenchmark
@@ -19,11 +19,13 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <stdio.h>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
 #include "physics/user_pointer.hpp"
 #include "utils/aligned_array.hpp"
+#include "utils/types.hpp"
 
 class Material;
 
@@ -34,6 +36,26 @@ class Material;
 class TriangleMesh
 {
 private:
+    /** Data of one triangle in the compact layout, so that a raycast hit
+     *  only needs to read one record to get the material and interpolate
+     *  the normal. The vertices are at the start and the size is a
+     *  multiple of the size of a vertex, so bullet can read the vertices
+     *  directly from an array of these records. */
+    struct CompactTriangle
+    {
+        float    m_vertices[9];
+        float    m_normals[9];
+        float    m_p1p2p3;
+        /** Index in m_compact_materials, NO_MATERIAL if there is none. */
+        uint16_t m_material;
+        uint16_t m_padding[3];
+    };   // CompactTriangle
+
+    static const uint16_t NO_MATERIAL = 0xffff;
+
+    /** If new meshes use the compact layout. */
+    static bool                  m_default_compact;
+
     UserPointer                  m_user_pointer;
     std::vector<const Material*> m_triangleIndex2Material;
     btRigidBody                 *m_body;
@@ -52,6 +74,37 @@ private:
     /** Pre-compute value used in smoothing. */
     AlignedArray<float>          m_p1p2p3;
 
+    /** A serialized bvh which is used instead of building the bvh when
+     *  the collision shape is created. The bvh is created in place in this
+     *  buffer, so it must be kept as long as the collision shape exists. */
+    void                        *m_serialized_bvh;
+
+    /** Size of m_serialized_bvh in bytes. */
+    unsigned int                 m_serialized_bvh_size;
+
+    /** If this mesh uses the compact layout: all triangle data is stored
+     *  in m_compact_triangles instead of m_mesh, m_normals, m_p1p2p3 and
+     *  m_triangleIndex2Material, and the bvh uses quantised bounding
+     *  boxes. */
+    bool                         m_compact;
+
+    /** The triangles in the compact layout. */
+    std::vector<CompactTriangle> m_compact_triangles;
+
+    /** All materials used in the compact layout. */
+    std::vector<const Material*> m_compact_materials;
+
+    /** The vertex indices of all triangles in the compact layout. */
+    std::vector<int>             m_compact_indices;
+
+    /** The mesh interface used by bullet to access m_compact_triangles. */
+    btTriangleIndexVertexArray  *m_compact_mesh;
+
+    void addTriangleData(const btVector3 &t1, const btVector3 &t2,
+                         const btVector3 &t3, const btVector3 &n1,
+                         const btVector3 &n2, const btVector3 &n3,
+                         const Material* m);
+
     /** If the rigid body can be transformed (which means that normalising
      *  the normals need to update the vertices and normals used according
      *  to the current transform of the body. */
@@ -83,6 +136,16 @@ public:
                             const char* serializedBhv = NULL);
     void removeAll();
     void removeCollisionObject();
+    bool saveCache(FILE *fd) const;
+    bool loadCache(FILE *fd);
+    size_t getMemoryUsage() const;
+    static void runBenchmark();
+    // ------------------------------------------------------------------------
+    /** Selects if meshes created from now on use the compact layout. */
+    static void setCompactLayout(bool compact) { m_default_compact = compact; }
+    // ------------------------------------------------------------------------
+    /** Returns if meshes created from now on use the compact layout. */
+    static bool useCompactLayout() { return m_default_compact; }
     btVector3 getInterpolatedNormal(unsigned int index,
                                     const btVector3 &position) const;
     // ------------------------------------------------------------------------
@@ -101,8 +164,20 @@ public:
     }
     const btRigidBody *getBody() const { return m_body; }
     // ------------------------------------------------------------------------
+    /** Returns the number of triangles in this mesh. */
+    unsigned int getNumTriangles() const
+    {
+        return m_compact ? (unsigned int)m_compact_triangles.size()
+                         : (unsigned int)m_triangleIndex2Material.size();
+    }   // getNumTriangles
+    // ------------------------------------------------------------------------
     const Material* getMaterial(int n) const
-                                          {return m_triangleIndex2Material[n];}
+    {
+        if (!m_compact)
+            return m_triangleIndex2Material[n];
+        const uint16_t m = m_compact_triangles[n].m_material;
+        return m == NO_MATERIAL ? NULL : m_compact_materials[m];
+    }   // getMaterial
     // ------------------------------------------------------------------------
     const btCollisionShape &getCollisionShape() const
                                           { return *m_collision_shape; }
@@ -119,6 +194,14 @@ public:
     void getTriangle(unsigned int indx, btVector3 *p1, btVector3 *p2,
                      btVector3 *p3) const
     {
+        if (m_compact)
+        {
+            const float *v = m_compact_triangles[indx].m_vertices;
+            p1->setValue(v[0], v[1], v[2]);
+            p2->setValue(v[3], v[4], v[5]);
+            p3->setValue(v[6], v[7], v[8]);
+            return;
+        }
         const IndexedMeshArray &m = m_mesh.getIndexedMeshArray();
         btVector3 *p = &(((btVector3*)(m[0].m_vertexBase))[3*indx]);
         *p1 = p[0];
@@ -132,7 +215,15 @@ public:
     void getNormals(unsigned int indx, btVector3 *n1, 
                     btVector3 *n2, btVector3 *n3) const
     {
-        assert(indx < m_triangleIndex2Material.size());
+        assert(indx < getNumTriangles());
+        if (m_compact)
+        {
+            const float *n = m_compact_triangles[indx].m_normals;
+            n1->setValue(n[0], n[1], n[2]);
+            n2->setValue(n[3], n[4], n[5]);
+            n3->setValue(n[6], n[7], n[8]);
+            return;
+        }
         unsigned int n = indx*3;
         *n1 = m_normals[n  ];
         *n2 = m_normals[n+1];
@@ -143,7 +234,9 @@ public:
      *  smoothing the normals. */
     float getP1P2P3(unsigned int indx) const
     {
-        assert(indx < m_p1p2p3.size());
+        assert(indx < getNumTriangles());
+        if (m_compact)
+            return m_compact_triangles[indx].m_p1p2p3;
         return m_p1p2p3[indx];
     }
 };
@@ -26,7 +26,9 @@
 #include "karts/controller/controller.hpp"
 #include "network/network_config.hpp"
 #include "network/rewind_manager.hpp"
+#include "network/network_string.hpp"
 #include "physics/physics.hpp"
+#include "race/history_stream.hpp"
 #include "race/race_manager.hpp"
 #include "states_screens/main_menu_screen.hpp"
 #include "tracks/track.hpp"
@@ -40,8 +42,21 @@ History* history = 0;
 History::History()
 {
     m_replay_history = false;
+    m_stream_history = false;
+    m_stream_writer  = NULL;
+    m_stream_fd      = NULL;
+    m_stream_reader  = NULL;
 }   // History
 
+//-----------------------------------------------------------------------------
+/** Finishes writing a streamed history.
+ */
+History::~History()
+{
+    stopStreaming();
+    delete m_stream_reader;
+}   // ~History
+
 //-----------------------------------------------------------------------------
 /** Initialise the history for a new recording. It especially allocates memory
  *  to store the history.
@@ -51,8 +66,80 @@ void History::initRecording()
     allocateMemory();
     m_event_index = 0;
     m_all_input_events.clear();
+    if (m_stream_history)
+        startStreaming();
 }   // initRecording
 
+//-----------------------------------------------------------------------------
+/** Opens the history file history.dat, either in the current directory or
+ *  (if this fails) in the config directory.
+ *  \param writeable True if the file should be opened for writing.
+ *  \return The file, or NULL if it could not be opened.
+ */
+FILE* History::openHistoryFile(bool writeable)
+{
+    const char *mode = writeable ? "wb" : "rb";
+    FILE *fd = fopen("history.dat", mode);
+    if(fd)
+    {
+        Log::info("History", writeable ? "Saved in ./history.dat."
+                                       : "Reading ./history.dat");
+        return fd;
+    }
+    std::string fn = file_manager->getUserConfigFile("history.dat");
+    fd = fopen(fn.c_str(), mode);
+    if(fd)
+    {
+        Log::info("History", writeable ? "Saved in '%s'." : "Reading '%s'.",
+                  fn.c_str());
+    }
+    return fd;
+}   // openHistoryFile
+
+//-----------------------------------------------------------------------------
+/** Starts streaming the history of a new race to history.dat. The events
+ *  are written in compressed chunks by a separate thread, so only the
+ *  events of the current chunk are kept in memory.
+ */
+void History::startStreaming()
+{
+    // This finishes the history of a previous race
+    stopStreaming();
+
+    FILE *fd = openHistoryFile(/*writeable*/true);
+    if (!fd)
+    {
+        Log::warn("History", "Can't open history.dat file for writing - "
+                             "history will not be streamed.");
+        return;
+    }
+
+    World *world = World::getWorld();
+    BareNetworkString header;
+    header.encodeString(std::string(STK_VERSION))
+          .addUInt8(world->getNumKarts())
+          .addUInt8(race_manager->getNumPlayers())
+          .addUInt8(race_manager->getDifficulty())
+          .addUInt8(race_manager->getReverseTrack() ? 1 : 0)
+          .encodeString(Track::getCurrentTrack()->getIdent());
+    for (unsigned int k = 0; k < world->getNumKarts(); k++)
+        header.encodeString(world->getKart(k)->getIdent());
+    m_stream_fd     = fd;
+    m_stream_writer = new HistoryStreamWriter(fd, header);
+}   // startStreaming
+
+//-----------------------------------------------------------------------------
+/** Writes all remaining chunks of a streamed history and closes the file.
+ */
+void History::stopStreaming()
+{
+    delete m_stream_writer;
+    m_stream_writer = NULL;
+    if (m_stream_fd)
+        fclose(m_stream_fd);
+    m_stream_fd = NULL;
+}   // stopStreaming
+
 //-----------------------------------------------------------------------------
 /** Allocates memory for the history. This is used when recording as well
  *  as when replaying (since in replay the data is read into memory first).
@@ -85,6 +172,11 @@ void History::addEvent(int kart_id, PlayerAction pa, int value)
     ie.m_value       = value;
     ie.m_kart_index  = kart_id;
     m_all_input_events.emplace_back(ie);
+    if (m_stream_writer && m_all_input_events.size() >= EVENTS_PER_CHUNK)
+    {
+        m_stream_writer->addChunk(m_all_input_events);
+        m_all_input_events.clear();
+    }
 }   // addEvent
 
 //-----------------------------------------------------------------------------
@@ -96,23 +188,37 @@ void History::updateReplay(int world_ticks)
 {
     World *world = World::getWorld();
 
-    while (m_event_index < m_all_input_events.size() &&
-        m_all_input_events[m_event_index].m_world_ticks <= world_ticks)
+    while(true)
     {
-        const InputEvent &ie = m_all_input_events[m_event_index];
-        AbstractKart *kart = world->getKart(ie.m_kart_index);
-        Log::verbose("history", "time %d event-time %d action %d %d",
-            world->getTimeTicks(), ie.m_world_ticks, ie.m_action,
-            ie.m_value);
-        kart->getController()->action(ie.m_action, ie.m_value);
-        m_event_index++;
-    }   // while we have events for current time step.
+        while (m_event_index < m_all_input_events.size() &&
+            m_all_input_events[m_event_index].m_world_ticks <= world_ticks)
+        {
+            const InputEvent &ie = m_all_input_events[m_event_index];
+            AbstractKart *kart = world->getKart(ie.m_kart_index);
+            Log::verbose("history", "time %d event-time %d action %d %d",
+                world->getTimeTicks(), ie.m_world_ticks, ie.m_action,
+                ie.m_value);
+            kart->getController()->action(ie.m_action, ie.m_value);
+            m_event_index++;
+        }   // while we have events for current time step.
+
+        // A streamed history is read one chunk at a time
+        if (m_event_index < m_all_input_events.size() || !m_stream_reader ||
+            !m_stream_reader->readChunk(&m_all_input_events))
+            break;
+        m_event_index = 0;
+    }   // while true
 
     // Check if we have reached the end of the buffer
     if(m_event_index >= m_all_input_events.size())
     {
         Log::info("History", "Replay finished");
         m_event_index= 0;
+        if (m_stream_reader)
+        {
+            m_stream_reader->restart();
+            m_stream_reader->readChunk(&m_all_input_events);
+        }
         // This is useful to use a reproducable rewind problem:
         // replay it with history, for debugging only
 #undef DO_REWIND_AT_END_OF_HISTORY
@@ -132,16 +238,15 @@ void History::updateReplay(int world_ticks)
  */
 void History::Save()
 {
-    FILE *fd = fopen("history.dat","w");
-    if(fd)
-        Log::info("History", "Saved in ./history.dat.");
-    else
+    if (m_stream_writer)
     {
-        std::string fn = file_manager->getUserConfigFile("history.dat");
-        fd = fopen(fn.c_str(), "w");
-        if(fd)
-            Log::info("History", "Saved in '%s'.", fn.c_str());
+        // Write the events of the current chunk, the rest is already saved
+        m_stream_writer->addChunk(m_all_input_events);
+        m_all_input_events.clear();
+        return;
     }
+
+    FILE *fd = openHistoryFile(/*writeable*/true);
     if(!fd)
     {
         Log::info("History", "Can't open history.dat file for writing - can't save history.");
@@ -191,19 +296,16 @@ void History::Load()
     char s[1024], s1[1024];
     int  n;
 
-    FILE *fd = fopen("history.dat","r");
-    if(fd)
-        Log::info("History", "Reading ./history.dat");
-    else
-    {
-        std::string fn = file_manager->getUserConfigFile("history.dat");
-        fd = fopen(fn.c_str(), "r");
-        if(fd)
-            Log::info("History", "Reading '%s'.", fn.c_str());
-    }
+    FILE *fd = openHistoryFile(/*writeable*/false);
     if(!fd)
         Log::fatal("History", "Could not open history.dat");
 
+    if (HistoryStreamReader::isStream(fd))
+    {
+        loadStream(fd);
+        return;
+    }
+
     if (fgets(s, 1023, fd) == NULL)
         Log::fatal("History", "Could not read history.dat.");
 
@@ -307,3 +409,53 @@ void History::Load()
     fclose(fd);
 }   // Load
 
+
+//-----------------------------------------------------------------------------
+/** Loads the header of a streamed history and the first chunk of events.
+ *  The other chunks are read in updateReplay when needed.
+ *  \param fd The history file.
+ */
+void History::loadStream(FILE *fd)
+{
+    BareNetworkString *header = HistoryStreamReader::readHeader(fd);
+    if (!header)
+        Log::fatal("History", "Unsupported streamed history file.");
+
+    std::string version;
+    header->decodeString(&version);
+    if (version != STK_VERSION)
+        Log::warn("History", "History is version '%s', STK version is '%s'.",
+                  version.c_str(), STK_VERSION);
+
+    unsigned int num_karts = header->getUInt8();
+    race_manager->setNumKarts(num_karts);
+    race_manager->setNumPlayers(header->getUInt8());
+    race_manager->setDifficulty((RaceManager::Difficulty)header->getUInt8());
+    race_manager->setReverseTrack(header->getUInt8() != 0);
+    std::string track;
+    header->decodeString(&track);
+    race_manager->setTrack(track);
+    // This value doesn't really matter, but should be defined, otherwise
+    // the racing phase can switch to 'ending'
+    race_manager->setNumLaps(100);
+
+    for (unsigned int i = 0; i < num_karts; i++)
+    {
+        std::string ident;
+        header->decodeString(&ident);
+        m_kart_ident.push_back(ident);
+        if (i < race_manager->getNumPlayers() &&
+            !MainMenuScreen::m_enable_online)
+        {
+            race_manager->setPlayerKart(i, ident);
+        }
+    }
+    delete header;
+
+    delete m_stream_reader;
+    m_stream_reader = new HistoryStreamReader(fd);
+    allocateMemory();
+    m_event_index = 0;
+    if (!m_stream_reader->readChunk(&m_all_input_events))
+        Log::warn("History", "Streamed history contains no events.");
+}   // loadStream
@@ -23,9 +23,12 @@
 #include "input/input.hpp"
 #include "karts/controller/kart_control.hpp"
 
+#include <stdio.h>
 #include <string>
 #include <vector>
 
+class HistoryStreamReader;
+class HistoryStreamWriter;
 class Kart;
 
 /**
@@ -33,16 +36,7 @@ class Kart;
   */
 class History
 {
-private:
-    /** True if a history should be replayed, */
-    bool m_replay_history;
-
-    /** Points to the last used input event index. */
-    unsigned int m_event_index;
-
-    /** The identities of the karts to use. */
-    std::vector<std::string> m_kart_ident;
-
+public:
     // ------------------------------------------------------------------------
     struct InputEvent
     {
@@ -55,14 +49,46 @@ private:
         /** The value to use. */
         int m_value;
     };   // InputEvent
-    // ------------------------------------------------------------------------
 
-    /** All input events. */
+private:
+    /** Number of events collected before they are written as one chunk
+     *  when streaming the history. */
+    static const unsigned int EVENTS_PER_CHUNK = 4096;
+
+    /** True if a history should be replayed, */
+    bool m_replay_history;
+
+    /** True if the history should be streamed to a file while recording,
+     *  instead of being kept in memory. */
+    bool m_stream_history;
+
+    /** Points to the last used input event index. */
+    unsigned int m_event_index;
+
+    /** The identities of the karts to use. */
+    std::vector<std::string> m_kart_ident;
+
+    /** All input events. When streaming, only the events of the current
+     *  chunk. */
     std::vector<InputEvent> m_all_input_events;
 
+    /** Writes the history in the background if streaming is enabled. */
+    HistoryStreamWriter *m_stream_writer;
+
+    /** The file the streamed history is written to. */
+    FILE *m_stream_fd;
+
+    /** Reads the next chunks when replaying a streamed history. */
+    HistoryStreamReader *m_stream_reader;
+
     void  allocateMemory(int size=-1);
+    FILE *openHistoryFile(bool writeable);
+    void  startStreaming();
+    void  stopStreaming();
+    void  loadStream(FILE *fd);
 public:
           History        ();
+         ~History        ();
     void  initRecording  ();
     void  Save           ();
     void  Load           ();
@@ -81,6 +107,9 @@ public:
     // ------------------------------------------------------------------------
     /** Set if replay is enabled or not. */
     void  setReplayHistory(bool b) { m_replay_history=b;  }
+    // ------------------------------------------------------------------------
+    /** Enables streaming of the history to a file while recording. */
+    void  setStreamHistory(bool b) { m_stream_history = b; }
 };
 
 extern History* history;
@@ -0,0 +1,363 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "race/history_stream.hpp"
+
+#include "network/bit_stream.hpp"
+#include "network/network_string.hpp"
+#include "utils/log.hpp"
+
+#include <string.h>
+#include <zlib.h>
+
+/** Identifies a streamed history file ('STKI'). */
+static const uint32_t HISTORY_STREAM_MAGIC = 0x53544b49;
+
+/** Version of the streamed history format. */
+static const uint8_t HISTORY_STREAM_VERSION = 1;
+
+/** Size of the uncompressed header of each chunk: first and last ticks,
+ *  number of events, uncompressed and compressed size. */
+static const unsigned int CHUNK_HEADER_SIZE = 20;
+
+/** Maximum number of events in one chunk. This limits the memory a damaged
+ *  file can request when it is read. */
+static const unsigned int MAX_CHUNK_EVENTS = 64 * 1024;
+
+/** Minimum and maximum number of bits of an encoded event: 4 values with
+ *  a variable size of 1 to 8 groups of 5 bits. */
+static const unsigned int MIN_EVENT_BITS = 4 * 5;
+static const unsigned int MAX_EVENT_BITS = 4 * 8 * 5;
+
+// ============================================================================
+/** Creates the writer and starts the thread that writes the chunks. The
+ *  header is written immediately.
+ *  \param fd The file to write to. The caller must close it after the
+ *         writer is deleted.
+ *  \param header Data describing the race (karts, track, ...).
+ */
+HistoryStreamWriter::HistoryStreamWriter(FILE *fd,
+                                         const BareNetworkString &header)
+{
+    m_fd     = fd;
+    m_finish = false;
+    BareNetworkString pre;
+    pre.addUInt32(HISTORY_STREAM_MAGIC).addUInt8(HISTORY_STREAM_VERSION)
+       .addUInt32(header.getTotalSize());
+    fwrite(pre.getData(), 1, pre.getTotalSize(), m_fd);
+    fwrite(header.getData(), 1, header.getTotalSize(), m_fd);
+    fflush(m_fd);
+    m_thread = std::thread(std::bind(&HistoryStreamWriter::run, this));
+}   // HistoryStreamWriter
+
+// ----------------------------------------------------------------------------
+/** Writes all remaining chunks and stops the thread. */
+HistoryStreamWriter::~HistoryStreamWriter()
+{
+    std::unique_lock<std::mutex> ul(m_mutex);
+    m_finish = true;
+    m_cv.notify_one();
+    ul.unlock();
+    m_thread.join();
+}   // ~HistoryStreamWriter
+
+// ----------------------------------------------------------------------------
+/** Encodes a chunk of events and queues it for writing. The time of each
+ *  event is stored as difference to the previous event, and all values use
+ *  a variable number of bits, so most events only need 2 or 3 bytes before
+ *  compression.
+ *  \param events The events of this chunk, at most MAX_CHUNK_EVENTS.
+ */
+void HistoryStreamWriter::addChunk(const std::vector<History::InputEvent> &events)
+{
+    if (events.empty()) return;
+    assert(events.size() <= MAX_CHUNK_EVENTS);
+    BareNetworkString *chunk = new BareNetworkString(
+        CHUNK_HEADER_SIZE + (int)events.size() * 4);
+    chunk->addUInt32(events.front().m_world_ticks)
+          .addUInt32(events.back().m_world_ticks)
+          .addUInt32((uint32_t)events.size());
+    {
+        BitWriter w(chunk);
+        int previous = events.front().m_world_ticks;
+        for (unsigned int i = 0; i < events.size(); i++)
+        {
+            const History::InputEvent &ie = events[i];
+            w.addVarInt(ie.m_world_ticks - previous)
+             .addVarUInt(ie.m_kart_index)
+             .addVarUInt(ie.m_action)
+             .addVarInt(ie.m_value);
+            previous = ie.m_world_ticks;
+        }
+    }   // flush BitWriter
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_chunks.push_back(chunk);
+    m_cv.notify_one();
+}   // addChunk
+
+// ----------------------------------------------------------------------------
+/** The main loop of the writer thread: compresses and writes all queued
+ *  chunks, until the writer is destroyed.
+ */
+void HistoryStreamWriter::run()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> ul(m_mutex);
+        m_cv.wait(ul, [this] { return !m_chunks.empty() || m_finish; });
+        if (m_chunks.empty())
+            return;
+        BareNetworkString *chunk = m_chunks.front();
+        m_chunks.pop_front();
+        ul.unlock();
+
+        // The first 12 bytes are the ticks and number of events
+        const Bytef *data = (const Bytef*)chunk->getData() + 12;
+        const uLong raw_size = chunk->getTotalSize() - 12;
+        uLongf compressed_size = compressBound(raw_size);
+        std::vector<Bytef> compressed(compressed_size);
+        if (compress2(compressed.data(), &compressed_size, data, raw_size,
+                      Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            Log::error("HistoryStream", "Can't compress history chunk.");
+            delete chunk;
+            continue;
+        }
+        BareNetworkString header;
+        header.addUInt32((uint32_t)raw_size)
+              .addUInt32((uint32_t)compressed_size);
+        fwrite(chunk->getData(), 1, 12, m_fd);
+        fwrite(header.getData(), 1, header.getTotalSize(), m_fd);
+        fwrite(compressed.data(), 1, compressed_size, m_fd);
+        // So that the history is not lost if STK crashes
+        fflush(m_fd);
+        delete chunk;
+    }
+}   // run
+
+// ----------------------------------------------------------------------------
+/** Unit tests for writing and reading streamed histories, including
+ *  skipping chunks.
+ */
+void HistoryStreamWriter::unitTesting()
+{
+    // A temporary file, which is removed when it is closed by the reader
+    FILE *fd = tmpfile();
+    if (!fd) return;
+    BareNetworkString header;
+    header.encodeString(std::string("test"));
+    HistoryStreamWriter *writer = new HistoryStreamWriter(fd, header);
+    std::vector<History::InputEvent> events;
+    for (int chunk = 0; chunk < 3; chunk++)
+    {
+        events.clear();
+        for (int i = 0; i < 100; i++)
+        {
+            History::InputEvent ie;
+            ie.m_world_ticks = chunk * 1000 + i * 3;
+            ie.m_kart_index  = i % 4;
+            ie.m_action      = (PlayerAction)(i % PA_COUNT);
+            ie.m_value       = i % 2 == 0 ? 32768 : -i;
+            events.push_back(ie);
+        }
+        writer->addChunk(events);
+    }
+    delete writer;   // writes all chunks
+
+    fseek(fd, 0, SEEK_SET);
+    assert(HistoryStreamReader::isStream(fd));
+    BareNetworkString *h = HistoryStreamReader::readHeader(fd);
+    assert(h);
+    std::string s;
+    h->decodeString(&s);
+    assert(s == "test");
+    delete h;
+
+    HistoryStreamReader reader(fd);   // closes the file
+    std::vector<History::InputEvent> read;
+    bool ok = reader.readChunk(&read);
+    assert(ok && read.size() == 100);
+    assert(read[5].m_world_ticks == 15 && read[5].m_kart_index == 1);
+    assert(read[5].m_action == (PlayerAction)(5 % PA_COUNT));
+    assert(read[5].m_value == -5 && read[4].m_value == 32768);
+
+    // Skip to the chunk containing tick 2100: that's the third chunk
+    ok = reader.skipToTicks(2100);
+    assert(ok);
+    ok = reader.readChunk(&read);
+    assert(ok && read[0].m_world_ticks == 2000);
+    ok = reader.readChunk(&read);
+    assert(!ok);
+
+    // A chunk claiming too many events must be rejected before any memory
+    // is allocated for it
+    fd = tmpfile();
+    if (!fd) return;
+    BareNetworkString damaged;
+    damaged.addUInt32(0).addUInt32(10).addUInt32(0xffffffff)
+           .addUInt32(0xffffffff).addUInt32(16);
+    fwrite(damaged.getData(), 1, damaged.getTotalSize(), fd);
+    fseek(fd, 0, SEEK_SET);
+    HistoryStreamReader damaged_reader(fd);
+    ok = damaged_reader.readChunk(&read);
+    assert(!ok);
+}   // unitTesting
+
+// ============================================================================
+/** Checks if the given file is a streamed history. The file position is
+ *  reset to the beginning of the file.
+ */
+bool HistoryStreamReader::isStream(FILE *fd)
+{
+    unsigned char magic[4];
+    size_t n = fread(magic, 1, 4, fd);
+    fseek(fd, 0, SEEK_SET);
+    BareNetworkString s((char*)magic, 4);
+    return n == 4 && s.getUInt32() == HISTORY_STREAM_MAGIC;
+}   // isStream
+
+// ----------------------------------------------------------------------------
+/** Reads the header of a streamed history. Afterwards the file is positioned
+ *  at the first chunk.
+ *  \return The header data (which the caller must free), or NULL if the
+ *          file is not a supported history stream.
+ */
+BareNetworkString* HistoryStreamReader::readHeader(FILE *fd)
+{
+    char prefix[9];
+    if (fread(prefix, 1, 9, fd) != 9)
+        return NULL;
+    BareNetworkString pre(prefix, 9);
+    if (pre.getUInt32() != HISTORY_STREAM_MAGIC ||
+        pre.getUInt8() != HISTORY_STREAM_VERSION)
+        return NULL;
+    uint32_t len = pre.getUInt32();
+    if (len > 1024 * 1024)
+        return NULL;
+    std::vector<char> buffer(len);
+    if (fread(buffer.data(), 1, len, fd) != len)
+        return NULL;
+    return new BareNetworkString(buffer.data(), len);
+}   // readHeader
+
+// ----------------------------------------------------------------------------
+/** Creates a reader for a file, which must be positioned at the start of
+ *  a chunk (e.g. after calling readHeader). The file is closed by the
+ *  destructor. */
+HistoryStreamReader::HistoryStreamReader(FILE *fd)
+{
+    m_fd          = fd;
+    m_first_chunk = ftell(fd);
+}   // HistoryStreamReader
+
+// ----------------------------------------------------------------------------
+HistoryStreamReader::~HistoryStreamReader()
+{
+    fclose(m_fd);
+}   // ~HistoryStreamReader
+
+// ----------------------------------------------------------------------------
+/** Reads the next chunk.
+ *  \param events On return contains the events of this chunk (only).
+ *  \return False if there are no more chunks, or the file is damaged.
+ */
+bool HistoryStreamReader::readChunk(std::vector<History::InputEvent> *events)
+{
+    char buffer[CHUNK_HEADER_SIZE];
+    if (fread(buffer, 1, CHUNK_HEADER_SIZE, m_fd) != CHUNK_HEADER_SIZE)
+        return false;
+    BareNetworkString header(buffer, CHUNK_HEADER_SIZE);
+    const int      first_ticks     = (int)header.getUInt32();
+    header.getUInt32();   // last ticks, only used when skipping
+    const uint32_t num_events      = header.getUInt32();
+    uLongf         raw_size        = header.getUInt32();
+    const uint32_t compressed_size = header.getUInt32();
+
+    // Check the sizes before allocating memory for them
+    if (num_events > MAX_CHUNK_EVENTS ||
+        raw_size > (uLongf)MAX_CHUNK_EVENTS * MAX_EVENT_BITS / 8 ||
+        (uint64_t)num_events * MIN_EVENT_BITS > (uint64_t)raw_size * 8 ||
+        compressed_size > compressBound(raw_size))
+    {
+        Log::error("HistoryStream", "Damaged history chunk.");
+        return false;
+    }
+
+    std::vector<Bytef> compressed(compressed_size);
+    std::vector<char> raw(raw_size);
+    if (fread(compressed.data(), 1, compressed_size, m_fd) != compressed_size ||
+        uncompress((Bytef*)raw.data(), &raw_size, compressed.data(),
+                   compressed_size) != Z_OK)
+    {
+        Log::error("HistoryStream", "Damaged history chunk.");
+        return false;
+    }
+
+    BareNetworkString data(raw.data(), (int)raw_size);
+    BitReader r(&data);
+    events->clear();
+    events->reserve(num_events);
+    int ticks = first_ticks;
+    for (unsigned int i = 0; i < num_events; i++)
+    {
+        History::InputEvent ie;
+        ticks           += r.getVarInt();
+        ie.m_world_ticks = ticks;
+        ie.m_kart_index  = r.getVarUInt();
+        ie.m_action      = (PlayerAction)r.getVarUInt();
+        ie.m_value       = r.getVarInt();
+        if (r.hasError())
+        {
+            Log::error("HistoryStream", "Damaged history chunk.");
+            events->clear();
+            return false;
+        }
+        events->push_back(ie);
+    }
+    return true;
+}   // readChunk
+
+// ----------------------------------------------------------------------------
+/** Skips all chunks that only contain events before the given time. The
+ *  skipped chunks are not decompressed.
+ *  \param ticks The time (in world ticks) from which to read.
+ *  \return False if no chunk contains events at or after this time.
+ */
+bool HistoryStreamReader::skipToTicks(int ticks)
+{
+    while (true)
+    {
+        long pos = ftell(m_fd);
+        char buffer[CHUNK_HEADER_SIZE];
+        if (fread(buffer, 1, CHUNK_HEADER_SIZE, m_fd) != CHUNK_HEADER_SIZE)
+            return false;
+        BareNetworkString header(buffer, CHUNK_HEADER_SIZE);
+        header.getUInt32();   // first ticks
+        const int last_ticks = (int)header.getUInt32();
+        header.skip(8);       // number of events, uncompressed size
+        const uint32_t compressed_size = header.getUInt32();
+        if (last_ticks >= ticks)
+        {
+            fseek(m_fd, pos, SEEK_SET);
+            return true;
+        }
+        if (fseek(m_fd, compressed_size, SEEK_CUR) != 0)
+            return false;
+    }
+}   // skipToTicks
@@ -0,0 +1,106 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_HISTORY_STREAM_HPP
+#define HEADER_HISTORY_STREAM_HPP
+
+#include "race/history.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+class BareNetworkString;
+
+/** \class HistoryStreamWriter
+ *  \brief Writes a history file as a sequence of compressed chunks.
+ *  The file starts with a magic number and a header (which is written
+ *  uncompressed), followed by chunks of input events. Each chunk is encoded
+ *  independently of the others (delta-encoded times with a variable number
+ *  of bits), then compressed with zlib. The compression and writing is done
+ *  in a separate thread, so the memory used is independent of the length
+ *  of a session.
+ *  \ingroup race
+ */
+class HistoryStreamWriter : public NoCopy
+{
+private:
+    /** The file to write to. It is not closed by the writer. */
+    FILE *m_fd;
+
+    /** Encoded (but not yet compressed) chunks waiting to be written. */
+    std::list<BareNetworkString*> m_chunks;
+
+    /** Protects m_chunks and m_finish. */
+    std::mutex m_mutex;
+
+    /** Signals the thread that a chunk was added or it should finish. */
+    std::condition_variable m_cv;
+
+    /** Set when all data was added, and the thread should exit. */
+    bool m_finish;
+
+    /** The thread compressing and writing the chunks. */
+    std::thread m_thread;
+
+    void run();
+
+public:
+    static void unitTesting();
+
+         HistoryStreamWriter(FILE *fd, const BareNetworkString &header);
+        ~HistoryStreamWriter();
+    void addChunk(const std::vector<History::InputEvent> &events);
+};   // HistoryStreamWriter
+
+// ============================================================================
+/** \class HistoryStreamReader
+ *  \brief Reads a history file written by a HistoryStreamWriter one chunk
+ *  at a time. Since chunks are independent, reading can start at any chunk,
+ *  and chunks can be skipped without decompressing them.
+ *  \ingroup race
+ */
+class HistoryStreamReader : public NoCopy
+{
+private:
+    /** The file to read from. */
+    FILE *m_fd;
+
+    /** Position of the first chunk in the file. */
+    long  m_first_chunk;
+
+public:
+    static bool isStream(FILE *fd);
+    static BareNetworkString* readHeader(FILE *fd);
+
+         HistoryStreamReader(FILE *fd);
+        ~HistoryStreamReader();
+    bool readChunk(std::vector<History::InputEvent> *events);
+    bool skipToTicks(int ticks);
+    // ------------------------------------------------------------------------
+    /** Continues reading with the first chunk again. */
+    void restart() { fseek(m_fd, m_first_chunk, SEEK_SET); }
+};   // HistoryStreamReader
+
+#endif
@@ -18,6 +18,25 @@
 #include "replay/replay_base.hpp"
 
 #include "io/file_manager.hpp"
+#include "network/bit_stream.hpp"
+#include "network/network_string.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+/** Identifies a binary replay file. */
+static const char REPLAY_MAGIC[4] = { 'S', 'T', 'K', 'R' };
+
+/** The factors with which the values of a frame are multiplied before they
+ *  are rounded to integers: time (ms), position (mm), rotation, speed,
+ *  steering and suspension lengths. */
+static const float FRAME_SCALE[14] = { 1000.0f,
+                                       1000.0f, 1000.0f, 1000.0f,
+                                       32767.0f, 32767.0f, 32767.0f, 32767.0f,
+                                       100.0f, 1000.0f,
+                                       1000.0f, 1000.0f, 1000.0f, 1000.0f };
 
 // -----------------------------------------------------------------------------
 ReplayBase::ReplayBase()
@@ -33,7 +52,7 @@ FILE* ReplayBase::openReplayFile(bool writeable, bool full_path)
 {
     FILE *fd = fopen(full_path ? getReplayFilename().c_str() :
         (file_manager->getReplayDir() + getReplayFilename()).c_str(),
-        writeable ? "w" : "r");
+        writeable ? "wb" : "rb");
     if (!fd)
     {
         return NULL;
@@ -41,3 +60,421 @@ FILE* ReplayBase::openReplayFile(bool writeable, bool full_path)
     return fd;
 
 }   // openReplayFile
+
+// -----------------------------------------------------------------------------
+/** Checks if the given file is a binary replay file. The file position is
+ *  reset to the beginning of the file.
+ *  \param fd The replay file.
+ */
+bool ReplayBase::isBinaryReplay(FILE *fd)
+{
+    char magic[4];
+    size_t n = fread(magic, 1, 4, fd);
+    fseek(fd, 0, SEEK_SET);
+    return n == 4 && memcmp(magic, REPLAY_MAGIC, 4) == 0;
+}   // isBinaryReplay
+
+// -----------------------------------------------------------------------------
+/** Reads the header of a binary replay file. Only the header is read, so
+ *  this is fast even for long replays. Afterwards the file position is at
+ *  the start of the kart data, see readBinaryReplay().
+ *  \param fd The replay file, positioned at the beginning.
+ *  \param header On return contains the header information.
+ *  \return False if the file is not a binary replay of a supported version.
+ */
+bool ReplayBase::readBinaryHeader(FILE *fd, ReplayHeader *header)
+{
+    char prefix[9];
+    if (fread(prefix, 1, 9, fd) != 9 || memcmp(prefix, REPLAY_MAGIC, 4) != 0)
+        return false;
+    BareNetworkString pre(prefix, 9);
+    pre.skip(4);
+    unsigned int version = pre.getUInt8();
+    if (version != getReplayVersion())
+    {
+        Log::warn("Replay", "Replay is version '%d'", version);
+        Log::warn("Replay", "STK version is '%d'", getReplayVersion());
+        return false;
+    }
+    uint32_t len = pre.getUInt32();
+    // A header is at most a few kilobytes
+    if (len == 0 || len > 1024 * 1024)
+        return false;
+    std::vector<char> buffer(len);
+    if (fread(buffer.data(), 1, len, fd) != len)
+        return false;
+
+    BareNetworkString s(buffer.data(), len);
+    if (!decodeHeader(s, header))
+    {
+        Log::error("Replay", "The header of the replay is corrupt.");
+        return false;
+    }
+    return true;
+}   // readBinaryHeader
+
+// -----------------------------------------------------------------------------
+/** Appends the header information to a string.
+ *  \param header The header to encode.
+ *  \param out The string to which the header is added.
+ */
+void ReplayBase::encodeHeader(const ReplayHeader &header,
+                              BareNetworkString *out)
+{
+    out->addUInt8((uint8_t)header.m_kart_list.size());
+    for (unsigned int i = 0; i < header.m_kart_list.size(); i++)
+    {
+        out->encodeString(header.m_kart_list[i]);
+        out->encodeString(i < header.m_name_list.size()
+                          ? header.m_name_list[i] : irr::core::stringw());
+    }
+    out->addUInt8(header.m_reverse ? 1 : 0).addUInt8(header.m_difficulty);
+    out->encodeString(header.m_track_name);
+    out->addUInt16(header.m_laps).addFloat(header.m_min_time);
+}   // encodeHeader
+
+// -----------------------------------------------------------------------------
+/** Returns true if the string contains a complete string encoded with
+ *  BareNetworkString::encodeString at its current position. */
+static bool hasEncodedString(const BareNetworkString &s)
+{
+    return s.size() > 0 && s.size() > (uint8_t)s.getCurrentData()[0];
+}   // hasEncodedString
+
+// -----------------------------------------------------------------------------
+/** Reads header information written with encodeHeader().
+ *  \param s The string to read from.
+ *  \param header On return contains the header information.
+ *  \return False if the string is too short (e.g. a corrupt file).
+ */
+bool ReplayBase::decodeHeader(const BareNetworkString &s,
+                              ReplayHeader *header)
+{
+    if (s.size() < 1)
+        return false;
+    unsigned int num_karts = s.getUInt8();
+    header->m_kart_list.clear();
+    header->m_name_list.clear();
+    for (unsigned int i = 0; i < num_karts; i++)
+    {
+        std::string ident;
+        irr::core::stringw name;
+        if (!hasEncodedString(s))
+            return false;
+        s.decodeString(&ident);
+        if (!hasEncodedString(s))
+            return false;
+        s.decodeStringW(&name);
+        header->m_kart_list.push_back(ident);
+        header->m_name_list.push_back(name);
+    }
+    if (s.size() < 2)
+        return false;
+    header->m_reverse    = s.getUInt8() != 0;
+    header->m_difficulty = s.getUInt8();
+    if (!hasEncodedString(s))
+        return false;
+    s.decodeString(&header->m_track_name);
+    if (s.size() < 6)
+        return false;
+    header->m_laps       = s.getUInt16();
+    header->m_min_time   = s.getFloat();
+    return true;
+}   // decodeHeader
+
+// -----------------------------------------------------------------------------
+/** Writes a binary replay file. The file starts with the header, followed by
+ *  the number of frames and the size of the data of each kart, and then the
+ *  delta-encoded frames of all karts.
+ *  \param fd The file to write to.
+ *  \param header The header information.
+ *  \param karts The frames of each kart in the header's kart list.
+ *  \return True if the file was written successfully.
+ */
+bool ReplayBase::writeBinaryReplay(FILE *fd, const ReplayHeader &header,
+                                   const std::vector<KartFrames> &karts)
+{
+    assert(karts.size() == header.m_kart_list.size());
+    BareNetworkString h;
+    encodeHeader(header, &h);
+
+    BareNetworkString pre;
+    for (unsigned int i = 0; i < 4; i++)
+        pre.addChar(REPLAY_MAGIC[i]);
+    pre.addUInt8(getReplayVersion()).addUInt32(h.getTotalSize());
+
+    BareNetworkString index;
+    std::vector<BareNetworkString> data(karts.size());
+    index.addUInt8((uint8_t)karts.size());
+    for (unsigned int k = 0; k < karts.size(); k++)
+    {
+        encodeKartFrames(karts[k], &data[k]);
+        index.addUInt32((uint32_t)karts[k].m_transform_events.size())
+             .addUInt32(data[k].getTotalSize());
+    }
+
+    bool ok = fwrite(pre.getData(), 1, pre.getTotalSize(), fd)
+                                                    == pre.getTotalSize() &&
+              fwrite(h.getData(), 1, h.getTotalSize(), fd)
+                                                    == h.getTotalSize() &&
+              fwrite(index.getData(), 1, index.getTotalSize(), fd)
+                                                    == index.getTotalSize();
+    for (unsigned int k = 0; ok && k < data.size(); k++)
+    {
+        ok = fwrite(data[k].getData(), 1, data[k].getTotalSize(), fd)
+                                                 == data[k].getTotalSize();
+    }
+    return ok;
+}   // writeBinaryReplay
+
+// -----------------------------------------------------------------------------
+/** Reads the frames of all karts from a binary replay file. The header must
+ *  have been read before using readBinaryHeader(). The rest of the file is
+ *  read with a single read, and then decoded.
+ *  \param fd The replay file.
+ *  \param karts On return contains the frames of each kart.
+ *  \return False if the file is truncated.
+ */
+bool ReplayBase::readBinaryReplay(FILE *fd, std::vector<KartFrames> *karts)
+{
+    long start = ftell(fd);
+    fseek(fd, 0, SEEK_END);
+    long end = ftell(fd);
+    fseek(fd, start, SEEK_SET);
+    if (start < 0 || end <= start)
+        return false;
+    std::vector<char> buffer(end - start);
+    if (fread(buffer.data(), 1, buffer.size(), fd) != buffer.size())
+        return false;
+
+    BareNetworkString s(buffer.data(), (int)buffer.size());
+    const unsigned int num_karts = s.getUInt8();
+    std::vector<uint32_t> num_frames(num_karts), data_size(num_karts);
+    for (unsigned int k = 0; k < num_karts; k++)
+    {
+        if (s.size() < 8)
+        {
+            Log::error("Replay", "The kart list of the replay is truncated.");
+            return false;
+        }
+        num_frames[k] = s.getUInt32();
+        data_size[k]  = s.getUInt32();
+    }
+
+    karts->clear();
+    karts->resize(num_karts);
+    for (unsigned int k = 0; k < num_karts; k++)
+    {
+        if (s.size() < data_size[k])
+        {
+            Log::error("Replay", "The frames of the replay are truncated.");
+            return false;
+        }
+        BareNetworkString data(s.getCurrentData(), data_size[k]);
+        s.skip(data_size[k]);
+        if (!decodeKartFrames(&data, num_frames[k], &(*karts)[k]))
+        {
+            Log::error("Replay", "The frames of kart %d are corrupt.", k);
+            return false;
+        }
+    }
+    return true;
+}   // readBinaryReplay
+
+// -----------------------------------------------------------------------------
+/** Encodes all frames of a kart. All values are quantised to integers
+ *  (see FRAME_SCALE), and the difference to the previous frame is stored
+ *  with a variable number of bits.
+ *  \param frames The frames to encode.
+ *  \param out The string to which the encoded data is appended.
+ */
+void ReplayBase::encodeKartFrames(const KartFrames &frames,
+                                  BareNetworkString *out)
+{
+    const unsigned int n = (unsigned int)frames.m_transform_events.size();
+    assert(frames.m_physic_info.size() == n &&
+           frames.m_kart_replay_events.size() == n);
+    int32_t previous[NUM_FRAME_VALUES];
+    memset(previous, 0, sizeof(previous));
+    BitWriter w(out);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const TransformEvent  &te = frames.m_transform_events[i];
+        const PhysicInfo      &pi = frames.m_physic_info[i];
+        const KartReplayEvent &kre = frames.m_kart_replay_events[i];
+        const btVector3    &xyz = te.m_transform.getOrigin();
+        const btQuaternion  q   = te.m_transform.getRotation();
+        const float values[NUM_FRAME_VALUES] =
+            { te.m_time, xyz.getX(), xyz.getY(), xyz.getZ(),
+              q.getX(), q.getY(), q.getZ(), q.getW(),
+              pi.m_speed, pi.m_steer,
+              pi.m_suspension_length[0], pi.m_suspension_length[1],
+              pi.m_suspension_length[2], pi.m_suspension_length[3] };
+        for (unsigned int j = 0; j < NUM_FRAME_VALUES; j++)
+        {
+            int32_t v = (int32_t)floorf(values[j] * FRAME_SCALE[j] + 0.5f);
+            w.addVarInt((int32_t)((uint32_t)v - (uint32_t)previous[j]));
+            previous[j] = v;
+        }
+        w.addVarInt(kre.m_nitro_usage).addBool(kre.m_zipper_usage)
+         .addVarInt(kre.m_skidding_state).addBool(kre.m_red_skidding)
+         .addBool(kre.m_jumping);
+    }   // for i < n
+}   // encodeKartFrames
+
+// -----------------------------------------------------------------------------
+/** Decodes the frames of a kart. The data can come from a corrupt or
+ *  manipulated file, so the frame count is checked against the size of the
+ *  data first, and decoding stops if the data ends early.
+ *  \param data The encoded frames of this kart.
+ *  \param num_frames Number of frames of this kart.
+ *  \param frames The decoded frames are appended to this object.
+ *  \return False if the data is invalid.
+ */
+bool ReplayBase::decodeKartFrames(BareNetworkString *data,
+                                  unsigned int num_frames,
+                                  KartFrames *frames)
+{
+    // Each frame needs at least MIN_FRAME_BITS, which limits the number
+    // of frames a corrupt file can claim
+    const uint64_t total_bits = (uint64_t)data->getTotalSize() * 8;
+    if ((uint64_t)num_frames * MIN_FRAME_BITS > total_bits)
+        return false;
+
+    int32_t previous[NUM_FRAME_VALUES];
+    memset(previous, 0, sizeof(previous));
+    BitReader r(data);
+    for (unsigned int i = 0; i < num_frames; i++)
+    {
+        float values[NUM_FRAME_VALUES];
+        for (unsigned int j = 0; j < NUM_FRAME_VALUES; j++)
+        {
+            previous[j] = (int32_t)((uint32_t)previous[j] +
+                                    (uint32_t)r.getVarInt());
+            values[j] = previous[j] / FRAME_SCALE[j];
+        }
+        TransformEvent te;
+        te.m_time = values[0];
+        btQuaternion q(values[4], values[5], values[6], values[7]);
+        if (q.length2() > 0.0f)
+            q.normalize();
+        else
+            q = btQuaternion(0, 0, 0, 1);
+        te.m_transform = btTransform(q, btVector3(values[1], values[2],
+                                                  values[3]));
+        PhysicInfo pi;
+        pi.m_speed = values[8];
+        pi.m_steer = values[9];
+        for (unsigned int j = 0; j < 4; j++)
+            pi.m_suspension_length[j] = values[10 + j];
+        KartReplayEvent kre;
+        kre.m_nitro_usage    = r.getVarInt();
+        kre.m_zipper_usage   = r.getBool();
+        kre.m_skidding_state = r.getVarInt();
+        kre.m_red_skidding   = r.getBool();
+        kre.m_jumping        = r.getBool();
+        if (r.hasError())
+            return false;
+        frames->m_transform_events.push_back(te);
+        frames->m_physic_info.push_back(pi);
+        frames->m_kart_replay_events.push_back(kre);
+    }   // for i < num_frames
+    return true;
+}   // decodeKartFrames
+
+// -----------------------------------------------------------------------------
+/** Unit tests for the binary replay format. It tests that frames survive a
+ *  round trip (within the quantisation error), that corrupt data is
+ *  rejected, and that the header of a replay file can be read back.
+ */
+void ReplayBase::unitTesting()
+{
+    KartFrames frames;
+    const unsigned int n = 101;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        TransformEvent te;
+        te.m_time = i * 0.05f;
+        btQuaternion q(btVector3(0, 1, 0), i * 0.1f);
+        te.m_transform = btTransform(q, btVector3(i * 1.5f, -2.0f, 100.0f));
+        PhysicInfo pi;
+        pi.m_speed = 10.0f + i;
+        pi.m_steer = -0.5f;
+        for (unsigned int j = 0; j < 4; j++)
+            pi.m_suspension_length[j] = 0.1f * j;
+        KartReplayEvent kre;
+        kre.m_nitro_usage    = i % 3;
+        kre.m_zipper_usage   = i % 2 == 0;
+        kre.m_skidding_state = i % 4;
+        kre.m_red_skidding   = i % 5 == 0;
+        kre.m_jumping        = i % 7 == 0;
+        frames.m_transform_events.push_back(te);
+        frames.m_physic_info.push_back(pi);
+        frames.m_kart_replay_events.push_back(kre);
+    }
+
+    BareNetworkString data;
+    encodeKartFrames(frames, &data);
+
+    KartFrames decoded;
+    bool ok = decodeKartFrames(&data, n, &decoded);
+    assert(ok);
+    assert(decoded.m_transform_events.size() == n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const btTransform &a = frames.m_transform_events[i].m_transform;
+        const btTransform &b = decoded.m_transform_events[i].m_transform;
+        assert(fabsf(frames.m_transform_events[i].m_time -
+                     decoded.m_transform_events[i].m_time) < 0.001f);
+        assert((a.getOrigin() - b.getOrigin()).length() < 0.002f);
+        assert(fabsf(a.getRotation().dot(b.getRotation())) > 0.9999f);
+        assert(fabsf(frames.m_physic_info[i].m_speed -
+                     decoded.m_physic_info[i].m_speed) < 0.01f);
+        const KartReplayEvent &e1 = frames.m_kart_replay_events[i];
+        const KartReplayEvent &e2 = decoded.m_kart_replay_events[i];
+        assert(e1.m_nitro_usage    == e2.m_nitro_usage);
+        assert(e1.m_zipper_usage   == e2.m_zipper_usage);
+        assert(e1.m_skidding_state == e2.m_skidding_state);
+        assert(e1.m_red_skidding   == e2.m_red_skidding);
+        assert(e1.m_jumping        == e2.m_jumping);
+    }
+
+    // Corrupt data must be rejected instead of being decoded
+    KartFrames bad;
+    data.reset();
+    ok = decodeKartFrames(&data, 1000000, &bad);
+    assert(!ok);
+    BareNetworkString truncated(data.getData(), data.getTotalSize() / 2);
+    ok = decodeKartFrames(&truncated, n, &bad);
+    assert(!ok);
+
+    // Complete file
+    FILE *fd = tmpfile();
+    if (!fd) return;
+    ReplayHeader header;
+    header.m_track_name = "test";
+    header.m_kart_list.push_back("tux");
+    header.m_name_list.push_back(L"name");
+    header.m_reverse    = true;
+    header.m_difficulty = 2;
+    header.m_laps       = 3;
+    header.m_min_time   = 12.5f;
+    std::vector<KartFrames> karts(1, frames);
+    ok = writeBinaryReplay(fd, header, karts);
+    assert(ok);
+    fseek(fd, 0, SEEK_SET);
+    ok = isBinaryReplay(fd);
+    assert(ok);
+    ReplayHeader header2;
+    ok = readBinaryHeader(fd, &header2);
+    assert(ok);
+    assert(header2.m_track_name == "test" && header2.m_kart_list[0] == "tux");
+    assert(header2.m_name_list[0] == L"name" && header2.m_reverse);
+    assert(header2.m_difficulty == 2 && header2.m_laps == 3);
+    assert(header2.m_min_time == 12.5f);
+    std::vector<KartFrames> karts2;
+    ok = readBinaryReplay(fd, &karts2);
+    assert(ok);
+    assert(karts2.size() == 1 && karts2[0].m_transform_events.size() == n);
+    fclose(fd);
+}   // unitTesting
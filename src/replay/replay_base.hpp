@@ -21,11 +21,17 @@
 
 #include "LinearMath/btTransform.h"
 #include "utils/no_copy.hpp"
+#include "utils/types.hpp"
 
+#include <irrString.h>
 #include <stdio.h>
 #include <string>
 #include <vector>
 
+class BareNetworkString;
+class BitReader;
+class BitWriter;
+
 /**
   * \ingroup race
   */
@@ -72,18 +78,68 @@ protected:
         bool        m_jumping;
     };   // KartReplayEvent
 
+    // ------------------------------------------------------------------------
+    /** All recorded frames of one kart. */
+    struct KartFrames
+    {
+        std::vector<TransformEvent>  m_transform_events;
+        std::vector<PhysicInfo>      m_physic_info;
+        std::vector<KartReplayEvent> m_kart_replay_events;
+    };   // KartFrames
+
+    // ------------------------------------------------------------------------
+    /** The information stored in the header of a replay file. */
+    class ReplayHeader
+    {
+    public:
+        std::string                      m_track_name;
+        std::vector<std::string>         m_kart_list;
+        std::vector<irr::core::stringw>  m_name_list;
+        bool                             m_reverse;
+        unsigned int                     m_difficulty;
+        unsigned int                     m_laps;
+        float                            m_min_time;
+    };   // ReplayHeader
+
+    /** Number of quantised values stored for each frame. */
+    static const unsigned int NUM_FRAME_VALUES = 14;
+
+    /** Minimum number of bits of an encoded frame: 16 values with at least
+     *  5 bits each, and 3 booleans. */
+    static const unsigned int MIN_FRAME_BITS = (NUM_FRAME_VALUES + 2) * 5 + 3;
+
     // ------------------------------------------------------------------------
     FILE *openReplayFile(bool writeable, bool full_path = false);
+    static bool isBinaryReplay(FILE *fd);
+    static bool readBinaryHeader(FILE *fd, ReplayHeader *header);
+    static void encodeHeader(const ReplayHeader &header,
+                             BareNetworkString *out);
+    static bool decodeHeader(const BareNetworkString &s,
+                             ReplayHeader *header);
+    static bool writeBinaryReplay(FILE *fd, const ReplayHeader &header,
+                                  const std::vector<KartFrames> &karts);
+    static bool readBinaryReplay(FILE *fd, std::vector<KartFrames> *karts);
+    static void encodeKartFrames(const KartFrames &frames,
+                                 BareNetworkString *out);
+    static bool decodeKartFrames(BareNetworkString *data,
+                                 unsigned int num_frames,
+                                 KartFrames *frames);
     // ------------------------------------------------------------------------
     /** Returns the filename that was opened. */
     virtual const std::string& getReplayFilename() const = 0;
     // ------------------------------------------------------------------------
     /** Returns the version number of the replay file. This is used to check
      *  that a loaded replay file can still be understood by this
-     *  executable. */
-    unsigned int getReplayVersion() const { return 3; }
+     *  executable. Version 4 is the binary format, version 3 the old text
+     *  format, which can still be read. */
+    static unsigned int getReplayVersion() { return 4; }
+    // ------------------------------------------------------------------------
+    /** Returns the version number of the old text replay format. */
+    static unsigned int getTextReplayVersion() { return 3; }
 
 public:
+    static void unitTesting();
+
              ReplayBase();
     virtual ~ReplayBase() {};
 };   // ReplayBase
@@ -23,17 +23,23 @@
 #include "karts/ghost_kart.hpp"
 #include "karts/controller/ghost_controller.hpp"
 #include "modes/world.hpp"
+#include "network/network_string.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <irrlicht.h>
 #include <stdio.h>
 #include <string>
+#include <thread>
 
 ReplayPlay::SortOrder ReplayPlay::m_sort_order = ReplayPlay::SO_DEFAULT;
 ReplayPlay *ReplayPlay::m_replay_play = NULL;
 
+/** Identifies the replay header cache file ('STKH'). */
+static const uint32_t HEADER_CACHE_MAGIC = 0x53544b48;
+
 //-----------------------------------------------------------------------------
 /** Initialises the Replay engine
  */
@@ -60,55 +66,295 @@ void ReplayPlay::reset()
 }   // reset
 
 //-----------------------------------------------------------------------------
+/** Loads the headers of all replay files. A persistent cache of all headers
+ *  is used, so that only new or changed files need to be parsed. Those are
+ *  parsed in parallel, since there can be thousands of replay files.
+ */
 void ReplayPlay::loadAllReplayFile()
 {
     m_replay_file_list.clear();
 
-    // Load stock replay first
+    // All replay files: stock replays first (using full path), then the
+    // user recorded replays
+    std::vector<std::pair<std::string, bool> > all_files;
     std::set<std::string> pre_record;
     file_manager->listFiles(pre_record, file_manager
         ->getAssetDirectory(FileManager::REPLAY), /*is_full_path*/ true);
     for (std::set<std::string>::iterator i  = pre_record.begin();
                                          i != pre_record.end(); ++i)
     {
-        if (!addReplayFile(*i, /*custom_replay*/ true))
-        {
-            // Skip invalid replay file
-            continue;
-        }
+        if (StringUtils::getExtension(*i) == "replay")
+            all_files.push_back(std::make_pair(*i, true));
     }
-
-    // Now user recorded replay
     std::set<std::string> files;
     file_manager->listFiles(files, file_manager->getReplayDir(),
         /*is_full_path*/ false);
-
     for (std::set<std::string>::iterator i  = files.begin();
                                          i != files.end(); ++i)
     {
-        if (!addReplayFile(*i))
+        if (StringUtils::getExtension(*i) == "replay")
+            all_files.push_back(std::make_pair(*i, false));
+    }
+
+    std::map<std::string, HeaderCacheEntry> cache;
+    loadHeaderCache(&cache);
+
+    // Find all files which are not in the cache or changed
+    std::map<std::string, HeaderCacheEntry> new_cache;
+    std::vector<std::string> keys(all_files.size());
+    std::vector<std::string> full_paths;
+    std::vector<HeaderCacheEntry*> to_parse;
+    for (unsigned int i = 0; i < all_files.size(); i++)
+    {
+        const std::string &fn = all_files[i].first;
+        const bool custom = all_files[i].second;
+        const std::string full_path = custom ? fn
+                                    : file_manager->getReplayDir() + fn;
+        keys[i] = (custom ? "1" : "0") + StringUtils::getBasename(fn);
+        uint64_t mtime, size;
+        if (!file_manager->getFileStats(full_path, &mtime, &size))
+            continue;
+        std::map<std::string, HeaderCacheEntry>::iterator c =
+            cache.find(keys[i]);
+        if (c != cache.end() && c->second.m_mtime == mtime &&
+            c->second.m_size == size)
+        {
+            new_cache[keys[i]] = c->second;
+        }
+        else
+        {
+            HeaderCacheEntry &entry = new_cache[keys[i]];
+            entry.m_mtime = mtime;
+            entry.m_size  = size;
+            entry.m_valid = false;
+            full_paths.push_back(full_path);
+            to_parse.push_back(&entry);
+        }
+        // The file name can't be cached, since the replay directory could
+        // have been moved
+        new_cache[keys[i]].m_data.m_filename = fn;
+        new_cache[keys[i]].m_data.m_custom_replay_file = custom;
+    }   // for i < all_files.size()
+
+    // Parse the new or changed files with a few threads
+    if (!to_parse.empty())
+    {
+        unsigned int num_threads = std::thread::hardware_concurrency();
+        num_threads = std::max(1u, std::min(num_threads, 8u));
+        num_threads = std::min(num_threads,
+                               (unsigned int)to_parse.size() / 4 + 1);
+        WorkerPool pool(num_threads);
+        pool.run((unsigned int)to_parse.size(),
+                 [&full_paths, &to_parse](unsigned int i)
+        {
+            to_parse[i]->m_valid =
+                readReplayHeader(full_paths[i], &to_parse[i]->m_data);
+        });
+        Log::info("Replay", "Parsed %d new or changed replay headers, "
+                  "%d cached.", (int)to_parse.size(),
+                  (int)(new_cache.size() - to_parse.size()));
+    }
+
+    for (unsigned int i = 0; i < all_files.size(); i++)
+    {
+        std::map<std::string, HeaderCacheEntry>::const_iterator c =
+            new_cache.find(keys[i]);
+        if (c == new_cache.end() || !c->second.m_valid)
         {
             // Skip invalid replay file
             continue;
         }
+        addReplayData(c->second.m_data);
     }
 
+    if (!to_parse.empty() || new_cache.size() != cache.size())
+        saveHeaderCache(new_cache);
 }   // loadAllReplayFile
 
 //-----------------------------------------------------------------------------
 bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay)
 {
-
-    char s[1024], s1[1024];
     if (StringUtils::getExtension(fn) != "replay") return false;
-    FILE *fd = fopen(custom_replay ? fn.c_str() :
-        (file_manager->getReplayDir() + fn).c_str(), "r");
-    if (fd == NULL) return false;
     ReplayData rd;
 
     // custom_replay is true when full path of filename is given
     rd.m_custom_replay_file = custom_replay;
     rd.m_filename = fn;
+    if (!readReplayHeader(custom_replay ? fn
+                                        : file_manager->getReplayDir() + fn,
+                          &rd))
+    {
+        return false;
+    }
+    return addReplayData(rd);
+}   // addReplayFile
+
+//-----------------------------------------------------------------------------
+/** Reads the header of a replay file in binary or text format. This function
+ *  is thread-safe, it is called from several threads when loading all replay
+ *  files.
+ *  \param full_path Full path of the replay file.
+ *  \param rd On return contains the header information.
+ *  \return False if the file is not a valid replay file.
+ */
+bool ReplayPlay::readReplayHeader(const std::string &full_path,
+                                  ReplayData *rd)
+{
+    FILE *fd = fopen(full_path.c_str(), "rb");
+    if (fd == NULL) return false;
+
+    bool ok = isBinaryReplay(fd) ? readBinaryHeader(fd, rd)
+                                 : readTextHeader(fd, rd);
+    fclose(fd);
+    if (!ok)
+        Log::warn("Replay", "Skipped '%s'", full_path.c_str());
+    return ok;
+}   // readReplayHeader
+
+//-----------------------------------------------------------------------------
+/** Adds a replay file to the list of available replays, if its track is
+ *  available.
+ *  \param rd Header information of the replay file.
+ */
+bool ReplayPlay::addReplayData(const ReplayData &rd)
+{
+    Track* t = track_manager->getTrack(rd.m_track_name);
+    if (t == NULL)
+    {
+        Log::warn("Replay", "Track '%s' used in replay not found in STK!",
+        rd.m_track_name.c_str());
+        return false;
+    }
+
+    m_replay_file_list.push_back(rd);
+    // First user is the game master and the "owner" of this replay file
+    if (rd.m_name_list.size() > 0)
+        m_replay_file_list.back().m_user_name = rd.m_name_list[0];
+
+    assert(m_replay_file_list.size() > 0);
+    // Force to use custom replay file immediately
+    if (rd.m_custom_replay_file)
+        m_current_replay_file = (unsigned int)m_replay_file_list.size() - 1;
+
+    return true;
+
+}   // addReplayData
+
+//-----------------------------------------------------------------------------
+/** Reads the cache of replay file headers. If the cache does not exist, was
+ *  written by a different version or is corrupt, the cache is empty.
+ *  \param cache On return contains all cached headers, indexed by file.
+ */
+void ReplayPlay::loadHeaderCache(std::map<std::string,
+                                          HeaderCacheEntry> *cache)
+{
+    const std::string fn = file_manager->getReplayDir() + "replay_headers.cache";
+    FILE *fd = fopen(fn.c_str(), "rb");
+    if (!fd) return;
+    std::vector<char> buffer;
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fd)) > 0)
+        buffer.insert(buffer.end(), chunk, chunk + n);
+    fclose(fd);
+
+    BareNetworkString s(buffer.data(), (int)buffer.size());
+    if (s.size() < 5 || s.getUInt32() != HEADER_CACHE_MAGIC ||
+        s.getUInt8() != getReplayVersion())
+        return;
+
+    while (s.size() > 0)
+    {
+        // Each entry is the file name (one byte length plus the string),
+        // modification time and size (8 bytes each) and the valid flag
+        const unsigned int name_length = (uint8_t)s.getCurrentData()[0];
+        if (s.size() < 1 + name_length + 17)
+        {
+            Log::warn("Replay", "Replay header cache is corrupt, ignored.");
+            cache->clear();
+            return;
+        }
+        std::string key;
+        s.decodeString(&key);
+        HeaderCacheEntry entry;
+        entry.m_mtime  = ((uint64_t)s.getUInt32()) << 32;
+        entry.m_mtime |= s.getUInt32();
+        entry.m_size   = ((uint64_t)s.getUInt32()) << 32;
+        entry.m_size  |= s.getUInt32();
+        entry.m_valid  = s.getUInt8() != 0;
+        if (entry.m_valid && !decodeHeader(s, &entry.m_data))
+        {
+            Log::warn("Replay", "Replay header cache is corrupt, ignored.");
+            cache->clear();
+            return;
+        }
+        (*cache)[key] = entry;
+    }
+}   // loadHeaderCache
+
+//-----------------------------------------------------------------------------
+/** Saves the cache of replay file headers in the replay directory. The cache
+ *  is written to a temporary file first, so that an interrupted write can
+ *  not leave a truncated cache behind.
+ *  \param cache All headers to save, indexed by file.
+ */
+void ReplayPlay::saveHeaderCache(const std::map<std::string,
+                                                HeaderCacheEntry> &cache)
+{
+    BareNetworkString s;
+    s.addUInt32(HEADER_CACHE_MAGIC).addUInt8(getReplayVersion());
+    for (std::map<std::string, HeaderCacheEntry>::const_iterator
+         i = cache.begin(); i != cache.end(); i++)
+    {
+        const HeaderCacheEntry &entry = i->second;
+        s.encodeString(i->first);
+        s.addUInt32((uint32_t)(entry.m_mtime >> 32))
+         .addUInt32((uint32_t)entry.m_mtime)
+         .addUInt32((uint32_t)(entry.m_size >> 32))
+         .addUInt32((uint32_t)entry.m_size)
+         .addUInt8(entry.m_valid ? 1 : 0);
+        if (entry.m_valid)
+            encodeHeader(entry.m_data, &s);
+    }
+
+    const std::string fn = file_manager->getReplayDir() + "replay_headers.cache";
+    const std::string tmp = fn + ".part";
+    FILE *fd = fopen(tmp.c_str(), "wb");
+    if (!fd)
+    {
+        Log::warn("Replay", "Can't write replay header cache '%s'.",
+                  tmp.c_str());
+        return;
+    }
+    bool ok = fwrite(s.getData(), 1, s.getTotalSize(), fd) ==
+              s.getTotalSize();
+    ok = fclose(fd) == 0 && ok;
+    if (!ok)
+    {
+        Log::warn("Replay", "Error writing replay header cache.");
+        file_manager->removeFile(tmp);
+        return;
+    }
+    // The behaviour of rename is unspecified if the target file should
+    // already exist - so remove it.
+    file_manager->removeFile(fn);
+    if (rename(tmp.c_str(), fn.c_str()) != 0)
+    {
+        Log::warn("Replay", "Can't rename replay header cache to '%s'.",
+                  fn.c_str());
+        file_manager->removeFile(tmp);
+    }
+}   // saveHeaderCache
+
+//-----------------------------------------------------------------------------
+/** Reads the header of a replay file in the old text format.
+ *  \param fd The replay file, positioned at the beginning.
+ *  \param rd On return contains the header information.
+ *  \return False if the header could not be read.
+ */
+bool ReplayPlay::readTextHeader(FILE *fd, ReplayData *rd)
+{
+    char s[1024], s1[1024];
 
     fgets(s, 1023, fd);
     unsigned int version;
@@ -116,25 +362,25 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay)
     {
         Log::warn("Replay", "No Version information "
                   "found in replay file (bogus replay file).");
-        fclose(fd);
         return false;
     }
-    if (version != getReplayVersion())
+    if (version != getTextReplayVersion())
     {
         Log::warn("Replay", "Replay is version '%d'", version);
-        Log::warn("Replay", "STK version is '%d'", getReplayVersion());
-        Log::warn("Replay", "Skipped '%s'", fn.c_str());
-        fclose(fd);
+        Log::warn("Replay", "STK version is '%d'", getTextReplayVersion());
         return false;
     }
 
     while(true)
     {
-        fgets(s, 1023, fd);
+        if (fgets(s, 1023, fd) == NULL)
+        {
+            Log::warn("Replay", "Could not read ghost karts info!");
+            return false;
+        }
         core::stringc is_end(s);
         is_end.trim();
         if (is_end == "kart_list_end") break;
-        char s1[1024];
         char display_name_encoded[1024];
 
         int scanned = sscanf(s,"kart: %s %[^\n]", s1, display_name_encoded);
@@ -144,21 +390,16 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay)
             break;
         }
 
-        rd.m_kart_list.push_back(std::string(s1));
+        rd->m_kart_list.push_back(std::string(s1));
         if (scanned == 2)
         {
             // If username of kart is present, use it
-            rd.m_name_list.push_back(StringUtils::xmlDecode(std::string(display_name_encoded)));
-            if (rd.m_name_list.size() == 1)
-            {
-                // First user is the game master and the "owner" of this replay file
-                rd.m_user_name = rd.m_name_list[0];
-            }
+            rd->m_name_list.push_back(StringUtils::xmlDecode(std::string(display_name_encoded)));
         } else
         { // scanned == 1
             // If username is not present, kart display name will default to kart name
             // (see GhostController::getName)
-            rd.m_name_list.push_back("");
+            rd->m_name_list.push_back("");
         }
     }
 
@@ -167,16 +408,14 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay)
     if(sscanf(s, "reverse: %d", &reverse) != 1)
     {
         Log::warn("Replay", "Reverse info found in replay file.");
-        fclose(fd);
         return false;
     }
-    rd.m_reverse = reverse != 0;
+    rd->m_reverse = reverse != 0;
 
     fgets(s, 1023, fd);
-    if (sscanf(s, "difficulty: %u", &rd.m_difficulty) != 1)
+    if (sscanf(s, "difficulty: %u", &rd->m_difficulty) != 1)
     {
         Log::warn("Replay", " No difficulty found in replay file.");
-        fclose(fd);
         return false;
     }
 
@@ -184,51 +423,30 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay)
     if (sscanf(s, "track: %s", s1) != 1)
     {
         Log::warn("Replay", "Track info not found in replay file.");
-        fclose(fd);
-        return false;
-    }
-    rd.m_track_name = std::string(s1);
-    Track* t = track_manager->getTrack(rd.m_track_name);
-    if (t == NULL)
-    {
-        Log::warn("Replay", "Track '%s' used in replay not found in STK!",
-        rd.m_track_name.c_str());
-        fclose(fd);
         return false;
     }
+    rd->m_track_name = std::string(s1);
 
     fgets(s, 1023, fd);
-    if (sscanf(s, "laps: %u", &rd.m_laps) != 1)
+    if (sscanf(s, "laps: %u", &rd->m_laps) != 1)
     {
         Log::warn("Replay", "No number of laps found in replay file.");
-        fclose(fd);
         return false;
     }
 
     fgets(s, 1023, fd);
-    if (sscanf(s, "min_time: %f", &rd.m_min_time) != 1)
+    if (sscanf(s, "min_time: %f", &rd->m_min_time) != 1)
     {
         Log::warn("Replay", "Finish time not found in replay file.");
-        fclose(fd);
         return false;
     }
-    fclose(fd);
-    m_replay_file_list.push_back(rd);
-
-    assert(m_replay_file_list.size() > 0);
-    // Force to use custom replay file immediately
-    if (custom_replay)
-        m_current_replay_file = (unsigned int)m_replay_file_list.size() - 1;
-
     return true;
-
-}   // addReplayFile
+}   // readTextHeader
 
 //-----------------------------------------------------------------------------
 void ReplayPlay::load()
 {
     m_ghost_karts.clearAndDeleteAll();
-    char s[1024];
 
     FILE *fd = openReplayFile(/*writeable*/false,
         m_replay_file_list.at(m_current_replay_file).m_custom_replay_file);
@@ -242,30 +460,39 @@ void ReplayPlay::load()
 
     Log::info("Replay", "Reading replay file '%s'.", getReplayFilename().c_str());
 
-    const unsigned int line_skipped = getNumGhostKart() + 7;
-    for (unsigned int i = 0; i < line_skipped; i++)
-        fgets(s, 1023, fd);
-
-    // eof actually doesn't trigger here, since it requires first to try
-    // reading behind eof, but still it's clearer this way.
-    while(!feof(fd))
+    std::vector<KartFrames> karts;
+    bool ok;
+    if (isBinaryReplay(fd))
     {
-        if(fgets(s, 1023, fd)==NULL)  // eof reached
-            break;
-        readKartData(fd, s);
+        ReplayHeader header;
+        ok = readBinaryHeader(fd, &header) && readBinaryReplay(fd, &karts);
+    }
+    else
+    {
+        char s[1024];
+        const unsigned int line_skipped = getNumGhostKart() + 7;
+        for (unsigned int i = 0; i < line_skipped; i++)
+            fgets(s, 1023, fd);
+        ok = readTextReplay(fd, &karts);
     }
-
-    fprintf(fd, "Replay file end.\n");
     fclose(fd);
+
+    if (!ok)
+        Log::warn("Replay", "Replay file '%s' is incomplete.",
+                  getReplayFilename().c_str());
+
+    // Each kart in the kart list needs a ghost kart
+    karts.resize(getNumGhostKart());
+    for (unsigned int i = 0; i < karts.size(); i++)
+        createGhostKart(karts[i]);
 }   // load
 
 //-----------------------------------------------------------------------------
-/** Reads all data from a replay file for a specific kart.
- *  \param fd The file descriptor from which to read.
+/** Creates the next ghost kart and adds all its replay events.
+ *  \param frames All frames of the kart.
  */
-void ReplayPlay::readKartData(FILE *fd, char *next_line)
+void ReplayPlay::createGhostKart(const KartFrames &frames)
 {
-    char s[1024];
     const unsigned int kart_num = m_ghost_karts.size();
     ReplayData &rd = m_replay_file_list[m_current_replay_file];
     m_ghost_karts.push_back(new GhostKart(rd.m_kart_list.at(kart_num),
@@ -275,14 +502,57 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line)
                                                  rd.m_name_list[kart_num]);
     getGhostKart(kart_num)->setController(controller);
 
+    for (unsigned int i = 0; i < frames.m_transform_events.size(); i++)
+    {
+        m_ghost_karts[kart_num].addReplayEvent(
+            frames.m_transform_events[i].m_time,
+            frames.m_transform_events[i].m_transform,
+            frames.m_physic_info[i], frames.m_kart_replay_events[i]);
+    }
+}   // createGhostKart
+
+//-----------------------------------------------------------------------------
+/** Reads the data of all karts from a replay file in the old text format.
+ *  \param fd The replay file, positioned after the header.
+ *  \param karts On return contains the frames of each kart.
+ */
+bool ReplayPlay::readTextReplay(FILE *fd, std::vector<KartFrames> *karts)
+{
+    char s[1024];
+    // eof actually doesn't trigger here, since it requires first to try
+    // reading behind eof, but still it's clearer this way.
+    while(!feof(fd))
+    {
+        if(fgets(s, 1023, fd)==NULL)  // eof reached
+            break;
+        karts->push_back(KartFrames());
+        if (!readTextKartData(fd, s, &karts->back()))
+            return false;
+    }
+    return true;
+}   // readTextReplay
+
+//-----------------------------------------------------------------------------
+/** Reads all data from a text replay file for a specific kart.
+ *  \param fd The file descriptor from which to read.
+ *  \param next_line The line with the number of records of this kart.
+ *  \param frames The frames read are added to this object.
+ */
+bool ReplayPlay::readTextKartData(FILE *fd, char *next_line,
+                                  KartFrames *frames)
+{
+    char s[1024];
     unsigned int size;
     if(sscanf(next_line,"size: %u",&size)!=1)
-        Log::fatal("Replay", "Number of records not found in replay file "
-            "for kart %d.", kart_num);
+    {
+        Log::warn("Replay", "Number of records not found in replay file.");
+        return false;
+    }
 
     for(unsigned int i=0; i<size; i++)
     {
-        fgets(s, 1023, fd);
+        if (fgets(s, 1023, fd) == NULL)
+            break;
         float x, y, z, rx, ry, rz, rw, time, speed, steer, w1, w2, w3, w4;
         int nitro, zipper, skidding, red_skidding, jumping;
 
@@ -296,8 +566,10 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line)
             &nitro, &zipper, &skidding, &red_skidding, &jumping
             )==19)
         {
-            btQuaternion q(rx, ry, rz, rw);
-            btVector3 xyz(x, y, z);
+            TransformEvent te;
+            te.m_time = time;
+            te.m_transform = btTransform(btQuaternion(rx, ry, rz, rw),
+                                         btVector3(x, y, z));
             PhysicInfo pi = {0};
             KartReplayEvent kre = {0};
             pi.m_speed = speed;
@@ -311,8 +583,9 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line)
             kre.m_skidding_state = skidding;
             kre.m_red_skidding = red_skidding!=0;
             kre.m_jumping = jumping != 0;
-            m_ghost_karts[kart_num].addReplayEvent(time,
-                btTransform(q, xyz), pi, kre);
+            frames->m_transform_events.push_back(te);
+            frames->m_physic_info.push_back(pi);
+            frames->m_kart_replay_events.push_back(kre);
         }
         else
         {
@@ -323,5 +596,61 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line)
             Log::warn("Replay", "Ignored.");
         }
     }   // for i
+    return true;
+}   // readTextKartData
 
-}   // readKartData
+//-----------------------------------------------------------------------------
+/** Converts a replay file in the old text format to the binary format. The
+ *  original file is kept with an additional '.txt' extension.
+ *  \param filename Full path of the replay file.
+ *  \return True if the file was converted (or is already binary).
+ */
+bool ReplayPlay::convertTextReplay(const std::string &filename)
+{
+    FILE *fd = fopen(filename.c_str(), "rb");
+    if (!fd)
+    {
+        Log::error("Replay", "Can't open '%s'.", filename.c_str());
+        return false;
+    }
+    if (isBinaryReplay(fd))
+    {
+        fclose(fd);
+        Log::info("Replay", "'%s' is already a binary replay.",
+                  filename.c_str());
+        return true;
+    }
+
+    ReplayData rd;
+    rd.m_filename = filename;
+    std::vector<KartFrames> karts;
+    bool ok = readTextHeader(fd, &rd) && readTextReplay(fd, &karts);
+    fclose(fd);
+    if (!ok)
+    {
+        Log::error("Replay", "Can't read text replay '%s'.", filename.c_str());
+        return false;
+    }
+    karts.resize(rd.m_kart_list.size());
+
+    const std::string backup = filename + ".txt";
+    if (rename(filename.c_str(), backup.c_str()) != 0)
+    {
+        Log::error("Replay", "Can't rename '%s' to '%s'.", filename.c_str(),
+                   backup.c_str());
+        return false;
+    }
+    fd = fopen(filename.c_str(), "wb");
+    ok = fd && writeBinaryReplay(fd, rd, karts);
+    if (fd)
+        fclose(fd);
+    if (!ok)
+    {
+        Log::error("Replay", "Can't write '%s', original is in '%s'.",
+                   filename.c_str(), backup.c_str());
+        return false;
+    }
+    Log::info("Replay", "Converted '%s', original is in '%s'.",
+              filename.c_str(), backup.c_str());
+    return true;
+}   // convertTextReplay
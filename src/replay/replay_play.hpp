@@ -24,6 +24,7 @@
 #include "utils/ptr_vector.hpp"
 
 #include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -49,19 +50,12 @@ public:
         SO_USER
     };
 
-    class ReplayData
+    class ReplayData : public ReplayHeader
     {
     public:
         std::string                m_filename;
-        std::string                m_track_name;
         core::stringw              m_user_name;
-        std::vector<std::string>   m_kart_list;
-        std::vector<core::stringw> m_name_list;
-        bool                       m_reverse;
         bool                       m_custom_replay_file;
-        unsigned int               m_difficulty;
-        unsigned int               m_laps;
-        float                      m_min_time;
 
         bool operator < (const ReplayData& r) const
         {
@@ -94,6 +88,18 @@ public:
     };   // ReplayData
 
 private:
+    /** An entry in the persistent cache of replay file headers. A header
+     *  is only parsed again if the modification time or size of the file
+     *  changed. */
+    struct HeaderCacheEntry
+    {
+        uint64_t   m_mtime;
+        uint64_t   m_size;
+        /** False if the file is not a valid replay file. */
+        bool       m_valid;
+        ReplayData m_data;
+    };   // HeaderCacheEntry
+
     static ReplayPlay       *m_replay_play;
 
     static SortOrder         m_sort_order;
@@ -107,11 +113,22 @@ private:
 
           ReplayPlay();
          ~ReplayPlay();
-    void  readKartData(FILE *fd, char *next_line);
+    void  createGhostKart(const KartFrames &frames);
+    bool  addReplayData(const ReplayData &rd);
+    void  loadHeaderCache(std::map<std::string, HeaderCacheEntry> *cache);
+    void  saveHeaderCache(const std::map<std::string,
+                                         HeaderCacheEntry> &cache);
+    static bool readReplayHeader(const std::string &full_path,
+                                 ReplayData *rd);
+    static bool readTextHeader(FILE *fd, ReplayData *rd);
+    static bool readTextReplay(FILE *fd, std::vector<KartFrames> *karts);
+    static bool readTextKartData(FILE *fd, char *next_line,
+                                 KartFrames *frames);
 public:
     void  reset();
     void  load();
     void  loadAllReplayFile();
+    static bool convertTextReplay(const std::string &filename);
     // ------------------------------------------------------------------------
     static void        setSortOrder(SortOrder so)       { m_sort_order = so; }
     // ------------------------------------------------------------------------
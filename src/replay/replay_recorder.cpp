@@ -220,60 +220,39 @@ void ReplayRecorder::save()
         (file_manager->getReplayDir() + getReplayFilename()).c_str());
     MessageQueue::add(MessageQueue::MT_GENERIC, msg);
 
-    fprintf(fd, "version: %d\n",    getReplayVersion());
-    for (unsigned int real_karts = 0; real_karts < num_karts; real_karts++)
-    {
-        const AbstractKart *kart = world->getKart(real_karts);
-        if (kart->isGhostKart()) continue;
-
-        // XML encode the username to handle Unicode
-        fprintf(fd, "kart: %s %s\n", kart->getIdent().c_str(),
-                StringUtils::xmlEncode(kart->getController()->getName()).c_str());
-    }
-
-    fprintf(fd, "kart_list_end\n");
-    fprintf(fd, "reverse: %d\n",    (int)race_manager->getReverseTrack());
-    fprintf(fd, "difficulty: %d\n", race_manager->getDifficulty());
-    fprintf(fd, "track: %s\n",      Track::getCurrentTrack()->getIdent().c_str());
-    fprintf(fd, "laps: %d\n",       race_manager->getNumLaps());
-    fprintf(fd, "min_time: %f\n",   min_time);
-
+    ReplayHeader header;
+    std::vector<KartFrames> karts;
     unsigned int max_frames = (unsigned int)(  stk_config->m_replay_max_time 
                                              / stk_config->m_replay_dt      );
     for (unsigned int k = 0; k < num_karts; k++)
     {
-        if (world->getKart(k)->isGhostKart()) continue;
-        fprintf(fd, "size:     %d\n", m_count_transforms[k]);
+        const AbstractKart *kart = world->getKart(k);
+        if (kart->isGhostKart()) continue;
+
+        header.m_kart_list.push_back(kart->getIdent());
+        header.m_name_list.push_back(kart->getController()->getName());
 
         unsigned int num_transforms = std::min(max_frames,
                                                m_count_transforms[k]);
-        for (unsigned int i = 0; i < num_transforms; i++)
-        {
-            const TransformEvent *p  = &(m_transform_events[k][i]);
-            const PhysicInfo *q      = &(m_physic_info[k][i]);
-            const KartReplayEvent *r = &(m_kart_replay_event[k][i]);
-            fprintf(fd, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f  %d %d %d %d %d\n",
-                    p->m_time,
-                    p->m_transform.getOrigin().getX(),
-                    p->m_transform.getOrigin().getY(),
-                    p->m_transform.getOrigin().getZ(),
-                    p->m_transform.getRotation().getX(),
-                    p->m_transform.getRotation().getY(),
-                    p->m_transform.getRotation().getZ(),
-                    p->m_transform.getRotation().getW(),
-                    q->m_speed,
-                    q->m_steer,
-                    q->m_suspension_length[0],
-                    q->m_suspension_length[1],
-                    q->m_suspension_length[2],
-                    q->m_suspension_length[3],
-                    r->m_nitro_usage,
-                    (int)r->m_zipper_usage,
-                    r->m_skidding_state,
-                    (int)r->m_red_skidding,
-                    (int)r->m_jumping
-                );
-        }   // for i
+        karts.push_back(KartFrames());
+        KartFrames &frames = karts.back();
+        frames.m_transform_events.assign(m_transform_events[k].begin(),
+            m_transform_events[k].begin() + num_transforms);
+        frames.m_physic_info.assign(m_physic_info[k].begin(),
+            m_physic_info[k].begin() + num_transforms);
+        frames.m_kart_replay_events.assign(m_kart_replay_event[k].begin(),
+            m_kart_replay_event[k].begin() + num_transforms);
+    }
+    header.m_reverse    = race_manager->getReverseTrack();
+    header.m_difficulty = race_manager->getDifficulty();
+    header.m_track_name = Track::getCurrentTrack()->getIdent();
+    header.m_laps       = race_manager->getNumLaps();
+    header.m_min_time   = min_time;
+
+    if (!writeBinaryReplay(fd, header, karts))
+    {
+        Log::error("ReplayRecorder", "Error writing replay file '%s'.",
+                   getReplayFilename().c_str());
     }
     fclose(fd);
 }   // save
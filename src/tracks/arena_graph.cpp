@@ -26,21 +26,51 @@
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <algorithm>
 #include <queue>
+#include <random>
+#include <stdio.h>
+#include <thread>
+
+/** Magic number and version of the shortest path cache files. The version
+ *  must be increased whenever the file layout or the computation of the
+ *  distances changes. */
+static const uint32_t ARENA_CACHE_MAGIC   = 0x53544b41;   // "STKA"
+static const uint32_t ARENA_CACHE_VERSION = 1;
+
+ArenaGraph::PathBackend ArenaGraph::m_default_backend = ArenaGraph::PATH_DENSE;
+const float ArenaGraph::MAX_COMPACT_DISTANCE = 65504.0f;
+const float ArenaGraph::UNREACHABLE_DISTANCE = 9999.9f;
 
 // -----------------------------------------------------------------------------
 ArenaGraph::ArenaGraph(const std::string &navmesh, const XMLNode *node)
           : Graph()
 {
+    m_backend = PATH_DENSE;
     loadNavmesh(navmesh);
-    buildGraph();
-    // Compute shortest distance from all nodes
-    for (unsigned int i = 0; i < getNumNodes(); i++)
-        computeDijkstra(i);
+    buildSpatialIndex();
+
+    // Computing the shortest distance between all nodes is expensive for
+    // large navmeshes, so the result is cached, and only computed again
+    // if the navmesh has changed.
+    const uint64_t hash = computeNavmeshHash();
+    const std::string cache_file = getCacheFileName(navmesh);
+    if (!loadCache(cache_file, hash))
+    {
+        buildGraph();
+        computeAllDijkstra();
+        saveCache(cache_file, hash);
+    }
 
     setNearbyNodesOfAllNodes();
+    if (m_default_backend == PATH_COMPACT && !buildCompactPaths())
+    {
+        Log::warn("ArenaGraph", "Can't use compact paths for '%s', using "
+                  "dense matrices.", navmesh.c_str());
+    }
     if (node && race_manager->getMinorMode() == RaceManager::MINOR_MODE_SOCCER)
         loadGoalNodes(node);
 
@@ -179,8 +209,7 @@ void ArenaGraph::buildGraph()
 {
     const unsigned int n_nodes = getNumNodes();
 
-    m_distance_matrix = std::vector<std::vector<float>>
-        (n_nodes, std::vector<float>(n_nodes, 9999.9f));
+    m_distance_matrix.assign(n_nodes * n_nodes, UNREACHABLE_DISTANCE);
     for (unsigned int i = 0; i < n_nodes; i++)
     {
         ArenaNode* cur_node = getNode(i);
@@ -188,22 +217,21 @@ void ArenaGraph::buildGraph()
         {
             Vec3 diff = getNode(adjacent)->getCenter() - cur_node->getCenter();
             float distance = diff.length();
-            m_distance_matrix[i][adjacent] = distance;
+            m_distance_matrix[i * n_nodes + adjacent] = distance;
         }
-        m_distance_matrix[i][i] = 0.0f;
+        m_distance_matrix[i * n_nodes + i] = 0.0f;
     }
 
     // Allocate and initialise the previous node data structure:
-    m_parent_node = std::vector<std::vector<int16_t>>
-        (n_nodes, std::vector<int16_t>(n_nodes, Graph::UNKNOWN_SECTOR));
+    m_parent_node.assign(n_nodes * n_nodes, Graph::UNKNOWN_SECTOR);
     for (unsigned int i = 0; i < n_nodes; i++)
     {
         for (unsigned int j = 0; j < n_nodes; j++)
         {
-            if (i == j || m_distance_matrix[i][j] >= 9899.9f)
-                m_parent_node[i][j] = -1;
+            if (i == j || m_distance_matrix[i * n_nodes + j] >= 9899.9f)
+                m_parent_node[i * n_nodes + j] = -1;
             else
-                m_parent_node[i][j] = i;
+                m_parent_node[i * n_nodes + j] = i;
         }   // for j
     }   // for i
 
@@ -212,10 +240,11 @@ void ArenaGraph::buildGraph()
 // ----------------------------------------------------------------------------
 /** Dijkstra shortest path computation. It computes the shortest distance from
  *  the specified node 'source' to all other nodes. At the end of the
- *  computation, m_distance_matrix[i][j] stores the shortest path distance from
- *  source to j and m_parent_node[source][j] stores the last vertex visited on
- *  the shortest path from i to j before visiting j. Suppose the shortest path
- *  from i to j is i->......->k->j  then m_parent_node[i][j] = k
+ *  computation, m_distance_matrix[source*n+j] stores the shortest path
+ *  distance from source to j and m_parent_node[source*n+j] stores the last
+ *  vertex visited on the shortest path from source to j before visiting j.
+ *  Suppose the shortest path from i to j is i->......->k->j  then
+ *  m_parent_node[i*n+j] = k
  */
 void ArenaGraph::computeDijkstra(int source)
 {
@@ -251,12 +280,15 @@ void ArenaGraph::computeDijkstra(int source)
             // Distance already computed, can be ignored
             if (visited[adjacent]) continue;
 
-            float new_dist =
-                current.second + m_distance_matrix[cur_index][adjacent];
-            if (new_dist < m_distance_matrix[source][adjacent])
+            // Don't use m_distance_matrix[cur_index][adjacent], since this
+            // row might be modified by another thread at the same time.
+            Vec3 diff = getNode(adjacent)->getCenter()
+                      - getNode(cur_index)->getCenter();
+            float new_dist = current.second + diff.length();
+            if (new_dist < m_distance_matrix[source * n + adjacent])
             {
-                m_distance_matrix[source][adjacent] = new_dist;
-                m_parent_node[source][adjacent] = cur_index;
+                m_distance_matrix[source * n + adjacent] = new_dist;
+                m_parent_node[source * n + adjacent] = cur_index;
             }
             IndDistPair pair(adjacent, new_dist);
             queue.push(pair);
@@ -264,15 +296,159 @@ void ArenaGraph::computeDijkstra(int source)
     }
 }   // computeDijkstra
 
+// ----------------------------------------------------------------------------
+/** Computes the shortest distance from all nodes to all other nodes. Each
+ *  call to computeDijkstra() only modifies the row of its source node, so
+ *  the nodes are distributed over a WorkerPool.
+ */
+void ArenaGraph::computeAllDijkstra()
+{
+    const unsigned int n = getNumNodes();
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    num_threads = std::max(1u, std::min(num_threads, 8u));
+    num_threads = std::min(num_threads, n / 64 + 1);
+
+    WorkerPool pool(num_threads);
+    pool.run(n, [this](unsigned int i) { computeDijkstra(i); });
+}   // computeAllDijkstra
+
+// ----------------------------------------------------------------------------
+/** Returns a hash of all data that the shortest paths depend on, i.e. the
+ *  center of each node and its adjacent nodes.
+ */
+uint64_t ArenaGraph::computeNavmeshHash() const
+{
+    const uint32_t n = getNumNodes();
+    uint64_t hash = StringUtils::hashData(&n, sizeof(n));
+    for (unsigned int i = 0; i < n; i++)
+    {
+        ArenaNode *node = getNode(i);
+        const Vec3 &center = node->getCenter();
+        float xyz[3] = { center.getX(), center.getY(), center.getZ() };
+        hash = StringUtils::hashData(hash, xyz, sizeof(xyz));
+        const std::vector<int> &adjacent = node->getAdjacentNodes();
+        const uint32_t num_adjacent = (uint32_t)adjacent.size();
+        hash = StringUtils::hashData(hash, &num_adjacent,
+                                     sizeof(num_adjacent));
+        if (num_adjacent > 0)
+        {
+            hash = StringUtils::hashData(hash, adjacent.data(),
+                                         adjacent.size() * sizeof(int));
+        }
+    }
+    return hash;
+}   // computeNavmeshHash
+
+// ----------------------------------------------------------------------------
+/** Returns the name of the cache file for the given navmesh file. The name
+ *  is based on a hash of the full path, so each arena has its own file,
+ *  which is overwritten if the navmesh changes.
+ */
+std::string ArenaGraph::getCacheFileName(const std::string &navmesh)
+{
+    uint64_t hash = StringUtils::hashData(navmesh.c_str(), navmesh.size());
+    char name[64];
+    snprintf(name, sizeof(name), "navmesh-%016llx.cache",
+             (unsigned long long)hash);
+    return file_manager->getCacheDir() + name;
+}   // getCacheFileName
+
+// ----------------------------------------------------------------------------
+/** Loads the distance and parent node matrix from a cache file. The data
+ *  is stored in the native byte order, since the cache is only used on the
+ *  machine which created it.
+ *  \param filename Name of the cache file.
+ *  \param hash Hash of the current navmesh.
+ *  \return True if the cache was valid and loaded.
+ */
+bool ArenaGraph::loadCache(const std::string &filename, uint64_t hash)
+{
+    FILE *fd = fopen(filename.c_str(), "rb");
+    if (!fd) return false;
+
+    const unsigned int n = getNumNodes();
+    uint32_t magic = 0, version = 0, num_nodes = 0;
+    uint64_t file_hash = 0;
+    bool ok = fread(&magic,     sizeof(magic),     1, fd) == 1 &&
+              fread(&version,   sizeof(version),   1, fd) == 1 &&
+              fread(&file_hash, sizeof(file_hash), 1, fd) == 1 &&
+              fread(&num_nodes, sizeof(num_nodes), 1, fd) == 1 &&
+              magic == ARENA_CACHE_MAGIC && version == ARENA_CACHE_VERSION &&
+              file_hash == hash && num_nodes == n;
+    if (ok)
+    {
+        const size_t size = (size_t)n * n;
+        m_distance_matrix.resize(size);
+        m_parent_node.resize(size);
+        ok = fread(m_distance_matrix.data(), sizeof(float), size, fd) == size &&
+             fread(m_parent_node.data(), sizeof(int16_t), size, fd) == size;
+    }
+    fclose(fd);
+
+    if (!ok)
+    {
+        Log::info("ArenaGraph", "Navmesh cache '%s' is outdated.",
+                  filename.c_str());
+        m_distance_matrix.clear();
+        m_parent_node.clear();
+    }
+    return ok;
+}   // loadCache
+
+// ----------------------------------------------------------------------------
+/** Saves the distance and parent node matrix to a cache file. The data is
+ *  written to a temporary file first, so that an interrupted write can not
+ *  leave a damaged cache behind.
+ *  \param filename Name of the cache file.
+ *  \param hash Hash of the navmesh, used to detect outdated caches.
+ */
+void ArenaGraph::saveCache(const std::string &filename, uint64_t hash) const
+{
+    const std::string tmp = filename + ".part";
+    FILE *fd = fopen(tmp.c_str(), "wb");
+    if (!fd)
+    {
+        Log::warn("ArenaGraph", "Can't write navmesh cache '%s'.",
+                  tmp.c_str());
+        return;
+    }
+    const uint32_t n = getNumNodes();
+    bool ok = fwrite(&ARENA_CACHE_MAGIC,   sizeof(uint32_t), 1, fd) == 1 &&
+              fwrite(&ARENA_CACHE_VERSION, sizeof(uint32_t), 1, fd) == 1 &&
+              fwrite(&hash,                sizeof(hash),     1, fd) == 1 &&
+              fwrite(&n,                   sizeof(n),        1, fd) == 1;
+    const size_t size = (size_t)n * n;
+    ok = ok &&
+         fwrite(m_distance_matrix.data(), sizeof(float), size, fd) == size &&
+         fwrite(m_parent_node.data(), sizeof(int16_t), size, fd) == size;
+    ok = fclose(fd) == 0 && ok;
+    if (!ok)
+    {
+        Log::warn("ArenaGraph", "Error writing navmesh cache '%s'.",
+                  tmp.c_str());
+        file_manager->removeFile(tmp);
+        return;
+    }
+    // The behaviour of rename is unspecified if the target file should
+    // already exist - so remove it.
+    file_manager->removeFile(filename);
+    if (rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        Log::warn("ArenaGraph", "Can't rename navmesh cache to '%s'.",
+                  filename.c_str());
+        file_manager->removeFile(tmp);
+    }
+}   // saveCache
+
 // ----------------------------------------------------------------------------
 /** THIS FUNCTION IS ONLY USED FOR UNIT-TESTING, to verify that the new
  *  Dijkstra algorithm gives the same results.
  *  computeFloydWarshall() computes the shortest distance between any two
- *  nodes. At the end of the computation, m_distance_matrix[i][j] stores the
- *  shortest path distance from i to j and m_parent_node[i][j] stores the last
- *  vertex visited on the shortest path from i to j before visiting j. Suppose
- *  the shortest path from i to j is i->......->k->j  then
- *  m_parent_node[i][j] = k
+ *  nodes. At the end of the computation, m_distance_matrix[i*n+j] stores the
+ *  shortest path distance from i to j and m_parent_node[i*n+j] stores the
+ *  last vertex visited on the shortest path from i to j before visiting j.
+ *  Suppose the shortest path from i to j is i->......->k->j  then
+ *  m_parent_node[i*n+j] = k
  */
 void ArenaGraph::computeFloydWarshall()
 {
@@ -284,12 +460,12 @@ void ArenaGraph::computeFloydWarshall()
         {
             for (unsigned int j = 0; j < n; j++)
             {
-                if ((m_distance_matrix[i][k] + m_distance_matrix[k][j]) <
-                    m_distance_matrix[i][j])
+                if ((m_distance_matrix[i*n + k] + m_distance_matrix[k*n + j]) <
+                    m_distance_matrix[i*n + j])
                 {
-                    m_distance_matrix[i][j] =
-                        m_distance_matrix[i][k] + m_distance_matrix[k][j];
-                    m_parent_node[i][j] = m_parent_node[k][j];
+                    m_distance_matrix[i*n + j] =
+                        m_distance_matrix[i*n + k] + m_distance_matrix[k*n + j];
+                    m_parent_node[i*n + j] = m_parent_node[k*n + j];
                 }
             }
         }
@@ -336,12 +512,14 @@ void ArenaGraph::setNearbyNodesOfAllNodes()
 {
     // Only save the nearby 8 nodes
     const unsigned int try_count = 8;
-    for (unsigned int i = 0; i < getNumNodes(); i++)
+    const unsigned int n = getNumNodes();
+    for (unsigned int i = 0; i < n; i++)
     {
         // Get the distance to all nodes at i
         ArenaNode* cur_node = getNode(i);
         std::vector<int> nearby_nodes;
-        std::vector<float> dist = m_distance_matrix[i];
+        std::vector<float> dist(m_distance_matrix.begin() + i * n,
+                                m_distance_matrix.begin() + (i + 1) * n);
 
         // Skip the same node
         dist[i] = 999999.0f;
@@ -358,18 +536,86 @@ void ArenaGraph::setNearbyNodesOfAllNodes()
 
 }   // setNearbyNodesOfAllNodes
 
+// ----------------------------------------------------------------------------
+/** Converts the dense distance and parent node matrices into the compact
+ *  representation (see PATH_COMPACT), and frees the dense matrices. The
+ *  first hop from i to j is the parent of i on the path from j to i (since
+ *  the graph is undirected), stored as index into the adjacent nodes of i.
+ *  \return False if the graph can't be represented this way (if a node has
+ *          too many adjacent nodes), in which case the dense matrices are
+ *          kept.
+ */
+bool ArenaGraph::buildCompactPaths()
+{
+    const unsigned int n = getNumNodes();
+    m_adjacent_start.resize(n + 1);
+    m_adjacent_nodes.clear();
+    for (unsigned int i = 0; i < n; i++)
+    {
+        m_adjacent_start[i] = (uint32_t)m_adjacent_nodes.size();
+        const std::vector<int> &adjacent = getNode(i)->getAdjacentNodes();
+        if (adjacent.size() >= NO_HOP)
+        {
+            m_adjacent_start.clear();
+            m_adjacent_nodes.clear();
+            return false;
+        }
+        m_adjacent_nodes.insert(m_adjacent_nodes.end(), adjacent.begin(),
+                                adjacent.end());
+    }
+    m_adjacent_start[n] = (uint32_t)m_adjacent_nodes.size();
+
+    m_compact_distance.resize((size_t)n * n);
+    m_compact_next.resize((size_t)n * n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        const int16_t *begin = m_adjacent_nodes.data() + m_adjacent_start[i];
+        const int16_t *end   = m_adjacent_nodes.data() + m_adjacent_start[i+1];
+        for (unsigned int j = 0; j < n; j++)
+        {
+            // Store unreachable pairs as explicit value, so that they are
+            // read back exactly
+            const float d = m_distance_matrix[i * n + j];
+            m_compact_distance[i * n + j] = d >= UNREACHABLE_DISTANCE
+                ? COMPACT_UNREACHABLE
+                : MiniGLM::toFloat16(std::min(d, MAX_COMPACT_DISTANCE));
+            const int16_t next = m_parent_node[j * n + i];
+            const int16_t *hop = std::find(begin, end, next);
+            m_compact_next[i * n + j] =
+                hop == end ? NO_HOP : (uint8_t)(hop - begin);
+        }   // for j
+    }   // for i
+
+    std::vector<float>().swap(m_distance_matrix);
+    std::vector<int16_t>().swap(m_parent_node);
+    m_backend = PATH_COMPACT;
+    return true;
+}   // buildCompactPaths
+
+// ----------------------------------------------------------------------------
+/** Returns the number of bytes used to store the shortest paths. */
+size_t ArenaGraph::getPathMemory() const
+{
+    return m_distance_matrix.capacity()  * sizeof(float)
+         + m_parent_node.capacity()      * sizeof(int16_t)
+         + m_compact_distance.capacity() * sizeof(short)
+         + m_compact_next.capacity()     * sizeof(uint8_t)
+         + m_adjacent_start.capacity()   * sizeof(uint32_t)
+         + m_adjacent_nodes.capacity()   * sizeof(int16_t);
+}   // getPathMemory
+
 // ----------------------------------------------------------------------------
 /** Determines the full path from 'from' to 'to' and returns it in a
  *  std::vector (in reverse order). Used only for unit testing.
  */
 std::vector<int16_t> ArenaGraph::getPathFromTo(int from, int to,
-                      const std::vector< std::vector< int16_t > >& parent_node)
+                      const std::vector<int16_t>& parent_node, unsigned int n)
 {
     std::vector<int16_t> path;
     path.push_back(to);
     while(from!=to)
     {
-        to = parent_node[from][to];
+        to = parent_node[from * n + to];
         path.push_back(to);
     }
     return path;
@@ -387,14 +633,48 @@ void ArenaGraph::unitTesting()
     Track *track = track_manager->getTrack("cave");
     std::string navmesh_file_name=track->getTrackFile("navmesh.xml");
 
-    double s = StkTime::getRealTime();
+    // The constructor might load the results from the cache, so compute
+    // them again with Dijkstra
     ArenaGraph* ag = new ArenaGraph(navmesh_file_name);
+    ag->buildGraph();
+    double s = StkTime::getRealTime();
+    ag->computeAllDijkstra();
     double e = StkTime::getRealTime();
     Log::error("Time", "Dijkstra       %lf", e-s);
 
+    // Test that the cache restores the same data, and detects changes
+    const std::string cache_file = getCacheFileName("unit-testing");
+    ag->saveCache(cache_file, 1234);
+    ag->m_distance_matrix.clear();
+    ag->m_parent_node.clear();
+    bool cache_loaded = ag->loadCache(cache_file, 5678);
+    assert(!cache_loaded);
+    cache_loaded = ag->loadCache(cache_file, 1234);
+    assert(cache_loaded);
+    file_manager->removeFile(cache_file);
+
     // Save the Dijkstra results
-    std::vector< std::vector< float > > distance_matrix = ag->m_distance_matrix;
-    std::vector< std::vector< int16_t > > parent_node = ag->m_parent_node;
+    const unsigned int n = ag->getNumNodes();
+    std::vector<float> distance_matrix = ag->m_distance_matrix;
+    std::vector<int16_t> parent_node = ag->m_parent_node;
+
+    // The compact paths must give the same next nodes, and distances
+    // within the precision of a half float
+    bool compact = ag->buildCompactPaths();
+    assert(compact);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = 0; j < n; j++)
+        {
+            assert(ag->getNextNode(i, j) == parent_node[j * n + i]);
+            float d = distance_matrix[i * n + j];
+            if (d >= UNREACHABLE_DISTANCE)
+                assert(ag->getDistance(i, j) == d);
+            else
+                assert(fabsf(ag->getDistance(i, j) - d) <= d / 1000.0f);
+        }
+    }
+    ag->m_backend = PATH_DENSE;
     ag->buildGraph();
 
     // Now compute results with Floyd-Warshall
@@ -404,15 +684,16 @@ void ArenaGraph::unitTesting()
     Log::error("Time", "Floyd-Warshall %lf", e-s);
 
     int error_count = 0;
-    for(unsigned int i=0; i<ag->m_distance_matrix.size(); i++)
+    for(unsigned int i=0; i<n; i++)
     {
-        for(unsigned int j=0; j<ag->m_distance_matrix[i].size(); j++)
+        for(unsigned int j=0; j<n; j++)
         {
-            if(ag->m_distance_matrix[i][j] - distance_matrix[i][j] > 0.001f)
+            if(ag->m_distance_matrix[i*n+j] - distance_matrix[i*n+j] > 0.001f)
             {
                 Log::error("ArenaGraph",
                            "Incorrect distance %d, %d: Dijkstra: %f F.W.: %f",
-                           i, j, distance_matrix[i][j], ag->m_distance_matrix[i][j]);
+                           i, j, distance_matrix[i*n+j],
+                           ag->m_distance_matrix[i*n+j]);
                 error_count++;
             }    // if distance is too different
 
@@ -424,16 +705,16 @@ void ArenaGraph::unitTesting()
             // debugging in the feature
 #undef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
 #ifdef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
-            if(ag->m_parent_node[i][j] != parent_node[i][j])
+            if(ag->m_parent_node[i*n+j] != parent_node[i*n+j])
             {
                 error_count++;
-                std::vector<int16_t> dijkstra_path = getPathFromTo(i, j, parent_node);
-                std::vector<int16_t> floyd_path = getPathFromTo(i, j, ag->m_parent_node);
+                std::vector<int16_t> dijkstra_path = getPathFromTo(i, j, parent_node, n);
+                std::vector<int16_t> floyd_path = getPathFromTo(i, j, ag->m_parent_node, n);
                 if(dijkstra_path.size()!=floyd_path.size())
                 {
                     Log::error("ArenaGraph",
                                "Incorrect path length %d, %d: Dijkstra: %d F.W.: %d",
-                               i, j, parent_node[i][j], ag->m_parent_node[i][j]);
+                               i, j, parent_node[i*n+j], ag->m_parent_node[i*n+j]);
                     continue;
                 }
                 Log::error("ArenaGraph", "Path problems from %d to %d:",
@@ -451,6 +732,109 @@ void ArenaGraph::unitTesting()
         }   // for j
     }   // for i
 
+    // The spatial index must give the same results as testing all quads.
+    // Use points in and around the arena, with random previous sectors.
+    const Vec3 &bb_min = ag->getBBMin();
+    const Vec3 &bb_max = ag->getBBMax();
+    const unsigned int num_points = 10000;
+    std::vector<Vec3> points(num_points);
+    std::vector<int> prev(num_points), sector(num_points),
+                     out_sector(num_points);
+    // A local generator, so the global random state is not modified
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> random_f(-0.1f, 1.1f);
+    std::uniform_int_distribution<int> random_sector(-1, (int)n - 1);
+    for (unsigned int i = 0; i < num_points; i++)
+    {
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            float f = random_f(random);
+            points[i][k] = bb_min[k] + f * (bb_max[k] - bb_min[k]);
+        }
+        prev[i] = random_sector(random);
+        sector[i] = prev[i];
+        ag->findRoadSector(points[i], &sector[i], NULL, i % 2 == 0);
+        out_sector[i] = ag->findOutOfRoadSector(points[i], prev[i], NULL,
+                                                i % 2 == 0);
+    }   // for i < num_points
+
+    ag->clearSpatialIndex();
+    int index_errors = 0;
+    for (unsigned int i = 0; i < num_points; i++)
+    {
+        int linear_sector = prev[i];
+        ag->findRoadSector(points[i], &linear_sector, NULL, i % 2 == 0);
+        int linear_out_sector = ag->findOutOfRoadSector(points[i], prev[i],
+                                                        NULL, i % 2 == 0);
+        if (sector[i] != linear_sector || out_sector[i] != linear_out_sector)
+        {
+            Log::error("ArenaGraph", "Spatial index differs at %f %f %f: "
+                       "%d/%d %d/%d", points[i].getX(), points[i].getY(),
+                       points[i].getZ(), sector[i], linear_sector,
+                       out_sector[i], linear_out_sector);
+            index_errors++;
+        }
+    }   // for i < num_points
+    ag->buildSpatialIndex();
+    assert(index_errors == 0);
+
     delete ag;
 
 }   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Compares the path backends for all arenas and soccer fields: it prints
+ *  the time to load the graph, the memory used for the shortest paths, and
+ *  the average time of a getNextNode() and getDistance() query.
+ */
+void ArenaGraph::runBenchmark()
+{
+    const PathBackend old_backend = m_default_backend;
+    const unsigned int num_queries = 1000000;
+    const char *names[] = { "dense", "compact" };
+
+    Log::info("ArenaGraph", "%-20s %-8s %6s %10s %10s %10s", "track",
+              "backend", "nodes", "load ms", "KB", "query ns");
+    for (unsigned int t = 0; t < track_manager->getNumberOfTracks(); t++)
+    {
+        Track *track = track_manager->getTrack(t);
+        if (!track->isArena() && !track->isSoccer()) continue;
+        std::string navmesh = track->getTrackFile("navmesh.xml");
+        if (!file_manager->fileExists(navmesh)) continue;
+
+        for (int b = PATH_DENSE; b <= PATH_COMPACT; b++)
+        {
+            m_default_backend = (PathBackend)b;
+            double start = StkTime::getRealTime();
+            ArenaGraph *ag = new ArenaGraph(navmesh);
+            double load = StkTime::getRealTime() - start;
+
+            // Use the same pseudo-random queries for each backend
+            const unsigned int n = ag->getNumNodes();
+            uint32_t seed = 12345;
+            float sum = 0;
+            start = StkTime::getRealTime();
+            for (unsigned int i = 0; n > 0 && i < num_queries; i++)
+            {
+                seed = seed * 1664525 + 1013904223;
+                int from = (seed >> 8) % n;
+                seed = seed * 1664525 + 1013904223;
+                int to = (seed >> 8) % n;
+                sum += ag->getDistance(from, to) + ag->getNextNode(from, to);
+            }
+            double query = StkTime::getRealTime() - start;
+
+            Log::info("ArenaGraph", "%-20s %-8s %6d %10.2f %10.1f %10.2f",
+                      track->getIdent().c_str(),
+                      names[ag->getPathBackend()], n, load * 1000.0,
+                      ag->getPathMemory() / 1024.0,
+                      query * 1.0e9 / num_queries);
+            // Make sure the queries are not optimised away
+            if (sum == -1.0f)
+                Log::verbose("ArenaGraph", "%f", sum);
+            delete ag;
+        }   // for b <= PATH_COMPACT
+    }   // for t < getNumberOfTracks
+
+    m_default_backend = old_backend;
+}   // runBenchmark
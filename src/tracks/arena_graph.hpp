@@ -21,6 +21,8 @@
 
 #include "tracks/graph.hpp"
 #include "utils/cpp2011.hpp"
+#include "utils/mini_glm.hpp"
+#include "utils/types.hpp"
 
 #include <set>
 
@@ -33,12 +35,62 @@ class XMLNode;
  */
 class ArenaGraph : public Graph
 {
+public:
+    /** How the shortest paths between all nodes are stored. */
+    enum PathBackend
+    {
+        /** A float distance and an int16_t parent node for each pair of
+         *  nodes, stored in two contiguous matrices. */
+        PATH_DENSE,
+        /** A half float distance and one byte first hop (the index into the
+         *  adjacent nodes of the start node) for each pair, which uses half
+         *  the memory of the dense matrices. */
+        PATH_COMPACT
+    };
+
 private:
-    /** The actual graph data structure, it is an adjacency matrix. */
-    std::vector<std::vector<float>> m_distance_matrix;
+    /** The backend used for newly loaded graphs. */
+    static PathBackend m_default_backend;
+
+    /** The backend used by this graph. */
+    PathBackend m_backend;
+
+    /** The actual graph data structure, it is an adjacency matrix. The
+     *  distance from i to j is at index i*n+j. Only used by PATH_DENSE
+     *  (and while computing the paths). */
+    std::vector<float> m_distance_matrix;
+
+    /** The matrix that is used to store computed shortest paths: the parent
+     *  of j on the path from i to j is at index i*n+j. Only used by
+     *  PATH_DENSE (and while computing the paths). */
+    std::vector<int16_t> m_parent_node;
+
+    /** PATH_COMPACT: the distance from i to j as half float at i*n+j. */
+    std::vector<short> m_compact_distance;
+
+    /** PATH_COMPACT: the next node on the path from i to j, as index into
+     *  the adjacent nodes of i (stored at i*n+j), or NO_HOP. */
+    std::vector<uint8_t> m_compact_next;
+
+    /** PATH_COMPACT: the adjacent nodes of node i are stored in
+     *  m_adjacent_nodes from index m_adjacent_start[i] on. */
+    std::vector<uint32_t> m_adjacent_start;
+
+    /** PATH_COMPACT: the adjacent nodes of all nodes. */
+    std::vector<int16_t> m_adjacent_nodes;
+
+    /** Value in m_compact_next if there is no next node. */
+    static const uint8_t NO_HOP = 0xff;
+
+    /** Value in m_compact_distance if there is no path between two nodes
+     *  (half float infinity). */
+    static const short COMPACT_UNREACHABLE = 0x7c00;
 
-    /** The matrix that is used to store computed shortest paths. */
-    std::vector<std::vector<int16_t>> m_parent_node;
+    /** Largest finite half float, longer distances are clamped to it. */
+    static const float MAX_COMPACT_DISTANCE;
+
+    /** Distance between two nodes if there is no path between them. */
+    static const float UNREACHABLE_DISTANCE;
 
     /** Used in soccer mode to colorize the goal lines in minimap. */
     std::set<int> m_red_node;
@@ -56,10 +108,22 @@ private:
     // ------------------------------------------------------------------------
     void computeDijkstra(int n);
     // ------------------------------------------------------------------------
+    void computeAllDijkstra();
+    // ------------------------------------------------------------------------
+    uint64_t computeNavmeshHash() const;
+    // ------------------------------------------------------------------------
+    static std::string getCacheFileName(const std::string &navmesh);
+    // ------------------------------------------------------------------------
+    bool loadCache(const std::string &filename, uint64_t hash);
+    // ------------------------------------------------------------------------
+    void saveCache(const std::string &filename, uint64_t hash) const;
+    // ------------------------------------------------------------------------
+    bool buildCompactPaths();
+    // ------------------------------------------------------------------------
     void computeFloydWarshall();
     // ------------------------------------------------------------------------
     static std::vector<int16_t> getPathFromTo(int from, int to,
-                     const std::vector< std::vector< int16_t > >& parent_node);
+                     const std::vector<int16_t>& parent_node, unsigned int n);
     // ------------------------------------------------------------------------
     virtual bool hasLapLine() const OVERRIDE                  { return false; }
     // ------------------------------------------------------------------------
@@ -70,6 +134,12 @@ public:
     // ------------------------------------------------------------------------
     static void unitTesting();
     // ------------------------------------------------------------------------
+    static void runBenchmark();
+    // ------------------------------------------------------------------------
+    /** Sets the backend used to store the shortest paths of arenas loaded
+     *  from now on. */
+    static void setDefaultBackend(PathBackend b)    { m_default_backend = b; }
+    // ------------------------------------------------------------------------
     ArenaGraph(const std::string &navmesh, const XMLNode *node = NULL);
     // ------------------------------------------------------------------------
     virtual ~ArenaGraph() {}
@@ -84,7 +154,12 @@ public:
     {
         if (i == Graph::UNKNOWN_SECTOR || j == Graph::UNKNOWN_SECTOR)
             return Graph::UNKNOWN_SECTOR;
-        return (int)(m_parent_node[j][i]);
+        if (m_backend == PATH_DENSE)
+            return (int)(m_parent_node[j * getNumNodes() + i]);
+        uint8_t hop = m_compact_next[i * getNumNodes() + j];
+        if (hop == NO_HOP)
+            return -1;
+        return (int)(m_adjacent_nodes[m_adjacent_start[i] + hop]);
     }
     // ------------------------------------------------------------------------
     /** Returns the distance between any two nodes */
@@ -92,8 +167,18 @@ public:
     {
         if (from == Graph::UNKNOWN_SECTOR || to == Graph::UNKNOWN_SECTOR)
             return 99999.0f;
-        return m_distance_matrix[from][to];
+        if (m_backend == PATH_DENSE)
+            return m_distance_matrix[from * getNumNodes() + to];
+        const short d = m_compact_distance[from * getNumNodes() + to];
+        if (d == COMPACT_UNREACHABLE)
+            return UNREACHABLE_DISTANCE;
+        return MiniGLM::toFloat32(d);
     }
+    // ------------------------------------------------------------------------
+    /** Returns the backend used to store the shortest paths. */
+    PathBackend getPathBackend() const { return m_backend; }
+    // ------------------------------------------------------------------------
+    size_t getPathMemory() const;
 
 };   // ArenaGraph
 
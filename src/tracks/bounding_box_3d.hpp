@@ -78,6 +78,21 @@ public:
         }
         return true;
     }
+    // ------------------------------------------------------------------------
+    /** Returns the axis aligned bounding box of this box. */
+    void getAABB(Vec3 *min, Vec3 *max) const
+    {
+        *min = m_box_faces[0][0];
+        *max = m_box_faces[0][0];
+        for (unsigned int i = 0; i < 6; i++)
+        {
+            for (unsigned int j = 0; j < 4; j++)
+            {
+                min->min(m_box_faces[i][j]);
+                max->max(m_box_faces[i][j]);
+            }
+        }
+    }   // getAABB
 
 };
 
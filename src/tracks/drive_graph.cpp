@@ -237,6 +237,7 @@ void DriveGraph::load(const std::string &quad_file_name,
         }   // incorrect specification
     }
     delete xml;
+    buildSpatialIndex();
 
     setDefaultSuccessors();
     computeDistanceFromStart(getStartNode(), 0.0f);
@@ -27,11 +27,14 @@
 #include "graphics/sp/sp_mesh_buffer.hpp"
 #include "modes/profile_world.hpp"
 #include "tracks/arena_node_3d.hpp"
+#include "tracks/bounding_box_3d.hpp"
 #include "tracks/drive_node_2d.hpp"
 #include "tracks/drive_node_3d.hpp"
 #include "tracks/track.hpp"
 #include "utils/log.hpp"
 
+#include <algorithm>
+
 const int Graph::UNKNOWN_SECTOR = -1;
 const float Graph::MIN_HEIGHT_TESTING = -1.0f;
 const float Graph::MAX_HEIGHT_TESTING = 5.0f;
@@ -47,6 +50,11 @@ Graph::Graph()
     m_bb_min      = Vec3( 99999,  99999,  99999);
     m_bb_max      = Vec3(-99999, -99999, -99999);
     memset(m_bb_nodes, 0, 4 * sizeof(int));
+    m_grid_min_x     = 0;
+    m_grid_min_z     = 0;
+    m_grid_cell_size = 1.0f;
+    m_grid_width     = 0;
+    m_grid_height    = 0;
 }  // Graph
 
 // -----------------------------------------------------------------------------
@@ -578,6 +586,34 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
     // the current one
     int indx       = *sector;
 
+    // The linear search below returns the first quad (starting after the
+    // previous sector) that contains the point. Only the quads in the grid
+    // cell of the point can contain it, so test those, and use the same
+    // order to get identical results.
+    if (!all_sectors && !m_grid_start.empty())
+    {
+        *sector = UNKNOWN_SECTOR;
+        int x, z;
+        if (!getGridCell(xyz, &x, &z))
+            return;
+        const int n     = (int)m_all_nodes.size();
+        const int first = indx < n - 1 ? indx + 1 : 0;
+        int min_key     = n;
+        const unsigned int cell = z * m_grid_width + x;
+        for (unsigned int i = m_grid_start[cell]; i < m_grid_start[cell + 1];
+             i++)
+        {
+            const int q = m_grid_quads[i];
+            const int key = (q - first + n) % n;
+            if (key < min_key && getQuad(q)->pointInside(xyz, ignore_vertical))
+            {
+                min_key = key;
+                *sector = q;
+            }
+        }   // for i in cell
+        return;
+    }   // if spatial index
+
     // If a current sector is given, and max_lookahead is specify, only test
     // the next max_lookahead quads instead of testing the whole graph.
     // This is necessary for the AI: if the track contains a loop, e.g.:
@@ -664,6 +700,17 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
         if(current_sector<0) current_sector += getNumNodes();
     }
 
+    if (!all_sectors && !m_grid_start.empty())
+    {
+        int sector = findOutOfRoadSectorInGrid(xyz,
+                                               (current_sector + 1) % count,
+                                               ignore_vertical);
+        if (sector != UNKNOWN_SECTOR)
+            return sector;
+        // Otherwise the point is outside of the grid, or no quad fulfills
+        // the height condition: use the linear search.
+    }
+
     int   min_sector = UNKNOWN_SECTOR;
     float min_dist_2 = 999999.0f*999999.0f;
 
@@ -721,6 +768,191 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
     return min_sector;
 }   // findOutOfRoadSector
 
+//-----------------------------------------------------------------------------
+/** Does the same as the first phase of findOutOfRoadSector (i.e. with the
+ *  height condition), but using the spatial index: the grid cells are
+ *  tested in rings of increasing distance around the point, until no quad
+ *  in the remaining cells can be closer than the closest quad found. The
+ *  distance of a quad is at least the 2d distance to its bounding box. If
+ *  two quads have the same distance, the one that comes first in the order
+ *  used by the linear search is used.
+ *  \param xyz The point to search the closest quad for.
+ *  \param first The quad that is tested first by the linear search.
+ *  \param ignore_vertical If the height condition is ignored.
+ *  \return The closest quad, or UNKNOWN_SECTOR if the point is outside of
+ *          the grid or no quad fulfills the height condition.
+ */
+int Graph::findOutOfRoadSectorInGrid(const Vec3 &xyz, int first,
+                                     bool ignore_vertical) const
+{
+    int cx, cz;
+    if (!getGridCell(xyz, &cx, &cz))
+        return UNKNOWN_SECTOR;
+
+    const int n      = (int)m_all_nodes.size();
+    int   min_sector = UNKNOWN_SECTOR;
+    int   min_key    = n;
+    float min_dist_2 = 999999.0f*999999.0f;
+    const int max_ring = std::max(m_grid_width, m_grid_height);
+    for (int r = 0; r <= max_ring; r++)
+    {
+        // All quads not tested yet are at least (r-1) cells away
+        if (min_sector != UNKNOWN_SECTOR && r > 1)
+        {
+            float bound = (r - 1) * m_grid_cell_size;
+            if (bound * bound > min_dist_2)
+                break;
+        }
+        for (int z = std::max(cz - r, 0);
+             z <= std::min(cz + r, m_grid_height - 1); z++)
+        {
+            // Only the cells at the border of the ring, the inner cells
+            // were done in earlier rings.
+            const bool border = z == cz - r || z == cz + r;
+            const int step    = border ? 1 : 2 * r;
+            for (int x = cx - r; x <= cx + r; x += std::max(step, 1))
+            {
+                if (x < 0 || x >= m_grid_width) continue;
+                const unsigned int cell = z * m_grid_width + x;
+                for (unsigned int i = m_grid_start[cell];
+                     i < m_grid_start[cell + 1]; i++)
+                {
+                    const int sector = m_grid_quads[i];
+                    const Quad *q = getQuad(sector);
+                    if (q->isIgnored()) continue;
+                    float dist_2 =
+                        m_all_nodes[sector]->getDistance2FromPoint(xyz);
+                    if (dist_2 > min_dist_2) continue;
+                    const int key = (sector - first + n) % n;
+                    if (dist_2 == min_dist_2 && key >= min_key) continue;
+                    // Same height condition as in findOutOfRoadSector
+                    float dist = xyz.getY() - q->getMinHeight();
+                    if ((dist < 5.0f && dist > -1.0f) || q->is3DQuad() ||
+                        ignore_vertical)
+                    {
+                        min_dist_2 = dist_2;
+                        min_sector = sector;
+                        min_key    = key;
+                    }
+                }   // for i in cell
+            }   // for x
+        }   // for z
+    }   // for r <= max_ring
+    return min_sector;
+}   // findOutOfRoadSectorInGrid
+
+//-----------------------------------------------------------------------------
+/** Returns the 2d bounding box (in the XZ plane) of all points for which
+ *  pointInside of a quad can be true. Some margin is added to allow for
+ *  rounding errors.
+ */
+void Graph::getQuadAABB(unsigned int n, Vec3 *min, Vec3 *max) const
+{
+    const Quad *q = getQuad(n);
+    const BoundingBox3D *box = q->is3DQuad()
+                             ? dynamic_cast<const BoundingBox3D*>(q)
+                             : NULL;
+    if (box)
+    {
+        box->getAABB(min, max);
+    }
+    else
+    {
+        *min = (*q)[0];
+        *max = (*q)[0];
+        for (unsigned int i = 1; i < 4; i++)
+        {
+            min->min((*q)[i]);
+            max->max((*q)[i]);
+        }
+    }
+    *min -= Vec3(0.01f, 0.01f, 0.01f);
+    *max += Vec3(0.01f, 0.01f, 0.01f);
+}   // getQuadAABB
+
+//-----------------------------------------------------------------------------
+/** Determines the grid cell of a point.
+ *  \return False if the point is outside of the grid.
+ */
+bool Graph::getGridCell(const Vec3 &xyz, int *x, int *z) const
+{
+    float fx = (xyz.getX() - m_grid_min_x) / m_grid_cell_size;
+    float fz = (xyz.getZ() - m_grid_min_z) / m_grid_cell_size;
+    if (!(fx >= 0 && fz >= 0 && fx < m_grid_width && fz < m_grid_height))
+        return false;
+    *x = (int)fx;
+    *z = (int)fz;
+    return true;
+}   // getGridCell
+
+//-----------------------------------------------------------------------------
+/** Builds a uniform grid in the XZ plane over all quads, which is used in
+ *  findRoadSector and findOutOfRoadSector to only test the quads close to
+ *  a point instead of all quads. Each quad is added to all cells that its
+ *  bounding box overlaps. Must be called after all quads are created.
+ */
+void Graph::buildSpatialIndex()
+{
+    clearSpatialIndex();
+    const unsigned int n = getNumNodes();
+    if (n == 0) return;
+
+    std::vector<Vec3> all_min(n), all_max(n);
+    Vec3 grid_min( 999999.0f,  999999.0f,  999999.0f);
+    Vec3 grid_max(-999999.0f, -999999.0f, -999999.0f);
+    float total_size = 0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        getQuadAABB(i, &all_min[i], &all_max[i]);
+        grid_min.min(all_min[i]);
+        grid_max.max(all_max[i]);
+        total_size += all_max[i].getX() - all_min[i].getX()
+                    + all_max[i].getZ() - all_min[i].getZ();
+    }
+
+    // A cell should have about the size of an average quad, but limit the
+    // number of cells on large tracks.
+    const int MAX_CELLS = 256;
+    float size = std::max(grid_max.getX() - grid_min.getX(),
+                          grid_max.getZ() - grid_min.getZ());
+    m_grid_cell_size = std::max(total_size / (2 * n),
+                                size / (MAX_CELLS - 1));
+    m_grid_cell_size = std::max(m_grid_cell_size, 0.1f);
+    m_grid_min_x  = grid_min.getX();
+    m_grid_min_z  = grid_min.getZ();
+    m_grid_width  = std::min(MAX_CELLS, (int)((grid_max.getX() - m_grid_min_x)
+                                              / m_grid_cell_size) + 1);
+    m_grid_height = std::min(MAX_CELLS, (int)((grid_max.getZ() - m_grid_min_z)
+                                              / m_grid_cell_size) + 1);
+
+    // First count the quads per cell, then fill in the quads
+    std::vector<int> x0(n), x1(n), z0(n), z1(n);
+    m_grid_start.assign(m_grid_width * m_grid_height + 1, 0);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        float s = 1.0f / m_grid_cell_size;
+        x0[i] = std::min(int((all_min[i].getX()-m_grid_min_x)*s), m_grid_width -1);
+        x1[i] = std::min(int((all_max[i].getX()-m_grid_min_x)*s), m_grid_width -1);
+        z0[i] = std::min(int((all_min[i].getZ()-m_grid_min_z)*s), m_grid_height-1);
+        z1[i] = std::min(int((all_max[i].getZ()-m_grid_min_z)*s), m_grid_height-1);
+        for (int z = z0[i]; z <= z1[i]; z++)
+            for (int x = x0[i]; x <= x1[i]; x++)
+                m_grid_start[z * m_grid_width + x + 1]++;
+    }
+    for (unsigned int i = 1; i < m_grid_start.size(); i++)
+        m_grid_start[i] += m_grid_start[i - 1];
+
+    // Quads are added in increasing order to each cell
+    std::vector<unsigned int> next(m_grid_start.begin(), m_grid_start.end()-1);
+    m_grid_quads.resize(m_grid_start.back());
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (int z = z0[i]; z <= z1[i]; z++)
+            for (int x = x0[i]; x <= x1[i]; x++)
+                m_grid_quads[next[z * m_grid_width + x]++] = i;
+    }
+}   // buildSpatialIndex
+
 //-----------------------------------------------------------------------------
 void Graph::loadBoundingBoxNodes()
 {
@@ -66,6 +66,11 @@ protected:
     // ------------------------------------------------------------------------
     /** Map 4 bounding box points to 4 closest graph nodes. */
     void loadBoundingBoxNodes();
+    // ------------------------------------------------------------------------
+    void buildSpatialIndex();
+    // ------------------------------------------------------------------------
+    /** Removes the spatial index, so all quads are tested linearly again. */
+    void clearSpatialIndex()       { m_grid_start.clear(); m_grid_quads.clear(); }
 
 private:
     /** The 2d bounding box, used for hashing. */
@@ -75,6 +80,24 @@ private:
     /** The 4 closest graph nodes to the bounding box. */
     int m_bb_nodes[4];
 
+    /** The spatial index is a uniform grid in the XZ plane. This is the
+     *  position of the lower corner of the grid. */
+    float m_grid_min_x, m_grid_min_z;
+
+    /** Size of a grid cell. */
+    float m_grid_cell_size;
+
+    /** Number of cells in X and Z direction. */
+    int m_grid_width, m_grid_height;
+
+    /** The quads overlapping grid cell i are stored in m_grid_quads from
+     *  index m_grid_start[i] to m_grid_start[i+1]. Empty if there is no
+     *  spatial index. */
+    std::vector<unsigned int> m_grid_start;
+
+    /** The indices of all quads in all grid cells. */
+    std::vector<int> m_grid_quads;
+
     /** The node of the graph mesh. */
     scene::ISceneNode *m_node;
 
@@ -104,6 +127,13 @@ private:
     virtual bool hasLapLine() const = 0;
     // ------------------------------------------------------------------------
     virtual void differentNodeColor(int n, video::SColor* c) const = 0;
+    // ------------------------------------------------------------------------
+    void getQuadAABB(unsigned int n, Vec3 *min, Vec3 *max) const;
+    // ------------------------------------------------------------------------
+    bool getGridCell(const Vec3 &xyz, int *x, int *z) const;
+    // ------------------------------------------------------------------------
+    int findOutOfRoadSectorInGrid(const Vec3 &xyz, int first,
+                                  bool ignore_vertical) const;
 
 public:
     static const int UNKNOWN_SECTOR;
@@ -85,13 +85,21 @@
 #include <SMeshBuffer.h>
 
 #include <iostream>
+#include <set>
 #include <stdexcept>
 #include <sstream>
+#include <stdio.h>
 #include <wchar.h>
 
 using namespace irr;
 
 
+/** Magic number and version of the physics cache files. The version must
+ *  be increased whenever the file layout or the conversion of the track
+ *  into physics changes. */
+static const uint32_t TRACK_CACHE_MAGIC   = 0x53544b54;   // "STKT"
+static const uint32_t TRACK_CACHE_VERSION = 1;
+
 const float Track::NOHIT               = -99999.9f;
 bool        Track::m_dont_load_navmesh = false;
 Track      *Track::m_current_track = NULL;
@@ -790,19 +798,15 @@ void Track::mapPoint2MiniMap(const Vec3 &xyz, Vec3 *draw_at) const
 }
 // -----------------------------------------------------------------------------
 /** Convert the track tree into its physics equivalents.
- *  \param main_track_count The number of meshes that are already converted
- *         when the main track was converted. Only the additional meshes
- *         added later still need to be converted.
+ *  \param main_track_count The number of meshes that belong to the main
+ *         track. Their vertex buffers were already uploaded when the main
+ *         track was loaded.
  */
 void Track::createPhysicsModel(unsigned int main_track_count)
 {
-    // Remove the temporary track rigid body, and then convert all objects
-    // (i.e. the track and all additional objects) into a new rigid body
-    // and convert this again. So this way we have an optimised track
-    // rigid body which includes all track objects.
-    // Note that removing the rigid body does not remove the already collected
-    // triangle information, so there is no need to convert the actual track
-    // (first element in m_track_mesh) again!
+    // Convert all objects (i.e. the track and all additional objects) into
+    // one rigid body. So this way we have an optimised track rigid body
+    // which includes all track objects.
 
     if (m_track_mesh == NULL)
     {
@@ -812,11 +816,36 @@ void Track::createPhysicsModel(unsigned int main_track_count)
     }
 
 
-    // Now convert all objects that are only used for the physics
-    // (like invisible walls).
+    // All nodes that are converted, in the order in which their triangles
+    // are added: the main track, objects that are only used for the physics
+    // (like invisible walls), and all additional objects.
+    std::vector<scene::ISceneNode*> nodes(m_all_nodes.begin(),
+                                          m_all_nodes.begin()+main_track_count);
+    nodes.insert(nodes.end(), m_static_physics_only_nodes.begin(),
+                 m_static_physics_only_nodes.end());
+    nodes.insert(nodes.end(), m_object_physics_only_nodes.begin(),
+                 m_object_physics_only_nodes.end());
+    nodes.insert(nodes.end(), m_all_nodes.begin()+main_track_count,
+                 m_all_nodes.end());
+
+    m_track_mesh->removeAll();
+    m_gfx_effect_mesh->removeAll();
+
+    // Converting all nodes and building the bvh takes a long time for big
+    // tracks, so the result is cached, and only computed again if any file
+    // of the track or any of the converted nodes changes.
+    const uint64_t hash = computePhysicsHash(nodes);
+    const std::string cache_file = getPhysicsCacheFileName();
+    const bool cache_loaded = loadPhysicsCache(cache_file, hash);
+    if (!cache_loaded)
+    {
+        for (unsigned int i = 0; i < nodes.size(); i++)
+            convertTrackToBullet(nodes[i]);
+    }
+
+    // Now remove all objects that are only used for the physics.
     for (unsigned int i = 0; i<m_static_physics_only_nodes.size(); i++)
     {
-        convertTrackToBullet(m_static_physics_only_nodes[i]);
         if (UserConfigParams::m_physics_debug &&
             m_static_physics_only_nodes[i]->getType() == scene::ESNT_MESH)
         {
@@ -840,23 +869,201 @@ void Track::createPhysicsModel(unsigned int main_track_count)
 
     for (unsigned int i = 0; i<m_object_physics_only_nodes.size(); i++)
     {
-        convertTrackToBullet(m_object_physics_only_nodes[i]);
         m_object_physics_only_nodes[i]->setVisible(false);
         m_object_physics_only_nodes[i]->grab();
         irr_driver->removeNode(m_object_physics_only_nodes[i]);
     }
 
-    m_track_mesh->removeAll();
-    m_gfx_effect_mesh->removeAll();
     for(unsigned int i=main_track_count; i<m_all_nodes.size(); i++)
     {
-        convertTrackToBullet(m_all_nodes[i]);
         uploadNodeVertexBuffer(m_all_nodes[i]);
     }
     m_track_mesh->createPhysicalBody(m_friction);
     m_gfx_effect_mesh->createCollisionShape();
+    if (!cache_loaded)
+        savePhysicsCache(cache_file, hash);
 }   // createPhysicsModel
 
+// ----------------------------------------------------------------------------
+/** Returns a hash of all data that the converted physics meshes depend on:
+ *  the files of the track and the global material definitions, the
+ *  settings used in the conversion, and for each node its type, transform,
+ *  the mesh file and the layout of its mesh buffers. Files are only
+ *  compared by modification time and size, they are not read.
+ *  \param nodes The nodes that are converted.
+ */
+uint64_t Track::computePhysicsHash(const std::vector<scene::ISceneNode*> &nodes)
+{
+    const float smooth_angle_limit = stk_config->m_smooth_angle_limit;
+    uint64_t hash = StringUtils::hashData(&smooth_angle_limit,
+                                          sizeof(smooth_angle_limit));
+    // The layout changes the serialized bvh
+    const bool compact = TriangleMesh::useCompactLayout();
+    hash = StringUtils::hashData(hash, &compact, sizeof(compact));
+#ifndef SERVER_ONLY
+    // Materials are taken from different places with and without shaders
+    const bool is_glsl = CVS->isGLSL();
+    hash = StringUtils::hashData(hash, &is_glsl, sizeof(is_glsl));
+#endif
+
+    std::set<std::string> files;
+    file_manager->listFiles(files, m_root, /*make_full_path*/true);
+    files.insert(file_manager->getAsset(FileManager::TEXTURE,
+                                        "materials.xml"));
+    files.insert(file_manager->getAsset(FileManager::MODEL, "materials.xml"));
+
+    scene::IMeshCache *mesh_cache =
+        irr_driver->getSceneManager()->getMeshCache();
+    for (unsigned int i = 0; i < nodes.size(); i++)
+    {
+        scene::ISceneNode *node = nodes[i];
+        if (node->getType() == scene::ESNT_LOD_NODE)
+        {
+            node = ((LODNode*)node)->getFirstNode();
+            if (!node) continue;
+        }
+        const int type = node->getType();
+        hash = StringUtils::hashData(hash, &type, sizeof(type));
+
+        scene::IMesh *mesh;
+        switch (type)
+        {
+        case scene::ESNT_MESH          :
+        case scene::ESNT_WATER_SURFACE :
+        case scene::ESNT_OCTREE        :
+            mesh = ((scene::IMeshSceneNode*)node)->getMesh();
+            break;
+        case scene::ESNT_ANIMATED_MESH :
+            mesh = ((scene::IAnimatedMeshSceneNode*)node)->getMesh();
+            break;
+        default:
+            continue;
+        }
+        node->updateAbsolutePosition();
+        hash = StringUtils::hashData(hash,
+                                 node->getAbsoluteTransformation().pointer(),
+                                 16 * sizeof(f32));
+
+        const io::path &mesh_file = mesh_cache->getMeshName(mesh).getPath();
+        if (!mesh_file.empty())
+        {
+            files.insert(mesh_file.c_str());
+            hash = StringUtils::hashData(hash, mesh_file.c_str(),
+                                         mesh_file.size());
+        }
+        const u32 num_buffers = mesh->getMeshBufferCount();
+        hash = StringUtils::hashData(hash, &num_buffers, sizeof(num_buffers));
+        for (u32 j = 0; j < num_buffers; j++)
+        {
+            const scene::IMeshBuffer *mb = mesh->getMeshBuffer(j);
+            const u32 layout[3] = { (u32)mb->getVertexType(),
+                                    mb->getVertexCount(),
+                                    mb->getIndexCount() };
+            hash = StringUtils::hashData(hash, layout, sizeof(layout));
+        }
+    }   // for i < nodes.size()
+
+    for (std::set<std::string>::const_iterator f = files.begin();
+         f != files.end(); f++)
+    {
+        uint64_t stats[2] = { 0, 0 };
+        file_manager->getFileStats(*f, &stats[0], &stats[1]);
+        hash = StringUtils::hashData(hash, f->c_str(), f->size());
+        hash = StringUtils::hashData(hash, stats, sizeof(stats));
+    }
+    return hash;
+}   // computePhysicsHash
+
+// ----------------------------------------------------------------------------
+/** Returns the name of the physics cache file of this track. The name is
+ *  based on a hash of the track directory, so each track has its own file,
+ *  which is overwritten if the track changes.
+ */
+std::string Track::getPhysicsCacheFileName() const
+{
+    uint64_t hash = StringUtils::hashData(m_root.c_str(), m_root.size());
+    char name[64];
+    snprintf(name, sizeof(name), "track-%016llx.cache",
+             (unsigned long long)hash);
+    return file_manager->getCacheDir() + name;
+}   // getPhysicsCacheFileName
+
+// ----------------------------------------------------------------------------
+/** Loads the triangles, materials and bvhs of the track mesh and the gfx
+ *  effect mesh from a cache file.
+ *  \param filename Name of the cache file.
+ *  \param hash Hash of the current track data.
+ *  \return True if the cache was valid and loaded. If false is returned,
+ *          both meshes are empty.
+ */
+bool Track::loadPhysicsCache(const std::string &filename, uint64_t hash)
+{
+    FILE *fd = fopen(filename.c_str(), "rb");
+    if (!fd) return false;
+
+    uint32_t magic = 0, version = 0;
+    uint64_t file_hash = 0;
+    bool ok = fread(&magic,     sizeof(magic),     1, fd) == 1 &&
+              fread(&version,   sizeof(version),   1, fd) == 1 &&
+              fread(&file_hash, sizeof(file_hash), 1, fd) == 1 &&
+              magic == TRACK_CACHE_MAGIC && version == TRACK_CACHE_VERSION &&
+              file_hash == hash;
+    ok = ok && m_track_mesh->loadCache(fd);
+    ok = ok && m_gfx_effect_mesh->loadCache(fd);
+    fclose(fd);
+
+    if (!ok)
+    {
+        Log::info("track", "Physics cache '%s' is outdated.",
+                  filename.c_str());
+        // The track mesh might have been loaded before the gfx mesh failed
+        delete m_track_mesh;
+        delete m_gfx_effect_mesh;
+        m_track_mesh      = new TriangleMesh(/*can_be_transformed*/false);
+        m_gfx_effect_mesh = new TriangleMesh(/*can_be_transformed*/false);
+    }
+    return ok;
+}   // loadPhysicsCache
+
+// ----------------------------------------------------------------------------
+/** Saves the triangles, materials and bvhs of the track mesh and the gfx
+ *  effect mesh to a cache file. The data is written to a temporary file
+ *  first, so that an interrupted write can not leave a damaged cache behind.
+ *  \param filename Name of the cache file.
+ *  \param hash Hash of the track data, used to detect outdated caches.
+ */
+void Track::savePhysicsCache(const std::string &filename, uint64_t hash) const
+{
+    const std::string tmp = filename + ".part";
+    FILE *fd = fopen(tmp.c_str(), "wb");
+    if (!fd)
+    {
+        Log::warn("track", "Can't write physics cache '%s'.", tmp.c_str());
+        return;
+    }
+    bool ok =
+        fwrite(&TRACK_CACHE_MAGIC,   sizeof(uint32_t), 1, fd) == 1 &&
+        fwrite(&TRACK_CACHE_VERSION, sizeof(uint32_t), 1, fd) == 1 &&
+        fwrite(&hash,                sizeof(hash),     1, fd) == 1 &&
+        m_track_mesh->saveCache(fd) && m_gfx_effect_mesh->saveCache(fd);
+    ok = fclose(fd) == 0 && ok;
+    if (!ok)
+    {
+        Log::warn("track", "Error writing physics cache '%s'.", tmp.c_str());
+        file_manager->removeFile(tmp);
+        return;
+    }
+    // The behaviour of rename is unspecified if the target file should
+    // already exist - so remove it.
+    file_manager->removeFile(filename);
+    if (rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        Log::warn("track", "Can't rename physics cache to '%s'.",
+                  filename.c_str());
+        file_manager->removeFile(tmp);
+    }
+}   // savePhysicsCache
+
 // -----------------------------------------------------------------------------
 
 
@@ -1414,19 +1621,12 @@ bool Track::loadMainTrack(const XMLNode &root)
 
     }   // for i
 
-    // This will (at this stage) only convert the main track model.
+    // The main track is converted into physics together with all other
+    // objects in createPhysicsModel.
     for(unsigned int i=0; i<m_all_nodes.size(); i++)
     {
-        convertTrackToBullet(m_all_nodes[i]);
         uploadNodeVertexBuffer(m_all_nodes[i]);
     }
-
-    if (m_track_mesh == NULL)
-    {
-        Log::fatal("track", "m_track_mesh == NULL, cannot loadMainTrack\n");
-    }
-
-    m_gfx_effect_mesh->createCollisionShape();
     scene_node->setMaterialFlag(video::EMF_LIGHTING, true);
     scene_node->setMaterialFlag(video::EMF_GOURAUD_SHADING, true);
 
@@ -1548,8 +1748,14 @@ void Track::update(int ticks)
     }
     float dt = stk_config->ticks2Time(ticks);
     m_track_object_manager->update(dt);
-    CheckManager::get()->update(dt);
-    ItemManager::get()->update(ticks);
+    {
+        ProfileWorld::SimTimer timer(ProfileWorld::SIM_CHECKS);
+        CheckManager::get()->update(dt);
+    }
+    {
+        ProfileWorld::SimTimer timer(ProfileWorld::SIM_ITEMS);
+        ItemManager::get()->update(ticks);
+    }
 
     // TODO: enable onUpdate scripts if we ever find a compelling use for them
     //Scripting::ScriptEngine* script_engine = World::getWorld()->getScriptEngine();
@@ -37,6 +37,7 @@ using namespace irr;
 
 #include "utils/aligned_array.hpp"
 #include "utils/translation.hpp"
+#include "utils/types.hpp"
 #include "utils/vec3.hpp"
 #include "utils/ptr_vector.hpp"
 
@@ -388,6 +389,10 @@ private:
     void loadArenaGraph(const XMLNode &node);
     btQuaternion getArenaStartRotation(const Vec3& xyz, float heading);
     void convertTrackToBullet(scene::ISceneNode *node);
+    uint64_t computePhysicsHash(const std::vector<scene::ISceneNode*> &nodes);
+    std::string getPhysicsCacheFileName() const;
+    bool loadPhysicsCache(const std::string &filename, uint64_t hash);
+    void savePhysicsCache(const std::string &filename, uint64_t hash) const;
     bool loadMainTrack(const XMLNode &node);
     void loadMinimap();
     void createWater(const XMLNode &node);
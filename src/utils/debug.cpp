@@ -36,6 +36,7 @@
 #include "graphics/sp/sp_uniform_assigner.hpp"
 #include "guiengine/widgets/label_widget.hpp"
 #include "guiengine/widgets/text_box_widget.hpp"
+#include "io/file_manager.hpp"
 #include "items/powerup_manager.hpp"
 #include "items/attachment.hpp"
 #include "karts/abstract_kart.hpp"
@@ -85,6 +86,7 @@ enum DebugMenuCommand
     DEBUG_GRAPHICS_BULLET_2,
     DEBUG_PROFILER,
     DEBUG_PROFILER_WRITE_REPORT,
+    DEBUG_PROFILER_TRACE,
     DEBUG_FONT_DUMP_GLYPH_PAGE,
     DEBUG_FONT_RELOAD,
     DEBUG_SP_RESET,
@@ -458,6 +460,13 @@ bool handleContextMenuAction(s32 cmd_id)
     case DEBUG_PROFILER_WRITE_REPORT:
         profiler.writeToFile();
         break;
+    case DEBUG_PROFILER_TRACE:
+        if (profiler.isTracing())
+            profiler.stopTrace();
+        else
+            profiler.startTrace(file_manager->getUserConfigFile(
+                                  file_manager->getStdoutName()) + ".trace.json");
+        break;
     case DEBUG_THROTTLE_FPS:
         main_loop->setThrottleFPS(false);
         break;
@@ -964,8 +973,13 @@ bool onEvent(const SEvent &event)
 
             mnu->addItem(L"Profiler", DEBUG_PROFILER);
             if (UserConfigParams::m_profiler_enabled)
+            {
                 mnu->addItem(L"Save profiler report",
                              DEBUG_PROFILER_WRITE_REPORT);
+                mnu->addItem(profiler.isTracing() ? L"Stop profiler trace"
+                                                  : L"Start profiler trace",
+                             DEBUG_PROFILER_TRACE);
+            }
             mnu->addItem(L"Do not limit FPS", DEBUG_THROTTLE_FPS);
             mnu->addItem(L"Toggle FPS", DEBUG_FPS);
             mnu->addItem(L"Save replay", DEBUG_SAVE_REPLAY);
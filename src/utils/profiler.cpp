@@ -26,6 +26,7 @@
 #include "graphics/irr_driver.hpp"
 #include "guiengine/scalable_font.hpp"
 #include "io/file_manager.hpp"
+#include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/vs.hpp"
 
@@ -95,11 +96,16 @@ Profiler::Profiler()
     m_threads_used = 1;
 
     m_gpu_times.resize(Q_LAST*m_max_frames);
+
+    m_trace_file  = NULL;
+    m_trace_start = 0;
+    m_trace_frame = 0;
 }   // Profile
 
 //-----------------------------------------------------------------------------
 Profiler::~Profiler()
 {
+    stopTrace();
 }   // ~Profiler
 
 //-----------------------------------------------------------------------------
@@ -145,7 +151,8 @@ void Profiler::pushCPUMarker(const char* name, const video::SColor& colour)
 
     ThreadData &td = m_all_threads_data[thread_id];
     AllEventData::iterator i = td.m_all_event_data.find(name);
-    double  start = getTimeMilliseconds() - m_time_last_sync;
+    double  now   = getTimeMilliseconds();
+    double  start = now - m_time_last_sync;
     if (i != td.m_all_event_data.end())
     {
         i->second.setStart(m_current_frame, start, (int)td.m_event_stack.size());
@@ -162,6 +169,7 @@ void Profiler::pushCPUMarker(const char* name, const video::SColor& colour)
         td.m_ordered_headings.push_back(name);
     }
     td.m_event_stack.push_back(name);
+    td.m_start_stack.push_back(now);
     m_lock.unlock();
 }   // pushCPUMarker
 
@@ -193,7 +201,20 @@ void Profiler::popCPUMarker()
     const std::string &name = td.m_event_stack.back();
     td.m_all_event_data[name].setEnd(m_current_frame, now - m_time_last_sync);
 
+    // Events are only written to the trace once they are complete, so an
+    // event that spans a frame boundary is not split.
+    if (m_trace_file)
+    {
+        TraceEvent te;
+        te.m_name      = name;
+        te.m_thread_id = thread_id;
+        te.m_start     = td.m_start_stack.back();
+        te.m_end       = now;
+        m_trace_events.push_back(te);
+    }
+
     td.m_event_stack.pop_back();
+    td.m_start_stack.pop_back();
     m_lock.unlock();
 }   // popCPUMarker
 
@@ -229,6 +250,9 @@ void Profiler::synchronizeFrame()
     double now = getTimeMilliseconds();
 
     m_lock.lock();
+    if (m_trace_file)
+        writeTraceFrame(now);
+
     // Set index to next frame
     int next_frame = m_current_frame+1;
     if (next_frame >= m_max_frames)
@@ -582,3 +606,144 @@ void Profiler::writeToFile()
     m_lock.unlock();
 
 }   // writeFile
+
+//-----------------------------------------------------------------------------
+/** Starts recording all profiling events in Chrome's trace event format
+ *  (which can be loaded e.g. with chrome://tracing or other trace viewers).
+ *  Contrary to the circular buffer used for the on-screen display, each
+ *  single event is recorded, and the data is written to the file once per
+ *  frame, so a whole session can be recorded. This also works with no
+ *  graphics, e.g. on a server. The profiler is enabled if necessary.
+ *  \param filename Name of the file to write the trace to.
+ */
+void Profiler::startTrace(const std::string &filename)
+{
+    stopTrace();
+
+    m_lock.lock();
+    m_trace_file = fopen(filename.c_str(), "w");
+    if (!m_trace_file)
+    {
+        m_lock.unlock();
+        Log::error("Profiler", "Can't open trace file '%s'.",
+                   filename.c_str());
+        return;
+    }
+    m_trace_start = getTimeMilliseconds();
+    m_trace_frame = 0;
+    m_trace_events.clear();
+
+    // The array format allows the closing ']' to be missing, so a trace
+    // is still usable if the program crashes. Process 0 contains the CPU
+    // threads, process 1 the frames, and process 2 the GPU phases.
+    fprintf(m_trace_file, "[{\"name\":\"process_name\",\"ph\":\"M\","
+                          "\"pid\":0,\"args\":{\"name\":\"CPU\"}}");
+    writeTraceEvent("process_name", "M", 1, 0, 0, -1, "\"name\":\"Frames\"");
+    writeTraceEvent("process_name", "M", 2, 0, 0, -1, "\"name\":\"GPU\"");
+    m_lock.unlock();
+
+    Log::info("Profiler", "Writing trace to '%s'.", filename.c_str());
+    if (!UserConfigParams::m_profiler_enabled)
+        toggleStatus();
+}   // startTrace
+
+//-----------------------------------------------------------------------------
+/** Stops recording a trace, and closes the trace file. Events that have
+ *  not been written to the file (i.e. from the current frame) are lost.
+ */
+void Profiler::stopTrace()
+{
+    m_lock.lock();
+    if (!m_trace_file)
+    {
+        m_lock.unlock();
+        return;
+    }
+    for (int i = 0; i < m_threads_used; i++)
+    {
+        std::string args = "\"name\":\"" +
+                   (i == 0 ? std::string("Main")
+                           : "Thread " + StringUtils::toString(i)) + "\"";
+        writeTraceEvent("thread_name", "M", 0, i, 0, -1, args);
+    }
+    fprintf(m_trace_file, "]\n");
+    fclose(m_trace_file);
+    m_trace_file = NULL;
+    m_trace_events.clear();
+    m_lock.unlock();
+}   // stopTrace
+
+//-----------------------------------------------------------------------------
+/** Writes one event to the trace file. Must be called with the lock held.
+ *  \param name Name of the event.
+ *  \param phase Chrome trace phase ("X" for a complete event, "C" for a
+ *         counter, "M" for metadata).
+ *  \param pid, tid Process and thread id to show this event for.
+ *  \param start Start time relative to the start of the trace in ms.
+ *  \param duration Duration in ms, or a negative value if the event has
+ *         no duration.
+ *  \param args Optional content of the args object.
+ */
+void Profiler::writeTraceEvent(const char *name, const char *phase, int pid,
+                               int tid, double start, double duration,
+                               const std::string &args)
+{
+    std::string escaped;
+    for (const char *c = name; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            escaped += '\\';
+        escaped += *c;
+    }
+    fprintf(m_trace_file, ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"pid\":%d,"
+                          "\"tid\":%d,\"ts\":%.3f", escaped.c_str(), phase,
+            pid, tid, start*1000.0);
+    if (duration >= 0)
+        fprintf(m_trace_file, ",\"dur\":%.3f", duration*1000.0);
+    if (!args.empty())
+        fprintf(m_trace_file, ",\"args\":{%s}", args.c_str());
+    fprintf(m_trace_file, "}");
+}   // writeTraceEvent
+
+//-----------------------------------------------------------------------------
+/** Writes all events completed in the current frame to the trace, followed
+ *  by the frame itself and the GPU times. Must be called with the lock held.
+ *  \param now The current time, i.e. the end of this frame.
+ */
+void Profiler::writeTraceFrame(double now)
+{
+    for (unsigned int i = 0; i < m_trace_events.size(); i++)
+    {
+        const TraceEvent &te = m_trace_events[i];
+        writeTraceEvent(te.m_name.c_str(), "X", 0, te.m_thread_id,
+                        te.m_start - m_trace_start, te.m_end - te.m_start);
+    }
+    m_trace_events.clear();
+
+    double frame_start = std::max(m_time_last_sync, m_trace_start)
+                       - m_trace_start;
+    double frame_end   = now - m_trace_start;
+    std::string name = "Frame " + StringUtils::toString(m_trace_frame);
+    writeTraceEvent(name.c_str(), "X", 1, 0, frame_start,
+                    frame_end - frame_start);
+    writeTraceEvent("Frame time", "C", 1, 0, frame_end, -1,
+                    "\"ms\":" + StringUtils::toString(frame_end-frame_start));
+    m_trace_frame++;
+
+#ifndef SERVER_ONLY
+    // The GPU only reports durations (of an earlier frame, since the query
+    // results are only available later), so show the phases one after the
+    // other starting at the beginning of the frame. Without graphics no
+    // query is ever started, and all times are 0.
+    double gpu_start = frame_start;
+    for (unsigned i = 0; i < Q_LAST; i++)
+    {
+        unsigned int us = irr_driver->getGPUTimer(i).elapsedTimeus();
+        if (us == 0) continue;
+        writeTraceEvent(irr_driver->getGPUQueryPhaseName(i), "X", 2, 0,
+                        gpu_start, us/1000.0);
+        gpu_start += us/1000.0;
+    }
+#endif
+    fflush(m_trace_file);
+}   // writeTraceFrame
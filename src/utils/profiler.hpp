@@ -29,6 +29,7 @@
 #include <map>
 #include <ostream>
 #include <stack>
+#include <stdio.h>
 #include <streambuf>
 #include <string>
 #include <vector>
@@ -215,9 +216,23 @@ private:
         *  bar graphs are drawn, which results in the proper nesting of events.*/
         std::vector<std::string> m_ordered_headings;
 
+        /** Absolute start time of each event on the event stack, used
+         *  for the trace export. */
+        std::vector<double> m_start_stack;
+
         AllEventData m_all_event_data;
     };   // class ThreadData
 
+    // ========================================================================
+    /** One complete event recorded for the trace export. */
+    struct TraceEvent
+    {
+        std::string m_name;
+        int         m_thread_id;
+        double      m_start;
+        double      m_end;
+    };   // TraceEvent
+
     // ========================================================================
 
     /** Data structure containing all currently buffered markers. The index
@@ -272,9 +287,27 @@ private:
 
     FreezeState     m_freeze_state;
 
+    /** File to which the trace is written, NULL if no trace is recorded. */
+    FILE *m_trace_file;
+
+    /** Time at which the trace was started, all trace times are relative
+     *  to this time. */
+    double m_trace_start;
+
+    /** Events completed since the last frame synchronisation, which are
+     *  written to the trace file in synchronizeFrame(). */
+    std::vector<TraceEvent> m_trace_events;
+
+    /** Number of frames written to the trace. */
+    int m_trace_frame;
+
 private:
     int  getThreadID();
     void drawBackground();
+    void writeTraceEvent(const char *name, const char *phase, int pid,
+                         int tid, double start, double duration,
+                         const std::string &args = "");
+    void writeTraceFrame(double now);
 
 public:
              Profiler();
@@ -288,6 +321,12 @@ public:
     void     draw();
     void     onClick(const core::vector2di& mouse_pos);
     void     writeToFile();
+    void     startTrace(const std::string &filename);
+    void     stopTrace();
+
+    // ------------------------------------------------------------------------
+    /** Returns true if a trace is currently being recorded. */
+    bool isTracing() const { return m_trace_file != NULL; }
 
     // ------------------------------------------------------------------------
     bool isFrozen() const { return m_freeze_state == FROZEN; }
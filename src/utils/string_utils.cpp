@@ -805,6 +805,31 @@ namespace StringUtils
         return destination;
     } //findAndReplace
 
+    // ------------------------------------------------------------------------
+    /** Updates a 64-bit FNV-1a hash with the given data. This is not a
+     *  cryptographic hash, it is only used to detect outdated cache files.
+     *  \param hash The hash of the previous data.
+     *  \param data Pointer to the data to add.
+     *  \param size Number of bytes to add.
+     */
+    uint64_t hashData(uint64_t hash, const void *data, size_t size)
+    {
+        const uint8_t *p = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= p[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }   // hashData
+
+    // ------------------------------------------------------------------------
+    /** Returns the 64-bit FNV-1a hash of the given data. */
+    uint64_t hashData(const void *data, size_t size)
+    {
+        return hashData(0xcbf29ce484222325ULL, data, size);
+    }   // hashData
+
 } // namespace StringUtils
 
 
@@ -31,6 +31,8 @@
 namespace StringUtils
 {
     int           versionToInt(const std::string &s);
+    uint64_t      hashData(uint64_t hash, const void *data, size_t size);
+    uint64_t      hashData(const void *data, size_t size);
 
     bool hasSuffix(const std::string& lhs, const std::string &rhs);
     bool startsWith(const std::string& str, const std::string& prefix);
@@ -66,6 +66,34 @@ double StkTime::getRealTime(long startAt)
     return m_timer->getRealTime()/1000.0;
 }   // getTimeSinceEpoch
 
+// ----------------------------------------------------------------------------
+/** Returns the CPU time in seconds used by the calling thread so far. Unlike
+ *  clock() this does not include the time of other threads of the process
+ *  (e.g. the network threads), so the difference of two calls in the same
+ *  thread is the CPU cost of the work done in between by this thread.
+ */
+double StkTime::getThreadCPUTime()
+{
+#ifdef WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return 0.0;
+    // Both times are in 100 ns units
+    uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) |
+                 kernel.dwLowDateTime;
+    uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (k + u) * 1.0e-7;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0.0;
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+#else
+    // No per-thread clock available, use the time of the whole process
+    return double(clock()) / CLOCKS_PER_SEC;
+#endif
+}   // getThreadCPUTime
+
 // ----------------------------------------------------------------------------
 /** Returns the current date.
  *  \param day Day (1 - 31).
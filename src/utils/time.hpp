@@ -90,6 +90,8 @@ public:
      *  The value is a double precision floating point value in seconds.
      */
     static double getRealTime(long startAt=0);
+    // ------------------------------------------------------------------------
+    static double getThreadCPUTime();
 
     // ------------------------------------------------------------------------
     /**
@@ -0,0 +1,118 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/worker_pool.hpp"
+
+// ----------------------------------------------------------------------------
+/** Starts the worker threads.
+ *  \param num_threads Number of threads working on a job, including the
+ *         thread calling run(). So 1 means that no threads are started.
+ */
+WorkerPool::WorkerPool(unsigned int num_threads)
+{
+    m_job          = NULL;
+    m_generation   = 0;
+    m_busy_workers = 0;
+    m_count        = 0;
+    m_next.store(0);
+    for (unsigned int i = 1; i < num_threads; i++)
+        m_threads.push_back(std::thread(std::bind(&WorkerPool::work, this)));
+}   // WorkerPool
+
+// ----------------------------------------------------------------------------
+/** Stops all worker threads. */
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = NULL;
+        m_generation++;
+    }
+    m_job_cv.notify_all();
+    for (unsigned int i = 0; i < m_threads.size(); i++)
+        m_threads[i].join();
+}   // ~WorkerPool
+
+// ----------------------------------------------------------------------------
+/** Calls the job for all indices from 0 to count-1, and returns when all
+ *  are done. Must only be called from one thread at a time.
+ *  \param count Number of indices.
+ *  \param job The function to call for each index.
+ */
+void WorkerPool::run(unsigned int count,
+                     const std::function<void(unsigned int)> &job)
+{
+    if (m_threads.empty() || count < 2)
+    {
+        for (unsigned int i = 0; i < count; i++)
+            job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job          = &job;
+        m_count        = count;
+        m_next.store(0);
+        m_busy_workers = (unsigned int)m_threads.size();
+        m_generation++;
+    }
+    m_job_cv.notify_all();
+    runJob(job);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this]() { return m_busy_workers == 0; });
+}   // run
+
+// ----------------------------------------------------------------------------
+/** Processes indices of a job until none are left. */
+void WorkerPool::runJob(const std::function<void(unsigned int)> &job)
+{
+    while (true)
+    {
+        unsigned int i = m_next.fetch_add(1);
+        if (i >= m_count) break;
+        job(i);
+    }
+}   // runJob
+
+// ----------------------------------------------------------------------------
+/** The main loop of a worker thread: waits for a job, works on it, and
+ *  exits when the pool is deleted. */
+void WorkerPool::work()
+{
+    unsigned int generation = 0;
+    while (true)
+    {
+        const std::function<void(unsigned int)> *job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_job_cv.wait(lock, [this, generation]()
+                                { return m_generation != generation; });
+            generation = m_generation;
+            job        = m_job;
+        }
+        if (!job) return;
+
+        runJob(*job);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy_workers == 0)
+            m_done_cv.notify_one();
+    }
+}   // work
@@ -0,0 +1,85 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_WORKER_POOL_HPP
+#define HEADER_WORKER_POOL_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** \class WorkerPool
+ *  \brief A fixed set of threads which run a job for a range of indices.
+ *  The threads are kept alive between jobs, so that short jobs (e.g. some
+ *  work for every kart in each time step) do not pay for creating threads.
+ *  The calling thread works on the job, too, and run() only returns once all
+ *  indices are done. The order in which indices are processed is undefined,
+ *  so a job must only write data that belongs to its index.
+ *  \ingroup utils
+ */
+class WorkerPool : public NoCopy
+{
+private:
+    /** The worker threads. */
+    std::vector<std::thread> m_threads;
+
+    /** Protects m_job, m_generation and m_busy_workers. */
+    std::mutex m_mutex;
+
+    /** Signals the workers that a new job is available or that they
+     *  should exit. */
+    std::condition_variable m_job_cv;
+
+    /** Signals run() that all workers are done. */
+    std::condition_variable m_done_cv;
+
+    /** The current job, NULL if the workers should exit. */
+    const std::function<void(unsigned int)> *m_job;
+
+    /** Increased for each job, so a worker knows when a new job starts. */
+    unsigned int m_generation;
+
+    /** Number of workers still working on the current job. */
+    unsigned int m_busy_workers;
+
+    /** Number of indices of the current job. */
+    unsigned int m_count;
+
+    /** The next index to process. */
+    std::atomic<unsigned int> m_next;
+
+    void work();
+    void runJob(const std::function<void(unsigned int)> &job);
+
+public:
+         WorkerPool(unsigned int num_threads);
+        ~WorkerPool();
+    void run(unsigned int count, const std::function<void(unsigned int)> &job);
+    // ------------------------------------------------------------------------
+    /** Returns the number of threads working on a job, including the
+     *  calling thread. */
+    unsigned int getNumThreads() const
+                                  { return (unsigned int)m_threads.size() + 1; }
+};   // WorkerPool
+
+#endif
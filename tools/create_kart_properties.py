@@ -141,6 +141,20 @@ def joinSubName(group, member, titleCase):
     else:
         return "_".join(words)
 
+# Types of the members in FlatCharacteristic and of the KartProperties getters
+flatTypes = {
+    "float":              "float",
+    "bool":               "bool",
+    "std::vector<float>": "FloatArray",
+    "InterpolationArray": "Interpolation",
+}
+kpTypes = {
+    "float":              "float",
+    "bool":               "bool",
+    "std::vector<float>": "const FlatCharacteristic::FloatArray&",
+    "InterpolationArray": "const FlatCharacteristic::Interpolation&",
+}
+
 # Functions to generate code
 
 def createEnum(groups):
@@ -188,25 +202,26 @@ def createKpDefs(groups):
         for m in g.members:
             nameTitle = joinSubName(g, m, True)
             nameUnderscore = joinSubName(g, m, False)
-            typeC = m.typeC
+            typeC = kpTypes[m.typeC]
 
-            print("    {0} get{1}() const;".
+            print("""    {0} get{1}() const
+        {{ return m_flat_characteristic.m_{2}; }}""".
                 format(typeC, nameTitle, nameUnderscore))
 
-def createKpGetter(groups):
+def createFlatDefs(groups):
     for g in groups:
+        print()
+        print("    // {0}".format(g.getBaseName().title()))
         for m in g.members:
-            nameTitle = joinSubName(g, m, True)
-            nameUnderscore = joinSubName(g, m, False)
-            typeC = m.typeC
-            result = "result"
+            print("    {0:13} m_{1};".
+                format(flatTypes[m.typeC], joinSubName(g, m, False)))
 
-            print("""// ----------------------------------------------------------------------------
-{1} KartProperties::get{0}() const
-{{
-    return m_cached_characteristic->get{0}();
-}}  // get{0}
-""".format(nameTitle, typeC))
+def createFlatLoad(groups):
+    for g in groups:
+        for m in g.members:
+            nameUnderscore = joinSubName(g, m, False)
+            print("    load(c, AbstractCharacteristic::{0},\n         &m_{1});".
+                format(nameUnderscore.upper(), nameUnderscore))
 
 def createGetType(groups):
     for g in groups:
@@ -245,7 +260,8 @@ functions = {
     "getType":  (createGetType,  "Implement the getType function",                         "karts/abstract_characteristic.cpp"),
     "getName":  (createGetName,  "Implement the getName function",                         "karts/abstract_characteristic.cpp"),
     "kpdefs":   (createKpDefs,   "Create the header function definitions for the getters", "karts/kart_properties.hpp"),
-    "kpgetter": (createKpGetter, "Implement the getters",                                  "karts/kart_properties.cpp"),
+    "flatdefs": (createFlatDefs, "Create the members of the flat characteristic",          "karts/flat_characteristic.hpp"),
+    "flatload": (createFlatLoad, "Code to fill the flat characteristic",                   "karts/flat_characteristic.cpp"),
     "loadXml":  (createLoadXml,  "Code to load the characteristics from an xml file",      "karts/xml_characteristic.cpp"),
 }
 